@@ -75,7 +75,14 @@ struct SpotLight {
         shader->set_float(name + ".quadratic", quadratic);
         shader->set_float(name + ".inner_cut_off", inner_cut_off);
         shader->set_float(name + ".outer_cut_off", outer_cut_off);
-        shader->set_int(name + ".lamp_on", lamp_on);
+    }
+
+    /**
+     * @brief the spotlight is compiled into the shaders, so a shader without it is used while the lamp is off
+     * @param features other features of the variant
+     */
+    const engine::resources::Shader *select(const engine::resources::Shader *shader, uint32_t features = 0) const {
+        return shader->variant(features | (lamp_on ? shader->feature("SPOTLIGHT") : 0));
     }
 };
 
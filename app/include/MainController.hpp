@@ -6,7 +6,13 @@
 #define MAINCONTROLLER_HPP
 
 #include <engine/core/Controller.hpp>
+#include <engine/core/WorldController.hpp>
+#include <engine/graphics/OcclusionCuller.hpp>
 #include <engine/platform/PlatformEventObserver.hpp>
+#include <engine/resources/InstanceCuller.hpp>
+#include <engine/resources/MultiDraw.hpp>
+#include <engine/util/SceneBvh.hpp>
+#include <engine/util/TransformStore.hpp>
 #include <Lights.hpp>
 #include <Target.hpp>
 
@@ -49,6 +55,7 @@ class MainController final : public engine::core::Controller {
     void draw_plane();
 
     unsigned m_vao_plane{0};
+    engine::graphics::OccluderMesh m_plane_occluder{};
     bool m_cursor_enable{true};
 
     DirectionalLight m_dirlight{};
@@ -63,26 +70,52 @@ class MainController final : public engine::core::Controller {
 
     int m_amount_tree{};
     glm::mat4 *m_model_tree{};
+    engine::resources::InstanceCuller m_tree_culler{};
+    std::vector<glm::mat4> m_visible_trees{};
     void set_instanced_tree();
     void draw_instanced_tree();
 
-    std::vector<Target> m_targets{};
+    engine::util::TransformStore m_transforms{};
+    uint32_t m_cabin_transform{engine::util::TransformStore::NONE};
+    uint32_t m_rifle_transform{engine::util::TransformStore::NONE};
+    void set_transforms();
+
+    std::vector<engine::core::Entity> m_targets{};
+    Target &target(uint32_t index);
     void set_targets();
     void draw_targets();
     void awake_targets();
-    void update_targets();
-    void create_boundingbox_targets();
+    static void update_targets(engine::core::World &world);
     void check_boundingbox_intersects();
 
+    enum class SceneObject : uint32_t { Target, Tree, Cabin };
+    engine::util::SceneBvh m_scene{};
+    std::vector<uint32_t> m_tree_proxies{};
+    uint32_t m_cabin_proxy{engine::util::SceneBvh::NONE};
+    std::vector<engine::util::RayHit> m_ray_hits{};
+    std::vector<uint32_t> m_visible_objects{};
+    void set_scene();
+    void update_scene();
+    void move_scene_object(uint32_t proxy, const engine::util::Aabb &box);
+    static uint64_t scene_object(SceneObject type, uint32_t index);
+    static SceneObject scene_object_type(uint64_t object);
+    static uint32_t scene_object_index(uint64_t object);
+
 
     void draw_tree();
+    engine::resources::MultiDraw m_static_draws{};
     void draw_cabin();
+    void set_cabin_uniforms(const engine::resources::Shader *shader);
     void draw_rifle();
     void draw_skybox();
 
     unsigned m_vao_crosshair{};
     void set_crosshair();
     void draw_crosshair();
+
+    void warm_up_shaders();
+
+    void submit_occluders();
 };
 }// app
 
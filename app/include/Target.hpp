@@ -5,6 +5,8 @@
 #ifndef TARGET_HPP
 #define TARGET_HPP
 #include <engine/resources/Model.hpp>
+#include <engine/util/SceneBvh.hpp>
+#include <engine/util/TransformStore.hpp>
 #include <Lights.hpp>
 
 
@@ -18,25 +20,26 @@ public:
     static constexpr float SCALE = 0.11f;
 
     bool m_active{false};
-    glm::vec3 box_min{};
-    glm::vec3 box_max{};
+    uint32_t proxy{engine::util::SceneBvh::NONE};
 
-    Target(engine::resources::Model *model, const glm::vec3 &position);
-    void draw(const engine::resources::Shader *shader, const DirectionalLight &dirlight, const SpotLight &spotlight);
+    Target(engine::resources::Model *model, const glm::vec3 &position, engine::util::TransformStore *transforms);
+    void draw(const engine::resources::Shader *shader);
 
     void put_up(float dt);
     void put_down(float dt);
     void update(float dt);
 
-    void calculate_bounding_box();
-
-    bool check_boundingbox_intersect(const glm::vec3 &raycast_origin, const glm::vec3 &raycast_dir);
+    const glm::mat4 &model_matrix() const;
+    engine::util::Aabb calculate_bounding_box() const;
+    bool hit(const glm::vec3 &origin, const glm::vec3 &dir) const;
 
 private:
     engine::resources::Model *m_model;
+    engine::util::TransformStore *m_transforms;
+    uint32_t m_transform;
     float m_angle{ANGLE_LOWER};
-    float m_scale{SCALE};
-    glm::vec3 m_position{};
+
+    glm::quat rotation() const;
 };
 }// app
 
@@ -0,0 +1,18 @@
+// Per-object data of a draw, see engine::resources::InstanceData. Included into the vertex shader with:
+// #include "include/instance.glsl"
+// Drawn alone, the object sets the uniforms; the INSTANCED variant, which GraphicsController::queue_draw merges,
+// reads the same names from the instance attributes, so the rest of the shader is the same for both.
+
+#if INSTANCED
+layout (location = 3) in mat4 aModel;
+layout (location = 8) in mat3 aNormalMatrix;
+layout (location = 11) in vec4 aParams;
+
+#define model aModel
+#define invNormal aNormalMatrix
+#define params aParams
+#else
+uniform mat4 model;
+uniform mat3 invNormal;
+uniform vec4 params;
+#endif
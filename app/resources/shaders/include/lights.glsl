@@ -0,0 +1,80 @@
+// Light casters shared by the lit shaders. Included into the fragment shader with:
+// #include "include/lights.glsl"
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float inner_cut_off;
+    float outer_cut_off;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Surface sampled once per fragment, so the textures aren't fetched again for every light.
+struct Material {
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+vec3 CalculateLight(vec3 ambient, vec3 diffuse, vec3 specular, Material material, vec3 light_dir, vec3 normal, vec3 view_dir) {
+    float diff = max(dot(light_dir, normal), 0.0f);
+    vec3 reflect_dir = reflect(-light_dir, normal);
+    float spec = pow(max(dot(view_dir, reflect_dir), 0.0f), material.shininess);
+
+    return ambient * material.diffuse + diffuse * diff * material.diffuse + specular * spec * material.specular;
+}
+
+vec3 CalculateDirLight(DirLight light, Material material, vec3 normal, vec3 view_dir) {
+    vec3 light_dir = normalize(-light.direction);
+    return CalculateLight(light.ambient, light.diffuse, light.specular, material, light_dir, normal, view_dir);
+}
+
+vec3 CalculatePointLight(PointLight light, Material material, vec3 normal, vec3 frag_pos, vec3 view_dir) {
+    vec3 light_dir = normalize(light.position - frag_pos);
+
+    float distance = length(light.position - frag_pos);
+    float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    return CalculateLight(light.ambient, light.diffuse, light.specular, material, light_dir, normal, view_dir) * attenuation;
+}
+
+vec3 CalculateSpotLight(SpotLight light, Material material, vec3 normal, vec3 frag_pos, vec3 view_dir) {
+    vec3 light_dir = normalize(light.position - frag_pos);
+
+    float distance = length(light.position - frag_pos);
+    float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    float theta = dot(-light_dir, normalize(light.direction));
+    float epsilon = light.inner_cut_off - light.outer_cut_off;
+    float intensity = clamp((theta - light.outer_cut_off) / epsilon, 0.0, 1.0);
+
+    return CalculateLight(light.ambient, light.diffuse, light.specular, material, light_dir, normal, view_dir) * attenuation * intensity;
+}
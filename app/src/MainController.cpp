@@ -8,6 +8,7 @@
 #include "engine/resources/ResourcesController.hpp"
 
 #include <MainController.hpp>
+#include <array>
 #include <spdlog/spdlog.h>
 
 namespace app {
@@ -27,10 +28,40 @@ void MainController::initialize() {
     engine::core::Controller::get<engine::graphics::GraphicsController>()->camera()->Position = glm::vec3(0.0f, 0.0f, 5.0f);
     set_instanced_tree();
     set_targets();
+    set_transforms();
+    set_scene();
     set_crosshair();
     set_dirlight();
     set_spotlight();
     set_rifle_dirlight();
+    warm_up_shaders();
+}
+
+void MainController::warm_up_shaders() {
+    auto graphics = engine::core::Controller::get<engine::graphics::GraphicsController>();
+    auto resources = engine::core::Controller::get<engine::resources::ResourcesController>();
+    // The lit shaders are drawn with and without the spotlight, see SpotLight::select.
+    auto variants = [resources](const std::string &name) {
+        const engine::resources::Shader *shader = resources->shader(name);
+        return std::array{shader, shader->variant(shader->feature("SPOTLIGHT"))};
+    };
+
+    // The trees are drawn instanced, so their layout includes the instance matrices.
+    auto tree = resources->model("tree");
+    tree->set_instanced_draw(m_model_tree, m_amount_tree);
+    for (auto shader: variants("tree")) { graphics->register_warm_up(shader, tree); }
+    for (auto shader: variants("cabin")) { graphics->register_warm_up(shader, resources->model("cabin1")); }
+    // The targets are drawn instanced as well, see MainController::draw_targets.
+    auto target = resources->model("target");
+    const engine::resources::InstanceData identity{};
+    target->set_instanced_draw(&identity, 1);
+    auto target_shader = resources->shader("target");
+    for (auto shader: variants("target")) { graphics->register_warm_up(target_shader->variant(shader->enabled_features() | target_shader->feature("INSTANCED")), target); }
+    for (auto shader: variants("plane")) { graphics->register_warm_up(shader, m_vao_plane, "plane"); }
+    graphics->register_warm_up(resources->shader("item"), resources->model("ak_47"));
+    graphics->register_warm_up(resources->shader("skybox"), resources->skybox("skybox_night")->vao(), "skybox");
+    graphics->register_warm_up(resources->shader("crosshair"), m_vao_crosshair, "crosshair");
+    graphics->warm_up();
 }
 
 void MainController::poll_events() {
@@ -42,7 +73,6 @@ void MainController::poll_events() {
 
     if (platform->key(engine::platform::KEY_P).state() == engine::platform::Key::State::JustPressed) {
         awake_targets();
-        create_boundingbox_targets();
     }
 }
 
@@ -58,7 +88,9 @@ void MainController::update() {
     update_jump();
     update_spotlight();
     update_raycast();
-    update_targets();
+    // The targets are raised and lowered by the "targets" system of the WorldController, which runs before this.
+    m_transforms.update();
+    update_scene();
     check_boundingbox_intersects();
 }
 
@@ -174,6 +206,7 @@ void MainController::update_spotlight() {
 void MainController::begin_draw() { engine::graphics::OpenGL::clear_buffers(); }
 
 void MainController::draw() {
+    submit_occluders();
     draw_instanced_tree();
     draw_plane();
     draw_cabin();
@@ -186,34 +219,104 @@ void MainController::draw() {
 void MainController::end_draw() { engine::core::Controller::get<engine::platform::PlatformController>()->swap_buffers(); }
 
 
-void MainController::terminate() { delete m_model_tree; }
+void MainController::terminate() {
+    m_tree_culler.destroy();
+    delete m_model_tree;
+}
 
 
 void MainController::set_targets() {
     auto model = engine::core::Controller::get<engine::resources::ResourcesController>()->model("target");
-    m_targets.emplace_back(model, glm::vec3(-0.2f, -0.5f, 0.3f));
-    m_targets.emplace_back(model, glm::vec3(2.0f, -0.5f, 1.2f));
-    m_targets.emplace_back(model, glm::vec3(0.6f, -0.5f, 2.0f));
-    m_targets.emplace_back(model, glm::vec3(-1.2f, -0.5f, -1.0f));
-    m_targets.emplace_back(model, glm::vec3(1.3f, -0.5f, -1.5f));
+    auto world_controller = engine::core::Controller::get<engine::core::WorldController>();
+    auto world = world_controller->world();
+    m_targets.push_back(world->create(Target(model, glm::vec3(-0.2f, -0.5f, 0.3f), &m_transforms)));
+    m_targets.push_back(world->create(Target(model, glm::vec3(2.0f, -0.5f, 1.2f), &m_transforms)));
+    m_targets.push_back(world->create(Target(model, glm::vec3(0.6f, -0.5f, 2.0f), &m_transforms)));
+    m_targets.push_back(world->create(Target(model, glm::vec3(-1.2f, -0.5f, -1.0f), &m_transforms)));
+    m_targets.push_back(world->create(Target(model, glm::vec3(1.3f, -0.5f, -1.5f), &m_transforms)));
+    world_controller->add_system("targets", update_targets);
+}
+
+Target &MainController::target(uint32_t index) { return engine::core::Controller::get<engine::core::WorldController>()->world()->get<Target>(m_targets[index]); }
+
+void MainController::set_transforms() {
+    m_cabin_transform = m_transforms.create(glm::vec3(-3.0f, -0.5f, 1.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.2f));
+    // The rifle is placed in view space, so it never moves either.
+    glm::quat rifle_rotation = glm::angleAxis(glm::radians(98.5f), glm::vec3(0.0f, 1.0f, 0.0f)) * glm::angleAxis(glm::radians(-3.0f), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::angleAxis(glm::radians(3.3f), glm::vec3(0.0f, 0.0f, 1.0f));
+    m_rifle_transform = m_transforms.create(glm::vec3(0.3f, -0.24f, -0.875f), rifle_rotation, glm::vec3(0.7f));
+    m_transforms.update();
 }
 
 void MainController::draw_targets() {
-    auto shader = engine::core::Controller::get<engine::resources::ResourcesController>()->shader("target");
-    for (auto &target: m_targets) { target.draw(shader, m_dirlight, m_spotlight); }
+    auto base = engine::core::Controller::get<engine::resources::ResourcesController>()->shader("target");
+    auto shader = m_spotlight.select(base, base->feature("INSTANCED"));
+    auto graphics = engine::core::Controller::get<engine::graphics::GraphicsController>();
+
+    shader->use();
+    shader->set_mat4("projection", graphics->projection_matrix());
+    shader->set_mat4("view", graphics->camera()->view_matrix());
+    shader->set_float("shininess", 32.0f);
+    shader->set_vec3("viewPos", graphics->camera()->Position);
+    m_dirlight.apply(shader, "dirlight");
+    m_spotlight.apply(shader, "spotlight");
+
+    m_visible_objects.clear();
+    m_scene.query_frustum(graphics->projection_matrix() * graphics->camera()->view_matrix(), m_visible_objects);
+    for (auto proxy: m_visible_objects) {
+        auto object = m_scene.user_data(proxy);
+        if (scene_object_type(object) == SceneObject::Target) { target(scene_object_index(object)).draw(shader); }
+    }
+    graphics->flush_draws();
 }
 
-void MainController::awake_targets() { for (auto &target: m_targets) { target.m_active = true; } }
+void MainController::awake_targets() { engine::core::Controller::get<engine::core::WorldController>()->world()->for_each<Target>([](Target &target) { target.m_active = true; }); }
 
-void MainController::update_targets() { for (auto &target: m_targets) { target.update(engine::core::Controller::get<engine::platform::PlatformController>()->dt()); } }
+// Serial, since the targets write their rotations into the shared TransformStore.
+void MainController::update_targets(engine::core::World &world) {
+    float dt = engine::core::Controller::get<engine::platform::PlatformController>()->dt();
+    world.for_each<Target>([dt](Target &target) { target.update(dt); });
+}
 
-void MainController::create_boundingbox_targets() { for (auto &target: m_targets) { if (target.m_active) { target.calculate_bounding_box(); } } }
 
 void MainController::check_boundingbox_intersects() {
     auto platform = engine::core::Controller::get<engine::platform::PlatformController>();
-    if (platform->key(engine::platform::MOUSE_BUTTON_LEFT).state() == engine::platform::Key::State::JustPressed) { for (auto &target: m_targets) { if (target.check_boundingbox_intersect(m_raycast.origin, m_raycast.dir)) { target.m_active = false; } } }
+    if (platform->key(engine::platform::MOUSE_BUTTON_LEFT).state() != engine::platform::Key::State::JustPressed) { return; }
+    m_ray_hits.clear();
+    m_scene.ray_all(m_raycast.origin, m_raycast.dir, m_ray_hits);
+    for (const auto &hit: m_ray_hits) {
+        auto object = m_scene.user_data(hit.proxy);
+        if (scene_object_type(object) != SceneObject::Target) { continue; }
+        auto &hit_target = target(scene_object_index(object));
+        if (hit_target.hit(m_raycast.origin, m_raycast.dir)) { hit_target.m_active = false; }
+    }
+}
+
+uint64_t MainController::scene_object(SceneObject type, uint32_t index) { return static_cast<uint64_t>(type) << 32 | index; }
+
+MainController::SceneObject MainController::scene_object_type(uint64_t object) { return static_cast<SceneObject>(object >> 32); }
+
+uint32_t MainController::scene_object_index(uint64_t object) { return static_cast<uint32_t>(object); }
+
+void MainController::set_scene() {
+    auto resources = engine::core::Controller::get<engine::resources::ResourcesController>();
+    for (uint32_t i = 0; i < m_targets.size(); i++) { target(i).proxy = m_scene.insert(target(i).calculate_bounding_box(), scene_object(SceneObject::Target, i)); }
+    auto tree_bounds = resources->model("tree")->bounds();
+    for (int i = 0; i < m_amount_tree; i++) { m_tree_proxies.push_back(m_scene.insert(tree_bounds.transformed(m_model_tree[i]), scene_object(SceneObject::Tree, i))); }
+    m_cabin_proxy = m_scene.insert(resources->model("cabin1")->bounds().transformed(m_transforms.world(m_cabin_transform)), scene_object(SceneObject::Cabin, 0));
+    m_scene.build();
 }
 
+void MainController::update_scene() {
+    // Targets move as they rotate, and a model that was still loading gets its real bounds once it's loaded.
+    auto resources = engine::core::Controller::get<engine::resources::ResourcesController>();
+    engine::core::Controller::get<engine::core::WorldController>()->world()->for_each<Target>([this](Target &target) { move_scene_object(target.proxy, target.calculate_bounding_box()); });
+    auto tree_bounds = resources->model("tree")->bounds();
+    for (int i = 0; i < m_amount_tree; i++) { move_scene_object(m_tree_proxies[i], tree_bounds.transformed(m_model_tree[i])); }
+    move_scene_object(m_cabin_proxy, resources->model("cabin1")->bounds().transformed(m_transforms.world(m_cabin_transform)));
+}
+
+void MainController::move_scene_object(uint32_t proxy, const engine::util::Aabb &box) { if (m_scene.box(proxy) != box) { m_scene.move(proxy, box); } }
+
 void MainController::create_plane() {
     auto graphics = engine::core::Controller::get<engine::graphics::GraphicsController>();
     float vertices[] = {
@@ -227,11 +330,26 @@ void MainController::create_plane() {
     };
 
     m_vao_plane = graphics->set_plane(vertices, sizeof(vertices));
+
+    // Position of every vertex, the rest are the normal and the texture coordinates.
+    constexpr size_t stride = 8;
+    for (size_t i = 0; i < std::size(vertices); i += stride) {
+        m_plane_occluder.vertices.emplace_back(vertices[i], vertices[i + 1], vertices[i + 2]);
+        m_plane_occluder.indices.push_back(static_cast<uint32_t>(m_plane_occluder.indices.size()));
+    }
+}
+
+void MainController::submit_occluders() {
+    auto occlusion = engine::core::Controller::get<engine::graphics::GraphicsController>()->occlusion_culler();
+    if (!occlusion) { return; }
+    occlusion->add_occluder(engine::core::Controller::get<engine::resources::ResourcesController>()->model("cabin1"), m_transforms.world(m_cabin_transform));
+    occlusion->add_occluder(m_plane_occluder, glm::mat4(1.0f));
 }
 
 void MainController::draw_plane() {
     auto graphics = engine::core::Controller::get<engine::graphics::GraphicsController>();
-    auto shader = engine::core::Controller::get<engine::resources::ResourcesController>()->shader("plane");
+    auto shader = m_spotlight.select(
+            engine::core::Controller::get<engine::resources::ResourcesController>()->shader("plane"));
     auto texture = engine::core::Controller::get<engine::resources::ResourcesController>()->texture("ground");
 
     shader->use();
@@ -244,12 +362,15 @@ void MainController::draw_plane() {
     m_dirlight.apply(shader, "dirlight");
     m_spotlight.apply(shader, "spotlight");
 
+    // The ground texture repeats five times across the plane.
+    graphics->request_texture_detail(texture, glm::vec3(-5.0f, -0.5f, -5.0f), glm::vec3(5.0f, -0.5f, 5.0f), 5.0f);
     graphics->draw_plane(m_vao_plane, shader, texture);
 }
 
 void MainController::draw_tree() {
     auto graphics = engine::core::Controller::get<engine::graphics::GraphicsController>();
-    auto shader = engine::core::Controller::get<engine::resources::ResourcesController>()->shader("tree");
+    auto shader = m_spotlight.select(
+            engine::core::Controller::get<engine::resources::ResourcesController>()->shader("tree"));
     auto tree = engine::core::Controller::get<engine::resources::ResourcesController>()->model("tree");
 
     shader->use();
@@ -266,14 +387,39 @@ void MainController::draw_tree() {
     shader->set_float("shininess", 8.0f);
     shader->set_vec3("viewPos", graphics->camera()->Position);
 
+    graphics->request_texture_detail(tree, model);
     tree->draw(shader);
 }
 
 void MainController::draw_cabin() {
     auto graphics = engine::core::Controller::get<engine::graphics::GraphicsController>();
-    auto shader = engine::core::Controller::get<engine::resources::ResourcesController>()->shader("cabin");
+    auto base = engine::core::Controller::get<engine::resources::ResourcesController>()->shader("cabin");
     auto cabin = engine::core::Controller::get<engine::resources::ResourcesController>()->model("cabin1");
+    const glm::mat4 &model = m_transforms.world(m_cabin_transform);
+    graphics->request_texture_detail(cabin, model);
+
+    // On GL 4.3 the static scene is one MultiDraw; the shader reads the matrices from its storage buffer.
+    if (engine::resources::MultiDraw::supported() &&
+        m_static_draws.add(cabin, model, m_transforms.normal(m_cabin_transform))) {
+        auto shader = m_spotlight.select(base, base->feature("MULTI_DRAW"));
+        set_cabin_uniforms(shader);
+        m_static_draws.draw(shader);
+        return;
+    }
+
+    auto shader = m_spotlight.select(base);
+    set_cabin_uniforms(shader);
+    shader->set_mat4("model", model);
+    shader->set_mat3("invNormal", m_transforms.normal(m_cabin_transform));
+    if (auto view = graphics->meshlet_view(model)) {
+        cabin->draw(shader, *view);
+    } else {
+        cabin->draw(shader);
+    }
+}
 
+void MainController::set_cabin_uniforms(const engine::resources::Shader *shader) {
+    auto graphics = engine::core::Controller::get<engine::graphics::GraphicsController>();
     shader->use();
     shader->set_mat4("projection", graphics->projection_matrix());
     shader->set_mat4("view", graphics->camera()->view_matrix());
@@ -281,17 +427,8 @@ void MainController::draw_cabin() {
     m_dirlight.apply(shader, "dirlight");
     m_spotlight.apply(shader, "spotlight");
 
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-3.0f, -0.5f, 1.0f));
-    model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
-    shader->set_mat4("model", model);
     shader->set_float("shininess", 32.0f);
     shader->set_vec3("viewPos", graphics->camera()->Position);
-
-    glm::mat3 normal_matrix = glm::mat3(glm::transpose(glm::inverse(model)));
-    shader->set_mat3("invNormal", normal_matrix);
-
-    cabin->draw(shader);
 }
 
 void MainController::draw_rifle() {
@@ -299,28 +436,22 @@ void MainController::draw_rifle() {
     auto shader = engine::core::Controller::get<engine::resources::ResourcesController>()->shader("item");
     auto rifle = engine::core::Controller::get<engine::resources::ResourcesController>()->model("ak_47");
 
-    glm::vec3 offset = glm::vec3(0.3f, -0.24f, -0.875f);
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, offset);
-    model = glm::rotate(model, glm::radians(98.5f), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(-3.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(3.3f), glm::vec3(0.0f, 0.0f, 1.0f));
-    model = glm::scale(model, glm::vec3(0.7f));
+    const glm::mat4 &model = m_transforms.world(m_rifle_transform);
 
     shader->use();
     shader->set_mat4("model", model);
     shader->set_float("shininess", 32.0f);
 
     shader->set_mat4("projection", graphics->projection_matrix());
-
-    glm::mat3 normal_matrix = glm::mat3(glm::transpose(glm::inverse(model)));
-    shader->set_mat3("invNormal", normal_matrix);
+    shader->set_mat3("invNormal", m_transforms.normal(m_rifle_transform));
 
     m_dirlight.apply(shader, "scene_dirlight");
     m_rifle_dirlight.apply(shader, "rifle_dirlight");
 
     shader->set_vec3("viewPos", graphics->camera()->Position);
 
+    // The rifle is drawn in view space, so the camera transform is applied to find its on-screen size.
+    graphics->request_texture_detail(rifle, glm::inverse(graphics->camera()->view_matrix()) * model);
     engine::graphics::OpenGL::set_depth_range(0.0, 0.01);
     rifle->draw(shader);
     engine::graphics::OpenGL::set_depth_range(0.0, 1.0);
@@ -381,11 +512,17 @@ void MainController::set_instanced_tree() {
         model = glm::scale(model, scale_factor);
         m_model_tree[i] = model;
     }
+    // The trees don't move, so the culler gets their matrices once.
+    if (engine::resources::InstanceCuller::supported()) {
+        m_tree_culler.set_instances(engine::core::Controller::get<engine::resources::ResourcesController>()->model("tree"),
+                                    m_model_tree, m_amount_tree);
+    }
 }
 
 void MainController::draw_instanced_tree() {
     auto graphics = engine::core::Controller::get<engine::graphics::GraphicsController>();
-    auto shader = engine::core::Controller::get<engine::resources::ResourcesController>()->shader("tree");
+    auto shader = m_spotlight.select(
+            engine::core::Controller::get<engine::resources::ResourcesController>()->shader("tree"));
     auto tree = engine::core::Controller::get<engine::resources::ResourcesController>()->model("tree");
 
     shader->use();
@@ -398,7 +535,19 @@ void MainController::draw_instanced_tree() {
     shader->set_float("shininess", 8.0f);
     shader->set_vec3("viewPos", graphics->camera()->Position);
 
-    graphics->instanced_draw(tree, shader, m_model_tree, m_amount_tree);
+    for (unsigned int i = 0; i < m_amount_tree; i++) { graphics->request_texture_detail(tree, m_model_tree[i]); }
+    if (auto occlusion = graphics->occlusion_culler()) {
+        m_visible_trees.clear();
+        for (int i = 0; i < m_amount_tree; i++) {
+            if (occlusion->visible(tree, m_model_tree[i])) { m_visible_trees.push_back(m_model_tree[i]); }
+        }
+        if (!m_visible_trees.empty()) { graphics->instanced_draw(tree, shader, m_visible_trees.data(), static_cast<int>(m_visible_trees.size())); }
+    } else if (engine::resources::InstanceCuller::supported()) {
+        m_tree_culler.draw(shader, graphics->projection_matrix() * graphics->camera()->view_matrix(),
+                           graphics->depth_pyramid());
+    } else {
+        graphics->instanced_draw(tree, shader, m_model_tree, m_amount_tree);
+    }
 }
 
 void MainController::set_crosshair() {
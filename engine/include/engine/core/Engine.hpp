@@ -9,6 +9,8 @@
 #include <engine/core/App.hpp>
 
 #include <engine/core/Controller.hpp>
+#include <engine/core/World.hpp>
+#include <engine/core/WorldController.hpp>
 
 
 #include <engine/platform/Window.hpp>
@@ -29,5 +31,6 @@
 #include <engine/resources/Shader.hpp>
 #include <engine/resources/Texture.hpp>
 #include <engine/resources/Skybox.hpp>
+#include <engine/resources/Resource.hpp>
 
 #endif//MATF_RG_PROJECT_ENGINE_HPP
@@ -0,0 +1,287 @@
+/**
+ * @file World.hpp
+ * @brief Defines the World class that stores entities and their components in archetype chunks.
+*/
+
+#ifndef MATF_RG_PROJECT_WORLD_HPP
+#define MATF_RG_PROJECT_WORLD_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <engine/util/Errors.hpp>
+#include <engine/util/WorkerPool.hpp>
+
+namespace engine::core {
+/**
+* @struct Entity
+* @brief Handle of an entity of a @ref World. A destroyed entity's index is reused with a new generation,
+* so old handles to it are no longer @ref World::alive.
+*/
+struct Entity {
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    uint32_t index{NONE};
+    uint32_t generation{0};
+
+    bool operator==(const Entity &) const = default;
+};
+
+/**
+* @class World
+* @brief Entities with components, stored by archetype: all the entities with the same set of components share
+* chunks of @ref World::CHUNK_BYTES, and every component type is a column of its own in each chunk.
+* Queries visit the chunks of the matching archetypes and walk the columns in order,
+* instead of chasing a pointer per object:
+* @code
+* struct Velocity { glm::vec3 value; };
+* auto entity = world.create(Position{glm::vec3(0.0f)}, Velocity{glm::vec3(1.0f, 0.0f, 0.0f)});
+* ...
+* world.parallel_for_each<Position, const Velocity>([dt](Position &position, const Velocity &velocity) {
+*     position.value += velocity.value * dt;
+* });
+* @endcode
+* Components are plain data: they are copied with `memcpy` when an entity changes archetype.
+* Adding or removing components, and creating or destroying entities, moves entities between chunks,
+* so it must not happen inside a query, and only on one thread at a time.
+*/
+class World {
+public:
+    static constexpr uint32_t CHUNK_BYTES = 16 * 1024;
+    static constexpr uint32_t MAX_COMPONENTS = 64;
+
+    World();
+
+    World(const World &) = delete;
+
+    World &operator=(const World &) = delete;
+
+    template<typename... Components>
+    Entity create(const Components &...components) {
+        const Entity result = create_entity(mask<Components...>());
+        (std::memcpy(component(result, component_id<Components>()), &components, sizeof(Components)), ...);
+        return result;
+    }
+
+    void destroy(Entity entity);
+
+    bool alive(Entity entity) const;
+
+    /**
+    * @brief Adds the component to the entity, or overwrites the one it has.
+    */
+    template<typename Component>
+    void add(Entity entity, const Component &value) {
+        const uint32_t id = component_id<Component>();
+        if (!component(entity, id)) {
+            set_archetype(entity, m_archetypes[m_records[entity.index].archetype].mask | uint64_t(1) << id);
+        }
+        std::memcpy(component(entity, id), &value, sizeof(Component));
+    }
+
+    template<typename Component>
+    void remove(Entity entity) {
+        const uint32_t id = component_id<Component>();
+        if (component(entity, id)) {
+            set_archetype(entity, m_archetypes[m_records[entity.index].archetype].mask & ~(uint64_t(1) << id));
+        }
+    }
+
+    template<typename Component>
+    bool has(Entity entity) const {
+        return component(entity, component_id<Component>()) != nullptr;
+    }
+
+    /**
+    * @returns The component of the entity. Valid until the next change of the components of any entity.
+    */
+    template<typename Component>
+    Component &get(Entity entity) {
+        void *result = component(entity, component_id<Component>());
+        RG_GUARANTEE(result != nullptr, "Entity {} doesn't have the requested component.", entity.index);
+        return *static_cast<Component *>(result);
+    }
+
+    /**
+    * @returns Number of entities alive.
+    */
+    uint32_t size() const {
+        return m_size;
+    }
+
+    /**
+    * @returns Number of entities that have all the components.
+    */
+    template<typename... Components>
+    uint32_t count() const {
+        const uint64_t required = mask<Components...>();
+        uint32_t result = 0;
+        for (const auto &archetype: m_archetypes) {
+            if ((archetype.mask & required) == required) {
+                for (const auto &chunk: archetype.chunks) {
+                    result += chunk.count;
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+    * @brief Calls `function(Components &...)`, or `function(Entity, Components &...)`, for every entity that has all
+    * the components, chunk by chunk.
+    */
+    template<typename... Components, typename Function>
+    void for_each(Function &&function) {
+        const uint64_t required = mask<Components...>();
+        for (auto &archetype: m_archetypes) {
+            if ((archetype.mask & required) == required) {
+                for (auto &chunk: archetype.chunks) {
+                    visit<Components...>(archetype, chunk, function);
+                }
+            }
+        }
+    }
+
+    /**
+    * @brief Like @ref World::for_each, with the chunks spread over the @ref util::WorkerPool.
+    * `function` is called from several threads at once, so it may only touch the components it's given
+    * and data that is safe to share.
+    */
+    template<typename... Components, typename Function>
+    void parallel_for_each(Function &&function) {
+        const uint64_t required = mask<Components...>();
+        m_jobs.clear();
+        for (uint32_t a = 0; a < m_archetypes.size(); ++a) {
+            if ((m_archetypes[a].mask & required) == required) {
+                for (uint32_t c = 0; c < m_archetypes[a].chunks.size(); ++c) {
+                    m_jobs.emplace_back(a, c);
+                }
+            }
+        }
+        util::WorkerPool::instance()->parallel_for(static_cast<uint32_t>(m_jobs.size()), [&](uint32_t job) {
+            auto &archetype = m_archetypes[m_jobs[job].first];
+            visit<Components...>(archetype, archetype.chunks[m_jobs[job].second], function);
+        });
+    }
+
+    /**
+    * @returns Process-wide index of the component type, assigned on its first use.
+    */
+    template<typename Component>
+    static uint32_t component_id() {
+        // Queries take const components to only read them; they are the same column.
+        if constexpr (std::is_const_v<Component>) {
+            return component_id<std::remove_const_t<Component>>();
+        } else {
+            static_assert(std::is_trivially_copyable_v<Component>, "Components are copied with memcpy.");
+            static_assert(alignof(Component) <= alignof(std::max_align_t), "Chunks are only aligned to max_align_t.");
+            static const uint32_t id = register_component(sizeof(Component));
+            return id;
+        }
+    }
+
+private:
+    struct Chunk {
+        /**
+        * @brief The entity column, followed by a column per component of the archetype.
+        */
+        std::unique_ptr<std::byte[]> data;
+        uint32_t count{0};
+    };
+
+    struct Archetype {
+        uint64_t mask{0};
+        std::vector<uint32_t> components;
+        /**
+        * @brief Offset of the column of every component in the chunks; only set for the components of the archetype.
+        */
+        std::array<uint32_t, MAX_COMPONENTS> offsets{};
+        std::array<uint32_t, MAX_COMPONENTS> sizes{};
+        /**
+        * @brief Entities in a chunk.
+        */
+        uint32_t capacity{0};
+        /**
+        * @brief Every chunk but the last one is full.
+        */
+        std::vector<Chunk> chunks;
+    };
+
+    struct Record {
+        uint32_t archetype{0};
+        uint32_t chunk{0};
+        uint32_t row{0};
+        uint32_t generation{0};
+    };
+
+    static uint32_t register_component(uint32_t size);
+
+    static uint32_t component_size(uint32_t id);
+
+    template<typename... Components>
+    static uint64_t mask() {
+        return (uint64_t(0) | ... | (uint64_t(1) << component_id<Components>()));
+    }
+
+    template<typename... Components, typename Function>
+    static void visit(Archetype &archetype, Chunk &chunk, Function &function) {
+        auto *entities = reinterpret_cast<const Entity *>(chunk.data.get());
+        std::tuple<Components *...> columns{
+                reinterpret_cast<Components *>(chunk.data.get() + archetype.offsets[component_id<Components>()])...};
+        for (uint32_t row = 0; row < chunk.count; ++row) {
+            if constexpr (std::is_invocable_v<Function &, Entity, Components &...>) {
+                function(entities[row], std::get<Components *>(columns)[row]...);
+            } else {
+                function(std::get<Components *>(columns)[row]...);
+            }
+        }
+    }
+
+    /**
+    * @returns Index of the archetype with the components of `mask`, created on the first request.
+    */
+    uint32_t archetype(uint64_t mask);
+
+    Entity create_entity(uint64_t mask);
+
+    /**
+    * @returns The component of a live entity, or nullptr if it doesn't have it.
+    */
+    void *component(Entity entity, uint32_t id) const;
+
+    /**
+    * @brief Moves the entity into the archetype of `mask`, keeping the components both archetypes have.
+    */
+    void set_archetype(Entity entity, uint64_t mask);
+
+    /**
+    * @brief Appends a row for the entity to the archetype and points its record at it.
+    */
+    void allocate_row(uint32_t archetype, Entity entity);
+
+    /**
+    * @brief Fills the row with the last row of the archetype, so that the chunks stay dense.
+    */
+    void free_row(uint32_t archetype, uint32_t chunk, uint32_t row);
+
+    std::vector<Archetype> m_archetypes;
+    std::unordered_map<uint64_t, uint32_t> m_archetype_lookup;
+    std::vector<Record> m_records;
+    std::vector<uint32_t> m_free_entities;
+    uint32_t m_size{0};
+    /**
+    * @brief Archetype and chunk of every job of @ref World::parallel_for_each.
+    */
+    std::vector<std::pair<uint32_t, uint32_t>> m_jobs;
+};
+} // namespace engine::core
+
+#endif//MATF_RG_PROJECT_WORLD_HPP
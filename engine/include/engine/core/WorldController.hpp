@@ -0,0 +1,55 @@
+/**
+ * @file WorldController.hpp
+ * @brief Defines the WorldController class that owns the @ref World of the app and runs its systems.
+*/
+
+#ifndef MATF_RG_PROJECT_WORLD_CONTROLLER_HPP
+#define MATF_RG_PROJECT_WORLD_CONTROLLER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <engine/core/Controller.hpp>
+#include <engine/core/World.hpp>
+
+namespace engine::core {
+/**
+* @class WorldController
+* @brief Owns the @ref World of the app and runs its systems in the update phase.
+*
+* The controller is registered with the engine controllers, after the @ref resources::ResourcesController,
+* so the systems run after the input of the frame is polled and before the update of the controllers
+* that are ordered after @ref EngineControllersEnd:
+* @code
+* auto world_controller = engine::core::Controller::get<engine::core::WorldController>();
+* world_controller->add_system("spin", [](engine::core::World &world) {
+*     world.parallel_for_each<Spin, Rotation>([](const Spin &spin, Rotation &rotation) { rotation.angle += spin.speed; });
+* });
+* @endcode
+*/
+class WorldController final : public Controller {
+public:
+    using System = std::function<void(World &world)>;
+
+    std::string_view name() const override {
+        return "WorldController";
+    }
+
+    World *world() {
+        return &m_world;
+    }
+
+    /**
+    * @brief Adds a system that runs every frame, after the systems added before it.
+    */
+    void add_system(std::string name, System system);
+
+private:
+    void update() override;
+
+    World m_world;
+    std::vector<std::pair<std::string, System>> m_systems;
+};
+} // namespace engine::core
+
+#endif//MATF_RG_PROJECT_WORLD_CONTROLLER_HPP
@@ -0,0 +1,124 @@
+/**
+ * @file DepthPyramid.hpp
+ * @brief Defines the DepthPyramid class that reduces the depth buffer of a frame into a mip chain for occlusion culling.
+*/
+
+#ifndef MATF_RG_PROJECT_DEPTH_PYRAMID_HPP
+#define MATF_RG_PROJECT_DEPTH_PYRAMID_HPP
+
+#include <cstdint>
+#include <memory>
+#include <glm/glm.hpp>
+#include <engine/graphics/GLResourceRegistry.hpp>
+
+namespace engine::resources {
+class Shader;
+}
+
+namespace engine::graphics {
+/**
+* @class DepthPyramid
+* @brief Hierarchical depth buffer (Hi-Z) of the previous frame: every texel of a level holds the farthest depth
+* of the texels it covers in the level below.
+*
+* At the end of a frame the @ref GraphicsController copies the depth buffer of the window and reduces it
+* with a compute shader. In the next frame an @ref resources::InstanceCuller projects the bounding box of an instance
+* with @ref DepthPyramid::view_projection, picks the level at which the box covers at most 2x2 texels and culls the
+* instance if its nearest depth is behind all of them.
+*
+* The pyramid is a frame old, so an object that comes into view from behind an occluder shows up one frame late.
+*
+* Opt-in in the config.json, needs @ref GLExtensions::compute_shader:
+* @code
+* "graphics": {
+*   "hi_z": true
+* }
+* @endcode
+*/
+class DepthPyramid {
+public:
+    DepthPyramid();
+
+    ~DepthPyramid();
+
+    /**
+    * @brief Reads the config.json. Called by the @ref GraphicsController.
+    */
+    void initialize();
+
+    /**
+    * @brief Releases the textures and the reduction shader.
+    */
+    void shutdown();
+
+    /**
+    * @returns true if the pyramid is built at the end of every frame.
+    */
+    bool enabled() const {
+        return m_enabled;
+    }
+
+    /**
+    * @returns true if the pyramid holds the depth of a frame and can be used for culling.
+    */
+    bool ready() const {
+        return m_enabled && m_ready;
+    }
+
+    /**
+    * @brief Copies the depth buffer of the default framebuffer and reduces it into the pyramid.
+    * @param width Width of the default framebuffer in pixels.
+    * @param height Height of the default framebuffer in pixels.
+    * @param view_projection Matrix the frame was drawn with.
+    */
+    void build(int32_t width, int32_t height, const glm::mat4 &view_projection);
+
+    /**
+    * @returns OpenGL ID of the `GL_R32F` pyramid texture; level 0 is half the size of the framebuffer.
+    */
+    uint32_t texture() const {
+        return m_pyramid.id();
+    }
+
+    /**
+    * @returns Size of level 0 in texels.
+    */
+    glm::vec2 size() const {
+        return {static_cast<float>(m_level_width), static_cast<float>(m_level_height)};
+    }
+
+    /**
+    * @returns Number of levels, down to 1x1.
+    */
+    int32_t levels() const {
+        return m_levels;
+    }
+
+    /**
+    * @returns Projection and view matrix of the frame the pyramid was built from.
+    */
+    const glm::mat4 &view_projection() const {
+        return m_view_projection;
+    }
+
+private:
+    /**
+    * @brief (Re)creates the depth copy and the pyramid for a framebuffer of `width` x `height` pixels.
+    */
+    void allocate(int32_t width, int32_t height);
+
+    GLTexture m_depth;
+    GLTexture m_pyramid;
+    std::unique_ptr<resources::Shader> m_reduce;
+    glm::mat4 m_view_projection{1.0f};
+    int32_t m_width{0};
+    int32_t m_height{0};
+    int32_t m_level_width{0};
+    int32_t m_level_height{0};
+    int32_t m_levels{0};
+    bool m_enabled{false};
+    bool m_ready{false};
+};
+} // namespace engine::graphics
+
+#endif//MATF_RG_PROJECT_DEPTH_PYRAMID_HPP
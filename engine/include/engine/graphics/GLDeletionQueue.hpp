@@ -0,0 +1,88 @@
+/**
+ * @file GLDeletionQueue.hpp
+ * @brief Defines the GLDeletionQueue class that deletes OpenGL objects once the GPU no longer uses them.
+*/
+
+#ifndef MATF_RG_PROJECT_GL_DELETION_QUEUE_HPP
+#define MATF_RG_PROJECT_GL_DELETION_QUEUE_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <engine/graphics/GLResourceRegistry.hpp>
+
+namespace engine::graphics {
+/**
+* @class GLDeletionQueue
+* @brief Defers the deletion of OpenGL objects until the GPU has finished the frames that could still reference them.
+*
+* Deleting a buffer or a texture that an in-flight frame still reads makes the driver either stall
+* or synchronize implicitly. Objects released during a frame are collected into a batch; at the end of the frame
+* the batch is guarded with a `glFenceSync`. Batches are deleted, oldest first, once their fence is signaled.
+* Fences are only polled, so the CPU never waits on the GPU.
+*
+* The queue is driven by the @ref GLResourceRegistry: every @ref GLHandle that is reset or destroyed ends up here.
+* Objects can be enqueued from the @ref GLUploadThread as well; they are deleted on the main thread.
+*/
+class GLDeletionQueue {
+public:
+    static GLDeletionQueue *instance();
+
+    /**
+    * @brief Schedules the object for deletion after the GPU finishes the current frame.
+    */
+    void enqueue(GLObjectType type, uint32_t id, uint64_t bytes);
+
+    /**
+    * @brief Fences the objects released during the frame and deletes the batches whose fence has been signaled.
+    */
+    void end_frame();
+
+    /**
+    * @brief Waits for the GPU and deletes all the pending objects. Called before the OpenGL context is destroyed.
+    */
+    void flush();
+
+    /**
+    * @returns Number of objects waiting to be deleted.
+    */
+    uint64_t pending_count() const;
+
+    /**
+    * @returns Estimated GPU memory still held by the objects waiting to be deleted.
+    */
+    uint64_t pending_bytes() const;
+
+private:
+    GLDeletionQueue() = default;
+
+    struct PendingObject {
+        GLObjectType type;
+        uint32_t id;
+        uint64_t bytes;
+    };
+
+    struct Batch {
+        /**
+        * @brief `GLsync` of the frame; kept opaque so that the header doesn't depend on glad.
+        */
+        void *fence;
+        std::vector<PendingObject> objects;
+    };
+
+    void delete_objects(const std::vector<PendingObject> &objects);
+
+    /**
+    * @brief Guards `m_current`, the only part of the queue touched outside the main thread.
+    */
+    std::mutex m_mutex;
+    std::vector<PendingObject> m_current;
+    std::deque<Batch> m_in_flight;
+    std::atomic<uint64_t> m_pending_count{0};
+    std::atomic<uint64_t> m_pending_bytes{0};
+};
+} // namespace engine::graphics
+
+#endif//MATF_RG_PROJECT_GL_DELETION_QUEUE_HPP
@@ -0,0 +1,140 @@
+/**
+ * @file GLExtensions.hpp
+ * @brief Defines the GLExtensions class that loads the OpenGL functions newer than the 3.3 core profile.
+*/
+
+#ifndef MATF_RG_PROJECT_GL_EXTENSIONS_HPP
+#define MATF_RG_PROJECT_GL_EXTENSIONS_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace engine::graphics {
+/**
+* @class GLExtensions
+* @brief Loads the OpenGL functions the engine uses when the driver offers them, either as an extension
+* or as part of a newer core version.
+*
+* The engine targets the 3.3 core profile, and the glad loader only knows its functions. Faster paths that need
+* newer functions check the matching flag first, and keep the 3.3 path as the fallback:
+* @code
+* if (GLExtensions::program_binary()) {
+*     CHECKED_GL_CALL(GLExtensions::glProgramBinary, program, format, binary.data(), size);
+* }
+* @endcode
+*
+* Loaded by the @ref GraphicsController right after the core functions.
+*/
+class GLExtensions {
+public:
+    /**
+    * @brief Resolves the address of an OpenGL function, for example `glfwGetProcAddress`.
+    */
+    using Loader = void *(*)(const char *name);
+
+    /**
+    * @brief Reads the extensions of the current context and loads the functions of the supported ones.
+    */
+    static void initialize(Loader loader);
+
+    /**
+    * @returns true if the context is at least the given core version.
+    */
+    static bool version(int32_t major, int32_t minor);
+
+    /**
+    * @returns true if the context offers the extension, for example "GL_ARB_get_program_binary".
+    */
+    static bool supported(std::string_view extension);
+
+    /**
+    * @returns true if program binaries can be read and loaded: GL 4.1 or `GL_ARB_get_program_binary`,
+    * and the driver offers at least one binary format.
+    */
+    static bool program_binary() {
+        return m_program_binary;
+    }
+
+    /**
+    * @returns true if the driver compiles and links shaders on its own threads, and the completion can be polled
+    * with `COMPLETION_STATUS_KHR`: `GL_KHR_parallel_shader_compile` or `GL_ARB_parallel_shader_compile`.
+    */
+    static bool parallel_shader_compile() {
+        return m_parallel_shader_compile;
+    }
+
+    /**
+    * @returns true if a range of texture units can be bound with one `glBindTextures` call:
+    * GL 4.4 or `GL_ARB_multi_bind`.
+    */
+    static bool multi_bind() {
+        return m_multi_bind;
+    }
+
+    /**
+    * @returns true if draws can be submitted from an indirect buffer with `glMultiDrawElementsIndirect`,
+    * with their `baseInstance`, and shaders can read shader storage buffers: GL 4.3.
+    */
+    static bool multi_draw_indirect() {
+        return m_multi_draw_indirect;
+    }
+
+    /**
+    * @returns true if compute shaders can be dispatched and their results drawn with `glDrawElementsIndirect`:
+    * GL 4.3.
+    */
+    static bool compute_shader() {
+        return m_compute_shader;
+    }
+
+    // GL_ARB_get_program_binary
+    static constexpr uint32_t PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257;
+    static constexpr uint32_t PROGRAM_BINARY_LENGTH = 0x8741;
+    static constexpr uint32_t NUM_PROGRAM_BINARY_FORMATS = 0x87FE;
+    static inline void (*glGetProgramBinary)(uint32_t program, int32_t buffer_size, int32_t *length,
+                                             uint32_t *binary_format, void *binary) = nullptr;
+    static inline void (*glProgramBinary)(uint32_t program, uint32_t binary_format, const void *binary,
+                                          int32_t length) = nullptr;
+    static inline void (*glProgramParameteri)(uint32_t program, uint32_t name, int32_t value) = nullptr;
+
+    // GL_KHR_parallel_shader_compile
+    static constexpr uint32_t COMPLETION_STATUS_KHR = 0x91B1;
+    static inline void (*glMaxShaderCompilerThreadsKHR)(uint32_t count) = nullptr;
+
+    // GL_ARB_multi_draw_indirect, GL_ARB_shader_storage_buffer_object
+    static constexpr uint32_t DRAW_INDIRECT_BUFFER = 0x8F3F;
+    static constexpr uint32_t SHADER_STORAGE_BUFFER = 0x90D2;
+    static inline void (*glMultiDrawElementsIndirect)(uint32_t mode, uint32_t type, const void *indirect,
+                                                      int32_t draw_count, int32_t stride) = nullptr;
+
+    // GL_ARB_compute_shader, GL_ARB_shader_image_load_store, GL_ARB_draw_indirect
+    static constexpr uint32_t COMPUTE_SHADER = 0x91B9;
+    static constexpr uint32_t VERTEX_ATTRIB_ARRAY_BARRIER_BIT = 0x00000001;
+    static constexpr uint32_t TEXTURE_FETCH_BARRIER_BIT = 0x00000008;
+    static constexpr uint32_t SHADER_IMAGE_ACCESS_BARRIER_BIT = 0x00000020;
+    static constexpr uint32_t COMMAND_BARRIER_BIT = 0x00000040;
+    static constexpr uint32_t SHADER_STORAGE_BARRIER_BIT = 0x00002000;
+    static inline void (*glDispatchCompute)(uint32_t groups_x, uint32_t groups_y, uint32_t groups_z) = nullptr;
+    static inline void (*glMemoryBarrier)(uint32_t barriers) = nullptr;
+    static inline void (*glBindImageTexture)(uint32_t unit, uint32_t texture, int32_t level, uint8_t layered,
+                                             int32_t layer, uint32_t access, uint32_t format) = nullptr;
+    static inline void (*glDrawElementsIndirect)(uint32_t mode, uint32_t type, const void *indirect) = nullptr;
+
+    // GL_ARB_multi_bind
+    static inline void (*glBindTextures)(uint32_t first, int32_t count, const uint32_t *textures) = nullptr;
+
+private:
+    static inline std::unordered_set<std::string> m_extensions;
+    static inline int32_t m_major{3};
+    static inline int32_t m_minor{3};
+    static inline bool m_program_binary{false};
+    static inline bool m_parallel_shader_compile{false};
+    static inline bool m_multi_bind{false};
+    static inline bool m_multi_draw_indirect{false};
+    static inline bool m_compute_shader{false};
+};
+} // namespace engine::graphics
+
+#endif//MATF_RG_PROJECT_GL_EXTENSIONS_HPP
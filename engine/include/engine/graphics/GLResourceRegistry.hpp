@@ -0,0 +1,244 @@
+/**
+ * @file GLResourceRegistry.hpp
+ * @brief Defines the GLResourceRegistry that tracks live OpenGL objects, and the RAII GLHandle types that own them.
+*/
+
+#ifndef MATF_RG_PROJECT_GL_RESOURCE_REGISTRY_HPP
+#define MATF_RG_PROJECT_GL_RESOURCE_REGISTRY_HPP
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace engine::graphics {
+/**
+* @brief Types of OpenGL objects tracked by the @ref GLResourceRegistry.
+*/
+enum class GLObjectType : uint8_t {
+    Buffer,
+    Texture,
+    VertexArray,
+    Program,
+    Count
+};
+
+/**
+* @brief Converts a @ref GLObjectType to a string.
+*/
+std::string_view to_string(GLObjectType type);
+
+/**
+* @brief Bookkeeping for a single live OpenGL object.
+*/
+struct GLResourceInfo {
+    GLObjectType type;
+    uint32_t id;
+    /**
+    * @brief Estimated GPU memory used by the object. Set by the code that uploads the data.
+    */
+    uint64_t bytes;
+    /**
+    * @brief Optional human-readable description, for example the path of the texture.
+    */
+    std::string label;
+    std::source_location location;
+    /**
+    * @brief Frame in which the object was created; 0 for objects created during initialization.
+    */
+    uint64_t frame;
+};
+
+/**
+* @class GLResourceRegistry
+* @brief Creates, deletes and keeps track of every OpenGL buffer, texture, vertex array and program in the engine.
+*
+* Don't use the registry directly; create objects through @ref GLHandle (@ref GLBuffer, @ref GLTexture,
+* @ref GLVertexArray, @ref GLProgram) so that they are always released.
+*
+* Debugging aids, enabled with command line arguments:
+* - `--gl-report-interval <frames>` logs live objects and their memory, grouped by creation site, every N frames.
+* - `--gl-soak-test <warmup-frames>` records the live GPU memory after the warmup frames and throws
+*   @ref engine::util::EngineError::Type::ResourceLeak as soon as a later frame ends with more memory or objects alive.
+*
+* Objects still alive when the @ref GraphicsController terminates are reported as leaks.
+*
+* Objects can also be created on the @ref GLUploadThread, so the bookkeeping is guarded by a mutex.
+*/
+class GLResourceRegistry {
+public:
+    static GLResourceRegistry *instance();
+
+    /**
+    * @brief Creates a new OpenGL object of `type` and starts tracking it.
+    * @returns OpenGL name of the object.
+    */
+    uint32_t create(GLObjectType type, std::string label, std::source_location location);
+
+    /**
+    * @brief Stops tracking the OpenGL object and hands it to the @ref GLDeletionQueue,
+    * which deletes it once the GPU has finished the frames that could still use it.
+    */
+    void destroy(GLObjectType type, uint32_t id);
+
+    /**
+    * @brief Updates the estimated GPU memory used by the object.
+    */
+    void set_size(GLObjectType type, uint32_t id, uint64_t bytes);
+
+    /**
+    * @returns Estimated GPU memory used by the object.
+    */
+    uint64_t size(GLObjectType type, uint32_t id) const;
+
+    /**
+    * @returns Estimated GPU memory used by all the live objects.
+    */
+    uint64_t live_bytes() const;
+
+    /**
+    * @returns Number of live objects of `type`.
+    */
+    uint64_t live_count(GLObjectType type) const;
+
+    /**
+    * @brief Logs the live objects grouped by creation site.
+    * @param since_frame Only objects created in or after this frame are reported.
+    */
+    void report(uint64_t since_frame = 0) const;
+
+    /**
+    * @brief Reads the debugging arguments. Called by the @ref GraphicsController.
+    */
+    void initialize();
+
+    /**
+    * @brief Fences the objects released during the frame, advances the frame counter, prints the periodic report
+    * and runs the soak test check.
+    * Called by the @ref GraphicsController at the end of every frame.
+    */
+    void end_frame();
+
+    /**
+    * @brief Deletes the objects waiting in the @ref GLDeletionQueue and reports the leaked objects.
+    * After shutdown objects are no longer deleted through OpenGL since the context is about to be destroyed.
+    */
+    void shutdown();
+
+private:
+    GLResourceRegistry() = default;
+
+    static uint64_t key(GLObjectType type, uint32_t id) {
+        return static_cast<uint64_t>(type) << 32 | id;
+    }
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, GLResourceInfo> m_live;
+    std::array<uint64_t, static_cast<size_t>(GLObjectType::Count)> m_bytes{};
+    std::array<uint64_t, static_cast<size_t>(GLObjectType::Count)> m_counts{};
+    uint64_t m_frame{0};
+    uint64_t m_report_interval{0};
+    uint64_t m_soak_warmup_frames{0};
+    uint64_t m_soak_baseline{0};
+    uint64_t m_soak_baseline_objects{0};
+    bool m_context_alive{true};
+};
+
+/**
+* @class GLHandle
+* @brief Move-only owner of an OpenGL object. The object is released when the handle is destroyed or reset.
+*
+* @code
+* auto vbo = graphics::GLBuffer::create("plane vertices");
+* CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, vbo.id());
+* CHECKED_GL_CALL(glBufferData, GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+* vbo.set_size(size);
+* @endcode
+*/
+template<GLObjectType Type>
+class GLHandle {
+public:
+    GLHandle() = default;
+
+    /**
+    * @brief Creates a new OpenGL object.
+    * @param label Optional description shown in the resource reports.
+    * @param location Creation site shown in the resource reports. Defaults to the caller.
+    */
+    static GLHandle create(std::string label = "",
+                           std::source_location location = std::source_location::current()) {
+        return GLHandle(GLResourceRegistry::instance()->create(Type, std::move(label), location));
+    }
+
+    GLHandle(const GLHandle &) = delete;
+
+    GLHandle &operator=(const GLHandle &) = delete;
+
+    GLHandle(GLHandle &&other) noexcept : m_id(std::exchange(other.m_id, 0)) {
+    }
+
+    GLHandle &operator=(GLHandle &&other) noexcept {
+        if (this != &other) {
+            reset();
+            m_id = std::exchange(other.m_id, 0);
+        }
+        return *this;
+    }
+
+    ~GLHandle() {
+        reset();
+    }
+
+    /**
+    * @returns OpenGL name of the object, or 0 if the handle is empty.
+    */
+    uint32_t id() const {
+        return m_id;
+    }
+
+    explicit operator bool() const {
+        return m_id != 0;
+    }
+
+    /**
+    * @brief Updates the estimated GPU memory used by the object.
+    */
+    void set_size(uint64_t bytes) const {
+        GLResourceRegistry::instance()->set_size(Type, m_id, bytes);
+    }
+
+    /**
+    * @returns Estimated GPU memory used by the object, 0 if the handle is empty.
+    */
+    uint64_t size() const {
+        return m_id != 0 ? GLResourceRegistry::instance()->size(Type, m_id) : 0;
+    }
+
+    /**
+    * @brief Releases the OpenGL object. The handle becomes empty immediately; the object itself is deleted
+    * by the @ref GLDeletionQueue once the GPU no longer uses it.
+    */
+    void reset() {
+        if (m_id != 0) {
+            GLResourceRegistry::instance()->destroy(Type, std::exchange(m_id, 0));
+        }
+    }
+
+private:
+    explicit GLHandle(uint32_t id) : m_id(id) {
+    }
+
+    uint32_t m_id{0};
+};
+
+using GLBuffer = GLHandle<GLObjectType::Buffer>;
+using GLTexture = GLHandle<GLObjectType::Texture>;
+using GLVertexArray = GLHandle<GLObjectType::VertexArray>;
+using GLProgram = GLHandle<GLObjectType::Program>;
+} // namespace engine::graphics
+
+#endif//MATF_RG_PROJECT_GL_RESOURCE_REGISTRY_HPP
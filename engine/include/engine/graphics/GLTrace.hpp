@@ -0,0 +1,191 @@
+/**
+ * @file GLTrace.hpp
+ * @brief Defines the GLTrace class that captures the OpenGL command stream, and the GLTraceReplayer that replays it.
+*/
+
+#ifndef MATF_RG_PROJECT_GLTRACE_HPP
+#define MATF_RG_PROJECT_GLTRACE_HPP
+
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace engine::graphics {
+/**
+* @class GLTrace
+* @brief Serializes every OpenGL call made through @ref CHECKED_GL_CALL into a binary trace file.
+*
+* Every call is written with its arguments, its return value and the client memory it references
+* (buffer data, texture pixels, shader sources, uniform arrays). Object names created by the driver are recorded
+* as well, so that the @ref GLTraceReplayer can remap them on replay.
+*
+* Capture is started by the @ref GraphicsController when the app is run with `--gl-capture <trace-file>`.
+* Everything before the first frame (resource loading) is recorded as frame 0, followed by
+* `--gl-capture-frames <N>` (default 60) frames after which the trace is closed.
+*
+* Calls that don't go through @ref CHECKED_GL_CALL (for example ImGui rendering) are not part of the trace.
+* Neither are writes through mapped buffers, calls made on the upload thread's shared context, program binaries
+* (which only load on the driver that wrote them) and queries the replaying driver may not support, so the paths
+* that rely on them fall back to plain recorded calls while @ref capturing is set.
+*/
+class GLTrace {
+public:
+    /**
+    * @brief Trace file format version. Increment when the record layout changes.
+    */
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+    * @brief Maximum number of arguments of a traced OpenGL function.
+    */
+    static constexpr uint32_t MAX_ARGS = 12;
+
+    /**
+    * @brief Record tags in the trace file.
+    */
+    enum class RecordType : uint8_t {
+        Function = 1,
+        Call = 2,
+        Frame = 3,
+        End = 4,
+    };
+
+    static GLTrace *instance();
+
+    /**
+    * @brief Checks whether a capture is in progress. Called for every @ref CHECKED_GL_CALL, so it is kept inline.
+    * @returns true if the calls should be recorded.
+    */
+    static bool capturing() {
+        return m_capturing;
+    }
+
+    /**
+    * @brief Encodes an OpenGL argument or return value into a 64-bit trace word.
+    * Pointers are stored as addresses, floats as their bit pattern and integers sign-extended.
+    */
+    template<typename T>
+    static uint64_t encode(T value) {
+        if constexpr (std::is_pointer_v<T>) {
+            return reinterpret_cast<uintptr_t>(value);
+        } else if constexpr (std::is_same_v<T, float>) {
+            return std::bit_cast<uint32_t>(value);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return std::bit_cast<uint64_t>(value);
+        } else {
+            return static_cast<uint64_t>(static_cast<int64_t>(value));
+        }
+    }
+
+    /**
+    * @brief Records a single OpenGL call. Used internally by @ref engine::graphics::OpenGL::call.
+    * @param function Name of the OpenGL function as written at the call site.
+    * @param args Encoded arguments, see @ref GLTrace::encode.
+    * @param result Encoded return value, or 0 for void functions.
+    */
+    static void record(std::string_view function, std::initializer_list<uint64_t> args, uint64_t result);
+
+    /**
+    * @brief Opens the trace file and starts recording.
+    * @param path Trace file to write.
+    * @param frames Number of frames to record after the setup frame.
+    */
+    void begin_capture(const std::filesystem::path &path, uint32_t frames);
+
+    /**
+    * @brief Marks the beginning of a new frame. Closes the trace once the requested number of frames has been recorded.
+    */
+    void begin_frame();
+
+    /**
+    * @brief Finishes the trace file. Safe to call if no capture is in progress.
+    */
+    void end_capture();
+
+private:
+    GLTrace() = default;
+
+    uint16_t function_id(std::string_view function);
+
+    void write_call(std::string_view function, std::initializer_list<uint64_t> args, uint64_t result);
+
+    template<typename T>
+    void write(const T &value) {
+        m_output.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    std::ofstream m_output;
+    std::filesystem::path m_path;
+    std::unordered_map<std::string_view, uint16_t> m_function_ids;
+    std::vector<uint8_t> m_payload;
+    uint32_t m_frame{0};
+    uint32_t m_frames{0};
+    uint64_t m_calls{0};
+
+    static inline bool m_capturing{false};
+};
+
+/**
+* @brief Replay statistics for a single OpenGL function.
+*/
+struct GLReplayFunctionStats {
+    std::string name;
+    uint64_t calls{0};
+    uint64_t total_ns{0};
+    uint64_t max_ns{0};
+};
+
+/**
+* @brief Replay statistics for a single frame of the trace.
+*/
+struct GLReplayFrameStats {
+    uint32_t index{0};
+    uint64_t calls{0};
+    /**
+    * @brief Time spent submitting the frame's calls to the driver.
+    */
+    uint64_t submit_ns{0};
+    /**
+    * @brief Time until the GPU finished the frame (`glFinish`), measured from the first call of the frame.
+    */
+    uint64_t finish_ns{0};
+};
+
+/**
+* @brief Result of @ref GLTraceReplayer::replay.
+*/
+struct GLReplayReport {
+    std::vector<GLReplayFunctionStats> functions;
+    std::vector<GLReplayFrameStats> frames;
+    /**
+    * @brief Calls of functions that the replayer doesn't know how to decode. They are skipped.
+    */
+    uint64_t skipped_calls{0};
+};
+
+/**
+* @class GLTraceReplayer
+* @brief Replays a trace recorded by @ref GLTrace as fast as possible and times every call.
+*
+* The replayer needs no window or engine controllers; if there's no current OpenGL context it creates a hidden one.
+* Object names recorded in the trace are remapped to the names the driver generates during replay.
+*/
+class GLTraceReplayer {
+public:
+    /**
+    * @brief Replays the trace.
+    * @param path Trace file recorded with `--gl-capture`.
+    * @returns Per function and per frame timings.
+    */
+    static GLReplayReport replay(const std::filesystem::path &path);
+};
+} // namespace engine::graphics
+
+#endif//MATF_RG_PROJECT_GLTRACE_HPP
@@ -0,0 +1,117 @@
+/**
+ * @file GLUploadThread.hpp
+ * @brief Defines the GLUploadThread that creates OpenGL buffers and textures on a second, shared context.
+*/
+
+#ifndef MATF_RG_PROJECT_GL_UPLOAD_THREAD_HPP
+#define MATF_RG_PROJECT_GL_UPLOAD_THREAD_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct GLFWwindow;
+
+namespace engine::graphics {
+/**
+* @class GLUploadThread
+* @brief Runs OpenGL uploads on a background thread with its own context that shares objects with the main one.
+*
+* A job has two parts. The `work` runs on the upload thread and creates and fills buffers and textures.
+* The thread then places a `glFenceSync` after the job; once the main thread sees that the fence has signaled,
+* it runs the `publish` part, which hands the finished objects to the resources. Objects that can't be shared
+* between contexts, like vertex arrays, are created in `publish`.
+*
+* @code
+* auto buffers = std::make_shared<resources::MeshBuffers>();
+* GLUploadThread::instance()->submit([=] { *buffers = resources::Mesh::upload(vertices, indices); },
+*                                    [=] { meshes.emplace_back(std::move(*buffers), textures); });
+* @endcode
+*
+* Enabled with `"graphics": {"upload_thread": true}` in the config.json. Without it, or while a @ref GLTrace
+* capture is recording, @ref GLUploadThread::running returns false and the resources are uploaded on the main thread.
+*/
+class GLUploadThread {
+public:
+    static GLUploadThread *instance();
+
+    /**
+    * @brief Creates the hidden window that owns the upload context and starts the thread.
+    * Called by the @ref GraphicsController on the main thread.
+    * @param shared window whose context shares its objects with the upload context.
+    */
+    void start(GLFWwindow *shared);
+
+    /**
+    * @brief Finishes the queued jobs, stops the thread and destroys its context. Called by the @ref GraphicsController.
+    */
+    void stop();
+
+    /**
+    * @returns true if the thread is running and jobs can be submitted.
+    */
+    bool running() const {
+        return m_thread.joinable();
+    }
+
+    /**
+    * @brief Queues a job.
+    * @param work runs on the upload thread, with the upload context current.
+    * @param publish runs on the main thread, from @ref GLUploadThread::process, once the GPU has finished the work.
+    * If `work` throws, `publish` isn't called and @ref GLUploadThread::process rethrows the exception.
+    */
+    void submit(std::function<void()> work, std::function<void()> publish);
+
+    /**
+    * @brief Publishes the finished jobs without waiting for the GPU. Called on the main thread once per frame.
+    */
+    void process();
+
+    /**
+    * @brief Waits for every submitted job and publishes it.
+    */
+    void finish();
+
+    /**
+    * @returns Number of jobs that are submitted but not yet published.
+    */
+    size_t pending() const;
+
+private:
+    GLUploadThread() = default;
+
+    struct Job {
+        std::function<void()> work;
+        std::function<void()> publish;
+        /**
+        * @brief `GLsync` placed after the work; kept opaque so that the header doesn't depend on glad.
+        */
+        void *fence{nullptr};
+        std::exception_ptr error;
+    };
+
+    void thread_loop();
+
+    /**
+    * @param wait block until the jobs are done instead of publishing only the finished ones.
+    */
+    void publish_finished(bool wait);
+
+    GLFWwindow *m_window{nullptr};
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Job> m_queued;
+    std::deque<Job> m_done;
+    /**
+    * @brief Number of jobs that are queued or running; guarded by `m_mutex`.
+    */
+    size_t m_in_progress{0};
+    bool m_stopping{false};
+};
+} // namespace engine::graphics
+
+#endif//MATF_RG_PROJECT_GL_UPLOAD_THREAD_HPP
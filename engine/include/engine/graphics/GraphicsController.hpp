@@ -7,8 +7,16 @@
 #define GRAPHICSCONTROLLER_HPP
 
 #include <engine/graphics/Camera.hpp>
+#include <engine/graphics/DepthPyramid.hpp>
+#include <engine/graphics/OcclusionCuller.hpp>
+#include <engine/graphics/GLResourceRegistry.hpp>
 #include <engine/core/Controller.hpp>
 #include <engine/platform/PlatformEventObserver.hpp>
+#include <engine/resources/InstanceData.hpp>
+#include <engine/resources/Meshlet.hpp>
+#include <optional>
+#include <string>
+#include <vector>
 
 struct ImGuiContext;
 
@@ -43,6 +51,26 @@ struct OrthographicMatrixParams {
     float Far;
 };
 
+/**
+* @brief First-draw cost of a program and vertex layout pair, measured by @ref GraphicsController::warm_up.
+*/
+struct WarmUpCost {
+    /**
+    * @brief Name of the shader, followed by its enabled features, for example "cabin+SPOTLIGHT".
+    */
+    std::string program;
+    std::string layout;
+    /**
+    * @brief Time from issuing the draw until it finished, in milliseconds. Includes the work the driver
+    * defers to the first draw, like compiling the program for the vertex format.
+    */
+    double cpu_ms;
+    /**
+    * @brief Time the draw took on the GPU, in milliseconds.
+    */
+    double gpu_ms;
+};
+
 enum ProjectionType {
     Perspective,
     Orthographic
@@ -89,16 +117,136 @@ public:
 
     void instanced_draw(resources::Model *model, const resources::Shader *shader, glm::mat4 *model_matrix, int amount);
 
+    /**
+    * @brief Draws `amount` instances of the model with their model matrices, normal matrices and parameters.
+    */
+    void instanced_draw(resources::Model *model, const resources::Shader *shader,
+                        const resources::InstanceData *instances, int amount);
+
+    /**
+    * @brief Queues a draw of the `model` with the `shader`, whose uniforms are already set for every draw but the
+    * per-object data: the model matrix, the normal matrix and a few scalars, streamed as instance attributes, see
+    * @ref resources::InstanceData. A shader that declares them with `#include "include/instance.glsl"` reads them
+    * from the uniforms `model`, `invNormal` and `params` when drawn alone and from the attributes in its
+    * `INSTANCED` variant, under the same names, so its code stays the same.
+    * The queued draws of the same model and shader are merged into one instanced draw by @ref GraphicsController::flush_draws:
+    * @code
+    * shader->use();
+    * shader->set_mat4("view", graphics->camera()->view_matrix());
+    * for (auto &object: objects) {
+    *     graphics->queue_draw(model, shader, {.model = object.model_matrix(), .normal = object.normal_matrix()});
+    * }
+    * graphics->flush_draws();
+    * @endcode
+    */
+    void queue_draw(resources::Model *model, const resources::Shader *shader, const resources::InstanceData &instance);
+
+    /**
+    * @brief Issues the draws queued by @ref GraphicsController::queue_draw, one instanced draw per model and shader,
+    * in the current render state. The leftovers of a frame are flushed at its end.
+    * @returns Number of issued draws.
+    */
+    uint32_t flush_draws();
+
+    /**
+    * @brief Uploads the plane vertices. The vao and its buffer are owned by the GraphicsController and released on terminate.
+    * @returns vao of the plane.
+    */
     unsigned int set_plane(float *vertices, size_t length);
 
     void draw_plane(unsigned int vao, const resources::Shader *shader, resources::Texture *texture);
 
+    /**
+    * @returns Number of screen pixels one world unit spans at the point of the box closest to the camera.
+    * @param box_min minimum corner of a world-space axis-aligned box.
+    * @param box_max maximum corner of a world-space axis-aligned box.
+    */
+    float pixels_per_unit(const glm::vec3 &box_min, const glm::vec3 &box_max) const;
+
+    /**
+    * @brief Reports the on-screen size of the textures of every mesh in the `model` drawn with `model_matrix`,
+    * see @ref resources::Texture::request_screen_size. Assumes that the texture coordinates of a mesh span
+    * its bounding box once.
+    */
+    void request_texture_detail(const resources::Model *model, const glm::mat4 &model_matrix) const;
+
+    /**
+    * @brief Reports the on-screen size of a `texture` that covers the world-space box, see @ref resources::Texture::request_screen_size.
+    * @param uv_repeat how many times the texture repeats along the larger side of the box.
+    */
+    void request_texture_detail(resources::Texture *texture, const glm::vec3 &box_min, const glm::vec3 &box_max,
+                                float uv_repeat = 1.0f) const;
+
+    /**
+    * @brief Uploads the crosshair vertices. The vao and its buffer are owned by the GraphicsController and released on terminate.
+    * @returns vao of the crosshair.
+    */
     unsigned int set_crosshair(float *vertices, size_t length);
 
     void draw_crosshair(const resources::Shader *shader, unsigned int vao);
 
+    /**
+    * @brief Registers a program and the vertex array it's drawn with for the @ref GraphicsController::warm_up.
+    * @param layout name of the vertex layout shown in the report, for example "plane".
+    */
+    void register_warm_up(const resources::Shader *shader, unsigned int vao, std::string layout);
+
+    /**
+    * @brief Registers a program and the vertex layout of the `model` meshes for the @ref GraphicsController::warm_up.
+    * All the meshes share the layout, so only the first one is drawn; a model that's still loading is drawn
+    * with its placeholder mesh, which has the same layout.
+    */
+    void register_warm_up(const resources::Shader *shader, const resources::Model *model);
+
+    /**
+    * @brief Draws every registered program and vertex layout pair once into a small offscreen target
+    * and clears the registrations.
+    *
+    * Drivers finish compiling a program the first time it's drawn, for the vertex format and state of that draw,
+    * so the first frame that uses it stalls. Called after the resources are loaded, while the loading screen
+    * is shown, it moves those stalls out of the game:
+    * @code
+    * auto shader = resources->shader("cabin");
+    * graphics->register_warm_up(shader, resources->model("cabin1"));
+    * graphics->register_warm_up(shader->variant(shader->feature("SPOTLIGHT")), resources->model("cabin1"));
+    * graphics->register_warm_up(resources->shader("crosshair"), crosshair_vao, "crosshair");
+    * graphics->warm_up();
+    * @endcode
+    * @returns The cost of the first draw of every pair, also written to the log.
+    */
+    std::vector<WarmUpCost> warm_up();
+
     Camera *camera() { return &m_camera; }
 
+    /**
+    * @returns The depth pyramid of the previous frame for occlusion culling, or nullptr if Hi-Z is disabled
+    * or no frame was drawn yet. See @ref DepthPyramid.
+    */
+    const DepthPyramid *depth_pyramid() const {
+        return m_depth_pyramid.ready() ? &m_depth_pyramid : nullptr;
+    }
+
+    /**
+    * @returns The CPU occlusion culler of the frame, or nullptr if it's disabled. See @ref OcclusionCuller.
+    */
+    OcclusionCuller *occlusion_culler() {
+        return m_occlusion_culler.enabled() ? &m_occlusion_culler : nullptr;
+    }
+
+    /**
+    * @returns The camera of the frame as seen by a model drawn with `model_matrix`, for drawing only its visible
+    * meshlets with @ref resources::Model::draw, or nothing if meshlet culling is disabled.
+    *
+    * Opt-in in the config.json. The backfacing meshlets are culled unless `backfaces` is false; that also culls
+    * the backfacing triangles, so it's only right for models that are wound consistently:
+    * @code
+    * "graphics": {
+    *   "meshlet_culling": {"backfaces": true}
+    * }
+    * @endcode
+    */
+    std::optional<resources::MeshletView> meshlet_view(const glm::mat4 &model_matrix);
+
     /**
     * @brief Compute the projection matrix.
     * @returns Return perspective projection by default.
@@ -160,7 +308,17 @@ private:
     */
     void initialize() override;
 
-    void terminate();
+    /**
+    * @brief Marks the frame boundary for the @ref GLTrace capture.
+    */
+    void begin_draw() override;
+
+    /**
+    * @brief Marks the frame boundary for the @ref GLResourceRegistry reports and soak test.
+    */
+    void end_draw() override;
+
+    void terminate() override;
 
     PerspectiveMatrixParams m_perspective_params{};
     OrthographicMatrixParams m_ortho_params{};
@@ -168,6 +326,42 @@ private:
     glm::mat4 m_projection_matrix{};
     Camera m_camera{};
     ImGuiContext *m_imgui_context{};
+
+    /**
+    * @brief Vertex arrays and buffers created by @ref GraphicsController::set_plane and @ref GraphicsController::set_crosshair.
+    */
+    std::vector<GLVertexArray> m_vertex_arrays;
+    std::vector<GLBuffer> m_buffers;
+
+    /**
+    * @brief A program and vertex array pair registered for the @ref GraphicsController::warm_up.
+    */
+    struct WarmUpDraw {
+        const resources::Shader *shader;
+        unsigned int vao;
+        std::string layout;
+    };
+
+    std::vector<WarmUpDraw> m_warm_up;
+
+    /**
+    * @brief A draw queued by @ref GraphicsController::queue_draw.
+    */
+    struct QueuedDraw {
+        resources::Model *model;
+        const resources::Shader *shader;
+        resources::InstanceData instance;
+    };
+
+    std::vector<QueuedDraw> m_queued_draws;
+    /**
+    * @brief Instances of the draw being flushed, kept to not allocate every frame.
+    */
+    std::vector<resources::InstanceData> m_instances;
+    DepthPyramid m_depth_pyramid;
+    OcclusionCuller m_occlusion_culler;
+    bool m_meshlet_culling{false};
+    bool m_meshlet_backfaces{true};
 };
 
 /**
@@ -0,0 +1,177 @@
+/**
+ * @file OcclusionCuller.hpp
+ * @brief Defines the OcclusionCuller class that rasterizes occluders into a small depth buffer on the CPU
+ * and tests bounding boxes against it.
+*/
+
+#ifndef MATF_RG_PROJECT_OCCLUSION_CULLER_HPP
+#define MATF_RG_PROJECT_OCCLUSION_CULLER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace engine::resources {
+class Model;
+}
+
+namespace engine::graphics {
+/**
+* @brief Low-poly stand-in of an object for the @ref OcclusionCuller, in the model space of the object.
+* The triangles are counter-clockwise when seen from the front; back faces aren't rasterized.
+*/
+struct OccluderMesh {
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> indices;
+
+    /**
+    * @returns The 12 triangles of the box between `box_min` and `box_max`, facing out.
+    */
+    static OccluderMesh box(const glm::vec3 &box_min, const glm::vec3 &box_max);
+};
+
+/**
+* @brief What the @ref OcclusionCuller did in the last frame.
+*/
+struct OcclusionStats {
+    uint32_t occluder_triangles{0};
+    uint32_t tested{0};
+    uint32_t culled{0};
+    /**
+    * @brief CPU time of the occluder setup, the rasterization and the tests.
+    */
+    double cpu_ms{0.0};
+};
+
+/**
+* @class OcclusionCuller
+* @brief Software occlusion culling: the large objects of the scene are drawn into a small depth buffer on the CPU,
+* and the bounding boxes of the other objects are tested against it before their draws are submitted.
+*
+* Nothing is read back from the GPU, so the culling works the same in every frame, with or without a window.
+* The depth buffer is rasterized in horizontal bands on the @ref util::WorkerPool, 4 pixels at a time with SSE2.
+* Every frame:
+* @code
+* auto occlusion = graphics->occlusion_culler();
+* occlusion->add_occluder(resources->model("cabin1"), cabin_matrix);
+* occlusion->add_occluder(ground, glm::mat4(1.0f));
+* ...
+* if (occlusion->visible(target, target_matrix)) {
+*     target->draw(shader);
+* }
+* @endcode
+* The first test after the occluders were added rasterizes them. The view projection matrix is taken from the
+* camera when the @ref GraphicsController begins the frame.
+*
+* Opt-in in the config.json, with the size of the depth buffer:
+* @code
+* "graphics": {
+*   "occlusion_culling": {"width": 256, "height": 128}
+* }
+* @endcode
+*/
+class OcclusionCuller {
+public:
+    /**
+    * @brief Scale of the boxes made from the mesh bounds of a model, around their centers.
+    * A bounding box is larger than the mesh inside it, and an occluder must not be, or it would hide visible objects.
+    */
+    static constexpr float DEFAULT_OCCLUDER_SCALE = 0.8f;
+
+    /**
+    * @brief Reads the config.json. Called by the @ref GraphicsController.
+    */
+    void initialize();
+
+    bool enabled() const {
+        return m_enabled;
+    }
+
+    /**
+    * @brief Clears the depth buffer and the occluders. Called by the @ref GraphicsController at the start of a frame.
+    */
+    void begin_frame(const glm::mat4 &view_projection);
+
+    /**
+    * @brief Adds the triangles of an occluder for this frame.
+    */
+    void add_occluder(const OccluderMesh &mesh, const glm::mat4 &model_matrix);
+
+    /**
+    * @brief Adds a box for every mesh of the model: its bounds scaled by `scale`.
+    */
+    void add_occluder(const resources::Model *model, const glm::mat4 &model_matrix,
+                      float scale = DEFAULT_OCCLUDER_SCALE);
+
+    /**
+    * @returns false if the box, transformed by `model_matrix`, is behind the occluders or outside the screen.
+    */
+    bool visible(const glm::vec3 &box_min, const glm::vec3 &box_max, const glm::mat4 &model_matrix);
+
+    /**
+    * @returns false if the bounds of the model's meshes are behind the occluders or outside the screen.
+    */
+    bool visible(const resources::Model *model, const glm::mat4 &model_matrix);
+
+    /**
+    * @returns Statistics of the previous frame.
+    */
+    const OcclusionStats &stats() const {
+        return m_stats;
+    }
+
+private:
+    /**
+    * @brief A triangle set up for rasterization: its edge functions and depth plane over the pixel coordinates.
+    * A pixel center (x, y) is inside if `a[i] * x + b[i] * y + c[i] >= 0` for every edge.
+    */
+    struct Triangle {
+        float a[3];
+        float b[3];
+        float c[3];
+        float depth_dx;
+        float depth_dy;
+        float depth_c;
+        int32_t min_x;
+        int32_t max_x;
+        int32_t min_y;
+        int32_t max_y;
+    };
+
+    /**
+    * @brief Clips a triangle against the near plane and sets up the parts in front of it.
+    */
+    void add_triangle(const glm::vec4 &v0, const glm::vec4 &v1, const glm::vec4 &v2);
+
+    /**
+    * @brief Sets up a triangle with all its vertices in front of the near plane.
+    */
+    void setup_triangle(const glm::vec4 &v0, const glm::vec4 &v1, const glm::vec4 &v2);
+
+    /**
+    * @brief Rasterizes the occluders added since the last rasterization.
+    */
+    void rasterize();
+
+    void rasterize_band(uint32_t band);
+
+    /**
+    * @brief Adds the time since `start` to the CPU time of the frame.
+    */
+    void account(std::chrono::steady_clock::time_point start);
+
+    std::vector<float> m_depth;
+    std::vector<Triangle> m_triangles;
+    glm::mat4 m_view_projection{1.0f};
+    int32_t m_width{0};
+    int32_t m_height{0};
+    bool m_enabled{false};
+    bool m_rasterized{true};
+    bool m_reported_over_budget{false};
+    OcclusionStats m_frame_stats{};
+    OcclusionStats m_stats{};
+};
+} // namespace engine::graphics
+
+#endif//MATF_RG_PROJECT_OCCLUSION_CULLER_HPP
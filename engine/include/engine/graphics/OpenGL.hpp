@@ -6,9 +6,14 @@
 #ifndef OPENGL_HPP
 #define OPENGL_HPP
 
+#include <array>
 #include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <span>
 #include <engine/resources/Shader.hpp>
+#include <engine/graphics/GLTrace.hpp>
+#include <engine/graphics/GLResourceRegistry.hpp>
 
 namespace engine::resources {
 class Skybox;
@@ -25,9 +30,25 @@ class Skybox;
 * CHECKED_GL_CALL(glGenTextures, 1, &texture_id);
 * @endcode
 */
-#define CHECKED_GL_CALL(func, ...) engine::graphics::OpenGL::call(std::source_location::current(), func, __VA_ARGS__)
+#define CHECKED_GL_CALL(func, ...) engine::graphics::OpenGL::call(std::source_location::current(), #func, func __VA_OPT__(,) __VA_ARGS__)
 
 namespace engine::graphics {
+/**
+* @brief Image decoded into client memory, ready to be uploaded with @ref OpenGL::upload_texture.
+*/
+struct TextureImage {
+    int32_t width{0};
+    int32_t height{0};
+    int32_t channels{0};
+    std::shared_ptr<uint8_t> pixels;
+    std::filesystem::path path;
+};
+
+/**
+* @brief Faces of a cubemap, indexed as the OpenGL cubemap targets: right, left, top, bottom, front, back.
+*/
+using CubemapImages = std::array<TextureImage, 6>;
+
 /**
 * @class OpenGL
 * @brief This class serves as the OpenGL interface for your app, since the engine doesn't directly link OpenGL to the app executable.
@@ -40,27 +61,35 @@ public:
 
     /**
     * @brief Performs a checked OpenGL call. If the OpenGL call fails, it throws @ref engine::util::EngineError::Type::OpenGLError.
+    * While a @ref GLTrace capture is in progress, the call is also recorded.
 
     * @param location Source location of where the call was made.
+    * @param name Name of the OpenGL function, used for tracing.
     * @param glfun OpenGL function to call.
     * @param args  OpenGL function arguments.
     *
     * @returns Return value if the `glfun` has it, otherwise void.
     */
     template<typename TResult, typename... TOpenGLArgs, typename... Args>
-    static TResult call(std::source_location location, TResult (*glfun)(TOpenGLArgs...), Args... args) {
+    static TResult call(std::source_location location, std::string_view name, TResult (*glfun)(TOpenGLArgs...), Args... args) {
         // @formatter:off
         if constexpr (!std::is_same_v<TResult, void>) {
             auto result = glfun(std::forward<Args>(args)...);
             #ifndef NDEBUG
                 assert_no_error(location);
             #endif
+            if (GLTrace::capturing()) {
+                GLTrace::record(name, {GLTrace::encode(static_cast<TOpenGLArgs>(args))...}, GLTrace::encode(result));
+            }
             return result;
         } else {
             glfun(std::forward<Args>(args)...);
             #ifndef NDEBUG
                 assert_no_error(location);
             #endif
+            if (GLTrace::capturing()) {
+                GLTrace::record(name, {GLTrace::encode(static_cast<TOpenGLArgs>(args))...}, 0);
+            }
         }
         // @formatter:on
     }
@@ -76,9 +105,40 @@ public:
     *
     * @param path path to a texture file.
     * @param flip_uvs flip_uvs on load.
-    * @returns OpenGL id of a texture object.
+    * @returns Texture object that owns the OpenGL texture.
+    */
+    static GLTexture generate_texture(const std::filesystem::path &path, bool flip_uvs);
+
+    /**
+    * @brief Decodes the image file into client memory. Makes no OpenGL calls, so it's safe to call from any thread.
+    * @param path path to an image file.
+    * @param flip_uvs flip the image vertically.
+    * @returns Decoded image.
+    */
+    static TextureImage load_image(const std::filesystem::path &path, bool flip_uvs);
+
+    /**
+    * @brief Decodes an image file that is already in memory, for example read from a @ref resources::ResourcePack.
+    * Makes no OpenGL calls, so it's safe to call from any thread.
+    * @param encoded contents of the image file.
+    * @param path of the image, used for the error messages and the resource reports.
+    * @param flip_uvs flip the image vertically.
+    * @returns Decoded image.
+    */
+    static TextureImage decode_image(std::span<const uint8_t> encoded, const std::filesystem::path &path,
+                                     bool flip_uvs);
+
+    /**
+    * @brief Uploads the decoded image into a new 2D texture and generates its mipmaps.
+    * @returns Texture object that owns the OpenGL texture.
     */
-    static uint32_t generate_texture(const std::filesystem::path &path, bool flip_uvs);
+    static GLTexture upload_texture(const TextureImage &image);
+
+    /**
+    * @brief Creates a small checkerboard texture that stands in for a texture that is still loading.
+    * @returns Texture object that owns the OpenGL texture.
+    */
+    static GLTexture generate_placeholder_texture();
 
     /**
     * @brief Get texture format for a `number_of_channels`.
@@ -93,12 +153,23 @@ public:
     */
     static uint32_t init_skybox_cube();
 
+    /**
+    * @brief Releases the cube created by @ref OpenGL::init_skybox_cube. Called once all the skyboxes are destroyed.
+    */
+    static void destroy_skybox_cube();
+
     /**
     * @brief Check if the shader with the `shader_id` compiled successfully.
     * @returns true if the shader compilation succeeded, false otherwise.
     */
     static bool shader_compiled_successfully(uint32_t shader_id);
 
+    /**
+    * @brief Check if the program with the `program_id` linked successfully.
+    * @returns true if the program link succeeded, false otherwise.
+    */
+    static bool program_linked_successfully(uint32_t program_id);
+
     /**
     * @brief Compiles the shader from source.
     * @param shader_source source code for the shader
@@ -115,9 +186,34 @@ public:
     * side of the cubemap based on the texture file name.
     * @param path directory in which cubemap textures are located.
     * @param flip_uvs wheater to flip_uvs on texture loading.
-    * @returns OpenGL id to the cubemap texture
+    * @returns Texture object that owns the OpenGL cubemap texture.
+    */
+    static GLTexture load_skybox_textures(const std::filesystem::path &path, bool flip_uvs = false);
+
+    /**
+    * @brief Decodes the six skybox images from the `path` directory. Makes no OpenGL calls, so it's safe to call from any thread.
+    * See @ref OpenGL::load_skybox_textures for the naming of the files.
+    * @returns Decoded faces of the cubemap.
     */
-    static uint32_t load_skybox_textures(const std::filesystem::path &path, bool flip_uvs = false);
+    static CubemapImages load_skybox_images(const std::filesystem::path &path, bool flip_uvs = false);
+
+    /**
+    * @brief Uploads the decoded faces into a new cubemap texture.
+    * @returns Texture object that owns the OpenGL cubemap texture.
+    */
+    static GLTexture upload_cubemap(const CubemapImages &images, const std::filesystem::path &path);
+
+    /**
+    * @brief Creates a 1x1 grey cubemap that stands in for a skybox that is still loading.
+    * @returns Texture object that owns the OpenGL cubemap texture.
+    */
+    static GLTexture generate_placeholder_cubemap();
+
+    /**
+    * @param name of a skybox image without the extension: right, left, top, bottom, front or back.
+    * @returns Index of the cubemap face for the image, in the order of the OpenGL cubemap targets.
+    */
+    static uint32_t cubemap_face_index(std::string_view name);
 
     /**
     * @brief Enables depth testing.
@@ -141,6 +237,13 @@ public:
     */
     static std::string get_compilation_error_message(uint32_t shader_id);
 
+    /**
+    * @brief Retrieve the program link error log message.
+    * @param program_id Program id for which the link failed.
+    * @returns program link error message.
+    */
+    static std::string get_link_error_message(uint32_t program_id);
+
     /**
      * @brief set depth range
      */
@@ -152,6 +255,11 @@ private:
     * @param location Source location from where the OpenGL call was made.
     */
     static void assert_no_error(std::source_location location);
+
+    /**
+    * @brief Flips the decoded image vertically in place.
+    */
+    static void flip_image(TextureImage &image);
 };
 }
 #endif //OPENGL_HPP
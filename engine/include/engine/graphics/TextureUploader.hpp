@@ -0,0 +1,197 @@
+/**
+ * @file TextureUploader.hpp
+ * @brief Defines the TextureUploader class that streams texture data to the GPU within a per-frame budget.
+*/
+
+#ifndef MATF_RG_PROJECT_TEXTURE_UPLOADER_HPP
+#define MATF_RG_PROJECT_TEXTURE_UPLOADER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <engine/graphics/GLResourceRegistry.hpp>
+#include <engine/graphics/OpenGL.hpp>
+
+namespace engine::graphics {
+/**
+* @brief A single level of a mip chain in client memory.
+*/
+struct MipLevel {
+    int32_t width{0};
+    int32_t height{0};
+    std::vector<uint8_t> pixels;
+};
+
+/**
+* @brief Decoded image with its mip chain, prepared on a loader thread by @ref TextureUploader::prepare.
+*/
+struct StreamedImage {
+    int32_t channels{0};
+    /**
+    * @brief Level 0 is the full resolution image.
+    */
+    std::vector<MipLevel> levels;
+    std::filesystem::path path;
+};
+
+/**
+* @class TextureUploader
+* @brief Streams texture data to the GPU through a ring of pixel unpack buffers, within a per-frame budget.
+*
+* @ref TextureUploader::upload allocates the texture storage and returns right away; the pixels are copied
+* into the ring buffer and transferred with `glTexSubImage2D` over the following frames, smallest mip level first.
+* After each level, `GL_TEXTURE_BASE_LEVEL` is lowered, so textures sharpen progressively instead of popping in.
+* Large levels are split into bands of rows, so no single frame uploads more than the budget allows.
+*
+* The mip chain is generated on the loader thread, so the main thread never blocks on `glGenerateMipmap`.
+* Regions of the ring are reused only after the fence of the frame that read them has signaled.
+*
+* The budget is set in the config.json, and whichever limit is reached first ends the uploads for the frame:
+* @code
+* "graphics": {
+*   "texture_upload": {"budget_ms": 2.0, "budget_mb": 16, "ring_mb": 32}
+* }
+* @endcode
+*
+* OpenGL 3.3 has no persistently mapped buffers, so each band is written through an unsynchronized `glMapBufferRange`
+* of a region the GPU no longer reads.
+*/
+class TextureUploader {
+public:
+    static TextureUploader *instance();
+
+    /**
+    * @brief Generates the mip chain of the image with a box filter. Makes no OpenGL calls, so it's safe to call from any thread.
+    */
+    static StreamedImage prepare(const TextureImage &image);
+
+    /**
+    * @brief Creates the texture storage for every level and queues the levels for streaming.
+    * @returns Texture object that owns the OpenGL texture. It samples only the levels that have already been uploaded.
+    */
+    GLTexture upload(StreamedImage image);
+
+    /**
+    * @brief Uploads every level of the image at once, without the ring buffer or the budget.
+    * Used on the @ref GLUploadThread, where uploads don't hold up the frame.
+    * @returns Texture object that owns the OpenGL texture.
+    */
+    static GLTexture upload_levels(const StreamedImage &image);
+
+    /**
+    * @brief Creates a cubemap texture and queues its faces for streaming.
+    * @returns Texture object that owns the OpenGL cubemap texture.
+    */
+    GLTexture upload_cubemap(const CubemapImages &images, const std::filesystem::path &path);
+
+    /**
+    * @brief Drops the queued uploads of a texture that is about to be destroyed.
+    */
+    void cancel(uint32_t texture);
+
+    /**
+    * @brief Uploads queued data until the per-frame budget is spent. Called by the @ref GraphicsController every frame.
+    */
+    void process();
+
+    /**
+    * @brief Uploads all the queued data, waiting for the GPU if the ring is full.
+    */
+    void flush();
+
+    /**
+    * @returns true if some data of the texture is still waiting to be uploaded.
+    */
+    bool pending(uint32_t texture) const;
+
+    /**
+    * @returns Number of mip levels and cubemap faces waiting to be uploaded.
+    */
+    size_t pending_uploads() const {
+        return m_uploads.size();
+    }
+
+    /**
+    * @brief Reads the budget from the config.json and creates the ring buffer. Called by the @ref GraphicsController.
+    */
+    void initialize();
+
+    /**
+    * @brief Drops the queued uploads and releases the ring buffer.
+    */
+    void shutdown();
+
+private:
+    TextureUploader() = default;
+
+    struct Upload {
+        uint32_t texture;
+        /**
+        * @brief GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP.
+        */
+        uint32_t bind_target;
+        /**
+        * @brief GL_TEXTURE_2D or one of the GL_TEXTURE_CUBE_MAP_* faces.
+        */
+        uint32_t image_target;
+        int32_t level;
+        int32_t format;
+        int32_t width;
+        int32_t height;
+        int32_t channels;
+        std::shared_ptr<const uint8_t> pixels;
+        int32_t next_row;
+        /**
+        * @brief Lower GL_TEXTURE_BASE_LEVEL to this level once it's uploaded.
+        */
+        bool set_base_level;
+    };
+
+    struct FrameFence {
+        /**
+        * @brief `GLsync` of the frame; kept opaque so that the header doesn't depend on glad.
+        */
+        void *fence;
+        /**
+        * @brief Bytes of the ring the frame used, including the ones skipped when wrapping around.
+        */
+        uint64_t bytes;
+    };
+
+    /**
+    * @param unlimited ignore the budget and wait for the GPU when the ring is full.
+    */
+    void upload_queued(bool unlimited);
+
+    /**
+    * @returns Offset of `size` free bytes in the ring, or nothing if the GPU still reads that much of it.
+    */
+    std::optional<uint64_t> allocate(uint64_t size);
+
+    /**
+    * @brief Places a fence after the uploads of the frame, so that their region of the ring can be reused once it signals.
+    */
+    void end_frame();
+
+    /**
+    * @brief Releases the ring regions of the frames whose fence has signaled.
+    * @param wait block until the oldest frame finishes.
+    */
+    void retire(bool wait);
+
+    std::deque<Upload> m_uploads;
+    std::deque<FrameFence> m_fences;
+    GLBuffer m_ring;
+    uint64_t m_capacity{0};
+    uint64_t m_head{0};
+    uint64_t m_used{0};
+    uint64_t m_frame_bytes{0};
+    double m_budget_ms{2.0};
+    uint64_t m_budget_bytes{16 * 1024 * 1024};
+};
+} // namespace engine::graphics
+
+#endif//MATF_RG_PROJECT_TEXTURE_UPLOADER_HPP
@@ -0,0 +1,191 @@
+/**
+ * @file GeometryBuffer.hpp
+ * @brief Defines the GeometryBuffer class that stores the vertices and indices of all the meshes in two shared buffers.
+*/
+
+#ifndef MATF_RG_PROJECT_GEOMETRY_BUFFER_HPP
+#define MATF_RG_PROJECT_GEOMETRY_BUFFER_HPP
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <engine/graphics/GLResourceRegistry.hpp>
+
+namespace engine::resources {
+/**
+* @brief Vertices and indices of a mesh in the @ref GeometryBuffer.
+* The indices are relative to the first vertex, so draws pass `first_vertex` as the base vertex.
+*/
+struct GeometryRange {
+    uint32_t first_vertex{0};
+    uint32_t vertex_count{0};
+    uint32_t first_index{0};
+    uint32_t index_count{0};
+};
+
+/**
+* @class GeometryAllocation
+* @brief Move-only owner of a @ref GeometryRange. The range is returned to the @ref GeometryBuffer
+* when the allocation is destroyed or reset.
+*/
+class GeometryAllocation {
+    friend class GeometryBuffer;
+
+public:
+    GeometryAllocation() = default;
+
+    GeometryAllocation(const GeometryAllocation &) = delete;
+
+    GeometryAllocation &operator=(const GeometryAllocation &) = delete;
+
+    GeometryAllocation(GeometryAllocation &&other) noexcept
+            : m_range(other.m_range)
+              , m_valid(std::exchange(other.m_valid, false)) {
+    }
+
+    GeometryAllocation &operator=(GeometryAllocation &&other) noexcept {
+        if (this != &other) {
+            reset();
+            m_range = other.m_range;
+            m_valid = std::exchange(other.m_valid, false);
+        }
+        return *this;
+    }
+
+    ~GeometryAllocation() {
+        reset();
+    }
+
+    const GeometryRange &get() const {
+        return m_range;
+    }
+
+    /**
+    * @returns Bytes of the shared buffers the range occupies.
+    */
+    uint64_t bytes() const;
+
+    explicit operator bool() const {
+        return m_valid;
+    }
+
+    /**
+    * @brief Returns the range to the @ref GeometryBuffer. The allocation becomes empty.
+    */
+    void reset();
+
+private:
+    explicit GeometryAllocation(GeometryRange range) : m_range(range), m_valid(true) {
+    }
+
+    GeometryRange m_range{};
+    bool m_valid{false};
+};
+
+/**
+* @class GeometryBuffer
+* @brief One vertex buffer and one index buffer that every @ref Mesh is sub-allocated from, in the @ref Vertex layout.
+*
+* With all the meshes in the same buffers, a @ref MultiDraw submits many meshes with a single
+* `glMultiDrawElementsIndirect` call, without switching vertex arrays between them. A mesh in the geometry buffer
+* keeps its own vertex array, pointed at the shared buffers, so @ref Mesh::draw works as before.
+*
+* Opt-in, with the capacities in the config.json:
+* @code
+* "graphics": {
+*   "geometry_buffer": {"vertices": 1048576, "indices": 4194304}
+* }
+* @endcode
+* The buffers don't grow: when a mesh doesn't fit, it gets buffers of its own and is drawn one by one.
+* Requires GL 4.3, see @ref graphics::GLExtensions::multi_draw_indirect; on older drivers every mesh has its own
+* buffers.
+*/
+class GeometryBuffer {
+    friend class GeometryAllocation;
+
+public:
+    static GeometryBuffer *instance();
+
+    /**
+    * @brief Reads the capacities from the config.json and creates the buffers. Called by the @ref graphics::GraphicsController.
+    */
+    void initialize();
+
+    /**
+    * @brief Releases the buffers. Allocations that are still alive are dropped silently when they're reset.
+    */
+    void shutdown();
+
+    /**
+    * @returns true if meshes are placed in the geometry buffer.
+    */
+    bool enabled() const {
+        return m_enabled;
+    }
+
+    /**
+    * @brief Copies the vertices and indices of a mesh from its own buffers into the shared ones.
+    * @returns The range of the mesh, or an empty allocation if the buffer is disabled or full.
+    */
+    GeometryAllocation allocate(const graphics::GLBuffer &vertices, uint32_t vertex_count,
+                                const graphics::GLBuffer &indices, uint32_t index_count);
+
+    /**
+    * @returns OpenGL ID of the shared vertex buffer.
+    */
+    uint32_t vertex_buffer() const {
+        return m_vertices.id();
+    }
+
+    /**
+    * @returns OpenGL ID of the shared index buffer.
+    */
+    uint32_t index_buffer() const {
+        return m_indices.id();
+    }
+
+    /**
+    * @brief Binds the vertex array of the shared buffers, with the draw index attribute read by the @ref MultiDraw
+    * shaders filled for at least `draws` draws.
+    */
+    void bind(uint32_t draws);
+
+private:
+    GeometryBuffer() = default;
+
+    /**
+    * @brief Free ranges of a buffer, by offset, merged with their neighbours when a range is freed.
+    */
+    class FreeList {
+    public:
+        void reset(uint32_t capacity);
+
+        /**
+        * @returns Offset of the first free range of `count` elements, or UINT32_MAX if none is large enough.
+        */
+        uint32_t allocate(uint32_t count);
+
+        void free(uint32_t offset, uint32_t count);
+
+    private:
+        std::map<uint32_t, uint32_t> m_free;
+    };
+
+    void free(const GeometryRange &range);
+
+    graphics::GLBuffer m_vertices;
+    graphics::GLBuffer m_indices;
+    graphics::GLVertexArray m_vao;
+    /**
+    * @brief Instanced attribute holding 0, 1, 2, ...; a draw with `baseInstance` i reads i from it.
+    */
+    graphics::GLBuffer m_draw_ids;
+    uint32_t m_draw_id_count{0};
+    FreeList m_free_vertices;
+    FreeList m_free_indices;
+    bool m_enabled{false};
+    bool m_reported_full{false};
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_GEOMETRY_BUFFER_HPP
@@ -0,0 +1,102 @@
+/**
+ * @file InstanceCuller.hpp
+ * @brief Defines the InstanceCuller class that culls the instances of a model on the GPU and draws the visible ones indirectly.
+*/
+
+#ifndef MATF_RG_PROJECT_INSTANCE_CULLER_HPP
+#define MATF_RG_PROJECT_INSTANCE_CULLER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include <engine/graphics/GLResourceRegistry.hpp>
+#include <engine/resources/MultiDraw.hpp>
+
+namespace engine::graphics {
+class DepthPyramid;
+}
+
+namespace engine::resources {
+class Model;
+class Shader;
+
+/**
+* @class InstanceCuller
+* @brief Draws the instances of a model that are in the view frustum, selected by a compute shader,
+* without reading anything back to the CPU.
+*
+* The instance matrices are uploaded once with @ref InstanceCuller::set_instances. Every @ref InstanceCuller::draw
+* runs one thread per instance that transforms the bounding box of the model (the union of the
+* @ref Mesh::min_vertex and @ref Mesh::max_vertex of its meshes) by the instance matrix and tests it against the
+* frustum planes. The matrices of the visible instances are appended to an output buffer, and their number is written
+* straight into the `instanceCount` of the `glDrawElementsIndirect` command of every mesh. The meshes read their
+* instance matrices (locations 3 to 6, as with @ref Model::instanced_draw) from the output buffer, so the shaders
+* of instanced models work unchanged.
+*
+* With a @ref graphics::DepthPyramid the instances hidden behind the depth of the previous frame are culled as well.
+*
+* @code
+* if (InstanceCuller::supported()) {
+*     culler.set_instances(tree, matrices.data(), matrices.size());
+*     ...
+*     culler.draw(shader, projection * view, graphics->depth_pyramid());
+* }
+* @endcode
+* Requires @ref graphics::GLExtensions::compute_shader.
+*/
+class InstanceCuller {
+public:
+    InstanceCuller();
+
+    ~InstanceCuller();
+
+    /**
+    * @returns true if instances can be culled on the GPU.
+    */
+    static bool supported();
+
+    /**
+    * @brief Uploads the instance matrices of the model. Only needed when the instances change.
+    */
+    void set_instances(Model *model, const glm::mat4 *model_matrices, uint32_t amount);
+
+    /**
+    * @brief Culls the instances and draws the visible ones with the shader.
+    * @param view_projection Matrix the frustum planes are taken from.
+    * @param pyramid Depth of the previous frame for occlusion culling; nullptr tests the frustum only.
+    */
+    void draw(const Shader *shader, const glm::mat4 &view_projection, const graphics::DepthPyramid *pyramid = nullptr);
+
+    /**
+    * @brief Releases the buffers and the compute shaders.
+    */
+    void destroy();
+
+    /**
+    * @returns Number of instances set with @ref InstanceCuller::set_instances.
+    */
+    uint32_t size() const {
+        return m_amount;
+    }
+
+private:
+    Model *m_model{nullptr};
+    uint32_t m_amount{0};
+    graphics::GLBuffer m_instances;
+    /**
+    * @brief Matrices of the visible instances, read by the instance attributes of the meshes.
+    */
+    graphics::GLBuffer m_visible;
+    graphics::GLBuffer m_commands;
+    uint64_t m_commands_capacity{0};
+    std::vector<DrawElementsIndirectCommand> m_mesh_commands;
+    std::unique_ptr<Shader> m_cull;
+    /**
+    * @brief Copies the number of visible instances from the command of the first mesh to the others.
+    */
+    std::unique_ptr<Shader> m_share_count;
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_INSTANCE_CULLER_HPP
@@ -0,0 +1,34 @@
+/**
+ * @file InstanceData.hpp
+ * @brief Defines the InstanceData that instanced draws stream to the shaders for every object.
+*/
+
+#ifndef MATF_RG_PROJECT_INSTANCE_DATA_HPP
+#define MATF_RG_PROJECT_INSTANCE_DATA_HPP
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace engine::resources {
+/**
+* @struct InstanceData
+* @brief Per-object data of an instanced draw, read by the shader from the instance attributes: the model matrix at
+* locations 3 to 6, the normal matrix at 8 to 10 and the parameters at 11. Location 7 is left to @ref MultiDraw.
+*/
+struct InstanceData {
+    static constexpr uint32_t NORMAL_LOCATION = 8;
+    static constexpr uint32_t PARAMS_LOCATION = 11;
+
+    glm::mat4 model{1.0f};
+    /**
+    * @brief Inverse transpose of the model matrix, so that the shader doesn't invert it for every vertex.
+    */
+    glm::mat3 normal{1.0f};
+    /**
+    * @brief A few scalars of the object for the shader, for example its shininess or tint.
+    */
+    glm::vec4 params{0.0f};
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_INSTANCE_DATA_HPP
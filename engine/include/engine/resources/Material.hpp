@@ -0,0 +1,62 @@
+/**
+ * @file Material.hpp
+ * @brief Defines the Material class that binds the textures of a mesh for a shader.
+*/
+
+#ifndef MATF_RG_PROJECT_MATERIAL_HPP
+#define MATF_RG_PROJECT_MATERIAL_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace engine::resources {
+class Shader;
+class Texture;
+
+/**
+* @class Material
+* @brief The textures of a @ref Mesh resolved to the texture units of one @ref Shader.
+*
+* The i-th texture of a type is sampled by the uniform named after @ref Texture::uniform_name_convention and i,
+* for example `texture_diffuse1` and `texture_specular1`. The names are looked up once, when the material is built,
+* and the shader keeps the unit of every sampler, see @ref Shader::sampler_unit. Drawing then only binds the textures:
+* with one `glBindTextures` call when the driver offers it, see @ref graphics::GLExtensions::multi_bind.
+*
+* Built by the @ref Mesh the first time it's drawn with a shader.
+*/
+class Material {
+public:
+    /**
+    * @brief Texture units a material can use.
+    */
+    static constexpr uint32_t MAX_TEXTURES = 16;
+
+    /**
+    * @brief Resolves the units of the `textures` in the `shader`. Textures the shader doesn't sample are left out.
+    */
+    Material(const Shader *shader, const std::vector<Texture *> &textures);
+
+    /**
+    * @brief Binds the textures to their units. The shader doesn't have to be in use.
+    */
+    void bind() const;
+
+    /**
+    * @returns The shader the material was built for.
+    */
+    const Shader *shader() const {
+        return m_shader;
+    }
+
+private:
+    const Shader *m_shader;
+    /**
+    * @brief Texture of every unit in [0, m_units), nullptr for the units the shader uses for other samplers.
+    */
+    std::array<Texture *, MAX_TEXTURES> m_textures{};
+    uint32_t m_units{0};
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_MATERIAL_HPP
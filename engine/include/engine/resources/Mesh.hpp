@@ -7,8 +7,17 @@
 #define MATF_RG_PROJECT_MESH_HPP
 
 #include <glm/glm.hpp>
+#include <filesystem>
+#include <memory>
+#include <utility>
 #include <vector>
+#include <engine/resources/GeometryBuffer.hpp>
+#include <engine/resources/InstanceData.hpp>
+#include <engine/resources/Material.hpp>
+#include <engine/resources/Meshlet.hpp>
 #include <engine/resources/Texture.hpp>
+#include <engine/resources/TriangleBvh.hpp>
+#include <engine/graphics/GLResourceRegistry.hpp>
 
 namespace engine::resources {
 /**
@@ -24,35 +33,127 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+/**
+* @struct MeshData
+* @brief A mesh imported into client memory, before it's uploaded to the OpenGL context.
+* Produced by the model import, which can run on a loader thread.
+*/
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    /**
+    * @brief Texture files referenced by the mesh material, with their types.
+    */
+    std::vector<std::pair<std::filesystem::path, TextureType>> textures;
+    /**
+    * @brief Clusters of the triangles, see @ref Meshlet::build. The indices are already in their order.
+    */
+    std::vector<Meshlet> meshlets;
+    /**
+    * @brief Triangles kept for exact ray queries; only built for the models that ask for it.
+    */
+    std::shared_ptr<const TriangleBvh> triangles;
+};
+
+/**
+* @struct MeshBuffers
+* @brief Vertex and index buffers of a mesh, without the vertex array.
+* Buffers are shared between OpenGL contexts and vertex arrays aren't, so the buffers can be filled
+* on the @ref graphics::GLUploadThread and the vertex array is created on the main thread.
+*/
+struct MeshBuffers {
+    graphics::GLBuffer vbo;
+    graphics::GLBuffer ebo;
+    uint32_t num_vertices{0};
+    uint32_t num_indices{0};
+    glm::vec3 min_vertex{0.0f};
+    glm::vec3 max_vertex{0.0f};
+    /**
+    * @brief Carried over from the @ref MeshData; empty for meshes that aren't split.
+    */
+    std::vector<Meshlet> meshlets;
+    std::shared_ptr<const TriangleBvh> triangles;
+};
+
 /**
 * @class Mesh
 * @brief Represents a mesh in the model in the OpenGL context.
 */
 class Mesh {
-    friend class AssimpSceneProcessor;
+    friend class ResourcesController;
+    friend class GeometryBuffer;
+    friend class InstanceCuller;
+    friend class MultiDraw;
 
 public:
     /**
     * @brief Draws the mesh using a given shader. Called by the @ref Model::draw function to draw all the meshes in the model.
+    * The textures are bound through the @ref Material of the shader, built on the first draw with it.
     * @param shader The shader to use for drawing.
     */
     void draw(const Shader *shader);
 
     /**
-    * @brief Destroys the mesh in the OpenGL context.
+    * @brief Draws only the meshlets of the mesh that are inside the frustum and, if `view.backfaces` is set,
+    * face the camera. The visible ranges are merged and submitted with one `glMultiDrawElementsBaseVertex`.
+    * Draws the whole mesh if it has no meshlets.
+    * @returns Number of meshlets drawn.
+    */
+    uint32_t draw(const Shader *shader, const MeshletView &view);
+
+    /**
+    * @brief Destroys the mesh in the OpenGL context: the vertex array, the vertex, index and instance buffers.
+    * The objects are deleted by the @ref graphics::GLDeletionQueue once in-flight frames are done with them,
+    * so a mesh can be destroyed in the middle of a frame.
     */
     void destroy();
 
     /**
-     * @brief setting up for instanced drawing
+     * @brief setting up for instanced drawing. The instance buffer is created on the first call and reused afterwards;
+     * it only grows when `amount` exceeds its capacity.
      */
     void set_instanced_draw(glm::mat4 *model_matrix, int amount);
 
+    /**
+    * @brief Like @ref Mesh::set_instanced_draw with the model matrices, with the normal matrices and parameters
+    * of the instances as well.
+    */
+    void set_instanced_draw(const InstanceData *instances, int amount);
+
     /**
      * @brief instanced drawing the mesh using a given shader
      */
     void instanced_draw(const Shader *shader, int amount);
 
+    /**
+    * @returns Estimated GPU memory used by the vertex, index and instance buffers.
+    */
+    uint64_t gpu_bytes() const;
+
+    /**
+    * @returns The textures the mesh binds when it's drawn.
+    */
+    const std::vector<Texture *> &textures() const {
+        return m_textures;
+    }
+
+    /**
+    * @returns OpenGL ID of the vertex array of the mesh.
+    */
+    uint32_t vao() const {
+        return m_vao.id();
+    }
+
+    uint32_t meshlet_count() const {
+        return static_cast<uint32_t>(m_meshlets.size());
+    }
+
+    /**
+    * @returns Triangles of the mesh on the CPU, or nullptr if the model wasn't loaded with `hit_test`.
+    */
+    const TriangleBvh *triangle_bvh() const {
+        return m_triangle_bvh.get();
+    }
 
     /**
      * @brief used later for calculating bounding box of model
@@ -70,14 +171,83 @@ private:
     Mesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
          std::vector<Texture *> textures);
 
+    /**
+    * @brief Constructs a Mesh object from buffers that are already filled, creating only its vertex array.
+    * When the @ref GeometryBuffer is enabled, the data is copied into it and the buffers are released.
+    * @param buffers The vertex and index buffers, see @ref Mesh::upload.
+    * @param textures The textures in the mesh.
+    */
+    Mesh(MeshBuffers buffers, std::vector<Texture *> textures);
+
+    /**
+    * @brief Creates and fills the vertex and index buffers of a mesh. Binds only `GL_COPY_WRITE_BUFFER`,
+    * so it can run on the @ref graphics::GLUploadThread.
+    */
+    static MeshBuffers upload(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
+
     /**
      * @brief calculating min_vertex and max_vertex
      */
-    void calculate_minmax_vertex(const std::vector<Vertex> &vertices);
+    static void calculate_minmax_vertex(const std::vector<Vertex> &vertices, MeshBuffers &buffers);
+
+    /**
+    * @brief Returns the material of the mesh for the shader, building it on the first request.
+    */
+    const Material &material(const Shader *shader);
+
+    /**
+    * @brief Sets the attributes of the @ref Vertex layout on the bound vertex array, read from the bound `GL_ARRAY_BUFFER`.
+    */
+    static void set_vertex_layout();
+
+    /**
+    * @brief Uploads `size` bytes of instance data to `m_instance_vbo`, growing it when they don't fit.
+    */
+    void upload_instances(const void *data, uint64_t size);
+
+    /**
+    * @brief Points the instance matrix attributes (locations 3 to 6) of the vertex array at `buffer`,
+    * unless they already read from it. With the stride of an @ref InstanceData, the normal matrix and parameter
+    * attributes read from it as well; otherwise they are disabled.
+    */
+    void set_instance_source(uint32_t buffer, uint32_t stride = sizeof(glm::mat4));
+
+    /**
+    * @returns Offset of the first index of the mesh in the bound index buffer, as `glDrawElements` takes it.
+    */
+    const void *index_offset() const;
 
-    uint32_t m_vao{0};
+    graphics::GLVertexArray m_vao;
+    graphics::GLBuffer m_vbo;
+    graphics::GLBuffer m_ebo;
+    graphics::GLBuffer m_instance_vbo;
+    /**
+    * @brief Range of the mesh in the @ref GeometryBuffer; empty if the mesh has its own vertex and index buffers.
+    */
+    GeometryAllocation m_geometry;
+    uint64_t m_instance_capacity{0};
+    /**
+    * @brief Buffer the instance matrix attributes read from: `m_instance_vbo`, or the output of an @ref InstanceCuller.
+    */
+    uint32_t m_instance_source{0};
+    uint32_t m_instance_stride{0};
     uint32_t m_num_indices{0};
     std::vector<Texture *> m_textures;
+    /**
+    * @brief Materials of the shaders the mesh was drawn with. A mesh is drawn with a few shaders at most,
+    * so they are searched linearly.
+    */
+    std::vector<Material> m_materials;
+    std::vector<Meshlet> m_meshlets;
+    MeshletBounds m_meshlet_bounds;
+    std::shared_ptr<const TriangleBvh> m_triangle_bvh;
+    /**
+    * @brief Scratch memory of the culled draws, kept to avoid allocations every frame.
+    */
+    std::vector<uint8_t> m_meshlet_visible;
+    std::vector<int32_t> m_draw_counts;
+    std::vector<const void *> m_draw_offsets;
+    std::vector<int32_t> m_draw_base_vertices;
 };
 }// namespace engine
 
@@ -0,0 +1,105 @@
+/**
+ * @file Meshlet.hpp
+ * @brief Defines the Meshlet clusters a mesh is split into at import, and the culling of the clusters before a draw.
+*/
+
+#ifndef MATF_RG_PROJECT_MESHLET_HPP
+#define MATF_RG_PROJECT_MESHLET_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace engine::resources {
+struct Vertex;
+
+/**
+* @struct Meshlet
+* @brief A cluster of neighbouring triangles of a mesh, with a contiguous range of its indices.
+*
+* The bounds are in the model space of the mesh. The normal cone holds the normals of all the triangles:
+* none of them faces the camera if `dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius`.
+*/
+struct Meshlet {
+    static constexpr uint32_t MAX_TRIANGLES = 124;
+    static constexpr uint32_t MAX_VERTICES = 64;
+
+    uint32_t first_index{0};
+    uint32_t index_count{0};
+    glm::vec3 center{0.0f};
+    float radius{0.0f};
+    glm::vec3 cone_axis{0.0f};
+    /**
+    * @brief Sine of the cone angle; 1 if the normals spread too far for the cluster to ever be backfacing.
+    */
+    float cone_cutoff{1.0f};
+
+    /**
+    * @brief Splits a triangle list into meshlets of at most @ref Meshlet::MAX_TRIANGLES triangles
+    * and @ref Meshlet::MAX_VERTICES vertices, growing each from a seed triangle through the triangles that share
+    * its vertices. The indices are reordered so that every meshlet is a contiguous range of them.
+    * @returns The meshlets, or none if the indices aren't a triangle list.
+    */
+    static std::vector<Meshlet> build(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+};
+
+/**
+* @struct MeshletView
+* @brief The camera as seen from the model space of a mesh, for @ref MeshletBounds::cull.
+*/
+struct MeshletView {
+    /**
+    * @param view_projection The projection matrix times the view matrix of the camera.
+    * @param camera_position The camera position in world space.
+    * @param model_matrix The model matrix the mesh is drawn with.
+    * @param backfaces Whether the backfacing meshlets are culled. The draw then culls the backfacing triangles too,
+    * so it must only be set for meshes that are wound consistently.
+    */
+    MeshletView(const glm::mat4 &view_projection, const glm::vec3 &camera_position, const glm::mat4 &model_matrix,
+                bool backfaces);
+
+    /**
+    * @brief Frustum planes in model space, normalized and pointing into the frustum.
+    */
+    std::array<glm::vec4, 6> planes;
+    glm::vec3 camera{0.0f};
+    bool backfaces{true};
+};
+
+/**
+* @class MeshletBounds
+* @brief The bounds and normal cones of the meshlets of a mesh laid out by component,
+* so that @ref MeshletBounds::cull tests 4 meshlets at a time with SSE2.
+*/
+class MeshletBounds {
+public:
+    MeshletBounds() = default;
+
+    explicit MeshletBounds(const std::vector<Meshlet> &meshlets);
+
+    /**
+    * @brief Writes 1 into `visible[i]` if meshlet i is inside the frustum and not backfacing, and 0 otherwise.
+    * @returns Number of visible meshlets.
+    */
+    uint32_t cull(const MeshletView &view, std::vector<uint8_t> &visible) const;
+
+    uint32_t size() const {
+        return m_size;
+    }
+
+private:
+    uint32_t m_size{0};
+    // Padded to a multiple of 4 meshlets.
+    std::vector<float> m_center_x;
+    std::vector<float> m_center_y;
+    std::vector<float> m_center_z;
+    std::vector<float> m_radius;
+    std::vector<float> m_axis_x;
+    std::vector<float> m_axis_y;
+    std::vector<float> m_axis_z;
+    std::vector<float> m_cutoff;
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_MESHLET_HPP
@@ -7,16 +7,41 @@
 #define MATF_RG_PROJECT_MODEL_HPP
 
 #include <engine/resources/Mesh.hpp>
+#include <engine/resources/Resource.hpp>
+#include <engine/util/Aabb.hpp>
 #include <algorithm>
+#include <limits>
+#include <optional>
 #include <utility>
 
 namespace engine::resources {
+/**
+* @struct ModelHit
+* @brief Where a ray hits a triangle of a model, see @ref Model::intersect.
+*/
+struct ModelHit {
+    /**
+    * @brief Index of the hit mesh in @ref Model::meshes.
+    */
+    uint32_t mesh{0};
+    /**
+    * @brief The triangle in the mesh; its distance is along the world space ray.
+    */
+    TriangleHit triangle;
+    /**
+    * @brief The hit in world space.
+    */
+    glm::vec3 position{0.0f};
+};
+
 /**
 * @class Model
 * @brief Represents a model object within the OpenGL context as an array of @ref Mesh objects.
 */
-class Model {
+class Model final : public Resource {
     friend class ResourcesController;
+    friend class InstanceCuller;
+    friend class MultiDraw;
 
 public:
     /**
@@ -25,16 +50,34 @@ public:
     */
     void draw(const Shader *shader);
 
+    /**
+    * @brief Draws the meshlets of the meshes that are visible from `view`, see @ref Mesh::draw.
+    * If `view.backfaces` is set, `GL_CULL_FACE` is enabled for the draw, so that the triangles of a visible meshlet
+    * are culled the same way as whole meshlets are.
+    * @returns Number of meshlets drawn.
+    */
+    uint32_t draw(const Shader *shader, const MeshletView &view);
+
     /**
     * @brief Destroys the model in the OpenGL context.
     */
-    void destroy();
+    void destroy() override;
+
+    /**
+    * @returns Estimated GPU memory used by the meshes of the model.
+    */
+    uint64_t gpu_bytes() const override;
 
     /**
      * @brief setting up for instanced drawing
      */
     void set_instanced_draw(glm::mat4 *model_matrix, int amount);
 
+    /**
+    * @brief Sets up instanced drawing with the model matrix, normal matrix and parameters of every instance.
+    */
+    void set_instanced_draw(const InstanceData *instances, int amount);
+
     /**
      * @brief instanced drawing the model using a given shader
      */
@@ -46,6 +89,27 @@ public:
     */
     const std::vector<Mesh> &meshes() const { return m_meshes; }
 
+    /**
+    * @returns The box around the meshes of the model, in its model space.
+    */
+    util::Aabb bounds() const;
+
+    /**
+    * @returns True if the triangles of every mesh are kept for @ref Model::intersect: the model is loaded
+    * and `hit_test` is set for it in the config.
+    */
+    bool hit_testable() const;
+
+    /**
+    * @brief Intersects a world space ray with the triangles of the model placed with `model_matrix`.
+    * The ray is moved into the model space instead of transforming the triangles, so one model can be tested
+    * at every place it's drawn at.
+    * @returns The nearest hit, or nothing if the ray misses the model or it isn't @ref Model::hit_testable.
+    */
+    std::optional<ModelHit> intersect(const glm::vec3 &origin, const glm::vec3 &direction,
+                                      const glm::mat4 &model_matrix,
+                                      float max_distance = std::numeric_limits<float>::infinity()) const;
+
     /**
     * @brief Returns the path to the model file from which the model was loaded.
     * @returns The path to the model.
@@ -0,0 +1,149 @@
+/**
+ * @file MultiDraw.hpp
+ * @brief Defines the MultiDraw class that draws many meshes from the geometry buffer with indirect draw commands.
+*/
+
+#ifndef MATF_RG_PROJECT_MULTI_DRAW_HPP
+#define MATF_RG_PROJECT_MULTI_DRAW_HPP
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <engine/graphics/GLResourceRegistry.hpp>
+
+namespace engine::resources {
+class Material;
+class Mesh;
+class Model;
+class Shader;
+
+/**
+* @brief Per-draw data the @ref MultiDraw shaders read from the shader storage buffer, in the std430 layout.
+*/
+struct DrawData {
+    glm::mat4 model;
+    /**
+    * @brief Inverse transpose of the model matrix; a mat4 so that it has the same layout in std430 as in C++.
+    */
+    glm::mat4 normal;
+};
+
+/**
+* @brief Arguments of one draw in the indirect buffer, as `glMultiDrawElementsIndirect` reads them.
+*/
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+};
+
+/**
+* @class MultiDraw
+* @brief Collects the meshes drawn with a shader in a frame and submits them with one `glMultiDrawElementsIndirect`
+* call per @ref Material, so the cost on the CPU barely depends on the number of objects.
+*
+* The meshes have to be in the @ref GeometryBuffer. Every mesh is one draw command, and the draws are sorted by their
+* material so that the textures are bound once per group. The shader reads the per-draw data by the draw index:
+* @code
+* #version 430 core
+* layout (location = 0) in vec3 aPos;
+* layout (location = 7) in uint aDrawIndex;
+*
+* struct Draw {
+*     mat4 model;
+*     mat4 normal;
+* };
+* layout (std430, binding = 0) readonly buffer Draws {
+*     Draw draws[];
+* };
+*
+* void main() {
+*     gl_Position = projection * view * draws[aDrawIndex].model * vec4(aPos, 1.0);
+* }
+* @endcode
+* `gl_DrawID` needs GL 4.6 or `GL_ARB_shader_draw_parameters`, so the index comes from the `baseInstance`
+* of the command instead, through an instanced attribute, which works on GL 4.3.
+*
+* @code
+* MultiDraw batch;
+* for (const auto &transform: transforms) {
+*     batch.add(model, transform);
+* }
+* batch.draw(shader);
+* @endcode
+*/
+class MultiDraw {
+public:
+    /**
+    * @brief Location of the `uint` attribute with the index of the draw.
+    */
+    static constexpr uint32_t DRAW_INDEX_LOCATION = 7;
+
+    /**
+    * @brief Binding of the shader storage buffer with the @ref DrawData array.
+    */
+    static constexpr uint32_t DRAWS_BINDING = 0;
+
+    /**
+    * @returns true if meshes can be drawn with a MultiDraw: the @ref GeometryBuffer is enabled.
+    */
+    static bool supported();
+
+    /**
+    * @brief Adds a draw for every mesh of the model.
+    * @returns false, without adding anything, if a mesh of the model isn't in the @ref GeometryBuffer;
+    * the caller then draws the model on its own.
+    */
+    bool add(Model *model, const glm::mat4 &model_matrix);
+
+    /**
+    * @brief Like @ref MultiDraw::add, with the normal matrix the caller already has, for example from a
+    * @ref util::TransformStore, instead of inverting the model matrix.
+    */
+    bool add(Model *model, const glm::mat4 &model_matrix, const glm::mat3 &normal_matrix);
+
+    /**
+    * @brief Draws the added meshes with the shader and clears the list.
+    */
+    void draw(const Shader *shader);
+
+    /**
+    * @brief Drops the added draws.
+    */
+    void clear();
+
+    /**
+    * @returns Number of draws added since the last @ref MultiDraw::draw.
+    */
+    size_t size() const {
+        return m_draws.size();
+    }
+
+private:
+    struct Draw {
+        Mesh *mesh;
+        const Material *material;
+        uint32_t data;
+    };
+
+    /**
+    * @brief Uploads `size` bytes to the buffer, growing it when they don't fit.
+    */
+    static void upload(graphics::GLBuffer &buffer, uint64_t &capacity, uint32_t target, const void *data,
+                       uint64_t size);
+
+    std::vector<Draw> m_draws;
+    std::vector<DrawData> m_data;
+    std::vector<DrawData> m_sorted_data;
+    std::vector<DrawElementsIndirectCommand> m_commands;
+
+    graphics::GLBuffer m_data_buffer;
+    uint64_t m_data_capacity{0};
+    graphics::GLBuffer m_command_buffer;
+    uint64_t m_command_capacity{0};
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_MULTI_DRAW_HPP
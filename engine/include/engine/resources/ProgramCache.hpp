@@ -0,0 +1,87 @@
+/**
+ * @file ProgramCache.hpp
+ * @brief Defines the ProgramCache class that stores linked shader programs on disk.
+*/
+
+#ifndef MATF_RG_PROJECT_PROGRAM_CACHE_HPP
+#define MATF_RG_PROJECT_PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace engine::resources {
+struct ShaderParsingResult;
+
+/**
+* @class ProgramCache
+* @brief Saves the binaries of the linked shader programs and loads them instead of compiling the sources again.
+*
+* After a program links, the @ref ShaderCompiler saves its `glGetProgramBinary` output with the binary format.
+* The file is named after a key that hashes the preprocessed sources of all the stages, the defines,
+* and the vendor, renderer and version of the driver, so editing a shader or updating the driver
+* just misses the cache. On the next launch the binary is loaded with `glProgramBinary`; if the driver rejects it,
+* the sources are compiled as usual and the file is overwritten.
+*
+* Enabled by the @ref ResourcesController with a directory in the config.json:
+* @code
+* "resources": {
+*   "program_cache": "cache/programs"
+* }
+* @endcode
+* The cache is bypassed while a @ref graphics::GLTrace capture is recording, since the trace has to contain the sources.
+* Requires GL 4.1 or `GL_ARB_get_program_binary`, see @ref graphics::GLExtensions::program_binary.
+*/
+class ProgramCache {
+public:
+    static ProgramCache *instance();
+
+    /**
+    * @brief Enables the cache. Reads the driver strings, so it's called with the OpenGL context current.
+    * @param directory where the binaries are stored; created if it doesn't exist.
+    */
+    void initialize(const std::filesystem::path &directory);
+
+    /**
+    * @returns true if programs should be looked up in and saved to the cache.
+    */
+    bool enabled() const;
+
+    /**
+    * @returns Key of the program built from `sources` with `defines`, for the current driver.
+    */
+    uint64_t key(const ShaderParsingResult &sources, std::string_view defines) const;
+
+    /**
+    * @brief Tries to load the program from the cache.
+    * @param program OpenGL program object, without attached shaders.
+    * @returns true if the program was loaded and linked; otherwise the program is left unlinked.
+    */
+    bool load(uint64_t key, uint32_t program);
+
+    /**
+    * @brief Marks the program so that the driver keeps its binary. Called before the program is linked.
+    */
+    void prepare(uint32_t program) const;
+
+    /**
+    * @brief Saves the binary of the linked program.
+    */
+    void store(uint64_t key, uint32_t program);
+
+private:
+    ProgramCache() = default;
+
+    std::filesystem::path file(uint64_t key) const;
+
+    std::filesystem::path m_directory;
+    /**
+    * @brief Vendor, renderer and version of the driver, part of every key.
+    */
+    std::string m_driver;
+    bool m_enabled{false};
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_PROGRAM_CACHE_HPP
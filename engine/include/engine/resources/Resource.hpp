@@ -0,0 +1,164 @@
+/**
+ * @file Resource.hpp
+ * @brief Defines the Resource base class for GPU resources that can be evicted, and the ResourceHandle that keeps them resident.
+*/
+
+#ifndef MATF_RG_PROJECT_RESOURCE_HPP
+#define MATF_RG_PROJECT_RESOURCE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+namespace engine::resources {
+/**
+* @class Resource
+* @brief Residency bookkeeping for the resources that the @ref ResourcesController can evict from GPU memory.
+*
+* When the resident resources exceed the GPU memory budget, the @ref ResourcesController destroys
+* the least recently used resources that are not referenced by a @ref ResourceHandle.
+* The resource object itself stays alive, so pointers to it remain valid; its GPU data is reloaded
+* the next time it is used.
+*/
+class Resource {
+    friend class ResourcesController;
+
+    template<typename TResource>
+    friend class ResourceHandle;
+
+public:
+    Resource() = default;
+
+    Resource(Resource &&) = default;
+
+    Resource &operator=(Resource &&) = default;
+
+    virtual ~Resource() = default;
+
+    /**
+    * @brief Destroys the resource in the OpenGL context.
+    */
+    virtual void destroy() = 0;
+
+    /**
+    * @returns Estimated GPU memory used by the resource, 0 if it isn't resident.
+    */
+    virtual uint64_t gpu_bytes() const = 0;
+
+    /**
+    * @brief Marks the resource as used in the current frame and reloads it if it was evicted.
+    * Called by the drawing and binding functions before they touch the OpenGL objects.
+    */
+    void use() const;
+
+    /**
+    * @returns true if the resource is loaded in GPU memory.
+    */
+    bool resident() const {
+        return m_resident;
+    }
+
+    /**
+    * @returns false while a placeholder stands in for the resource that is loading in the background.
+    */
+    bool loaded() const {
+        return m_loaded;
+    }
+
+    /**
+    * @returns Number of @ref ResourceHandle objects that keep the resource resident.
+    */
+    uint32_t references() const {
+        return m_references;
+    }
+
+private:
+    /**
+    * @brief Loads the GPU data again after eviction. Set by the @ref ResourcesController when the resource is loaded.
+    */
+    std::function<void()> m_reload;
+    uint32_t m_references{0};
+    // Residency isn't part of the logical state of the resource, so it can be updated through const pointers.
+    mutable uint64_t m_last_used_frame{0};
+    mutable bool m_resident{true};
+    bool m_loaded{true};
+};
+
+/**
+* @class ResourceHandle
+* @brief Reference-counted pointer to a resource. A resource with at least one handle is never evicted.
+*
+* @code
+* auto resources = engine::core::Controller::get<engine::resources::ResourcesController>();
+* engine::resources::ResourceHandle tree(resources->model("tree"));
+* tree->draw(shader);
+* @endcode
+*/
+template<typename TResource>
+class ResourceHandle {
+public:
+    ResourceHandle() = default;
+
+    explicit ResourceHandle(TResource *resource) : m_resource(resource) {
+        retain();
+    }
+
+    ResourceHandle(const ResourceHandle &other) : m_resource(other.m_resource) {
+        retain();
+    }
+
+    ResourceHandle &operator=(const ResourceHandle &other) {
+        if (this != &other) {
+            release();
+            m_resource = other.m_resource;
+            retain();
+        }
+        return *this;
+    }
+
+    ResourceHandle(ResourceHandle &&other) noexcept : m_resource(std::exchange(other.m_resource, nullptr)) {
+    }
+
+    ResourceHandle &operator=(ResourceHandle &&other) noexcept {
+        if (this != &other) {
+            release();
+            m_resource = std::exchange(other.m_resource, nullptr);
+        }
+        return *this;
+    }
+
+    ~ResourceHandle() {
+        release();
+    }
+
+    TResource *get() const {
+        return m_resource;
+    }
+
+    TResource *operator->() const {
+        return m_resource;
+    }
+
+    explicit operator bool() const {
+        return m_resource != nullptr;
+    }
+
+private:
+    void retain() {
+        if (m_resource) {
+            ++static_cast<Resource *>(m_resource)->m_references;
+        }
+    }
+
+    void release() {
+        if (m_resource) {
+            --static_cast<Resource *>(m_resource)->m_references;
+            m_resource = nullptr;
+        }
+    }
+
+    TResource *m_resource{nullptr};
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_RESOURCE_HPP
@@ -0,0 +1,179 @@
+/**
+ * @file ResourcePack.hpp
+ * @brief Defines the ResourcePack class that reads resources from a single memory-mapped .rgpak archive.
+*/
+
+#ifndef MATF_RG_PROJECT_RESOURCE_PACK_HPP
+#define MATF_RG_PROJECT_RESOURCE_PACK_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace engine::resources {
+/**
+* @brief How an entry is stored in the @ref ResourcePack.
+*/
+enum class PackCompression : uint32_t {
+    None,
+    /**
+    * @brief A single LZ4 block, see @ref engine::util::lz4_compress.
+    */
+    LZ4,
+};
+
+/**
+* @class PackedFile
+* @brief Contents of a file read from a @ref ResourcePack.
+* Uncompressed entries point straight into the mapped archive; compressed ones own their decompressed bytes.
+* The data stays valid as long as the @ref ResourcePack it was read from.
+*/
+class PackedFile {
+    friend class ResourcePack;
+
+public:
+    std::span<const uint8_t> data() const {
+        return m_data;
+    }
+
+    std::string_view text() const {
+        return {reinterpret_cast<const char *>(m_data.data()), m_data.size()};
+    }
+
+private:
+    std::span<const uint8_t> m_data;
+    std::vector<uint8_t> m_storage;
+};
+
+/**
+* @brief Summary of an archive written by @ref ResourcePack::write.
+*/
+struct ResourcePackStats {
+    uint64_t files{0};
+    uint64_t compressed_files{0};
+    uint64_t bytes{0};
+    uint64_t stored_bytes{0};
+};
+
+/**
+* @class ResourcePack
+* @brief Read-only archive of the files in the resources directory, the `.rgpak` format.
+*
+* Layout, all integers little-endian:
+* - header: magic `RGPAK` padded to 8 bytes, version, number of entries, offsets and sizes of the table of contents and the names;
+* - table of contents: one fixed-size entry per file, sorted by the 64-bit FNV-1a hash of the file name;
+* - names: the file names relative to the resources directory, with `/` separators, not null-terminated;
+* - data: each file at an offset aligned to @ref ResourcePack::ALIGNMENT, stored as is or as an LZ4 block.
+*
+* The header, the table of contents and the names are at the start of the file, so opening the archive reads
+* a single contiguous range. The archive is memory-mapped; a lookup is a binary search over the hashes.
+* Reading is thread-safe.
+*
+* Archives are built by the `rg-pack` tool, see @ref ResourcePack::write.
+*/
+class ResourcePack {
+public:
+    static constexpr std::string_view EXTENSION = ".rgpak";
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t ALIGNMENT = 64;
+
+    /**
+    * @brief Maps the archive into memory and validates its table of contents.
+    * Throws @ref engine::util::EngineError::Type::AssetLoadingError if the file isn't a valid archive.
+    */
+    explicit ResourcePack(const std::filesystem::path &path);
+
+    ResourcePack(const ResourcePack &) = delete;
+
+    ResourcePack &operator=(const ResourcePack &) = delete;
+
+    ~ResourcePack();
+
+    /**
+    * @param name of the file relative to the packed directory, for example `textures/grass.png`.
+    * @returns true if the archive contains the file.
+    */
+    bool contains(std::string_view name) const;
+
+    /**
+    * @brief Reads a file from the archive, decompressing it if needed.
+    * Throws @ref engine::util::EngineError::Type::FileNotFound if the archive doesn't contain the file.
+    * @param name of the file relative to the packed directory, for example `textures/grass.png`.
+    */
+    PackedFile read(std::string_view name) const;
+
+    /**
+    * @brief Lists the files and directories directly inside `directory`, like `std::filesystem::directory_iterator`.
+    * @param directory relative to the packed directory, for example `skyboxes`; empty for the root.
+    * @returns Sorted names relative to the packed directory, for example `skyboxes/skybox`.
+    */
+    std::vector<std::string> list(std::string_view directory) const;
+
+    /**
+    * @returns Number of files in the archive.
+    */
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    const std::filesystem::path &path() const {
+        return m_path;
+    }
+
+    /**
+    * @brief Packs every file under `root` into the archive at `output`.
+    * @param compress store the files with LZ4 when that saves at least an eighth of their size.
+    * Any file that LZ4 shrinks by less is stored as it is, whatever its extension; in practice that's most
+    * already compressed formats, like .jpg and .png.
+    * @returns Summary of the written archive.
+    */
+    static ResourcePackStats write(const std::filesystem::path &root, const std::filesystem::path &output,
+                                   bool compress);
+
+    /**
+    * @returns The 64-bit FNV-1a hash used to index the names.
+    */
+    static uint64_t hash(std::string_view name);
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t entry_count;
+        uint64_t toc_offset;
+        uint64_t names_offset;
+        uint64_t names_size;
+        uint64_t reserved;
+    };
+
+    struct Entry {
+        uint64_t hash;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t stored_size;
+        uint32_t name_offset;
+        uint32_t name_size;
+        PackCompression compression;
+        uint32_t reserved;
+    };
+
+    const Entry *find(std::string_view name) const;
+
+    std::string_view name(const Entry &entry) const;
+
+    std::filesystem::path m_path;
+    const uint8_t *m_data{nullptr};
+    uint64_t m_size{0};
+    /**
+    * @brief Holds the archive on platforms without mmap.
+    */
+    std::vector<uint8_t> m_buffer;
+    std::span<const Entry> m_entries;
+    std::string_view m_names;
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_RESOURCE_PACK_HPP
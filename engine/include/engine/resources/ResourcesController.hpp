@@ -6,10 +6,16 @@
 #ifndef MATF_RG_PROJECT_RESOURCES_CONTROLLER_HPP
 #define MATF_RG_PROJECT_RESOURCES_CONTROLLER_HPP
 
+#include <future>
 #include <engine/core/Controller.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/graphics/TextureUploader.hpp>
 #include <engine/resources/Model.hpp>
+#include <engine/resources/ResourcePack.hpp>
 #include <engine/resources/Texture.hpp>
+#include <engine/resources/TextureStreamer.hpp>
 #include <engine/resources/Shader.hpp>
+#include <engine/resources/ShaderCompiler.hpp>
 #include <engine/resources/Skybox.hpp>
 #include <unordered_map>
 
@@ -17,8 +23,40 @@ namespace engine::resources {
 /**
 * @class ResourcesController
 * @brief Manages app resources: @ref Model, @ref Texture, @ref Shader, and @ref Skybox.
+*
+* Models, textures and skyboxes count against the GPU memory budget set by `resources.gpu_budget_mb` in the config.json
+* (0, the default, means unlimited). At the end of every frame in which the resident resources exceed the budget,
+* the least recently used resources that aren't referenced by a @ref ResourceHandle and weren't used in that frame
+* are evicted. Pointers to evicted resources stay valid; the resource is reloaded the next time it is drawn or bound.
+*
+* With `resources.lazy_loading` set to true in the config.json nothing but the shaders is loaded during initialization.
+* @ref ResourcesController::model, @ref ResourcesController::texture and @ref ResourcesController::skybox return
+* immediately with a placeholder (a box for models, a checkerboard for textures, a grey cubemap for skyboxes)
+* and decode the files in the background, on a bounded number of @ref util::WorkerPool threads. The GPU data is uploaded on the main thread, at the start of the first frame
+* after the decoding finishes, and the resource swaps its placeholder for the real data in place.
+* Texture pixels are then streamed by the @ref graphics::TextureUploader over the following frames, smallest mip level first.
+* With `resources.texture_streaming` set, only the mip levels the textures need on screen are kept resident,
+* see @ref TextureStreamer.
+* Assets that have to be ready before they are shown are listed in preload groups:
+* @code
+* "resources": {
+*   "lazy_loading": true,
+*   "preload": ["scene"],
+*   "preload_groups": {
+*     "scene": {"models": ["tree"], "textures": ["grass"], "skyboxes": ["skybox"]}
+*   }
+* }
+* @endcode
+* Groups in `resources.preload` are loaded during initialization, the others with @ref ResourcesController::preload
+* or in the background with @ref ResourcesController::request.
+*
+* With `resources.pack` set to the path of a @ref ResourcePack, for example `"resources.rgpak"`, every resource is read
+* from the memory-mapped archive instead of the "resources/" directory. Paths keep their "resources/" prefix,
+* so the rest of the app doesn't change.
 */
 class ResourcesController final : public core::Controller {
+    friend class Resource;
+
 public:
     std::string_view name() const override {
         return "ResourcesController";
@@ -63,38 +101,205 @@ public:
 
     /**
     * @brief Retrieves the @ref Shader with a given name. You are not supposed to call `delete` on this pointer.
+    * If the shader is still compiling in the background, waits for it.
     * @param name of the .glsl file in the `resources/shaders` directory
     * @param path to the shader.glsl file that contains shader source code.
     * @returns The pointer to the @ref Shader associated with the `name`.
     */
     Shader *shader(const std::string &name, const std::filesystem::path &path = "");
 
+    /**
+    * @returns Estimated GPU memory used by the resident models, textures and skyboxes.
+    */
+    uint64_t resident_bytes() const;
+
+    /**
+    * @returns GPU memory budget in bytes, 0 if unlimited.
+    */
+    uint64_t gpu_budget() const {
+        return m_gpu_budget;
+    }
+
+    /**
+    * @brief Sets the GPU memory budget in bytes. 0 disables eviction.
+    */
+    void set_gpu_budget(uint64_t bytes) {
+        m_gpu_budget = bytes;
+    }
+
+    /**
+    * @returns true if the resources are loaded on demand in the background. See `resources.lazy_loading`.
+    */
+    bool lazy_loading() const {
+        return m_lazy_loading;
+    }
+
+    /**
+    * @brief Starts loading the resources of a preload group in the background.
+    * @param group name of the group in `resources.preload_groups` in the config.json.
+    */
+    void request(const std::string &group);
+
+    /**
+    * @brief Loads the resources of a preload group and blocks until all of them are uploaded.
+    * @param group name of the group in `resources.preload_groups` in the config.json.
+    */
+    void preload(const std::string &group);
+
+    /**
+    * @returns true if every resource of the preload group, including the textures of its models, has finished loading.
+    */
+    bool group_ready(const std::string &group);
+
+    /**
+    * @returns Number of resources that are still loading in the background.
+    */
+    size_t pending_loads() const {
+        return m_pending_models.size() + m_pending_textures.size() + m_pending_skyboxes.size() + m_publishing +
+               m_compiling.size();
+    }
+
+    /**
+    * @returns Number of shaders the driver is still compiling; a loading screen can poll it to show the progress.
+    */
+    size_t compiling_shaders() const {
+        return m_compiling.size();
+    }
+
+    /**
+    * @returns The archive the resources are read from, nullptr if they are read from the "resources/" directory.
+    */
+    const ResourcePack *pack() const {
+        return m_pack.get();
+    }
+
 private:
     /**
     * @brief Loads all the resources from the "resources/" directory.
     */
     void initialize() override;
 
+    /**
+    * @brief Destroys all the loaded resources in the OpenGL context.
+    */
+    void terminate() override;
+
+    /**
+    * @brief Uploads the resources whose background loading has finished.
+    */
+    void update() override;
+
+    /**
+    * @brief Evicts the least recently used resources if the resident resources exceed the GPU memory budget.
+    */
+    void end_draw() override;
+
+    /**
+    * @brief Marks the resource as used in the current frame and reloads it if it was evicted. See @ref Resource::use.
+    */
+    void use(const Resource *resource);
+
+    /**
+    * @brief Imports the meshes of a model file with assimp. Makes no OpenGL calls, so it's safe to call from any thread.
+    * @param hit_test Also keeps the triangles of the meshes on the CPU, see @ref Model::intersect.
+    */
+    std::vector<MeshData> import_meshes(const std::string &name, const std::filesystem::path &model_path,
+                                        bool flip_uvs, bool hit_test) const;
+
+    /**
+    * @brief Decodes an image from the resources directory or the pack. Safe to call from any thread.
+    */
+    graphics::TextureImage load_image(const std::filesystem::path &path, bool flip_uvs) const;
+
+    /**
+    * @brief Decodes the six images of a skybox from the resources directory or the pack. Safe to call from any thread.
+    */
+    graphics::CubemapImages load_skybox_images(const std::filesystem::path &path, bool flip_uvs) const;
+
+    /**
+    * @returns The entries directly inside the `directory`, from the resources directory or the pack.
+    * Empty if the directory doesn't exist.
+    */
+    std::vector<std::filesystem::path> list_directory(const std::filesystem::path &directory) const;
+
+    /**
+    * @returns Name of the file in the pack, for example "textures/grass.png" for "resources/textures/grass.png".
+    */
+    std::string pack_name(const std::filesystem::path &path) const;
+
+    /**
+    * @brief Uploads the imported meshes and loads the textures they reference.
+    */
+    std::vector<Mesh> create_meshes(std::vector<MeshData> meshes);
+
+    /**
+    * @brief Uploads the imported meshes of a lazily loaded model on the @ref graphics::GLUploadThread.
+    * The model keeps its placeholder until the buffers are published.
+    */
+    void submit_meshes(Model *model, std::vector<MeshData> meshes);
+
+    /**
+    * @brief Creates the box that stands in for a model that is still loading.
+    */
+    std::vector<Mesh> placeholder_meshes();
+
+    /**
+    * @brief Puts the placeholder in place of the model and imports its meshes on the @ref util::WorkerPool.
+    * @ref finish_loads uploads them once they are ready. Used in lazy mode for the first load and after eviction.
+    */
+    void load_model_async(Model *model, bool flip_uvs, bool hit_test);
+
+    /**
+    * @brief Puts the placeholder in place of the texture and decodes its image on the @ref util::WorkerPool.
+    */
+    void load_texture_async(Texture *texture, bool flip_uvs);
+
+    /**
+    * @brief Puts the placeholder in place of the skybox and decodes its images on the @ref util::WorkerPool.
+    */
+    void load_skybox_async(Skybox *skybox, bool flip_uvs);
+
+    /**
+    * @brief Uploads the resources whose background loading has finished.
+    * @param wait block until the pending loads finish.
+    */
+    void finish_loads(bool wait);
+
     /**
     * @brief Loads all the models from the "resources/models" directory based on the provided configuration. Called during @ref ResourcesController::initialize.
     */
     void load_models();
 
     /**
-    * @brief Loads all the models from the "resources/textures" directory. Called during @ref ResourcesController::initialize.
+    * @brief Loads all the textures from the "resources/textures" directory. Called during @ref ResourcesController::initialize.
+    * In the lazy mode only the paths are recorded, so that the textures can later be requested by name.
     */
     void load_textures();
 
     /**
     * @brief Loads all the skyboxes from the "resources/skyboxes" directory. Called during @ref ResourcesController::initialize.
+    * In the lazy mode only the paths are recorded, so that the skyboxes can later be requested by name.
     */
     void load_skyboxes();
 
     /**
-    * @brief Loads and compile all the shaders from the "resources/shaders" directory. Called during @ref ResourcesController::initialize.
+    * @brief Submits all the shaders from the "resources/shaders" directory to the driver in one batch.
+    * Their status is checked when they're first used, or once the driver reports them completed.
+    * Called during @ref ResourcesController::initialize.
     */
     void load_shaders();
 
+    /**
+    * @brief Checks the shaders the driver has finished compiling.
+    * @param wait block until all the submitted shaders are finished.
+    */
+    void finish_shaders(bool wait);
+
+    /**
+    * @returns Reader that resolves the `#include` directives of the shaders from the pack.
+    */
+    ShaderCompiler::IncludeReader pack_include_reader() const;
+
     /**
     * @brief A hashmap of all the loaded @ref Model.
     */
@@ -111,7 +316,59 @@ private:
     * @brief A hashmap of all the loaded @ref Shader.
     */
     std::unordered_map<std::string, std::unique_ptr<Shader> > m_shaders;
+    /**
+    * @brief Shaders in @ref ResourcesController::m_shaders whose compile and link status hasn't been checked yet.
+    */
+    std::unordered_map<std::string, ShaderCompileJob> m_compiling;
+
+    /**
+    * @brief Paths of the textures and skyboxes found in the resources directories, by name.
+    */
+    std::unordered_map<std::string, std::filesystem::path> m_texture_paths;
+    std::unordered_map<std::string, std::filesystem::path> m_skybox_paths;
+
+    struct PendingModel {
+        Model *model;
+        std::future<std::vector<MeshData> > meshes;
+    };
+
+    struct PendingTexture {
+        Texture *texture;
+        bool flip_uvs;
+        std::future<graphics::StreamedImage> image;
+    };
+
+    struct PendingSkybox {
+        Skybox *skybox;
+        std::future<graphics::CubemapImages> images;
+    };
+
+    std::vector<PendingModel> m_pending_models;
+    std::vector<PendingTexture> m_pending_textures;
+    std::vector<PendingSkybox> m_pending_skyboxes;
+    /**
+    * @brief Resources uploaded on the @ref graphics::GLUploadThread that aren't published yet.
+    */
+    size_t m_publishing{0};
+    /**
+    * @brief Checkerboard shared by the placeholder models.
+    */
+    std::unique_ptr<Texture> m_placeholder_texture;
+    bool m_lazy_loading{false};
+    std::unique_ptr<ResourcePack> m_pack;
+    /**
+    * @brief Manages the mip levels of the lazily loaded textures, if `resources.texture_streaming` is set.
+    */
+    std::unique_ptr<TextureStreamer> m_streamer;
+
+    uint64_t m_gpu_budget{0};
+    uint64_t m_frame{0};
+    /**
+    * @brief Set while the resources used every frame don't fit into the budget; the warning is logged once.
+    */
+    bool m_over_budget{false};
 
+    const std::filesystem::path m_resources_path = "resources";
     const std::filesystem::path m_models_path = "resources/models";
     const std::filesystem::path m_textures_path = "resources/textures";
     const std::filesystem::path m_shaders_path = "resources/shaders";
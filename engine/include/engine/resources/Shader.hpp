@@ -7,7 +7,12 @@
 #define MATF_RG_PROJECT_SHADER_HPP
 
 #include <engine/util/Utils.hpp>
+#include <engine/graphics/GLResourceRegistry.hpp>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 
 namespace engine::resources {
@@ -18,7 +23,7 @@ using ShaderName = std::string;
 * @brief The type of the shader.
 */
 enum class ShaderType {
-    Vertex, Fragment, Geometry
+    Vertex, Fragment, Geometry, Compute
 };
 
 /**
@@ -28,9 +33,31 @@ enum class ShaderType {
 */
 std::string_view to_string(ShaderType type);
 
+/**
+* @struct ShaderFeature
+* @brief A compile-time switch declared in the shader source with `//#feature NAME [value]`.
+*/
+struct ShaderFeature {
+    std::string name;
+    /**
+    * @brief Value `NAME` is defined to when the feature is enabled, "1" if none was declared.
+    * A disabled feature is defined to 0.
+    */
+    std::string value;
+};
+
 /**
 * @class Shader
 * @brief Represents a linked shader program object within the OpenGL context.
+*
+* A shader can declare features, for example `//#feature SPOTLIGHT`. Every combination of enabled features is
+* a separate program, a variant, compiled the first time it's requested and cached in the shader:
+* @code
+* uint32_t features = spotlight_on ? shader->feature("SPOTLIGHT") : 0;
+* const Shader *variant = shader->variant(features);
+* variant->use();
+* @endcode
+* The shader returned by the @ref ResourcesController is the variant with every feature disabled.
 */
 class Shader {
     friend class ShaderCompiler;
@@ -117,7 +144,7 @@ public:
     const std::string &name() const;
 
     /**
-    * @brief Returns the source code of the shader program.
+    * @brief Returns the source code of the shader program, with the `#include` directives resolved.
     * @returns The source code of the shader.
     */
     const std::string &source() const;
@@ -128,26 +155,59 @@ public:
     */
     const std::filesystem::path &source_path() const;
 
+    /**
+    * @brief Returns the texture unit the sampler uniform reads from. The first request for a sampler assigns it
+    * the next free unit and sets the uniform, so a @ref Material only has to bind its textures to the units.
+    * @returns The texture unit, or -1 if the program has no active uniform with the name.
+    */
+    int32_t sampler_unit(std::string_view name) const;
+
+    /**
+    * @brief Returns the bit of a declared feature in the masks passed to @ref Shader::variant.
+    * Throws @ref util::EngineError::Type::ShaderCompilationError if the shader doesn't declare the feature.
+    */
+    uint32_t feature(std::string_view name) const;
+
+    /**
+    * @brief Returns the variant of the shader with the given features enabled, compiling it on the first request.
+    * @param features bitmask of @ref Shader::feature bits.
+    */
+    const Shader *variant(uint32_t features) const;
+
+    /**
+    * @returns The features declared in the source.
+    */
+    const std::vector<ShaderFeature> &features() const {
+        return m_features;
+    }
+
+    /**
+    * @returns The bitmask of the features enabled in this variant.
+    */
+    uint32_t enabled_features() const {
+        return m_enabled_features;
+    }
+
+    /**
+    * @brief Destroys the shader program and its variants in the OpenGL context.
+    */
+    void destroy();
+
 private:
     /**
     * @brief Constructs a Shader object.
-    * @param shader_id The OpenGL ID of the shader program.
+    * @param program The OpenGL shader program, owned by the Shader.
     * @param name The name of the shader program.
     * @param source The source code of the shader program.
     * @param source_path The path to the source file from which the shader program was compiled.
     */
-    Shader(unsigned shader_id, std::string name, std::string source,
+    Shader(graphics::GLProgram program, std::string name, std::string source,
            std::filesystem::path source_path = "");
 
     /**
-    * @brief Destroys the shader program in the OpenGL context.
+    * @brief The OpenGL shader program.
     */
-    void destroy() const;
-
-    /**
-    * @brief The OpenGL ID of the shader program.
-    */
-    unsigned m_shader_id;
+    graphics::GLProgram m_program;
 
     /**
     * @brief The name of the shader program
@@ -155,6 +215,17 @@ private:
     std::string m_name;
     std::string m_source;
     std::filesystem::path m_source_path;
+
+    std::vector<ShaderFeature> m_features;
+    uint32_t m_enabled_features{0};
+    /**
+    * @brief Sampler uniforms assigned by @ref Shader::sampler_unit, indexed by their texture unit.
+    */
+    mutable std::vector<std::string> m_sampler_units;
+    /**
+    * @brief Variants requested from this shader so far, by their feature mask.
+    */
+    mutable std::unordered_map<uint32_t, std::unique_ptr<Shader> > m_variants;
 };
 } // namespace engine
 
@@ -9,7 +9,9 @@
 #include <engine/graphics/OpenGL.hpp>
 #include <engine/resources/Shader.hpp>
 #include <filesystem>
+#include <functional>
 #include <string>
+#include <vector>
 
 namespace engine::resources {
 /**
@@ -22,6 +24,23 @@ struct ShaderParsingResult {
     std::string geometry_shader;
 };
 
+/**
+* @struct ShaderCompileJob
+* @brief A program whose stages and link were handed to the driver, but whose status hasn't been checked yet.
+* Produced by @ref ShaderCompiler::submit_from_source and completed by @ref ShaderCompiler::finish.
+*/
+struct ShaderCompileJob {
+    std::string name;
+    uint32_t program{0};
+    uint32_t vertex_shader{0};
+    uint32_t fragment_shader{0};
+    uint32_t geometry_shader{0};
+    /**
+    * @brief Key the program is saved under in the @ref ProgramCache once it links; 0 if it isn't saved.
+    */
+    uint64_t cache_key{0};
+};
+
 /**
 * @class ShaderCompiler
 * @brief Compiles GLSL shaders from a single source file.
@@ -45,16 +64,35 @@ struct ShaderParsingResult {
 *     FragColor = vec4(0.0, 0.0, 0.0, 1.0);
 * }
 * @endcode
+*
+* The source is preprocessed before it's split:
+* - `#include "file.glsl"` is replaced with the contents of the file, relative to the including file;
+* - `//#feature NAME [value]` declares a compile-time switch, see @ref Shader::variant. Every stage gets
+*   `#define NAME value` (or `#define NAME 0` when the feature is disabled) right after its `#version` line,
+*   so the stages can test it with `#if NAME`.
 */
 class ShaderCompiler {
 public:
+    /**
+    * @brief Reads a file referenced by an `#include` directive.
+    */
+    using IncludeReader = std::function<std::string(const std::filesystem::path &path)>;
+
+    /**
+    * @brief Maximum number of features a shader can declare, one bit each in the variant masks.
+    */
+    static constexpr size_t MAX_FEATURES = 32;
+
     /**
     * @brief Compiles a shader from source.
     * @param shader_name
     * @param shader_source string for the vertex, fragment, [geometry] shader
+    * @param source_path path the source was read from, if any; for example from a @ref ResourcePack.
     * @returns Compiled @ref Shader object that can be used for drawing.
     */
-    static Shader compile_from_source(std::string shader_name, std::string shader_source);
+    static Shader compile_from_source(std::string shader_name, std::string shader_source,
+                                      std::filesystem::path source_path = "",
+                                      const IncludeReader &read_include = {});
 
     /**
     * @brief Compiles a shader from file.
@@ -65,17 +103,92 @@ public:
     static Shader compile_from_file(std::string shader_name, const std::filesystem::path &shader_path);
 
     /**
-    * @brief Splits a single shader source string into `vertex`, `fragment`, [`geometry`] shader strings.
+    * @brief Hands the stages and the link of the shader to the driver without waiting for them.
+    *
+    * Checking a compile or link status makes the driver finish the work right away, so the status is only checked
+    * by @ref ShaderCompiler::finish. Submitting all the shaders first lets a driver with
+    * `GL_KHR_parallel_shader_compile` compile them on its own threads in the meantime.
+    * @param job filled with what @ref ShaderCompiler::finish needs to check the program.
+    * @param read_include reads the included files; reads them from the disk if empty.
+    * @returns The shader, which can't be used before its job is finished.
+    */
+    static Shader submit_from_source(std::string shader_name, std::string shader_source,
+                                     const std::filesystem::path &source_path, ShaderCompileJob &job,
+                                     const IncludeReader &read_include = {});
+
+    /**
+    * @brief Same as @ref ShaderCompiler::submit_from_source, reading the source from `shader_path`.
+    */
+    static Shader submit_from_file(std::string shader_name, const std::filesystem::path &shader_path,
+                                   ShaderCompileJob &job);
+
+    /**
+    * @brief Compiles the variant of `shader` with the `features` enabled. Called by @ref Shader::variant.
+    */
+    static Shader compile_variant(const Shader &shader, uint32_t features);
+
+    /**
+    * @brief Compiles and links a program with a single compute stage, right away.
+    * The source is a plain GLSL compute shader, without the `#shader` directives. Requires
+    * @ref graphics::GLExtensions::compute_shader.
+    * @returns Compiled @ref Shader object that can be dispatched.
+    */
+    static Shader compile_compute(std::string shader_name, std::string shader_source);
+
+    /**
+    * @brief Checks without blocking whether the driver has finished the job.
+    * @returns true if @ref ShaderCompiler::finish won't block. Always true without `GL_KHR_parallel_shader_compile`.
+    */
+    static bool completed(const ShaderCompileJob &job);
+
+    /**
+    * @brief Waits for the job, checks that every stage compiled and the program linked,
+    * and saves the program to the @ref ProgramCache. Throws @ref util::EngineError::Type::ShaderCompilationError
+    * with the driver's log if it didn't.
+    */
+    static void finish(ShaderCompileJob &job);
+
+    /**
+    * @brief Drops a job that is no longer needed, for example at shutdown.
+    */
+    static void cancel(ShaderCompileJob &job);
+
+    /**
+    * @brief Splits a single shader source string into `vertex`, `fragment`, [`geometry`] shader strings,
+    * and defines the features in each of them.
     * @returns @ref ShaderParsingResult
     */
     ShaderParsingResult parse_source();
 
 private:
     /**
-    * @brief Compile shader sources into a OpenGL shader program.
-    * @returns A @ref graphics::OpenGL::ShaderProgramId referencing OpenGL shader program.
+    * @brief Submits the shader sources to be compiled and linked into the OpenGL shader program.
+    * @returns A @ref graphics::GLProgram owning the OpenGL shader program.
+    */
+    graphics::GLProgram submit(const ShaderParsingResult &shader_sources, ShaderCompileJob &job);
+
+    /**
+    * @brief Parses, defines and submits the variant selected by `m_enabled_features`.
     */
-    graphics::OpenGL::ShaderProgramId compile(const ShaderParsingResult &shader_sources);
+    Shader build(const std::filesystem::path &source_path, ShaderCompileJob &job);
+
+    /**
+    * @brief Replaces the `#include` directives with the contents of the files, recursively.
+    * @param including files being expanded, used to report include cycles.
+    */
+    static std::string expand_includes(const std::string &source, const std::filesystem::path &directory,
+                                       const IncludeReader &read_include,
+                                       std::vector<std::filesystem::path> &including);
+
+    /**
+    * @brief Collects the `//#feature` declarations from `m_sources`.
+    */
+    std::vector<ShaderFeature> parse_features() const;
+
+    /**
+    * @returns `#define` lines of all the declared features for `m_enabled_features`.
+    */
+    std::string defines() const;
 
     ShaderCompiler(std::string shader_name, std::string shader_source) : m_shader_name(
             std::move(shader_name))
@@ -89,16 +202,10 @@ private:
     */
     std::string *now_parsing(ShaderParsingResult &result, const std::string &line);
 
-    /**
-    * @brief Compiles a single shader (Vertex|Fragment|Geometry) (not the whole program).
-    * @param shader_source
-    * @param type of the shader to compile Vertex|Fragment|Geometry
-    * @returns OpenGL id to a compiled shader.
-    */
-    uint32_t compile(const std::string &shader_source, ShaderType type);
-
     std::string m_shader_name;
     std::string m_sources;
+    std::vector<ShaderFeature> m_features;
+    uint32_t m_enabled_features{0};
 };
 }
 #endif //SHADER_COMPILER_HPP
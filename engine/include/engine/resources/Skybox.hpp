@@ -9,13 +9,15 @@
 #include <cstdint>
 #include <filesystem>
 #include <utility>
+#include <engine/graphics/GLResourceRegistry.hpp>
+#include <engine/resources/Resource.hpp>
 
 namespace engine::resources {
 /**
 * @class Skybox
 * @brief Represents a skybox object within the OpenGL context.
 */
-class Skybox {
+class Skybox final : public Resource {
     friend class ResourcesController;
 
 public:
@@ -32,32 +34,40 @@ public:
     * @returns The OpenGL ID of the skybox texture.
     */
     uint32_t texture() const {
-        return m_texture_id;
+        return m_texture.id();
     }
 
     /**
-    * @brief Destroys the skybox object in the OpenGL context.
+    * @brief Destroys the skybox texture in the OpenGL context. The cube vao is shared by all the skyboxes
+    * and is released by @ref graphics::OpenGL::destroy_skybox_cube.
     */
-    void destroy();
+    void destroy() override;
+
+    /**
+    * @returns Estimated GPU memory used by the cubemap texture.
+    */
+    uint64_t gpu_bytes() const override {
+        return m_texture.size();
+    }
 
 private:
     Skybox() = default;
 
     uint32_t m_vao{0};
-    uint32_t m_texture_id{0};
+    graphics::GLTexture m_texture{};
     std::filesystem::path m_path{};
     std::string m_name{};
 
     /**
     * @brief Constructs a Skybox object.
     * @param vao The OpenGL ID of the skybox.
-    * @param texture_id The OpenGL ID of the skybox texture.
+    * @param texture The OpenGL cubemap texture, owned by the skybox.
     * @param path The path to the skybox texture.
     * @param name The name of the skybox.
     */
-    Skybox(uint32_t vao, uint32_t texture_id, std::filesystem::path path, std::string name)
+    Skybox(uint32_t vao, graphics::GLTexture texture, std::filesystem::path path, std::string name)
             : m_vao(vao)
-              , m_texture_id(texture_id)
+              , m_texture(std::move(texture))
               , m_path(std::move(path))
               , m_name(std::move(name)) {
     }
@@ -6,9 +6,12 @@
 #ifndef MATF_RG_PROJECT_TEXTURE_HPP
 #define MATF_RG_PROJECT_TEXTURE_HPP
 
+#include <algorithm>
 #include <string_view>
 #include <filesystem>
 #include <utility>
+#include <engine/graphics/GLResourceRegistry.hpp>
+#include <engine/resources/Resource.hpp>
 
 namespace engine::resources {
 class Shader;
@@ -28,8 +31,9 @@ enum class TextureType {
 * @class Texture
 * @brief Represents a texture object within the OpenGL context.
 */
-class Texture {
+class Texture final : public Resource {
     friend class ResourcesController;
+    friend class TextureStreamer;
 
 public:
     /**
@@ -48,9 +52,17 @@ public:
     static std::string_view uniform_name_convention(TextureType type);
 
     /**
-    * @brief Destroys the texture object in the OpenGL context.
+    * @brief Destroys the texture object in the OpenGL context. Deletion is deferred until the GPU has finished
+    * the frames that sample the texture.
     */
-    void destroy();
+    void destroy() override;
+
+    /**
+    * @returns Estimated GPU memory used by the texture and its mipmaps.
+    */
+    uint64_t gpu_bytes() const override {
+        return m_texture.size();
+    }
 
     /**
     * @brief Returns the type of the texture.
@@ -65,7 +77,7 @@ public:
     * @returns The OpenGL ID of the texture.
     */
     uint32_t id() const {
-        return m_id;
+        return m_texture.id();
     }
 
     /**
@@ -74,6 +86,16 @@ public:
     */
     void bind(int32_t sampler);
 
+    /**
+    * @brief Tells the @ref TextureStreamer how large the texture appears on screen this frame, so that it keeps
+    * the matching mip level resident. Call it before drawing; the largest request of the frame wins.
+    * See @ref graphics::GraphicsController::request_texture_detail.
+    * @param pixels Number of screen pixels one repeat of the texture spans along its larger side.
+    */
+    void request_screen_size(float pixels) {
+        m_requested_pixels = std::max(m_requested_pixels, pixels);
+    }
+
     /**
     * @brief Returns the path to the texture file from which the texture was loaded.
     * @returns The path to the texture file.
@@ -95,22 +117,26 @@ public:
 private:
     /**
     * @brief Constructs a Texture object.
-    * @param id The OpenGL ID of the texture.
+    * @param texture The OpenGL texture object, owned by the Texture.
     * @param type The type of the texture.
     * @param path The path to the texture file.
     * @param name The name of the texture.
     */
-    Texture(uint32_t id, TextureType type, std::filesystem::path path, std::string name)
-            : m_id(id)
+    Texture(graphics::GLTexture texture, TextureType type, std::filesystem::path path, std::string name)
+            : m_texture(std::move(texture))
               , m_type(type)
               , m_path(std::move(path))
               , m_name(std::move(name)) {
     }
 
-    uint32_t m_id{};
+    graphics::GLTexture m_texture{};
     TextureType m_type{};
     std::filesystem::path m_path{};
     std::string m_name{};
+    /**
+    * @brief Largest @ref Texture::request_screen_size since the @ref TextureStreamer last looked at the texture.
+    */
+    float m_requested_pixels{0.0f};
 };
 } // namespace engine
 #endif//MATF_RG_PROJECT_TEXTURE_HPP
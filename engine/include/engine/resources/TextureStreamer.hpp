@@ -0,0 +1,162 @@
+/**
+ * @file TextureStreamer.hpp
+ * @brief Defines the TextureStreamer class that keeps only the mip levels of the textures that are visible on screen resident.
+*/
+
+#ifndef MATF_RG_PROJECT_TEXTURE_STREAMER_HPP
+#define MATF_RG_PROJECT_TEXTURE_STREAMER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <engine/graphics/GLResourceRegistry.hpp>
+#include <engine/graphics/TextureUploader.hpp>
+
+namespace engine::resources {
+class Texture;
+
+/**
+* @class TextureStreamer
+* @brief Loads and drops the mip levels of the textures depending on how large they appear on screen.
+*
+* Every frame the renderer reports the on-screen size of the textures it draws with @ref Texture::request_screen_size.
+* The streamer turns the size into the finest mip level worth having: a texture 2048 texels wide that spans
+* 200 pixels doesn't need more than the 256-wide level. If the levels wanted by all the textures don't fit into
+* the budget, the largest textures are coarsened first.
+*
+* The decoded mip chain of a texture is kept in memory while the texture is drawn. A texture that needs more detail
+* gets a new OpenGL texture that holds only the wanted levels, copied from the chain on a @ref util::WorkerPool thread
+* and streamed in by the @ref graphics::TextureUploader; the textures are swapped once it's complete.
+* A texture that needs less detail is clamped with `GL_TEXTURE_BASE_LEVEL` right away; its memory is released by
+* the same rebuild once it stayed too detailed for a while, or right away when over the budget.
+* A texture that isn't drawn for a while drops to its coarsest level and releases its decoded chain; the file is
+* decoded again when it's back on screen.
+*
+* Created by the @ref ResourcesController when `resources.texture_streaming` is set in the config.json:
+* @code
+* "resources": {
+*   "lazy_loading": true,
+*   "texture_streaming": {"budget_mb": 64, "initial_size": 256, "drop_delay_frames": 120}
+* }
+* @endcode
+*/
+class TextureStreamer {
+public:
+    /**
+    * @brief Decodes the image of a texture. Called on a loader thread.
+    */
+    using ImageLoader = std::function<graphics::TextureImage(const std::filesystem::path &path, bool flip_uvs)>;
+
+    /**
+    * @param budget GPU memory for all the streamed textures in bytes, 0 for no limit.
+    * @param initial_size largest side of a texture that is uploaded before anything requests it.
+    * @param drop_delay frames a texture has to be more detailed than needed before its levels are dropped.
+    * @param loader decodes the images again when a texture whose chain was dropped is back on screen.
+    */
+    TextureStreamer(uint64_t budget, int32_t initial_size, uint32_t drop_delay, ImageLoader loader);
+
+    TextureStreamer(const TextureStreamer &) = delete;
+
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    /**
+    * @brief Waits for the images that are still decoding and drops the textures that are still streaming in.
+    */
+    ~TextureStreamer();
+
+    /**
+    * @brief Starts streaming the texture: uploads the levels needed so far and manages them from then on.
+    * @param image freshly decoded image of the texture, with its full mip chain.
+    */
+    void track(Texture *texture, graphics::StreamedImage image, bool flip_uvs);
+
+    /**
+    * @brief Picks the levels every texture needs this frame and starts the loads and drops. Called once per frame.
+    */
+    void update();
+
+    /**
+    * @returns GPU memory used by the streamed textures, including the ones that are still streaming in.
+    */
+    uint64_t resident_bytes() const;
+
+private:
+    struct LoadedImage {
+        std::shared_ptr<const graphics::StreamedImage> decoded;
+        /**
+        * @brief Levels of the decoded chain from the loaded mip down.
+        */
+        graphics::StreamedImage levels;
+    };
+
+    struct State {
+        int32_t width;
+        int32_t height;
+        int32_t channels;
+        int32_t levels;
+        bool flip_uvs;
+        /**
+        * @brief OpenGL texture the state describes. Changes if the texture is reloaded in full after an eviction.
+        */
+        uint32_t texture_id;
+        /**
+        * @brief Mip level of the image stored in level 0 of the OpenGL texture.
+        */
+        int32_t resident_mip;
+        /**
+        * @brief Finest mip level sampled, set with `GL_TEXTURE_BASE_LEVEL`.
+        */
+        int32_t clamp_mip;
+        int32_t target_mip;
+        uint32_t coarser_frames{0};
+        /**
+        * @brief Frames since the texture was last drawn.
+        */
+        uint32_t unrequested_frames{0};
+        int32_t loading_mip{-1};
+        /**
+        * @brief Full mip chain, kept while the texture is drawn so that changing its levels doesn't decode the file.
+        */
+        std::shared_ptr<const graphics::StreamedImage> decoded;
+        std::future<LoadedImage> image;
+        /**
+        * @brief Rebuilt texture that is streaming in; replaces the current one once it's complete.
+        */
+        graphics::GLTexture incoming;
+    };
+
+    /**
+    * @returns The finest mip level of the texture worth having when it spans `pixels` on screen.
+    */
+    static int32_t mip_for(const State &state, float pixels);
+
+    /**
+    * @returns GPU memory of the mip chain from `mip` down to 1x1.
+    */
+    static uint64_t bytes_from(const State &state, int32_t mip);
+
+    /**
+    * @returns A copy of the levels of the image from `mip` down.
+    */
+    static graphics::StreamedImage levels_from(const graphics::StreamedImage &image, int32_t mip);
+
+    void start_load(Texture *texture, State &state, int32_t mip);
+
+    /**
+    * @brief Applies the budget by coarsening the largest targets first.
+    * @returns true if the targets had to be coarsened.
+    */
+    bool fit_budget();
+
+    std::unordered_map<Texture *, State> m_states;
+    uint64_t m_budget;
+    int32_t m_initial_size;
+    uint32_t m_drop_delay;
+    ImageLoader m_loader;
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_TEXTURE_STREAMER_HPP
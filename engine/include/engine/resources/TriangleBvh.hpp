@@ -0,0 +1,130 @@
+/**
+ * @file TriangleBvh.hpp
+ * @brief Defines the TriangleBvh class that keeps the triangles of a mesh on the CPU for exact ray queries.
+*/
+
+#ifndef MATF_RG_PROJECT_TRIANGLE_BVH_HPP
+#define MATF_RG_PROJECT_TRIANGLE_BVH_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace engine::resources {
+struct Vertex;
+
+/**
+* @struct TriangleHit
+* @brief Where a ray hits a triangle of a mesh.
+*/
+struct TriangleHit {
+    /**
+    * @brief Index of the triangle in the index buffer of the mesh: its indices start at `3 * triangle`.
+    */
+    uint32_t triangle{0};
+    /**
+    * @brief Along the ray, in units of its direction.
+    */
+    float distance{0.0f};
+    /**
+    * @brief Weights of the second and the third vertex of the triangle; the first one has `1 - u - v`.
+    */
+    glm::vec2 barycentrics{0.0f};
+    /**
+    * @brief Texture coordinates interpolated at the hit.
+    */
+    glm::vec2 uv{0.0f};
+};
+
+/**
+* @class TriangleBvh
+* @brief Bounding volume hierarchy over the triangles of a mesh, with a compact copy of their positions
+* and texture coordinates, for ray queries that hit the actual geometry instead of its bounding box.
+*
+* Built with the binned surface area heuristic. The nodes are 32 bytes and laid out depth first, so the left
+* child of a node directly follows it and only the right child is referenced. The triangles are stored
+* in the order of the leaves, each with its index in the mesh.
+*/
+class TriangleBvh {
+public:
+    /**
+    * @brief Leaves hold at most this many triangles.
+    */
+    static constexpr uint32_t MAX_LEAF_TRIANGLES = 4;
+
+    /**
+    * @brief Builds the hierarchy of a triangle list.
+    */
+    static std::shared_ptr<const TriangleBvh> build(const std::vector<Vertex> &vertices,
+                                                    const std::vector<uint32_t> &indices);
+
+    /**
+    * @brief Reads a hierarchy written by @ref TriangleBvh::save for the same vertices and indices.
+    * @returns nullptr if the stream doesn't hold one that matches them.
+    */
+    static std::shared_ptr<const TriangleBvh> load(std::istream &in, const std::vector<Vertex> &vertices,
+                                                   const std::vector<uint32_t> &indices);
+
+    /**
+    * @brief Writes the nodes and the triangle order; the positions are taken from the mesh again on load.
+    */
+    void save(std::ostream &out) const;
+
+    /**
+    * @returns The nearest triangle the ray `origin + t * direction` hits for t in [0, `max_distance`],
+    * both sides of the triangles included.
+    */
+    std::optional<TriangleHit> intersect(const glm::vec3 &origin, const glm::vec3 &direction,
+                                         float max_distance = std::numeric_limits<float>::infinity()) const;
+
+    /**
+    * @returns CPU memory used by the nodes and the triangles.
+    */
+    uint64_t cpu_bytes() const;
+
+private:
+    struct Node {
+        glm::vec3 min;
+        /**
+        * @brief First triangle of a leaf, or the right child of an inner node.
+        */
+        uint32_t first;
+        glm::vec3 max;
+        /**
+        * @brief Triangles of a leaf; 0 for an inner node.
+        */
+        uint32_t count;
+    };
+
+    static_assert(sizeof(Node) == 32);
+
+    /**
+    * @brief Copies the positions and texture coordinates out of the mesh vertices.
+    */
+    void set_vertices(const std::vector<Vertex> &vertices);
+
+    /**
+    * @brief Builds the node `index` over the triangles [first, first + count) of the leaf order.
+    */
+    void build_node(uint32_t index, uint32_t first, uint32_t count, uint32_t depth,
+                    const std::vector<glm::vec3> &centroids);
+
+    std::vector<Node> m_nodes;
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::vec2> m_uvs;
+    /**
+    * @brief Vertex indices of the triangles in the leaf order, 3 per triangle.
+    */
+    std::vector<uint32_t> m_indices;
+    /**
+    * @brief Index of every triangle of the leaf order in the mesh.
+    */
+    std::vector<uint32_t> m_triangles;
+};
+} // namespace engine::resources
+
+#endif//MATF_RG_PROJECT_TRIANGLE_BVH_HPP
@@ -0,0 +1,120 @@
+/**
+ * @file Aabb.hpp
+ * @brief Defines the Aabb axis-aligned bounding box used by the spatial queries.
+*/
+
+#ifndef MATF_RG_PROJECT_AABB_HPP
+#define MATF_RG_PROJECT_AABB_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <glm/glm.hpp>
+
+namespace engine::util {
+/**
+* @struct Aabb
+* @brief Axis-aligned bounding box. A default constructed box is empty: growing it by a point gives that point.
+*/
+struct Aabb {
+    glm::vec3 min{std::numeric_limits<float>::max()};
+    glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+    bool operator==(const Aabb &box) const = default;
+
+    void grow(const glm::vec3 &point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const Aabb &box) {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    static Aabb merge(const Aabb &a, const Aabb &b) {
+        Aabb result = a;
+        result.grow(b);
+        return result;
+    }
+
+    bool empty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    glm::vec3 center() const {
+        return 0.5f * (min + max);
+    }
+
+    /**
+    * @returns Half of the surface area, which is all the surface area heuristic compares; 0 for an empty box.
+    */
+    float area() const {
+        if (empty()) {
+            return 0.0f;
+        }
+        const glm::vec3 extent = max - min;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    bool overlaps(const Aabb &box) const {
+        return min.x <= box.max.x && box.min.x <= max.x && min.y <= box.max.y && box.min.y <= max.y &&
+               min.z <= box.max.z && box.min.z <= max.z;
+    }
+
+    /**
+    * @returns The smallest box around this box transformed by `matrix`, rotation included.
+    */
+    Aabb transformed(const glm::mat4 &matrix) const {
+        if (empty()) {
+            return *this;
+        }
+        // Every row of the result is a sum over the columns, and each term is smallest at one of the box ends.
+        Aabb result;
+        result.min = result.max = glm::vec3(matrix[3]);
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 3; ++row) {
+                const float a = matrix[column][row] * min[column];
+                const float b = matrix[column][row] * max[column];
+                result.min[row] += std::min(a, b);
+                result.max[row] += std::max(a, b);
+            }
+        }
+        return result;
+    }
+
+    /**
+    * @brief Intersects the ray `origin + t * direction` for t in [0, `max_distance`] with the box.
+    * @param inverse_direction 1 / direction, per component.
+    * @returns The distance at which the ray enters the box, 0 if it starts inside, or nothing if it misses.
+    *
+    * A ray parallel to a pair of faces, with an infinite inverse component, is between them for its whole length
+    * if its origin is, boundary included, and never otherwise; the slab isn't computed, as an origin on a face
+    * would give 0 * inf = NaN.
+    */
+    std::optional<float> intersect(const glm::vec3 &origin, const glm::vec3 &inverse_direction,
+                                   float max_distance) const {
+        const glm::vec3 t0 = (min - origin) * inverse_direction;
+        const glm::vec3 t1 = (max - origin) * inverse_direction;
+        glm::vec3 t_near = glm::min(t0, t1);
+        glm::vec3 t_far = glm::max(t0, t1);
+        for (int axis = 0; axis < 3; ++axis) {
+            if (std::isinf(inverse_direction[axis])) {
+                const bool inside = min[axis] <= origin[axis] && origin[axis] <= max[axis];
+                t_near[axis] = inside ? -std::numeric_limits<float>::infinity()
+                                      : std::numeric_limits<float>::infinity();
+                t_far[axis] = -t_near[axis];
+            }
+        }
+        const float enter = std::max({t_near.x, t_near.y, t_near.z, 0.0f});
+        const float leave = std::min({t_far.x, t_far.y, t_far.z, max_distance});
+        if (enter > leave) {
+            return std::nullopt;
+        }
+        return enter;
+    }
+};
+} // namespace engine::util
+
+#endif//MATF_RG_PROJECT_AABB_HPP
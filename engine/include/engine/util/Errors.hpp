@@ -104,6 +104,10 @@ public:
         * @brief The error that occurs when an asset loading fails.
         */
         AssetLoadingError,
+        /**
+        * @brief The error that occurs when GPU resources keep growing in a steady state. See @ref engine::graphics::GLResourceRegistry.
+        */
+        ResourceLeak,
 
         EngineErrorCount
     };
@@ -0,0 +1,182 @@
+/**
+ * @file IOService.hpp
+ * @brief Defines the IOService that reads files asynchronously, through io_uring on Linux or a thread pool elsewhere.
+*/
+
+#ifndef MATF_RG_PROJECT_IO_SERVICE_HPP
+#define MATF_RG_PROJECT_IO_SERVICE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace engine::util {
+/**
+* @class FileBuffer
+* @brief Contents of a file read by the @ref IOService. The file is read straight into this buffer, without extra copies.
+*/
+class FileBuffer {
+public:
+    FileBuffer() = default;
+
+    FileBuffer(std::filesystem::path path, uint64_t size) : m_path(std::move(path)),
+                                                            m_data(std::make_unique_for_overwrite<uint8_t[]>(size)),
+                                                            m_size(size) {
+    }
+
+    std::span<const uint8_t> data() const {
+        return {m_data.get(), m_size};
+    }
+
+    std::span<uint8_t> data() {
+        return {m_data.get(), m_size};
+    }
+
+    std::string_view text() const {
+        return {reinterpret_cast<const char *>(m_data.get()), m_size};
+    }
+
+    const std::filesystem::path &path() const {
+        return m_path;
+    }
+
+private:
+    std::filesystem::path m_path;
+    std::unique_ptr<uint8_t[]> m_data;
+    uint64_t m_size{0};
+};
+
+/**
+* @brief Outcome of a read passed to the completion callback.
+*/
+struct ReadResult {
+    std::filesystem::path path;
+    /**
+    * @brief Number of bytes read; less than requested only if the file is shorter.
+    */
+    uint64_t bytes{0};
+    /**
+    * @brief `errno` of the failed read, 0 on success.
+    */
+    int error{0};
+};
+
+/**
+* @class IOService
+* @brief Reads files asynchronously, so that loading many assets keeps the disk queue full.
+*
+* On Linux the reads are submitted to an io_uring and completed on a dedicated thread; if io_uring isn't available
+* (kernels before 5.6, sandboxes that block the syscalls, other platforms) the reads run on a small thread pool.
+* The service also falls back to the thread pool if the ring starts failing later.
+* Reads go directly into caller-provided memory or into a @ref FileBuffer sized to the file.
+*
+* @code
+* auto io = engine::util::IOService::instance();
+* auto image = io->read("resources/textures/grass.png");
+* auto model = io->read("resources/models/tree/tree.obj");
+* decode(image.get().data());
+* @endcode
+*/
+class IOService {
+public:
+    using ReadCallback = std::function<void(const ReadResult &)>;
+
+    static IOService *instance();
+
+    ~IOService();
+
+    /**
+    * @brief Reads the whole file into a new @ref FileBuffer.
+    * The future throws @ref EngineError::Type::FileNotFound if the file can't be opened,
+    * and @ref EngineError::Type::AssetLoadingError if the read fails.
+    */
+    std::future<FileBuffer> read(const std::filesystem::path &path);
+
+    /**
+    * @brief Reads `destination.size()` bytes of the file, starting at `offset`, into `destination`.
+    * @param on_complete called on an I/O thread once the read finishes; keep it short.
+    * The destination must stay valid until then.
+    */
+    void read(const std::filesystem::path &path, std::span<uint8_t> destination, uint64_t offset,
+              ReadCallback on_complete);
+
+    /**
+    * @brief Reads the whole file and blocks until it's read.
+    */
+    FileBuffer read_file(const std::filesystem::path &path);
+
+    /**
+    * @returns "io_uring" or "thread pool".
+    */
+    std::string_view backend() const;
+
+private:
+    IOService();
+
+    struct Request {
+        int fd;
+        uint8_t *destination;
+        uint64_t size;
+        uint64_t offset;
+        uint64_t done;
+        std::filesystem::path path;
+        ReadCallback on_complete;
+    };
+
+    /**
+    * @brief Opens the file and hands the request to the backend. Calls `on_complete` right away if the open fails.
+    */
+    void submit(const std::filesystem::path &path, std::span<uint8_t> destination, uint64_t offset,
+                ReadCallback on_complete);
+
+    static void complete(Request *request, int error);
+
+    bool setup_io_uring();
+
+    void start_workers();
+
+    /**
+    * @brief Hands the queued reads, and the ones the kernel hasn't taken yet, to new worker threads and stops
+    * submitting to the ring. Called with `m_mutex` locked.
+    * @param error `errno` the ring failed with.
+    */
+    void fall_back_to_workers(int error);
+
+    /**
+    * @brief Pushes the queued requests into the submission queue while it has room. Called with `m_mutex` locked.
+    */
+    void submit_queued();
+
+    void completion_loop();
+
+    void worker_loop();
+
+    std::mutex m_mutex;
+    std::condition_variable m_queue_cv;
+    std::deque<Request *> m_queue;
+    std::vector<std::thread> m_threads;
+    bool m_running{true};
+
+    /**
+    * @brief io_uring state; the ring is shared with the kernel through mmap.
+    */
+    struct Ring;
+    std::unique_ptr<Ring> m_ring;
+    /**
+    * @brief False if io_uring is unavailable, or failed and the workers took over.
+    */
+    std::atomic<bool> m_use_ring{false};
+};
+} // namespace engine::util
+
+#endif//MATF_RG_PROJECT_IO_SERVICE_HPP
@@ -0,0 +1,28 @@
+/**
+ * @file Lz4.hpp
+ * @brief Defines the compression and decompression of the LZ4 block format.
+*/
+
+#ifndef MATF_RG_PROJECT_LZ4_HPP
+#define MATF_RG_PROJECT_LZ4_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace engine::util {
+/**
+* @brief Compresses `source` into a single LZ4 block (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+* The block carries no header; the uncompressed size has to be stored next to it.
+* @returns The compressed block.
+*/
+std::vector<uint8_t> lz4_compress(std::span<const uint8_t> source);
+
+/**
+* @brief Decompresses a single LZ4 block into `destination`, which must be exactly the uncompressed size.
+* @returns false if the block is malformed or doesn't decompress to `destination.size()` bytes.
+*/
+bool lz4_decompress(std::span<const uint8_t> source, std::span<uint8_t> destination);
+} // namespace engine::util
+
+#endif//MATF_RG_PROJECT_LZ4_HPP
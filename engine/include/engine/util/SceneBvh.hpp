@@ -0,0 +1,233 @@
+/**
+ * @file SceneBvh.hpp
+ * @brief Defines the SceneBvh class, a dynamic bounding volume hierarchy over the objects of the scene.
+*/
+
+#ifndef MATF_RG_PROJECT_SCENE_BVH_HPP
+#define MATF_RG_PROJECT_SCENE_BVH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <vector>
+#include <glm/glm.hpp>
+#include <engine/util/Aabb.hpp>
+
+namespace engine::util {
+/**
+* @brief An object hit by a @ref SceneBvh ray query, at `distance` along the ray.
+*/
+struct RayHit {
+    uint32_t proxy;
+    float distance;
+};
+
+/**
+* @struct RayBatch
+* @brief Rays laid out by component, for @ref SceneBvh::ray_closest on many rays at once.
+*/
+struct RayBatch {
+    std::vector<float> origin_x;
+    std::vector<float> origin_y;
+    std::vector<float> origin_z;
+    std::vector<float> direction_x;
+    std::vector<float> direction_y;
+    std::vector<float> direction_z;
+    std::vector<float> max_distances;
+
+    void add(const glm::vec3 &origin, const glm::vec3 &direction,
+             float max_distance = std::numeric_limits<float>::infinity()) {
+        origin_x.push_back(origin.x);
+        origin_y.push_back(origin.y);
+        origin_z.push_back(origin.z);
+        direction_x.push_back(direction.x);
+        direction_y.push_back(direction.y);
+        direction_z.push_back(direction.z);
+        max_distances.push_back(max_distance);
+    }
+
+    void clear() {
+        for (auto *component: {&origin_x, &origin_y, &origin_z, &direction_x, &direction_y, &direction_z,
+                               &max_distances}) {
+            component->clear();
+        }
+    }
+
+    uint32_t size() const {
+        return static_cast<uint32_t>(origin_x.size());
+    }
+
+    glm::vec3 origin(uint32_t ray) const {
+        return {origin_x[ray], origin_y[ray], origin_z[ray]};
+    }
+
+    glm::vec3 direction(uint32_t ray) const {
+        return {direction_x[ray], direction_y[ray], direction_z[ray]};
+    }
+};
+
+/**
+* @class SceneBvh
+* @brief Bounding volume hierarchy over the world space boxes of the objects of the scene, for picking,
+* culling and overlap tests in logarithmic time instead of a loop over every object.
+*
+* Every object is a proxy with its box and a user value, usually the index of the object in the app:
+* @code
+* auto proxy = bvh.insert(util::Aabb{box_min, box_max}.transformed(model), index);
+* bvh.build();
+* ...
+* bvh.move(proxy, new_box); // every time the object moves
+* if (auto hit = bvh.ray_closest(camera->Position, camera->Front)) {
+*     shoot(bvh.user_data(hit->proxy));
+* }
+* @endcode
+* @ref SceneBvh::build splits the objects top down with the binned surface area heuristic. Afterwards the tree
+* is kept up to date incrementally: a moved box is refitted into its ancestors, inserted boxes descend to the
+* cheapest sibling, and every refitted node is rotated when swapping a child with a grandchild makes the tree cheaper,
+* so the tree stays close to a rebuilt one while the objects move.
+*
+* The queries share a traversal stack, so a tree must not be queried from several threads at once.
+*/
+class SceneBvh {
+public:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    /**
+    * @returns Proxy of the new object, valid until it's removed.
+    */
+    uint32_t insert(const Aabb &box, uint64_t user_data = 0);
+
+    /**
+    * @brief Sets a new box of the object and refits the tree around it. An object that moved away from its
+    * neighbours is reinserted instead.
+    */
+    void move(uint32_t proxy, const Aabb &box);
+
+    void remove(uint32_t proxy);
+
+    /**
+    * @brief Rebuilds the whole tree with the surface area heuristic. Best called once all the objects are inserted.
+    */
+    void build();
+
+    const Aabb &box(uint32_t proxy) const {
+        return m_proxies[proxy].box;
+    }
+
+    uint64_t user_data(uint32_t proxy) const {
+        return m_proxies[proxy].user_data;
+    }
+
+    /**
+    * @returns Number of objects in the tree.
+    */
+    uint32_t size() const {
+        return m_size;
+    }
+
+    /**
+    * @returns Surface area heuristic cost of the tree: the areas of the nodes relative to the root.
+    * Lower is better; it grows as the objects move away from where the tree was built for them.
+    */
+    float cost() const;
+
+    /**
+    * @brief Appends the proxies whose boxes are at least partly inside the frustum of `view_projection`.
+    */
+    void query_frustum(const glm::mat4 &view_projection, std::vector<uint32_t> &result) const;
+
+    /**
+    * @brief Appends the proxies whose boxes overlap `box`.
+    */
+    void query_overlap(const Aabb &box, std::vector<uint32_t> &result) const;
+
+    /**
+    * @returns The nearest object whose box the ray hits, among the ones `accept` returns true for, if given.
+    */
+    std::optional<RayHit> ray_closest(const glm::vec3 &origin, const glm::vec3 &direction,
+                                      float max_distance = std::numeric_limits<float>::infinity(),
+                                      const std::function<bool(uint32_t proxy)> &accept = {}) const;
+
+    /**
+    * @brief Finds the nearest hit of every ray in the batch: `result[i]` is the hit of ray i,
+    * with @ref SceneBvh::NONE as the proxy if it misses.
+    *
+    * Groups of 4 rays whose directions point into the same octant are traced together as a packet,
+    * testing each node against the 4 rays at once with SSE2; the node is entered if any of them hits it.
+    * Rays of the other groups diverge too soon to share the traversal, so they are traced one at a time.
+    * Only the objects `accept` returns true for, if given, are hit, as with the single ray.
+    */
+    void ray_closest(const RayBatch &rays, std::vector<RayHit> &result,
+                     const std::function<bool(uint32_t proxy)> &accept = {}) const;
+
+    /**
+    * @brief Appends every object whose box the ray hits, sorted from the nearest.
+    */
+    void ray_all(const glm::vec3 &origin, const glm::vec3 &direction, std::vector<RayHit> &result,
+                 float max_distance = std::numeric_limits<float>::infinity()) const;
+
+private:
+    struct Node {
+        Aabb box;
+        uint32_t parent{NONE};
+        uint32_t children[2]{NONE, NONE};
+        /**
+        * @brief The object of a leaf; NONE for the inner nodes.
+        */
+        uint32_t proxy{NONE};
+
+        bool leaf() const {
+            return proxy != NONE;
+        }
+    };
+
+    struct Proxy {
+        Aabb box;
+        uint64_t user_data{0};
+        uint32_t leaf{NONE};
+    };
+
+    uint32_t allocate_node();
+
+    void free_node(uint32_t node);
+
+    /**
+    * @brief Builds the subtree of `proxies[begin, end)` and returns its root.
+    */
+    uint32_t build_range(std::vector<uint32_t> &proxies, uint32_t begin, uint32_t end, uint32_t parent);
+
+    void insert_leaf(uint32_t leaf);
+
+    void remove_leaf(uint32_t leaf);
+
+    /**
+    * @brief Traces rays [first, first + count) of the batch, up to 4 with directions in the same octant, as a packet.
+    */
+    void trace_packet(const RayBatch &rays, uint32_t first, uint32_t count, std::vector<RayHit> &result,
+                      const std::function<bool(uint32_t proxy)> &accept) const;
+
+    /**
+    * @brief Recomputes the boxes of `node` and its ancestors, rotating each of them.
+    */
+    void refit(uint32_t node);
+
+    /**
+    * @brief Swaps a child of `node` with a grandchild under the other child, if that lowers the area of that child.
+    */
+    void rotate(uint32_t node);
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_free_nodes;
+    std::vector<Proxy> m_proxies;
+    std::vector<uint32_t> m_free_proxies;
+    uint32_t m_root{NONE};
+    uint32_t m_size{0};
+    /**
+    * @brief Stack of the traversals, kept to avoid allocations in every query.
+    */
+    mutable std::vector<uint32_t> m_stack;
+};
+} // namespace engine::util
+
+#endif//MATF_RG_PROJECT_SCENE_BVH_HPP
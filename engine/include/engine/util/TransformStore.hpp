@@ -0,0 +1,149 @@
+/**
+ * @file TransformStore.hpp
+ * @brief Defines the TransformStore class that keeps the transforms of the scene and their cached matrices.
+*/
+
+#ifndef MATF_RG_PROJECT_TRANSFORM_STORE_HPP
+#define MATF_RG_PROJECT_TRANSFORM_STORE_HPP
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace engine::util {
+/**
+* @class TransformStore
+* @brief Positions, rotations and scales of the objects of the scene, with their world and normal matrices
+* computed once when they change instead of at every draw.
+*
+* The components are stored by field, and @ref TransformStore::update builds the matrices of 4 transforms at once
+* with SSE2, skipping the ones that didn't change, so static objects cost nothing per frame:
+* @code
+* auto cabin = transforms.create(glm::vec3(-3.0f, -0.5f, 1.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.2f));
+* ...
+* transforms.set_rotation(target, glm::angleAxis(angle, glm::vec3(1.0f, 0.0f, 0.0f)));
+* transforms.update(); // once per frame, after the objects moved
+* shader->set_mat4("model", transforms.world(cabin));
+* shader->set_mat3("invNormal", transforms.normal(cabin));
+* @endcode
+* A transform can have a parent, created before it. A change of the parent moves its children as well.
+*/
+class TransformStore {
+public:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    /**
+    * @brief Transforms handed to one job of the @ref WorkerPool.
+    */
+    static constexpr uint32_t CHUNK_SIZE = 256;
+
+    /**
+    * @brief Updates with fewer changed transforms than this run on the calling thread alone.
+    */
+    static constexpr uint32_t PARALLEL_THRESHOLD = 4 * CHUNK_SIZE;
+
+    /**
+    * @param parent Transform this one is relative to, or @ref TransformStore::NONE for one in world space.
+    * @returns Index of the new transform. Transforms are never removed, so it stays valid.
+    */
+    uint32_t create(const glm::vec3 &position, const glm::quat &rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                    const glm::vec3 &scale = glm::vec3(1.0f), uint32_t parent = NONE);
+
+    void set_position(uint32_t transform, const glm::vec3 &position);
+
+    void set_rotation(uint32_t transform, const glm::quat &rotation);
+
+    void set_scale(uint32_t transform, const glm::vec3 &scale);
+
+    glm::vec3 position(uint32_t transform) const {
+        return {m_position_x[transform], m_position_y[transform], m_position_z[transform]};
+    }
+
+    glm::quat rotation(uint32_t transform) const {
+        return {m_rotation_w[transform], m_rotation_x[transform], m_rotation_y[transform], m_rotation_z[transform]};
+    }
+
+    glm::vec3 scale(uint32_t transform) const {
+        return {m_scale_x[transform], m_scale_y[transform], m_scale_z[transform]};
+    }
+
+    uint32_t parent(uint32_t transform) const {
+        return m_parents[transform];
+    }
+
+    uint32_t size() const {
+        return static_cast<uint32_t>(m_parents.size());
+    }
+
+    /**
+    * @brief Recomputes the matrices of the transforms that changed since the last update, and of their descendants.
+    * The local matrices are built in chunks spread over the @ref WorkerPool when there are many of them;
+    * the children are then multiplied with their parents in order.
+    * @returns Number of recomputed transforms.
+    */
+    uint32_t update();
+
+    /**
+    * @returns Model matrix of the transform as of the last @ref TransformStore::update.
+    */
+    const glm::mat4 &world(uint32_t transform) const {
+        return m_world[transform];
+    }
+
+    /**
+    * @returns Inverse transpose of the upper 3x3 of @ref TransformStore::world, for transforming normals.
+    */
+    const glm::mat3 &normal(uint32_t transform) const {
+        return m_normal[transform];
+    }
+
+    /**
+    * @returns True if the last @ref TransformStore::update recomputed the matrices of the transform.
+    */
+    bool changed(uint32_t transform) const {
+        return m_changed[transform] != 0;
+    }
+
+private:
+    void mark_dirty(uint32_t transform);
+
+    /**
+    * @brief Builds the matrices of the dirty transforms in [first, last) from their own fields: the world matrices
+    * of the ones without a parent, the local ones of the rest. `first` is a multiple of 4.
+    */
+    void compute_local(uint32_t first, uint32_t last);
+
+    /**
+    * @brief Fields of the transforms, padded with identities to a multiple of 4.
+    */
+    std::vector<float> m_position_x;
+    std::vector<float> m_position_y;
+    std::vector<float> m_position_z;
+    std::vector<float> m_rotation_x;
+    std::vector<float> m_rotation_y;
+    std::vector<float> m_rotation_z;
+    std::vector<float> m_rotation_w;
+    std::vector<float> m_scale_x;
+    std::vector<float> m_scale_y;
+    std::vector<float> m_scale_z;
+    std::vector<uint32_t> m_parents;
+    /**
+    * @brief Relative to the parent; only filled for the transforms that have one.
+    */
+    std::vector<glm::mat4> m_local;
+    std::vector<glm::mat4> m_world;
+    std::vector<glm::mat3> m_normal;
+    std::vector<uint8_t> m_dirty;
+    std::vector<uint8_t> m_changed;
+    /**
+    * @brief Lowest dirty transform, or NONE if none is: descendants come after their ancestors,
+    * so nothing before it has to be looked at.
+    */
+    uint32_t m_first_dirty{NONE};
+    bool m_any_changed{false};
+};
+} // namespace engine::util
+
+#endif//MATF_RG_PROJECT_TRANSFORM_STORE_HPP
@@ -0,0 +1,114 @@
+/**
+ * @file WorkerPool.hpp
+ * @brief Defines the WorkerPool that splits CPU work of a frame across a few persistent threads.
+*/
+
+#ifndef MATF_RG_PROJECT_WORKER_POOL_HPP
+#define MATF_RG_PROJECT_WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace engine::util {
+/**
+* @class WorkerPool
+* @brief Threads that are started once and run the jobs of @ref WorkerPool::parallel_for.
+*
+* Starting a thread costs more than most of the per-frame work, so the threads are kept waiting between calls.
+* The calling thread takes jobs as well, and returns once all of them are done:
+* @code
+* WorkerPool::instance()->parallel_for(bands, [&](uint32_t band) {
+*     rasterize(band);
+* });
+* @endcode
+* Jobs must not throw, and must not call @ref WorkerPool::parallel_for themselves.
+*
+* Longer work that shouldn't hold up the frame, like loading an asset, runs in the background with
+* @ref WorkerPool::async. At most half of the workers run background tasks at once, so the rest stay free for
+* @ref WorkerPool::parallel_for, and a burst of tasks waits in a queue instead of starting a thread each.
+*/
+class WorkerPool {
+public:
+    using Job = std::function<void(uint32_t index)>;
+    using Task = std::function<void()>;
+
+    static WorkerPool *instance();
+
+    ~WorkerPool();
+
+    /**
+    * @returns Number of threads that run jobs, including the calling one.
+    */
+    uint32_t size() const {
+        return static_cast<uint32_t>(m_threads.size()) + 1;
+    }
+
+    /**
+    * @brief Calls `job(i)` for every i in [0, count), spread over the workers and the calling thread,
+    * and waits for all the calls to return. Calls from several threads are run one after another.
+    */
+    void parallel_for(uint32_t count, const Job &job);
+
+    /**
+    * @brief Queues `task` to run on a worker in the background. Tasks start in the order they were queued.
+    * Tasks must not throw; tasks still queued when the pool is destroyed don't run.
+    */
+    void submit(Task task);
+
+    /**
+    * @brief Runs `function` in the background, see @ref WorkerPool::submit.
+    * @returns Future of its result; it holds the exception if `function` throws.
+    * Unlike the futures of `std::async`, it doesn't wait for the task when destroyed.
+    */
+    template<typename Function>
+    std::future<std::invoke_result_t<Function>> async(Function function) {
+        // std::function has to be copyable, so the task is shared.
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(std::move(function));
+        auto result = task->get_future();
+        submit([task] { (*task)(); });
+        return result;
+    }
+
+private:
+    WorkerPool();
+
+    void worker_loop();
+
+    /**
+    * @brief Takes job indices until there are none left.
+    */
+    void run(const Job &job, uint32_t count);
+
+    std::mutex m_submit_mutex;
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    const Job *m_job{nullptr};
+    uint32_t m_count{0};
+    std::atomic<uint32_t> m_next{0};
+    /**
+    * @brief Workers that took the current job and haven't finished it yet.
+    */
+    uint32_t m_busy{0};
+    uint64_t m_generation{0};
+    std::deque<Task> m_tasks;
+    /**
+    * @brief Background tasks running now, and how many may run at once.
+    */
+    uint32_t m_background{0};
+    uint32_t m_max_background{1};
+    bool m_running{true};
+    std::vector<std::thread> m_threads;
+};
+} // namespace engine::util
+
+#endif//MATF_RG_PROJECT_WORKER_POOL_HPP
@@ -1,5 +1,6 @@
 #include <spdlog/spdlog.h>
 #include <engine/core/App.hpp>
+#include <engine/core/WorldController.hpp>
 #include <engine/platform/PlatformController.hpp>
 #include <engine/resources/ResourcesController.hpp>
 #include <engine/util/Errors.hpp>
@@ -37,11 +38,13 @@ void App::engine_setup(int argc, char **argv) {
     auto platform = register_controller<platform::PlatformController>();
     auto graphics = register_controller<graphics::GraphicsController>();
     auto resources = register_controller<resources::ResourcesController>();
+    auto world = register_controller<WorldController>();
     auto end = register_controller<EngineControllersEnd>();
     begin->before(platform);
     platform->before(graphics);
     graphics->before(resources);
-    resources->before(end);
+    resources->before(world);
+    world->before(end);
 }
 
 void App::initialize() {
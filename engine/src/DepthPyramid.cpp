@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <glad/glad.h>
+#include <engine/graphics/DepthPyramid.hpp>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/resources/Shader.hpp>
+#include <engine/resources/ShaderCompiler.hpp>
+#include <engine/util/Configuration.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::graphics {
+
+/**
+* @brief Writes one level of the pyramid from the level below, or from the depth copy for level 0.
+*/
+static constexpr const char *REDUCE_SOURCE = R"(#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (r32f, binding = 0) writeonly uniform image2D destination;
+uniform sampler2D source;
+uniform int source_level;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(destination);
+    if (texel.x >= size.x || texel.y >= size.y) {
+        return;
+    }
+    ivec2 source_size = textureSize(source, source_level);
+    // The last texel of a level below an odd-sized one also covers the extra row or column.
+    ivec2 last = ivec2(texel.x == size.x - 1 && (source_size.x & 1) != 0 ? 2 : 1,
+                       texel.y == size.y - 1 && (source_size.y & 1) != 0 ? 2 : 1);
+    float depth = 0.0;
+    for (int y = 0; y <= last.y; ++y) {
+        for (int x = 0; x <= last.x; ++x) {
+            ivec2 coordinate = min(texel * 2 + ivec2(x, y), source_size - 1);
+            depth = max(depth, texelFetch(source, coordinate, source_level).r);
+        }
+    }
+    imageStore(destination, texel, vec4(depth));
+}
+)";
+
+static constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+
+DepthPyramid::DepthPyramid() = default;
+
+DepthPyramid::~DepthPyramid() = default;
+
+void DepthPyramid::initialize() {
+    const auto &config = util::Configuration::config();
+    if (!config.contains("graphics") || !config["graphics"].value<bool>("hi_z", false)) {
+        return;
+    }
+    if (!GLExtensions::compute_shader()) {
+        spdlog::info("[DepthPyramid]: compute shaders aren't supported by the driver, Hi-Z culling is disabled");
+        return;
+    }
+    m_reduce = std::make_unique<resources::Shader>(
+            resources::ShaderCompiler::compile_compute("depth pyramid", REDUCE_SOURCE));
+    m_reduce->use();
+    m_reduce->set_int("source", 0);
+    CHECKED_GL_CALL(glUseProgram, 0);
+    m_enabled = true;
+}
+
+void DepthPyramid::shutdown() {
+    if (m_reduce) {
+        m_reduce->destroy();
+        m_reduce.reset();
+    }
+    m_depth.reset();
+    m_pyramid.reset();
+    m_width = m_height = 0;
+    m_levels = 0;
+    m_enabled = false;
+    m_ready = false;
+}
+
+void DepthPyramid::allocate(int32_t width, int32_t height) {
+    m_width = width;
+    m_height = height;
+    m_level_width = std::max(width / 2, 1);
+    m_level_height = std::max(height / 2, 1);
+    m_levels = 1;
+    while ((m_level_width >> m_levels) > 0 || (m_level_height >> m_levels) > 0) {
+        ++m_levels;
+    }
+
+    m_depth = GLTexture::create("depth pyramid source");
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, m_depth.id());
+    CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT,
+                    GL_UNSIGNED_INT, nullptr);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    m_depth.set_size(static_cast<uint64_t>(width) * height * 4);
+
+    m_pyramid = GLTexture::create("depth pyramid");
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, m_pyramid.id());
+    uint64_t bytes = 0;
+    for (int32_t level = 0; level < m_levels; ++level) {
+        const int32_t level_width = std::max(m_level_width >> level, 1);
+        const int32_t level_height = std::max(m_level_height >> level, 1);
+        CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_2D, level, GL_R32F, level_width, level_height, 0, GL_RED, GL_FLOAT,
+                        nullptr);
+        bytes += static_cast<uint64_t>(level_width) * level_height * sizeof(float);
+    }
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+    m_pyramid.set_size(bytes);
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, 0);
+    m_ready = false;
+}
+
+void DepthPyramid::build(int32_t width, int32_t height, const glm::mat4 &view_projection) {
+    // A minimized window has no depth to reduce; the last pyramid stays.
+    if (!m_enabled || width <= 0 || height <= 0) {
+        return;
+    }
+    if (width != m_width || height != m_height) {
+        allocate(width, height);
+    }
+
+    CHECKED_GL_CALL(glBindFramebuffer, GL_READ_FRAMEBUFFER, 0);
+    CHECKED_GL_CALL(glActiveTexture, GL_TEXTURE0);
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, m_depth.id());
+    CHECKED_GL_CALL(glCopyTexSubImage2D, GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    m_reduce->use();
+    for (int32_t level = 0; level < m_levels; ++level) {
+        const uint32_t level_width = std::max(m_level_width >> level, 1);
+        const uint32_t level_height = std::max(m_level_height >> level, 1);
+        // Level 0 reads the depth copy, every other level the one below it.
+        if (level == 1) {
+            CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, m_pyramid.id());
+        }
+        m_reduce->set_int("source_level", std::max(level - 1, 0));
+        CHECKED_GL_CALL(GLExtensions::glBindImageTexture, 0, m_pyramid.id(), level, GL_FALSE, 0, GL_WRITE_ONLY,
+                        GL_R32F);
+        CHECKED_GL_CALL(GLExtensions::glDispatchCompute, (level_width + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+                        (level_height + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1u);
+        CHECKED_GL_CALL(GLExtensions::glMemoryBarrier, GLExtensions::TEXTURE_FETCH_BARRIER_BIT |
+                                                       GLExtensions::SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, 0);
+    CHECKED_GL_CALL(glUseProgram, 0);
+    m_view_projection = view_projection;
+    m_ready = true;
+}
+
+}
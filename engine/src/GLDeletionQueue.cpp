@@ -0,0 +1,85 @@
+#include <glad/glad.h>
+#include <engine/graphics/GLDeletionQueue.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/util/Errors.hpp>
+
+namespace engine::graphics {
+
+GLDeletionQueue *GLDeletionQueue::instance() {
+    static GLDeletionQueue queue;
+    return &queue;
+}
+
+void GLDeletionQueue::enqueue(GLObjectType type, uint32_t id, uint64_t bytes) {
+    std::lock_guard lock(m_mutex);
+    m_current.push_back(PendingObject{.type = type, .id = id, .bytes = bytes});
+    ++m_pending_count;
+    m_pending_bytes += bytes;
+}
+
+void GLDeletionQueue::end_frame() {
+    std::vector<PendingObject> released;
+    {
+        std::lock_guard lock(m_mutex);
+        released.swap(m_current);
+    }
+    if (!released.empty()) {
+        GLsync fence = CHECKED_GL_CALL(glFenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_in_flight.push_back(Batch{.fence = fence, .objects = std::move(released)});
+    }
+
+    // Fences signal in submission order, so polling stops at the first batch that is still in flight.
+    while (!m_in_flight.empty()) {
+        auto fence = static_cast<GLsync>(m_in_flight.front().fence);
+        GLenum status = CHECKED_GL_CALL(glClientWaitSync, fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        CHECKED_GL_CALL(glDeleteSync, fence);
+        delete_objects(m_in_flight.front().objects);
+        m_in_flight.pop_front();
+    }
+}
+
+void GLDeletionQueue::flush() {
+    std::lock_guard lock(m_mutex);
+    if (m_in_flight.empty() && m_current.empty()) {
+        return;
+    }
+    CHECKED_GL_CALL(glFinish);
+    for (auto &batch: m_in_flight) {
+        CHECKED_GL_CALL(glDeleteSync, static_cast<GLsync>(batch.fence));
+        delete_objects(batch.objects);
+    }
+    m_in_flight.clear();
+    delete_objects(m_current);
+    m_current.clear();
+}
+
+uint64_t GLDeletionQueue::pending_count() const {
+    return m_pending_count;
+}
+
+uint64_t GLDeletionQueue::pending_bytes() const {
+    return m_pending_bytes;
+}
+
+void GLDeletionQueue::delete_objects(const std::vector<PendingObject> &objects) {
+    for (const auto &object: objects) {
+        switch (object.type) {
+            case GLObjectType::Buffer: CHECKED_GL_CALL(glDeleteBuffers, 1, &object.id);
+                break;
+            case GLObjectType::Texture: CHECKED_GL_CALL(glDeleteTextures, 1, &object.id);
+                break;
+            case GLObjectType::VertexArray: CHECKED_GL_CALL(glDeleteVertexArrays, 1, &object.id);
+                break;
+            case GLObjectType::Program: CHECKED_GL_CALL(glDeleteProgram, object.id);
+                break;
+            default: RG_SHOULD_NOT_REACH_HERE("Unhandled GLObjectType");
+        }
+        --m_pending_count;
+        m_pending_bytes -= object.bytes;
+    }
+}
+
+}
@@ -0,0 +1,68 @@
+#include <glad/glad.h>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::graphics {
+
+template<typename T>
+static bool load(GLExtensions::Loader loader, T &function, const char *name) {
+    function = reinterpret_cast<T>(loader(name));
+    return function != nullptr;
+}
+
+void GLExtensions::initialize(Loader loader) {
+    CHECKED_GL_CALL(glGetIntegerv, GL_MAJOR_VERSION, &m_major);
+    CHECKED_GL_CALL(glGetIntegerv, GL_MINOR_VERSION, &m_minor);
+    int32_t count = 0;
+    CHECKED_GL_CALL(glGetIntegerv, GL_NUM_EXTENSIONS, &count);
+    m_extensions.clear();
+    for (int32_t i = 0; i < count; ++i) {
+        m_extensions.emplace(reinterpret_cast<const char *>(CHECKED_GL_CALL(glGetStringi, GL_EXTENSIONS, i)));
+    }
+
+    if (version(4, 1) || supported("GL_ARB_get_program_binary")) {
+        int32_t formats = 0;
+        CHECKED_GL_CALL(glGetIntegerv, NUM_PROGRAM_BINARY_FORMATS, &formats);
+        m_program_binary = formats > 0 &&
+                           load(loader, glGetProgramBinary, "glGetProgramBinary") &&
+                           load(loader, glProgramBinary, "glProgramBinary") &&
+                           load(loader, glProgramParameteri, "glProgramParameteri");
+    }
+    // The ARB variant has the same enums, its entry point is only named differently.
+    if (supported("GL_KHR_parallel_shader_compile")) {
+        m_parallel_shader_compile = load(loader, glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsKHR");
+    } else if (supported("GL_ARB_parallel_shader_compile")) {
+        m_parallel_shader_compile = load(loader, glMaxShaderCompilerThreadsKHR, "glMaxShaderCompilerThreadsARB");
+    }
+    if (m_parallel_shader_compile) {
+        // 0xFFFFFFFF lets the driver pick the number of threads.
+        CHECKED_GL_CALL(glMaxShaderCompilerThreadsKHR, 0xFFFFFFFFu);
+    }
+    if (version(4, 4) || supported("GL_ARB_multi_bind")) {
+        m_multi_bind = load(loader, glBindTextures, "glBindTextures");
+    }
+    // The base instance of the commands and the shader storage buffers are core in 4.3 as well.
+    if (version(4, 3)) {
+        m_multi_draw_indirect = load(loader, glMultiDrawElementsIndirect, "glMultiDrawElementsIndirect");
+    }
+    if (version(4, 3)) {
+        m_compute_shader = load(loader, glDispatchCompute, "glDispatchCompute") &&
+                           load(loader, glMemoryBarrier, "glMemoryBarrier") &&
+                           load(loader, glBindImageTexture, "glBindImageTexture") &&
+                           load(loader, glDrawElementsIndirect, "glDrawElementsIndirect");
+    }
+    spdlog::info("[GLExtensions]: OpenGL {}.{}, {} extensions, program binary: {}, parallel shader compile: {}, "
+                 "multi bind: {}, multi draw indirect: {}, compute shader: {}", m_major, m_minor, count,
+                 m_program_binary, m_parallel_shader_compile, m_multi_bind, m_multi_draw_indirect, m_compute_shader);
+}
+
+bool GLExtensions::version(int32_t major, int32_t minor) {
+    return m_major > major || (m_major == major && m_minor >= minor);
+}
+
+bool GLExtensions::supported(std::string_view extension) {
+    return m_extensions.contains(std::string(extension));
+}
+
+}
@@ -0,0 +1,195 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <engine/graphics/GLResourceRegistry.hpp>
+#include <engine/graphics/GLDeletionQueue.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/util/ArgParser.hpp>
+#include <engine/util/Errors.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::graphics {
+
+std::string_view to_string(GLObjectType type) {
+    switch (type) {
+        case GLObjectType::Buffer: return "Buffer";
+        case GLObjectType::Texture: return "Texture";
+        case GLObjectType::VertexArray: return "VertexArray";
+        case GLObjectType::Program: return "Program";
+        default: RG_SHOULD_NOT_REACH_HERE("Unhandled GLObjectType");
+    }
+}
+
+GLResourceRegistry *GLResourceRegistry::instance() {
+    static GLResourceRegistry registry;
+    return &registry;
+}
+
+uint32_t GLResourceRegistry::create(GLObjectType type, std::string label, std::source_location location) {
+    uint32_t id = 0;
+    switch (type) {
+        case GLObjectType::Buffer: CHECKED_GL_CALL(glGenBuffers, 1, &id);
+            break;
+        case GLObjectType::Texture: CHECKED_GL_CALL(glGenTextures, 1, &id);
+            break;
+        case GLObjectType::VertexArray: CHECKED_GL_CALL(glGenVertexArrays, 1, &id);
+            break;
+        case GLObjectType::Program: id = CHECKED_GL_CALL(glCreateProgram);
+            break;
+        default: RG_SHOULD_NOT_REACH_HERE("Unhandled GLObjectType");
+    }
+    std::lock_guard lock(m_mutex);
+    m_live.emplace(key(type, id), GLResourceInfo{
+            .type = type,
+            .id = id,
+            .bytes = 0,
+            .label = std::move(label),
+            .location = location,
+            .frame = m_frame,
+    });
+    ++m_counts[static_cast<size_t>(type)];
+    return id;
+}
+
+void GLResourceRegistry::destroy(GLObjectType type, uint32_t id) {
+    uint64_t bytes = 0;
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_live.find(key(type, id));
+        RG_GUARANTEE(it != m_live.end(), "Destroying an untracked {} {}", to_string(type), id);
+        bytes = it->second.bytes;
+        m_bytes[static_cast<size_t>(type)] -= bytes;
+        --m_counts[static_cast<size_t>(type)];
+        m_live.erase(it);
+    }
+
+    if (m_context_alive) {
+        GLDeletionQueue::instance()->enqueue(type, id, bytes);
+    }
+}
+
+void GLResourceRegistry::set_size(GLObjectType type, uint32_t id, uint64_t bytes) {
+    std::lock_guard lock(m_mutex);
+    auto it = m_live.find(key(type, id));
+    RG_GUARANTEE(it != m_live.end(), "Resizing an untracked {} {}", to_string(type), id);
+    auto &total = m_bytes[static_cast<size_t>(type)];
+    total = total - it->second.bytes + bytes;
+    it->second.bytes = bytes;
+}
+
+uint64_t GLResourceRegistry::size(GLObjectType type, uint32_t id) const {
+    std::lock_guard lock(m_mutex);
+    auto it = m_live.find(key(type, id));
+    return it != m_live.end() ? it->second.bytes : 0;
+}
+
+uint64_t GLResourceRegistry::live_bytes() const {
+    std::lock_guard lock(m_mutex);
+    uint64_t result = 0;
+    for (auto bytes: m_bytes) {
+        result += bytes;
+    }
+    return result;
+}
+
+uint64_t GLResourceRegistry::live_count(GLObjectType type) const {
+    std::lock_guard lock(m_mutex);
+    return m_counts[static_cast<size_t>(type)];
+}
+
+void GLResourceRegistry::report(uint64_t since_frame) const {
+    struct SiteStats {
+        uint64_t count{0};
+        uint64_t bytes{0};
+        std::string example_label;
+    };
+
+    std::map<std::tuple<std::string_view, uint32_t, GLObjectType>, SiteStats> sites;
+    {
+        std::lock_guard lock(m_mutex);
+        for (const auto &[_, info]: m_live) {
+            if (info.frame < since_frame) {
+                continue;
+            }
+            auto &site = sites[{info.location.file_name(), info.location.line(), info.type}];
+            ++site.count;
+            site.bytes += info.bytes;
+            if (site.example_label.empty()) {
+                site.example_label = info.label;
+            }
+        }
+    }
+
+    std::vector<std::pair<decltype(sites)::key_type, SiteStats>> sorted(sites.begin(), sites.end());
+    std::ranges::sort(sorted, [](const auto &a, const auto &b) {
+        return a.second.bytes > b.second.bytes;
+    });
+
+    const auto deletion_queue = GLDeletionQueue::instance();
+    spdlog::info("[GLResourceRegistry]: frame {}, {:.2f} MiB live in {} buffers, {} textures, {} vertex arrays, {} programs; {} objects ({:.2f} MiB) awaiting deletion",
+                 m_frame, static_cast<double>(live_bytes()) / (1024.0 * 1024.0),
+                 live_count(GLObjectType::Buffer), live_count(GLObjectType::Texture),
+                 live_count(GLObjectType::VertexArray), live_count(GLObjectType::Program),
+                 deletion_queue->pending_count(),
+                 static_cast<double>(deletion_queue->pending_bytes()) / (1024.0 * 1024.0));
+    for (const auto &[site, stats]: sorted) {
+        const auto &[file, line, type] = site;
+        spdlog::info("    {:>6} x {:<11} {:>10} bytes  {}:{} {}", stats.count, to_string(type), stats.bytes,
+                     file, line, stats.example_label);
+    }
+}
+
+void GLResourceRegistry::initialize() {
+    auto args = util::ArgParser::instance();
+    m_report_interval = static_cast<uint64_t>(std::max(args->arg<int>("--gl-report-interval", 0).value(), 0));
+    m_soak_warmup_frames = static_cast<uint64_t>(std::max(args->arg<int>("--gl-soak-test", 0).value(), 0));
+    if (m_soak_warmup_frames > 0) {
+        spdlog::info("[GLResourceRegistry]: soak test enabled, live GPU memory must not grow after frame {}",
+                     m_soak_warmup_frames);
+    }
+}
+
+void GLResourceRegistry::end_frame() {
+    GLDeletionQueue::instance()->end_frame();
+    uint64_t live_objects = 0;
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_frame;
+        live_objects = m_live.size();
+    }
+    if (m_report_interval > 0 && m_frame % m_report_interval == 0) {
+        report();
+    }
+    if (m_soak_warmup_frames == 0 || m_frame < m_soak_warmup_frames) {
+        return;
+    }
+    if (m_frame == m_soak_warmup_frames) {
+        m_soak_baseline = live_bytes();
+        m_soak_baseline_objects = live_objects;
+        spdlog::info("[GLResourceRegistry]: soak test baseline {} bytes in {} objects", m_soak_baseline,
+                     m_soak_baseline_objects);
+        return;
+    }
+    // Vertex arrays and programs have no size, so the number of objects is checked as well.
+    if (live_bytes() > m_soak_baseline || live_objects > m_soak_baseline_objects) {
+        spdlog::error("[GLResourceRegistry]: objects created after the soak test warmup:");
+        report(m_soak_warmup_frames);
+        throw util::EngineError(util::EngineError::Type::ResourceLeak,
+                                std::format("Live GPU memory grew from {} bytes in {} objects to {} bytes in {} objects in frame {}.",
+                                            m_soak_baseline, m_soak_baseline_objects, live_bytes(), live_objects,
+                                            m_frame));
+    }
+}
+
+void GLResourceRegistry::shutdown() {
+    GLDeletionQueue::instance()->flush();
+    if (!m_live.empty()) {
+        spdlog::warn("[GLResourceRegistry]: {} OpenGL objects leaked:", m_live.size());
+        report();
+    }
+    m_context_alive = false;
+}
+
+}
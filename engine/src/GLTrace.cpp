@@ -0,0 +1,819 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/GLTrace.hpp>
+#include <engine/util/Errors.hpp>
+#include <engine/util/Utils.hpp>
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <span>
+#include <tuple>
+
+namespace engine::graphics {
+
+static constexpr char TRACE_MAGIC[8] = {'R', 'G', 'G', 'L', 'T', 'R', 'C', '\0'};
+
+/**
+* @brief Kinds of OpenGL objects whose names are remapped on replay.
+*/
+enum class ObjectKind : uint8_t {
+    None,
+    Buffer,
+    Texture,
+    VertexArray,
+    Shader,
+    Program,
+    UniformLocation,
+    Sync,
+    Framebuffer,
+    Renderbuffer,
+    Query,
+    Count
+};
+
+/**
+* @brief Describes how a traced argument is captured and decoded on replay.
+*/
+enum class ArgRole : uint8_t {
+    /**
+    * @brief Plain value, replayed as recorded.
+    */
+    Value,
+    /**
+    * @brief Object name that has to be remapped.
+    */
+    Name,
+    /**
+    * @brief Pointer that is really an offset into a bound buffer, replayed as recorded.
+    */
+    Offset,
+    /**
+    * @brief Pointer to client memory stored in the call payload.
+    */
+    Payload,
+    /**
+    * @brief Output array of object names generated by the call (glGen*). The payload holds the recorded names.
+    */
+    GeneratedNames,
+    /**
+    * @brief Input array of object names deleted by the call (glDelete*). The payload holds the recorded names.
+    */
+    DeletedNames,
+    /**
+    * @brief Input array of object names the call uses (glBindTextures). The payload holds the recorded names,
+    * as many as `payload_size` tells. A null pointer is replayed as nullptr.
+    */
+    UsedNames,
+    /**
+    * @brief Array of strings stored in the payload (glShaderSource).
+    */
+    Strings,
+    /**
+    * @brief Output pointer whose value isn't needed on replay. Points to scratch memory on replay, sized by
+    * `payload_size` when the call tells how much it writes (glGet*InfoLog), and large enough for any query otherwise.
+    */
+    Scratch,
+    /**
+    * @brief Pointer replayed as nullptr.
+    */
+    Null,
+};
+
+struct ArgSpec {
+    ArgRole role{ArgRole::Value};
+    ObjectKind kind{ObjectKind::None};
+};
+
+struct GLCallRecord {
+    uint16_t function{0};
+    uint8_t argc{0};
+    std::array<uint64_t, GLTrace::MAX_ARGS> args{};
+    uint64_t result{0};
+    std::span<const uint8_t> payload;
+};
+
+struct GLReplayContext;
+
+struct GLFunctionSpec {
+    std::string_view name;
+    void (*invoke)(GLReplayContext &context, const GLFunctionSpec &spec, const GLCallRecord &call){nullptr};
+    std::array<ArgSpec, GLTrace::MAX_ARGS> args{};
+    ObjectKind result_kind{ObjectKind::None};
+    /**
+    * @brief Copies the client memory referenced by the call into the payload. nullptr if the call references none.
+    */
+    void (*capture_payload)(const uint64_t *args, std::vector<uint8_t> &payload){nullptr};
+    /**
+    * @brief Number of bytes the pointer argument of the call references. nullptr if it can't be told from the arguments.
+    */
+    uint64_t (*payload_size)(const uint64_t *args){nullptr};
+};
+
+struct GLReplayContext {
+    std::array<std::unordered_map<uint64_t, uint64_t>, static_cast<size_t>(ObjectKind::Count)> names;
+    std::vector<uint8_t> scratch;
+    std::vector<const char *> strings;
+    uint64_t current_program{0};
+
+    uint64_t remap(ObjectKind kind, uint64_t recorded) {
+        if (kind == ObjectKind::UniformLocation) {
+            if (static_cast<int32_t>(recorded) < 0) {
+                return recorded;
+            }
+            recorded = current_program << 32 | (recorded & 0xffffffff);
+        }
+        auto &map = names[static_cast<size_t>(kind)];
+        auto it = map.find(recorded);
+        return it != map.end() ? it->second : recorded;
+    }
+
+    void bind(ObjectKind kind, uint64_t recorded, uint64_t replayed) {
+        names[static_cast<size_t>(kind)][recorded] = replayed;
+    }
+};
+
+// ------------------------------------------------------------------ payload capture
+
+static uint64_t gl_pixel_size(uint64_t format, uint64_t type) {
+    uint64_t channels = 4;
+    switch (format) {
+        case GL_RED:
+        case GL_DEPTH_COMPONENT: channels = 1; break;
+        case GL_RG: channels = 2; break;
+        case GL_RGB:
+        case GL_BGR: channels = 3; break;
+        default: channels = 4; break;
+    }
+    switch (type) {
+        case GL_FLOAT:
+        case GL_UNSIGNED_INT:
+        case GL_INT: return channels * 4;
+        case GL_HALF_FLOAT:
+        case GL_UNSIGNED_SHORT:
+        case GL_SHORT: return channels * 2;
+        default: return channels;
+    }
+}
+
+/**
+* @brief Size of an image in client memory with the default GL_UNPACK_ALIGNMENT of 4.
+*/
+static uint64_t gl_image_size(uint64_t width, uint64_t height, uint64_t format, uint64_t type) {
+    uint64_t row = width * gl_pixel_size(format, type);
+    uint64_t stride = (row + 3) & ~uint64_t{3};
+    return height == 0 ? 0 : stride * (height - 1) + row;
+}
+
+static void append_bytes(std::vector<uint8_t> &payload, uint64_t pointer, uint64_t size) {
+    if (pointer == 0 || size == 0) {
+        return;
+    }
+    auto bytes = reinterpret_cast<const uint8_t *>(static_cast<uintptr_t>(pointer));
+    payload.insert(payload.end(), bytes, bytes + size);
+}
+
+template<size_t Count, size_t ElementSize>
+uint64_t array_size(const uint64_t *args) {
+    return args[Count] * ElementSize;
+}
+
+template<size_t Size>
+uint64_t sized_size(const uint64_t *args) {
+    return args[Size];
+}
+
+static uint64_t tex_image_2d_size(const uint64_t *args) {
+    return gl_image_size(args[3], args[4], args[6], args[7]);
+}
+
+static uint64_t tex_sub_image_2d_size(const uint64_t *args) {
+    return gl_image_size(args[4], args[5], args[6], args[7]);
+}
+
+template<size_t Pointer, size_t Count, size_t ElementSize>
+void capture_array(const uint64_t *args, std::vector<uint8_t> &payload) {
+    append_bytes(payload, args[Pointer], array_size<Count, ElementSize>(args));
+}
+
+template<size_t Pointer, size_t Size>
+void capture_sized(const uint64_t *args, std::vector<uint8_t> &payload) {
+    append_bytes(payload, args[Pointer], sized_size<Size>(args));
+}
+
+static void capture_tex_image_2d(const uint64_t *args, std::vector<uint8_t> &payload) {
+    append_bytes(payload, args[8], tex_image_2d_size(args));
+}
+
+static void capture_tex_sub_image_2d(const uint64_t *args, std::vector<uint8_t> &payload) {
+    append_bytes(payload, args[8], tex_sub_image_2d_size(args));
+}
+
+static void capture_shader_source(const uint64_t *args, std::vector<uint8_t> &payload) {
+    auto strings = reinterpret_cast<const GLchar *const *>(static_cast<uintptr_t>(args[2]));
+    auto lengths = reinterpret_cast<const GLint *>(static_cast<uintptr_t>(args[3]));
+    for (uint64_t i = 0; i < args[1]; ++i) {
+        uint32_t length = lengths && lengths[i] >= 0
+                              ? static_cast<uint32_t>(lengths[i])
+                              : static_cast<uint32_t>(std::strlen(strings[i]));
+        append_bytes(payload, reinterpret_cast<uintptr_t>(&length), sizeof(length));
+        append_bytes(payload, reinterpret_cast<uintptr_t>(strings[i]), length);
+    }
+}
+
+/**
+* @brief glMultiDrawElementsBaseVertex references three arrays of `drawcount` entries: the counts, the index offsets
+* and the base vertices. They are recorded one after the other, the offsets widened to 64 bits.
+*/
+static uint64_t multi_draw_elements_base_vertex_size(const uint64_t *args) {
+    return args[4] * (sizeof(GLsizei) + sizeof(uint64_t) + sizeof(GLint));
+}
+
+static void capture_multi_draw_elements_base_vertex(const uint64_t *args, std::vector<uint8_t> &payload) {
+    append_bytes(payload, args[1], args[4] * sizeof(GLsizei));
+    auto offsets = reinterpret_cast<const void *const *>(static_cast<uintptr_t>(args[3]));
+    for (uint64_t i = 0; i < args[4]; ++i) {
+        const auto offset = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(offsets[i]));
+        append_bytes(payload, reinterpret_cast<uintptr_t>(&offset), sizeof(offset));
+    }
+    append_bytes(payload, args[5], args[4] * sizeof(GLint));
+}
+
+// ------------------------------------------------------------------ replay decoding
+
+template<typename T>
+T decode(GLReplayContext &context, const ArgSpec &spec, const GLCallRecord &call, size_t index) {
+    const uint64_t word = call.args[index];
+    if constexpr (std::is_pointer_v<T>) {
+        switch (spec.role) {
+            // A null pointer was recorded without a payload, and tells GL to allocate without uploading.
+            case ArgRole::Payload: return word == 0 ? nullptr : reinterpret_cast<T>(const_cast<uint8_t *>(call.payload.data()));
+            case ArgRole::UsedNames: return word == 0 ? nullptr : reinterpret_cast<T>(context.scratch.data());
+            case ArgRole::GeneratedNames:
+            case ArgRole::DeletedNames:
+            case ArgRole::Scratch: return reinterpret_cast<T>(context.scratch.data());
+            case ArgRole::Strings: return reinterpret_cast<T>(context.strings.data());
+            case ArgRole::Null: return nullptr;
+            case ArgRole::Name: return reinterpret_cast<T>(static_cast<uintptr_t>(context.remap(spec.kind, word)));
+            default: return reinterpret_cast<T>(static_cast<uintptr_t>(word));
+        }
+    } else if constexpr (std::is_same_v<T, float>) {
+        return std::bit_cast<float>(static_cast<uint32_t>(word));
+    } else if constexpr (std::is_same_v<T, double>) {
+        return std::bit_cast<double>(word);
+    } else {
+        if (spec.role == ArgRole::Name) {
+            return static_cast<T>(context.remap(spec.kind, word));
+        }
+        return static_cast<T>(word);
+    }
+}
+
+/**
+* @brief Prepares the scratch memory and the string table referenced by pointer arguments before the call.
+*/
+static void prepare_call(GLReplayContext &context, const GLFunctionSpec &spec, const GLCallRecord &call) {
+    for (size_t i = 0; i < call.argc; ++i) {
+        switch (spec.args[i].role) {
+            case ArgRole::GeneratedNames: {
+                context.scratch.assign(call.args[0] * sizeof(GLuint), 0);
+                break;
+            }
+            case ArgRole::DeletedNames: {
+                RG_GUARANTEE(call.payload.size() >= call.args[0] * sizeof(GLuint),
+                             "Corrupted GL trace file: {} deletes {} names, but {} bytes were recorded.", spec.name,
+                             call.args[0], call.payload.size());
+                context.scratch.resize(call.args[0] * sizeof(GLuint));
+                auto recorded = reinterpret_cast<const GLuint *>(call.payload.data());
+                auto replayed = reinterpret_cast<GLuint *>(context.scratch.data());
+                for (uint64_t n = 0; n < call.args[0]; ++n) {
+                    replayed[n] = static_cast<GLuint>(context.remap(spec.args[i].kind, recorded[n]));
+                }
+                break;
+            }
+            case ArgRole::UsedNames: {
+                if (call.args[i] == 0) {
+                    break;
+                }
+                const uint64_t count = spec.payload_size(call.args.data()) / sizeof(GLuint);
+                RG_GUARANTEE(call.payload.size() >= count * sizeof(GLuint),
+                             "Corrupted GL trace file: {} uses {} names, but {} bytes were recorded.", spec.name, count,
+                             call.payload.size());
+                context.scratch.resize(count * sizeof(GLuint));
+                auto recorded = reinterpret_cast<const GLuint *>(call.payload.data());
+                auto replayed = reinterpret_cast<GLuint *>(context.scratch.data());
+                for (uint64_t n = 0; n < count; ++n) {
+                    replayed[n] = static_cast<GLuint>(context.remap(spec.args[i].kind, recorded[n]));
+                }
+                break;
+            }
+            case ArgRole::Scratch: {
+                const uint64_t size = spec.payload_size ? spec.payload_size(call.args.data()) : 4096;
+                context.scratch.assign(size, 0);
+                break;
+            }
+            case ArgRole::Payload: {
+                // GL reads as many bytes as the arguments say, whatever the payload holds.
+                if (call.args[i] != 0) {
+                    const uint64_t size = spec.payload_size ? spec.payload_size(call.args.data()) : 1;
+                    RG_GUARANTEE(call.payload.size() >= size,
+                                 "Corrupted GL trace file: {} references {} bytes, but {} were recorded.", spec.name,
+                                 size, call.payload.size());
+                }
+                break;
+            }
+            case ArgRole::Strings: {
+                // Strings are copied into the scratch buffer so that they can be null-terminated.
+                std::vector<size_t> offsets;
+                size_t offset = 0;
+                while (offset + sizeof(uint32_t) <= call.payload.size()) {
+                    uint32_t length;
+                    std::memcpy(&length, call.payload.data() + offset, sizeof(length));
+                    offset += sizeof(length);
+                    offsets.push_back(context.scratch.size());
+                    context.scratch.insert(context.scratch.end(), call.payload.begin() + offset,
+                                           call.payload.begin() + offset + length);
+                    context.scratch.push_back('\0');
+                    offset += length;
+                }
+                context.strings.clear();
+                for (size_t string_offset: offsets) {
+                    context.strings.push_back(reinterpret_cast<const char *>(context.scratch.data() + string_offset));
+                }
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+/**
+* @brief Binds the names generated and releases the names deleted by the call.
+*/
+static void finish_call(GLReplayContext &context, const GLFunctionSpec &spec, const GLCallRecord &call) {
+    for (size_t i = 0; i < call.argc; ++i) {
+        const auto &arg = spec.args[i];
+        if (arg.role == ArgRole::GeneratedNames) {
+            auto recorded = reinterpret_cast<const GLuint *>(call.payload.data());
+            auto replayed = reinterpret_cast<const GLuint *>(context.scratch.data());
+            for (uint64_t n = 0; n < call.args[0] && n * sizeof(GLuint) < call.payload.size(); ++n) {
+                context.bind(arg.kind, recorded[n], replayed[n]);
+            }
+        } else if (arg.role == ArgRole::DeletedNames) {
+            auto recorded = reinterpret_cast<const GLuint *>(call.payload.data());
+            for (uint64_t n = 0; n < call.args[0]; ++n) {
+                context.names[static_cast<size_t>(arg.kind)].erase(recorded[n]);
+            }
+        }
+    }
+    context.scratch.clear();
+}
+
+template<typename TResult, typename... TArgs, size_t... I>
+void invoke_decoded(GLReplayContext &context, const GLFunctionSpec &spec, const GLCallRecord &call,
+                    TResult (*function)(TArgs...), std::index_sequence<I...>) {
+    prepare_call(context, spec, call);
+    std::tuple<TArgs...> args{decode<TArgs>(context, spec.args[I], call, I)...};
+    if constexpr (std::is_same_v<TResult, void>) {
+        std::apply(function, args);
+    } else {
+        TResult result = std::apply(function, args);
+        if (spec.result_kind == ObjectKind::UniformLocation) {
+            context.bind(ObjectKind::UniformLocation, call.args[0] << 32 | (call.result & 0xffffffff),
+                         GLTrace::encode(result));
+        } else if (spec.result_kind != ObjectKind::None) {
+            context.bind(spec.result_kind, call.result, GLTrace::encode(result));
+        }
+    }
+    finish_call(context, spec, call);
+}
+
+template<typename TResult, typename... TArgs>
+constexpr size_t arity(TResult (*)(TArgs...)) {
+    return sizeof...(TArgs);
+}
+
+/**
+* @brief Replays a call through the glad or @ref GLExtensions function pointer `FunctionPointer` points to.
+* The pointer is read on every call since the functions are loaded at runtime.
+*/
+template<auto FunctionPointer, size_t... I>
+void replay_indexed(GLReplayContext &context, const GLFunctionSpec &spec, const GLCallRecord &call,
+                    std::index_sequence<I...> indices) {
+    RG_GUARANTEE(*FunctionPointer != nullptr, "The GL trace calls {}, which the driver of the replay doesn't offer.",
+                 spec.name);
+    invoke_decoded(context, spec, call, *FunctionPointer, indices);
+}
+
+#define RG_GL_REPLAY(function)                                                                                          \
+    [](GLReplayContext &context, const GLFunctionSpec &spec, const GLCallRecord &call) {                                 \
+        replay_indexed<&function>(context, spec, call, std::make_index_sequence<arity(decltype(function){})>{});        \
+    }
+
+static void replay_multi_draw_elements_base_vertex(GLReplayContext &, const GLFunctionSpec &spec,
+                                                   const GLCallRecord &call) {
+    const uint64_t draws = call.args[4];
+    RG_GUARANTEE(call.payload.size() >= multi_draw_elements_base_vertex_size(call.args.data()),
+                 "Corrupted GL trace file: {} references {} draws, but {} bytes were recorded.", spec.name, draws,
+                 call.payload.size());
+    std::vector<GLsizei> counts(draws);
+    std::vector<const void *> offsets(draws);
+    std::vector<GLint> base_vertices(draws);
+    const uint8_t *data = call.payload.data();
+    std::memcpy(counts.data(), data, draws * sizeof(GLsizei));
+    data += draws * sizeof(GLsizei);
+    for (uint64_t i = 0; i < draws; ++i) {
+        uint64_t offset;
+        std::memcpy(&offset, data + i * sizeof(offset), sizeof(offset));
+        offsets[i] = reinterpret_cast<const void *>(static_cast<uintptr_t>(offset));
+    }
+    data += draws * sizeof(uint64_t);
+    std::memcpy(base_vertices.data(), data, draws * sizeof(GLint));
+    glMultiDrawElementsBaseVertex(static_cast<GLenum>(call.args[0]), counts.data(), static_cast<GLenum>(call.args[2]),
+                                  offsets.data(), static_cast<GLsizei>(draws), base_vertices.data());
+}
+
+constexpr ArgSpec value() { return {ArgRole::Value, ObjectKind::None}; }
+constexpr ArgSpec name(ObjectKind kind) { return {ArgRole::Name, kind}; }
+constexpr ArgSpec offset() { return {ArgRole::Offset, ObjectKind::None}; }
+constexpr ArgSpec payload() { return {ArgRole::Payload, ObjectKind::None}; }
+constexpr ArgSpec generated(ObjectKind kind) { return {ArgRole::GeneratedNames, kind}; }
+constexpr ArgSpec deleted(ObjectKind kind) { return {ArgRole::DeletedNames, kind}; }
+constexpr ArgSpec used(ObjectKind kind) { return {ArgRole::UsedNames, kind}; }
+constexpr ArgSpec strings() { return {ArgRole::Strings, ObjectKind::None}; }
+constexpr ArgSpec scratch() { return {ArgRole::Scratch, ObjectKind::None}; }
+constexpr ArgSpec null() { return {ArgRole::Null, ObjectKind::None}; }
+
+constexpr ObjectKind BUFFER = ObjectKind::Buffer;
+constexpr ObjectKind TEXTURE = ObjectKind::Texture;
+constexpr ObjectKind VERTEX_ARRAY = ObjectKind::VertexArray;
+constexpr ObjectKind SHADER = ObjectKind::Shader;
+constexpr ObjectKind PROGRAM = ObjectKind::Program;
+constexpr ObjectKind LOCATION = ObjectKind::UniformLocation;
+constexpr ObjectKind SYNC = ObjectKind::Sync;
+constexpr ObjectKind FRAMEBUFFER = ObjectKind::Framebuffer;
+constexpr ObjectKind RENDERBUFFER = ObjectKind::Renderbuffer;
+constexpr ObjectKind QUERY = ObjectKind::Query;
+
+// @formatter:off
+/**
+* @brief Functions the replayer knows how to decode. Add an entry here when the engine starts using a new OpenGL function.
+*/
+static const std::vector<GLFunctionSpec> &gl_function_specs() {
+    static const std::vector<GLFunctionSpec> specs = {
+        {"glGenBuffers", RG_GL_REPLAY(glGenBuffers), {value(), generated(BUFFER)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glDeleteBuffers", RG_GL_REPLAY(glDeleteBuffers), {value(), deleted(BUFFER)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glBindBuffer", RG_GL_REPLAY(glBindBuffer), {value(), name(BUFFER)}},
+        {"glBindBufferBase", RG_GL_REPLAY(glBindBufferBase), {value(), value(), name(BUFFER)}},
+        {"glBufferData", RG_GL_REPLAY(glBufferData), {value(), value(), payload(), value()}, ObjectKind::None, capture_sized<2, 1>, sized_size<1>},
+        {"glBufferSubData", RG_GL_REPLAY(glBufferSubData), {value(), value(), value(), payload()}, ObjectKind::None, capture_sized<3, 2>, sized_size<2>},
+        {"glCopyBufferSubData", RG_GL_REPLAY(glCopyBufferSubData), {value(), value(), value(), value(), value()}},
+        // The bytes written through the mapping aren't captured; the TextureUploader doesn't map buffers while capturing.
+        {"glMapBufferRange", RG_GL_REPLAY(glMapBufferRange), {value(), value(), value(), value()}},
+        {"glUnmapBuffer", RG_GL_REPLAY(glUnmapBuffer), {value()}},
+        {"glGenVertexArrays", RG_GL_REPLAY(glGenVertexArrays), {value(), generated(VERTEX_ARRAY)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glDeleteVertexArrays", RG_GL_REPLAY(glDeleteVertexArrays), {value(), deleted(VERTEX_ARRAY)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glBindVertexArray", RG_GL_REPLAY(glBindVertexArray), {name(VERTEX_ARRAY)}},
+        {"glEnableVertexAttribArray", RG_GL_REPLAY(glEnableVertexAttribArray), {value()}},
+        {"glDisableVertexAttribArray", RG_GL_REPLAY(glDisableVertexAttribArray), {value()}},
+        {"glVertexAttribPointer", RG_GL_REPLAY(glVertexAttribPointer), {value(), value(), value(), value(), value(), offset()}},
+        {"glVertexAttribIPointer", RG_GL_REPLAY(glVertexAttribIPointer), {value(), value(), value(), value(), offset()}},
+        {"glVertexAttribDivisor", RG_GL_REPLAY(glVertexAttribDivisor), {value(), value()}},
+        {"glGenTextures", RG_GL_REPLAY(glGenTextures), {value(), generated(TEXTURE)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glDeleteTextures", RG_GL_REPLAY(glDeleteTextures), {value(), deleted(TEXTURE)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glBindTexture", RG_GL_REPLAY(glBindTexture), {value(), name(TEXTURE)}},
+        {"GLExtensions::glBindTextures", RG_GL_REPLAY(GLExtensions::glBindTextures), {value(), value(), used(TEXTURE)}, ObjectKind::None, capture_array<2, 1, sizeof(GLuint)>, array_size<1, sizeof(GLuint)>},
+        {"glActiveTexture", RG_GL_REPLAY(glActiveTexture), {value()}},
+        {"glTexImage2D", RG_GL_REPLAY(glTexImage2D), {value(), value(), value(), value(), value(), value(), value(), value(), payload()}, ObjectKind::None, capture_tex_image_2d, tex_image_2d_size},
+        {"glTexSubImage2D", RG_GL_REPLAY(glTexSubImage2D), {value(), value(), value(), value(), value(), value(), value(), value(), payload()}, ObjectKind::None, capture_tex_sub_image_2d, tex_sub_image_2d_size},
+        {"glTexParameteri", RG_GL_REPLAY(glTexParameteri), {value(), value(), value()}},
+        {"glCopyTexSubImage2D", RG_GL_REPLAY(glCopyTexSubImage2D), {value(), value(), value(), value(), value(), value(), value(), value()}},
+        {"glGenerateMipmap", RG_GL_REPLAY(glGenerateMipmap), {value()}},
+        {"glPixelStorei", RG_GL_REPLAY(glPixelStorei), {value(), value()}},
+        {"glCreateShader", RG_GL_REPLAY(glCreateShader), {value()}, SHADER},
+        {"glShaderSource", RG_GL_REPLAY(glShaderSource), {name(SHADER), value(), strings(), null()}, ObjectKind::None, capture_shader_source},
+        {"glCompileShader", RG_GL_REPLAY(glCompileShader), {name(SHADER)}},
+        {"glGetShaderiv", RG_GL_REPLAY(glGetShaderiv), {name(SHADER), value(), scratch()}},
+        {"glGetShaderInfoLog", RG_GL_REPLAY(glGetShaderInfoLog), {name(SHADER), value(), null(), scratch()}, ObjectKind::None, nullptr, sized_size<1>},
+        {"glDeleteShader", RG_GL_REPLAY(glDeleteShader), {name(SHADER)}},
+        {"glCreateProgram", RG_GL_REPLAY(glCreateProgram), {}, PROGRAM},
+        {"glAttachShader", RG_GL_REPLAY(glAttachShader), {name(PROGRAM), name(SHADER)}},
+        {"glLinkProgram", RG_GL_REPLAY(glLinkProgram), {name(PROGRAM)}},
+        {"glGetProgramiv", RG_GL_REPLAY(glGetProgramiv), {name(PROGRAM), value(), scratch()}},
+        {"glGetProgramInfoLog", RG_GL_REPLAY(glGetProgramInfoLog), {name(PROGRAM), value(), null(), scratch()}, ObjectKind::None, nullptr, sized_size<1>},
+        {"glUseProgram", RG_GL_REPLAY(glUseProgram), {name(PROGRAM)}},
+        {"glDeleteProgram", RG_GL_REPLAY(glDeleteProgram), {name(PROGRAM)}},
+        {"glGetUniformLocation", RG_GL_REPLAY(glGetUniformLocation), {name(PROGRAM), payload()}, LOCATION, [](const uint64_t *args, std::vector<uint8_t> &payload) {
+            auto string = reinterpret_cast<const char *>(static_cast<uintptr_t>(args[1]));
+            append_bytes(payload, args[1], std::strlen(string) + 1);
+        }},
+        {"glUniform1i", RG_GL_REPLAY(glUniform1i), {name(LOCATION), value()}},
+        {"glUniform1f", RG_GL_REPLAY(glUniform1f), {name(LOCATION), value()}},
+        {"glUniform2fv", RG_GL_REPLAY(glUniform2fv), {name(LOCATION), value(), payload()}, ObjectKind::None, capture_array<2, 1, 2 * sizeof(GLfloat)>, array_size<1, 2 * sizeof(GLfloat)>},
+        {"glUniform3fv", RG_GL_REPLAY(glUniform3fv), {name(LOCATION), value(), payload()}, ObjectKind::None, capture_array<2, 1, 3 * sizeof(GLfloat)>, array_size<1, 3 * sizeof(GLfloat)>},
+        {"glUniform4fv", RG_GL_REPLAY(glUniform4fv), {name(LOCATION), value(), payload()}, ObjectKind::None, capture_array<2, 1, 4 * sizeof(GLfloat)>, array_size<1, 4 * sizeof(GLfloat)>},
+        {"glUniformMatrix2fv", RG_GL_REPLAY(glUniformMatrix2fv), {name(LOCATION), value(), value(), payload()}, ObjectKind::None, capture_array<3, 1, 4 * sizeof(GLfloat)>, array_size<1, 4 * sizeof(GLfloat)>},
+        {"glUniformMatrix3fv", RG_GL_REPLAY(glUniformMatrix3fv), {name(LOCATION), value(), value(), payload()}, ObjectKind::None, capture_array<3, 1, 9 * sizeof(GLfloat)>, array_size<1, 9 * sizeof(GLfloat)>},
+        {"glUniformMatrix4fv", RG_GL_REPLAY(glUniformMatrix4fv), {name(LOCATION), value(), value(), payload()}, ObjectKind::None, capture_array<3, 1, 16 * sizeof(GLfloat)>, array_size<1, 16 * sizeof(GLfloat)>},
+        {"glEnable", RG_GL_REPLAY(glEnable), {value()}},
+        {"glDisable", RG_GL_REPLAY(glDisable), {value()}},
+        {"glDepthFunc", RG_GL_REPLAY(glDepthFunc), {value()}},
+        {"glDepthRange", RG_GL_REPLAY(glDepthRange), {value(), value()}},
+        {"glViewport", RG_GL_REPLAY(glViewport), {value(), value(), value(), value()}},
+        {"glClearColor", RG_GL_REPLAY(glClearColor), {value(), value(), value(), value()}},
+        {"glClear", RG_GL_REPLAY(glClear), {value()}},
+        {"glDrawArrays", RG_GL_REPLAY(glDrawArrays), {value(), value(), value()}},
+        {"glDrawElements", RG_GL_REPLAY(glDrawElements), {value(), value(), value(), offset()}},
+        {"glDrawElementsInstanced", RG_GL_REPLAY(glDrawElementsInstanced), {value(), value(), value(), offset(), value()}},
+        {"glDrawElementsBaseVertex", RG_GL_REPLAY(glDrawElementsBaseVertex), {value(), value(), value(), offset(), value()}},
+        {"glDrawElementsInstancedBaseVertex", RG_GL_REPLAY(glDrawElementsInstancedBaseVertex), {value(), value(), value(), offset(), value(), value()}},
+        {"glMultiDrawElementsBaseVertex", replay_multi_draw_elements_base_vertex, {value(), payload(), value(), payload(), value(), payload()}, ObjectKind::None, capture_multi_draw_elements_base_vertex, multi_draw_elements_base_vertex_size},
+        // The commands are read from the bound GL_DRAW_INDIRECT_BUFFER, uploaded by the recorded glBufferData calls.
+        {"GLExtensions::glMultiDrawElementsIndirect", RG_GL_REPLAY(GLExtensions::glMultiDrawElementsIndirect), {value(), value(), offset(), value(), value()}},
+        {"GLExtensions::glDrawElementsIndirect", RG_GL_REPLAY(GLExtensions::glDrawElementsIndirect), {value(), value(), offset()}},
+        {"GLExtensions::glDispatchCompute", RG_GL_REPLAY(GLExtensions::glDispatchCompute), {value(), value(), value()}},
+        {"GLExtensions::glMemoryBarrier", RG_GL_REPLAY(GLExtensions::glMemoryBarrier), {value()}},
+        {"GLExtensions::glBindImageTexture", RG_GL_REPLAY(GLExtensions::glBindImageTexture), {value(), name(TEXTURE), value(), value(), value(), value(), value()}},
+        {"glGenFramebuffers", RG_GL_REPLAY(glGenFramebuffers), {value(), generated(FRAMEBUFFER)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glDeleteFramebuffers", RG_GL_REPLAY(glDeleteFramebuffers), {value(), deleted(FRAMEBUFFER)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glBindFramebuffer", RG_GL_REPLAY(glBindFramebuffer), {value(), name(FRAMEBUFFER)}},
+        {"glFramebufferRenderbuffer", RG_GL_REPLAY(glFramebufferRenderbuffer), {value(), value(), value(), name(RENDERBUFFER)}},
+        {"glCheckFramebufferStatus", RG_GL_REPLAY(glCheckFramebufferStatus), {value()}},
+        {"glGenRenderbuffers", RG_GL_REPLAY(glGenRenderbuffers), {value(), generated(RENDERBUFFER)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glDeleteRenderbuffers", RG_GL_REPLAY(glDeleteRenderbuffers), {value(), deleted(RENDERBUFFER)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glBindRenderbuffer", RG_GL_REPLAY(glBindRenderbuffer), {value(), name(RENDERBUFFER)}},
+        {"glRenderbufferStorage", RG_GL_REPLAY(glRenderbufferStorage), {value(), value(), value(), value()}},
+        {"glGenQueries", RG_GL_REPLAY(glGenQueries), {value(), generated(QUERY)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glDeleteQueries", RG_GL_REPLAY(glDeleteQueries), {value(), deleted(QUERY)}, ObjectKind::None, capture_array<1, 0, sizeof(GLuint)>, array_size<0, sizeof(GLuint)>},
+        {"glBeginQuery", RG_GL_REPLAY(glBeginQuery), {value(), name(QUERY)}},
+        {"glEndQuery", RG_GL_REPLAY(glEndQuery), {value()}},
+        {"glGetQueryObjectui64v", RG_GL_REPLAY(glGetQueryObjectui64v), {name(QUERY), value(), scratch()}},
+        {"glGetIntegerv", RG_GL_REPLAY(glGetIntegerv), {value(), scratch()}},
+        {"glFenceSync", RG_GL_REPLAY(glFenceSync), {value(), value()}, SYNC},
+        {"glClientWaitSync", RG_GL_REPLAY(glClientWaitSync), {name(SYNC), value(), value()}},
+        {"glDeleteSync", RG_GL_REPLAY(glDeleteSync), {name(SYNC)}},
+        {"glFinish", RG_GL_REPLAY(glFinish), {}},
+        {"glFlush", RG_GL_REPLAY(glFlush), {}},
+    };
+    return specs;
+}
+// @formatter:on
+
+static const GLFunctionSpec *find_spec(std::string_view function) {
+    static const auto index = [] {
+        std::unordered_map<std::string_view, const GLFunctionSpec *> result;
+        for (const auto &spec: gl_function_specs()) {
+            result.emplace(spec.name, &spec);
+        }
+        return result;
+    }();
+    auto it = index.find(function);
+    return it != index.end() ? it->second : nullptr;
+}
+
+// ------------------------------------------------------------------ capture
+
+GLTrace *GLTrace::instance() {
+    static GLTrace trace;
+    return &trace;
+}
+
+void GLTrace::record(std::string_view function, std::initializer_list<uint64_t> args, uint64_t result) {
+    instance()->write_call(function, args, result);
+}
+
+void GLTrace::begin_capture(const std::filesystem::path &path, uint32_t frames) {
+    RG_GUARANTEE(!m_capturing, "GL capture is already in progress: {}", m_path.string());
+    m_output.open(path, std::ios::binary | std::ios::trunc);
+    RG_GUARANTEE(m_output.is_open(), "Failed to open GL trace file {} for writing.", path.string());
+    m_path = path;
+    m_frame = 0;
+    m_frames = frames;
+    m_calls = 0;
+    m_function_ids.clear();
+    m_output.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    write(VERSION);
+    write(RecordType::Frame);
+    write(m_frame);
+    m_capturing = true;
+    spdlog::info("GLTrace: capturing {} frames to {}", frames, path.string());
+}
+
+void GLTrace::begin_frame() {
+    if (!m_capturing) {
+        return;
+    }
+    if (m_frame == m_frames) {
+        end_capture();
+        return;
+    }
+    ++m_frame;
+    write(RecordType::Frame);
+    write(m_frame);
+}
+
+void GLTrace::end_capture() {
+    if (!m_capturing) {
+        return;
+    }
+    m_capturing = false;
+    write(RecordType::End);
+    m_output.close();
+    spdlog::info("GLTrace: captured {} calls in {} frames to {}", m_calls, m_frame, m_path.string());
+}
+
+uint16_t GLTrace::function_id(std::string_view function) {
+    auto [it, inserted] = m_function_ids.emplace(function, static_cast<uint16_t>(m_function_ids.size()));
+    if (inserted) {
+        if (!find_spec(function)) {
+            spdlog::warn("GLTrace: {} is not supported by the replayer, it will be skipped on replay.", function);
+        }
+        write(RecordType::Function);
+        write(it->second);
+        write(static_cast<uint16_t>(function.size()));
+        m_output.write(function.data(), static_cast<std::streamsize>(function.size()));
+    }
+    return it->second;
+}
+
+void GLTrace::write_call(std::string_view function, std::initializer_list<uint64_t> args, uint64_t result) {
+    RG_GUARANTEE(args.size() <= MAX_ARGS, "{} has more than {} arguments.", function, MAX_ARGS);
+    const uint16_t id = function_id(function);
+    m_payload.clear();
+    if (auto spec = find_spec(function); spec && spec->capture_payload) {
+        spec->capture_payload(std::data(args), m_payload);
+    }
+    write(RecordType::Call);
+    write(id);
+    write(static_cast<uint8_t>(args.size()));
+    for (uint64_t arg: args) {
+        write(arg);
+    }
+    write(result);
+    write(static_cast<uint32_t>(m_payload.size()));
+    m_output.write(reinterpret_cast<const char *>(m_payload.data()), static_cast<std::streamsize>(m_payload.size()));
+    ++m_calls;
+}
+
+// ------------------------------------------------------------------ replay
+
+/**
+* @brief Reads records from the trace file loaded into memory.
+*/
+class GLTraceReader {
+public:
+    explicit GLTraceReader(std::vector<uint8_t> data) : m_data(std::move(data)) {
+    }
+
+    bool done() const {
+        return m_offset >= m_data.size();
+    }
+
+    template<typename T>
+    T read() {
+        RG_GUARANTEE(m_offset + sizeof(T) <= m_data.size(), "Unexpected end of GL trace file.");
+        T value;
+        std::memcpy(&value, m_data.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return value;
+    }
+
+    std::span<const uint8_t> read_bytes(size_t size) {
+        RG_GUARANTEE(m_offset + size <= m_data.size(), "Unexpected end of GL trace file.");
+        std::span<const uint8_t> result(m_data.data() + m_offset, size);
+        m_offset += size;
+        return result;
+    }
+
+private:
+    std::vector<uint8_t> m_data;
+    size_t m_offset{0};
+};
+
+static std::vector<uint8_t> read_binary_file(const std::filesystem::path &path) {
+    RG_GUARANTEE(std::filesystem::exists(path), "GL trace file {} doesn't exist.", path.string());
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data(std::filesystem::file_size(path));
+    file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+    return data;
+}
+
+static GLFWwindow *create_headless_context() {
+    RG_GUARANTEE(glfwInit(), "GLFW failed to initialize for the GL trace replay.");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "gl-replay", nullptr, nullptr);
+    RG_GUARANTEE(window, "GLFW failed to create a hidden window for the GL trace replay.");
+    glfwMakeContextCurrent(window);
+    RG_GUARANTEE(gladLoadGLLoader((GLADloadproc) glfwGetProcAddress), "OpenGL failed to init!");
+    // The trace can call the functions newer than 3.3 the engine used; the driver usually creates its newest
+    // core context for the 3.3 request, so they are loaded as in the app.
+    GLExtensions::initialize((GLExtensions::Loader) glfwGetProcAddress);
+    return window;
+}
+
+GLReplayReport GLTraceReplayer::replay(const std::filesystem::path &path) {
+    using Clock = std::chrono::steady_clock;
+    GLTraceReader reader(read_binary_file(path));
+    auto magic = reader.read_bytes(sizeof(TRACE_MAGIC));
+    RG_GUARANTEE(std::memcmp(magic.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0, "{} is not a GL trace file.",
+                 path.string());
+    auto version = reader.read<uint32_t>();
+    RG_GUARANTEE(version == GLTrace::VERSION, "GL trace version {} is not supported, expected {}.", version,
+                 GLTrace::VERSION);
+
+    GLFWwindow *window = nullptr;
+    if (!glfwGetCurrentContext()) {
+        window = create_headless_context();
+    }
+    defer {
+        if (window) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
+    };
+
+    GLReplayReport report;
+    GLReplayContext context;
+    std::vector<const GLFunctionSpec *> specs;
+    Clock::time_point frame_begin = Clock::now();
+
+    auto finish_frame = [&] {
+        if (report.frames.empty()) {
+            return;
+        }
+        glFinish();
+        report.frames.back().finish_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - frame_begin).count();
+    };
+
+    while (!reader.done()) {
+        switch (reader.read<GLTrace::RecordType>()) {
+            case GLTrace::RecordType::Function: {
+                auto id = reader.read<uint16_t>();
+                auto length = reader.read<uint16_t>();
+                auto bytes = reader.read_bytes(length);
+                std::string function(bytes.begin(), bytes.end());
+                if (specs.size() <= id) {
+                    specs.resize(id + 1);
+                    report.functions.resize(id + 1);
+                }
+                specs[id] = find_spec(function);
+                report.functions[id].name = std::move(function);
+                break;
+            }
+            case GLTrace::RecordType::Call: {
+                GLCallRecord call;
+                call.function = reader.read<uint16_t>();
+                call.argc = reader.read<uint8_t>();
+                RG_GUARANTEE(call.argc <= GLTrace::MAX_ARGS && call.function < specs.size(), "Corrupted GL trace file.");
+                for (uint8_t i = 0; i < call.argc; ++i) {
+                    call.args[i] = reader.read<uint64_t>();
+                }
+                call.result = reader.read<uint64_t>();
+                call.payload = reader.read_bytes(reader.read<uint32_t>());
+
+                const GLFunctionSpec *spec = specs[call.function];
+                if (!spec) {
+                    ++report.skipped_calls;
+                    break;
+                }
+                if (spec->name == "glUseProgram") {
+                    context.current_program = call.args[0];
+                }
+                auto begin = Clock::now();
+                spec->invoke(context, *spec, call);
+                uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+
+                auto &stats = report.functions[call.function];
+                ++stats.calls;
+                stats.total_ns += elapsed;
+                stats.max_ns = std::max(stats.max_ns, elapsed);
+                if (!report.frames.empty()) {
+                    ++report.frames.back().calls;
+                    report.frames.back().submit_ns += elapsed;
+                }
+                break;
+            }
+            case GLTrace::RecordType::Frame: {
+                finish_frame();
+                report.frames.push_back(GLReplayFrameStats{.index = reader.read<uint32_t>()});
+                frame_begin = Clock::now();
+                break;
+            }
+            case GLTrace::RecordType::End: {
+                finish_frame();
+                return report;
+            }
+            default: RG_SHOULD_NOT_REACH_HERE("Corrupted GL trace file {}.", path.string());
+        }
+    }
+    spdlog::warn("GL trace {} ended without an end record; the capture was probably interrupted.", path.string());
+    finish_frame();
+    return report;
+}
+} // namespace engine::graphics
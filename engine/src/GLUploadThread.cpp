@@ -0,0 +1,145 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <engine/graphics/GLUploadThread.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/util/Errors.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::graphics {
+
+GLUploadThread *GLUploadThread::instance() {
+    static GLUploadThread thread;
+    return &thread;
+}
+
+void GLUploadThread::start(GLFWwindow *shared) {
+    RG_GUARANTEE(!running(), "The GL upload thread is already running.");
+    // GLFW windows can only be created on the main thread; the context is made current on the upload thread.
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    m_window = glfwCreateWindow(1, 1, "upload", nullptr, shared);
+    glfwDefaultWindowHints();
+    if (!m_window) {
+        spdlog::warn("[GLUploadThread]: failed to create a shared context, uploading on the main thread");
+        return;
+    }
+    m_stopping = false;
+    m_thread = std::thread([this] {
+        thread_loop();
+    });
+    spdlog::info("[GLUploadThread]: started");
+}
+
+void GLUploadThread::stop() {
+    if (!running()) {
+        return;
+    }
+    finish();
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+    glfwDestroyWindow(m_window);
+    m_window = nullptr;
+}
+
+void GLUploadThread::submit(std::function<void()> work, std::function<void()> publish) {
+    RG_GUARANTEE(running(), "The GL upload thread isn't running.");
+    {
+        std::lock_guard lock(m_mutex);
+        m_queued.push_back(Job{.work = std::move(work), .publish = std::move(publish)});
+        ++m_in_progress;
+    }
+    m_cv.notify_one();
+}
+
+void GLUploadThread::thread_loop() {
+    glfwMakeContextCurrent(m_window);
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [this] {
+                return m_stopping || !m_queued.empty();
+            });
+            if (m_queued.empty()) {
+                break;
+            }
+            job = std::move(m_queued.front());
+            m_queued.pop_front();
+        }
+        try {
+            job.work();
+            // Objects bound in this context aren't deleted until they're unbound here as well.
+            CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, 0);
+            CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_CUBE_MAP, 0);
+            CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, 0);
+        } catch (...) {
+            job.error = std::current_exception();
+        }
+        job.fence = CHECKED_GL_CALL(glFenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // The fence has to reach the GPU before another context can wait for it.
+        CHECKED_GL_CALL(glFlush);
+        {
+            std::lock_guard lock(m_mutex);
+            m_done.push_back(std::move(job));
+            --m_in_progress;
+        }
+        m_cv.notify_all();
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+
+void GLUploadThread::process() {
+    publish_finished(false);
+}
+
+void GLUploadThread::finish() {
+    if (!running()) {
+        return;
+    }
+    {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this] {
+            return m_in_progress == 0;
+        });
+    }
+    publish_finished(true);
+}
+
+size_t GLUploadThread::pending() const {
+    std::lock_guard lock(m_mutex);
+    return m_in_progress + m_done.size();
+}
+
+void GLUploadThread::publish_finished(bool wait) {
+    while (true) {
+        Job job;
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_done.empty()) {
+                return;
+            }
+            // Jobs finish in submission order, so polling stops at the first one the GPU is still working on.
+            auto fence = static_cast<GLsync>(m_done.front().fence);
+            GLenum status = CHECKED_GL_CALL(glClientWaitSync, fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                            wait ? GL_TIMEOUT_IGNORED : 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                return;
+            }
+            CHECKED_GL_CALL(glDeleteSync, fence);
+            job = std::move(m_done.front());
+            m_done.pop_front();
+        }
+        if (job.error) {
+            std::rethrow_exception(job.error);
+        }
+        job.publish();
+    }
+}
+
+}
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include <glad/glad.h>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/resources/GeometryBuffer.hpp>
+#include <engine/resources/Mesh.hpp>
+#include <engine/resources/MultiDraw.hpp>
+#include <engine/util/Configuration.hpp>
+#include <engine/util/Errors.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::resources {
+
+static constexpr uint32_t NO_SPACE = std::numeric_limits<uint32_t>::max();
+
+uint64_t GeometryAllocation::bytes() const {
+    return m_valid ? m_range.vertex_count * sizeof(Vertex) + m_range.index_count * sizeof(uint32_t) : 0;
+}
+
+void GeometryAllocation::reset() {
+    if (m_valid) {
+        m_valid = false;
+        GeometryBuffer::instance()->free(m_range);
+    }
+}
+
+void GeometryBuffer::FreeList::reset(uint32_t capacity) {
+    m_free.clear();
+    if (capacity > 0) {
+        m_free.emplace(0, capacity);
+    }
+}
+
+uint32_t GeometryBuffer::FreeList::allocate(uint32_t count) {
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        auto [offset, size] = *it;
+        if (size < count) {
+            continue;
+        }
+        m_free.erase(it);
+        if (size > count) {
+            m_free.emplace(offset + count, size - count);
+        }
+        return offset;
+    }
+    return NO_SPACE;
+}
+
+void GeometryBuffer::FreeList::free(uint32_t offset, uint32_t count) {
+    auto next = m_free.lower_bound(offset);
+    if (next != m_free.end() && offset + count == next->first) {
+        count += next->second;
+        next = m_free.erase(next);
+    }
+    if (next != m_free.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += count;
+            return;
+        }
+    }
+    m_free.emplace(offset, count);
+}
+
+GeometryBuffer *GeometryBuffer::instance() {
+    static GeometryBuffer buffer;
+    return &buffer;
+}
+
+void GeometryBuffer::initialize() {
+    const auto &config = util::Configuration::config();
+    if (!config.contains("graphics") || !config["graphics"].contains("geometry_buffer")) {
+        return;
+    }
+    if (!graphics::GLExtensions::multi_draw_indirect()) {
+        spdlog::info("[GeometryBuffer]: multi draw indirect isn't supported by the driver, meshes keep their own buffers");
+        return;
+    }
+    const auto &geometry = config["graphics"]["geometry_buffer"];
+    const auto vertices = geometry.value<uint32_t>("vertices", 1u << 20);
+    const auto indices = geometry.value<uint32_t>("indices", 1u << 22);
+    RG_GUARANTEE(vertices > 0 && indices > 0, "graphics.geometry_buffer capacities must be positive.");
+
+    const uint64_t vertex_bytes = static_cast<uint64_t>(vertices) * sizeof(Vertex);
+    const uint64_t index_bytes = static_cast<uint64_t>(indices) * sizeof(uint32_t);
+    m_vertices = graphics::GLBuffer::create("geometry buffer vertices");
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, m_vertices.id());
+    CHECKED_GL_CALL(glBufferData, GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(vertex_bytes), nullptr, GL_STATIC_DRAW);
+    m_vertices.set_size(vertex_bytes);
+    m_indices = graphics::GLBuffer::create("geometry buffer indices");
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, m_indices.id());
+    CHECKED_GL_CALL(glBufferData, GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(index_bytes), nullptr, GL_STATIC_DRAW);
+    m_indices.set_size(index_bytes);
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, 0);
+
+    m_vao = graphics::GLVertexArray::create("geometry buffer");
+    m_draw_ids = graphics::GLBuffer::create("geometry buffer draw indices");
+    CHECKED_GL_CALL(glBindVertexArray, m_vao.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, m_vertices.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, m_indices.id());
+    Mesh::set_vertex_layout();
+    CHECKED_GL_CALL(glBindVertexArray, 0);
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, 0);
+
+    m_free_vertices.reset(vertices);
+    m_free_indices.reset(indices);
+    m_enabled = true;
+    spdlog::info("[GeometryBuffer]: {} vertices ({} MB), {} indices ({} MB)", vertices, vertex_bytes / (1024 * 1024),
+                 indices, index_bytes / (1024 * 1024));
+}
+
+void GeometryBuffer::shutdown() {
+    m_enabled = false;
+    m_vao.reset();
+    m_draw_ids.reset();
+    m_vertices.reset();
+    m_indices.reset();
+    m_draw_id_count = 0;
+    m_free_vertices.reset(0);
+    m_free_indices.reset(0);
+}
+
+GeometryAllocation GeometryBuffer::allocate(const graphics::GLBuffer &vertices, uint32_t vertex_count,
+                                            const graphics::GLBuffer &indices, uint32_t index_count) {
+    if (!m_enabled || vertex_count == 0 || index_count == 0) {
+        return {};
+    }
+    const uint32_t first_vertex = m_free_vertices.allocate(vertex_count);
+    const uint32_t first_index = first_vertex != NO_SPACE ? m_free_indices.allocate(index_count) : NO_SPACE;
+    if (first_index == NO_SPACE) {
+        if (first_vertex != NO_SPACE) {
+            m_free_vertices.free(first_vertex, vertex_count);
+        }
+        if (!m_reported_full) {
+            spdlog::warn("[GeometryBuffer]: full, meshes that don't fit get their own buffers. "
+                         "Increase graphics.geometry_buffer in the config.json.");
+            m_reported_full = true;
+        }
+        return {};
+    }
+
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_READ_BUFFER, vertices.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, m_vertices.id());
+    CHECKED_GL_CALL(glCopyBufferSubData, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                    static_cast<GLintptr>(first_vertex * sizeof(Vertex)),
+                    static_cast<GLsizeiptr>(vertex_count * sizeof(Vertex)));
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_READ_BUFFER, indices.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, m_indices.id());
+    CHECKED_GL_CALL(glCopyBufferSubData, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                    static_cast<GLintptr>(first_index * sizeof(uint32_t)),
+                    static_cast<GLsizeiptr>(index_count * sizeof(uint32_t)));
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_READ_BUFFER, 0);
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, 0);
+    return GeometryAllocation(GeometryRange{
+            .first_vertex = first_vertex,
+            .vertex_count = vertex_count,
+            .first_index = first_index,
+            .index_count = index_count,
+    });
+}
+
+void GeometryBuffer::free(const GeometryRange &range) {
+    // Meshes released after the shutdown have nothing to give back.
+    if (!m_enabled) {
+        return;
+    }
+    m_free_vertices.free(range.first_vertex, range.vertex_count);
+    m_free_indices.free(range.first_index, range.index_count);
+}
+
+void GeometryBuffer::bind(uint32_t draws) {
+    CHECKED_GL_CALL(glBindVertexArray, m_vao.id());
+    if (draws <= m_draw_id_count) {
+        return;
+    }
+    m_draw_id_count = std::max(draws, m_draw_id_count * 2);
+    std::vector<uint32_t> ids(m_draw_id_count);
+    std::iota(ids.begin(), ids.end(), 0u);
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, m_draw_ids.id());
+    CHECKED_GL_CALL(glBufferData, GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(ids.size() * sizeof(uint32_t)), ids.data(),
+                    GL_STATIC_DRAW);
+    m_draw_ids.set_size(ids.size() * sizeof(uint32_t));
+    CHECKED_GL_CALL(glEnableVertexAttribArray, MultiDraw::DRAW_INDEX_LOCATION);
+    CHECKED_GL_CALL(glVertexAttribIPointer, MultiDraw::DRAW_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(uint32_t),
+                    nullptr);
+    CHECKED_GL_CALL(glVertexAttribDivisor, MultiDraw::DRAW_INDEX_LOCATION, 1);
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, 0);
+}
+
+}
@@ -1,4 +1,9 @@
 
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <functional>
+#include <limits>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
@@ -6,15 +11,31 @@
 #include <GLFW/glfw3.h>
 #include <engine/graphics/GraphicsController.hpp>
 #include <engine/graphics/OpenGL.hpp>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/GLTrace.hpp>
+#include <engine/graphics/GLUploadThread.hpp>
+#include <engine/graphics/TextureUploader.hpp>
+#include <engine/util/ArgParser.hpp>
+#include <engine/util/Configuration.hpp>
+#include <engine/util/Utils.hpp>
 #include <engine/platform/PlatformController.hpp>
+#include <engine/resources/GeometryBuffer.hpp>
 #include <engine/resources/Skybox.hpp>
 #include <engine/resources/Model.hpp>
+#include <engine/resources/Shader.hpp>
+#include <spdlog/spdlog.h>
 
 namespace engine::graphics {
 
+/**
+* @brief Width and height of the offscreen target the @ref GraphicsController::warm_up draws into.
+*/
+static constexpr int32_t WARM_UP_TARGET_SIZE = 4;
+
 void GraphicsController::initialize() {
     const int opengl_initialized = gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
     RG_GUARANTEE(opengl_initialized, "OpenGL failed to init!");
+    GLExtensions::initialize((GLExtensions::Loader) glfwGetProcAddress);
 
     auto platform = engine::core::Controller::get<platform::PlatformController>();
     auto handle = platform->window()
@@ -43,9 +64,74 @@ void GraphicsController::initialize() {
     (void) io;
     RG_GUARANTEE(ImGui_ImplGlfw_InitForOpenGL(handle, true), "ImGUI failed to initialize for OpenGL");
     RG_GUARANTEE(ImGui_ImplOpenGL3_Init("#version 330 core"), "ImGUI failed to initialize for OpenGL");
+
+    GLResourceRegistry::instance()->initialize();
+    TextureUploader::instance()->initialize();
+
+    auto capture_path = util::ArgParser::instance()->arg<std::string>("--gl-capture");
+    if (capture_path.has_value() && !capture_path->empty()) {
+        auto frames = util::ArgParser::instance()->arg<int>("--gl-capture-frames", 60);
+        GLTrace::instance()->begin_capture(capture_path.value(), static_cast<uint32_t>(frames.value()));
+    }
+
+    resources::GeometryBuffer::instance()->initialize();
+    m_depth_pyramid.initialize();
+    m_occlusion_culler.initialize();
+
+    const auto &config = util::Configuration::config();
+    if (config.contains("graphics") && config["graphics"].contains("meshlet_culling")) {
+        m_meshlet_culling = true;
+        m_meshlet_backfaces = config["graphics"]["meshlet_culling"].value<bool>("backfaces", true);
+        spdlog::info("[GraphicsController]: meshlet culling enabled, backfaces {}", m_meshlet_backfaces);
+    }
+    if (config.contains("graphics") && config["graphics"].value<bool>("upload_thread", false)) {
+        if (GLTrace::capturing()) {
+            spdlog::info("[GraphicsController]: upload thread disabled while the GL trace is capturing");
+        } else {
+            GLUploadThread::instance()->start(handle);
+        }
+    }
+}
+
+void GraphicsController::begin_draw() {
+    GLTrace::instance()->begin_frame();
+    if (m_occlusion_culler.enabled()) {
+        m_occlusion_culler.begin_frame(projection_matrix<>() * m_camera.view_matrix());
+    }
+}
+
+std::optional<resources::MeshletView> GraphicsController::meshlet_view(const glm::mat4 &model_matrix) {
+    if (!m_meshlet_culling) {
+        return std::nullopt;
+    }
+    return resources::MeshletView(projection_matrix<>() * m_camera.view_matrix(), m_camera.Position, model_matrix,
+                                  m_meshlet_backfaces);
+}
+
+void GraphicsController::end_draw() {
+    // Queued draws nobody flushed still belong to this frame, and to its depth pyramid.
+    flush_draws();
+    if (m_depth_pyramid.enabled()) {
+        int width = 0;
+        int height = 0;
+        glfwGetFramebufferSize(core::Controller::get<platform::PlatformController>()->window()->handle_(), &width,
+                               &height);
+        m_depth_pyramid.build(width, height, projection_matrix<>() * m_camera.view_matrix());
+    }
+    TextureUploader::instance()->process();
+    GLResourceRegistry::instance()->end_frame();
 }
 
 void GraphicsController::terminate() {
+    GLTrace::instance()->end_capture();
+    m_warm_up.clear();
+    m_vertex_arrays.clear();
+    m_buffers.clear();
+    GLUploadThread::instance()->stop();
+    m_depth_pyramid.shutdown();
+    resources::GeometryBuffer::instance()->shutdown();
+    TextureUploader::instance()->shutdown();
+    GLResourceRegistry::instance()->shutdown();
     if (ImGui::GetCurrentContext()) {
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
@@ -80,6 +166,7 @@ void GraphicsController::end_gui() {
 
 void GraphicsController::draw_skybox(const resources::Shader *shader, const resources::Skybox *skybox) {
     glm::mat4 view = glm::mat4(glm::mat3(m_camera.view_matrix()));
+    skybox->use();
     shader->use();
     shader->set_mat4("view", view);
     shader->set_mat4("projection", projection_matrix<>());
@@ -98,15 +185,49 @@ void GraphicsController::instanced_draw(resources::Model *model, const resources
     model->instanced_draw(shader, amount);
 }
 
+void GraphicsController::instanced_draw(resources::Model *model, const resources::Shader *shader,
+                                        const resources::InstanceData *instances, int amount) {
+    model->set_instanced_draw(instances, amount);
+    model->instanced_draw(shader, amount);
+}
+
+void GraphicsController::queue_draw(resources::Model *model, const resources::Shader *shader, const resources::InstanceData &instance) {
+    m_queued_draws.push_back(QueuedDraw{model, shader, instance});
+}
+
+uint32_t GraphicsController::flush_draws() {
+    // Draws of the same model and shader differ only in the per-object data, so they are grouped by the pair,
+    // keeping the order in which they were queued within a group.
+    std::ranges::stable_sort(m_queued_draws, [](const QueuedDraw &a, const QueuedDraw &b) {
+        return std::less<>{}(a.shader, b.shader) || (a.shader == b.shader && std::less<>{}(a.model, b.model));
+    });
+    uint32_t result = 0;
+    for (size_t first = 0; first < m_queued_draws.size();) {
+        const QueuedDraw &draw = m_queued_draws[first];
+        m_instances.clear();
+        size_t last = first;
+        for (; last < m_queued_draws.size() && m_queued_draws[last].model == draw.model &&
+               m_queued_draws[last].shader == draw.shader; ++last) {
+            m_instances.push_back(m_queued_draws[last].instance);
+        }
+        const auto amount = static_cast<int>(m_instances.size());
+        instanced_draw(draw.model, draw.shader, m_instances.data(), amount);
+        ++result;
+        first = last;
+    }
+    m_queued_draws.clear();
+    return result;
+}
+
 unsigned int GraphicsController::set_plane(float *vertices, size_t length) {
-    unsigned int vbo, vao;
-    CHECKED_GL_CALL(glGenBuffers, 1, &vbo);
-    CHECKED_GL_CALL(glGenVertexArrays, 1, &vao);
-    CHECKED_GL_CALL(glBindVertexArray, vao);
-    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, vbo);
+    auto &vao = m_vertex_arrays.emplace_back(GLVertexArray::create("plane"));
+    auto &vbo = m_buffers.emplace_back(GLBuffer::create("plane"));
+    CHECKED_GL_CALL(glBindVertexArray, vao.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, vbo.id());
     CHECKED_GL_CALL(glBufferData, GL_ARRAY_BUFFER, length, vertices, GL_STATIC_DRAW);
+    vbo.set_size(length);
 
-    CHECKED_GL_CALL(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
+    CHECKED_GL_CALL(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), nullptr);
     CHECKED_GL_CALL(glEnableVertexAttribArray, 0);
 
     CHECKED_GL_CALL(glVertexAttribPointer, 1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
@@ -118,7 +239,7 @@ unsigned int GraphicsController::set_plane(float *vertices, size_t length) {
     CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, 0);
     CHECKED_GL_CALL(glBindVertexArray, 0);
 
-    return vao;
+    return vao.id();
 }
 
 void GraphicsController::draw_plane(unsigned int vao, const resources::Shader *shader, resources::Texture *texture) {
@@ -130,21 +251,52 @@ void GraphicsController::draw_plane(unsigned int vao, const resources::Shader *s
     CHECKED_GL_CALL(glBindVertexArray, 0);
 }
 
+float GraphicsController::pixels_per_unit(const glm::vec3 &box_min, const glm::vec3 &box_max) const {
+    const glm::vec3 closest = glm::clamp(m_camera.Position, box_min, box_max);
+    const float distance = std::max(glm::length(closest - m_camera.Position), m_perspective_params.Near);
+    return m_perspective_params.Height / (2.0f * distance * std::tan(m_perspective_params.FOV / 2.0f));
+}
+
+void GraphicsController::request_texture_detail(const resources::Model *model, const glm::mat4 &model_matrix) const {
+    for (const auto &mesh: model->meshes()) {
+        glm::vec3 box_min(std::numeric_limits<float>::max());
+        glm::vec3 box_max(std::numeric_limits<float>::lowest());
+        for (int corner = 0; corner < 8; ++corner) {
+            const glm::vec3 local(corner & 1 ? mesh.max_vertex.x : mesh.min_vertex.x,
+                                  corner & 2 ? mesh.max_vertex.y : mesh.min_vertex.y,
+                                  corner & 4 ? mesh.max_vertex.z : mesh.min_vertex.z);
+            const glm::vec3 world = glm::vec3(model_matrix * glm::vec4(local, 1.0f));
+            box_min = glm::min(box_min, world);
+            box_max = glm::max(box_max, world);
+        }
+        for (auto texture: mesh.textures()) {
+            request_texture_detail(texture, box_min, box_max);
+        }
+    }
+}
+
+void GraphicsController::request_texture_detail(resources::Texture *texture, const glm::vec3 &box_min,
+                                                const glm::vec3 &box_max, float uv_repeat) const {
+    const glm::vec3 extent = box_max - box_min;
+    const float size = std::max({extent.x, extent.y, extent.z}) / uv_repeat;
+    texture->request_screen_size(size * pixels_per_unit(box_min, box_max));
+}
+
 unsigned int GraphicsController::set_crosshair(float *vertices, size_t length) {
-    unsigned int vbo, vao;
-    CHECKED_GL_CALL(glGenBuffers, 1, &vbo);
-    CHECKED_GL_CALL(glGenVertexArrays, 1, &vao);
-    CHECKED_GL_CALL(glBindVertexArray, vao);
-    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, vbo);
+    auto &vao = m_vertex_arrays.emplace_back(GLVertexArray::create("crosshair"));
+    auto &vbo = m_buffers.emplace_back(GLBuffer::create("crosshair"));
+    CHECKED_GL_CALL(glBindVertexArray, vao.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, vbo.id());
     CHECKED_GL_CALL(glBufferData, GL_ARRAY_BUFFER, length, vertices, GL_STATIC_DRAW);
+    vbo.set_size(length);
 
-    CHECKED_GL_CALL(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
+    CHECKED_GL_CALL(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), nullptr);
     CHECKED_GL_CALL(glEnableVertexAttribArray, 0);
 
     CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, 0);
     CHECKED_GL_CALL(glBindVertexArray, 0);
 
-    return vao;
+    return vao.id();
 }
 
 void GraphicsController::draw_crosshair(const resources::Shader *shader, unsigned int vao) {
@@ -155,5 +307,99 @@ void GraphicsController::draw_crosshair(const resources::Shader *shader, unsigne
     CHECKED_GL_CALL(glBindVertexArray, 0);
 }
 
+void GraphicsController::register_warm_up(const resources::Shader *shader, unsigned int vao, std::string layout) {
+    m_warm_up.push_back(WarmUpDraw{.shader = shader, .vao = vao, .layout = std::move(layout)});
+}
+
+void GraphicsController::register_warm_up(const resources::Shader *shader, const resources::Model *model) {
+    if (model->meshes().empty()) {
+        spdlog::warn("[GraphicsController]: model {} has no meshes to warm up {} with", model->name(), shader->name());
+        return;
+    }
+    register_warm_up(shader, model->meshes().front().vao(), model->name());
+}
+
+static std::string program_label(const resources::Shader *shader) {
+    std::string label = shader->name();
+    const auto &features = shader->features();
+    for (size_t i = 0; i < features.size(); ++i) {
+        if (shader->enabled_features() & (1u << i)) {
+            label += std::format("+{}", features[i].name);
+        }
+    }
+    return label;
+}
+
+std::vector<WarmUpCost> GraphicsController::warm_up() {
+    std::vector<WarmUpCost> costs;
+    auto draws = std::move(m_warm_up);
+    m_warm_up.clear();
+    if (draws.empty()) {
+        return costs;
+    }
+
+    int32_t viewport[4];
+    CHECKED_GL_CALL(glGetIntegerv, GL_VIEWPORT, viewport);
+    uint32_t framebuffer = 0;
+    uint32_t renderbuffers[2] = {};
+    uint32_t query = 0;
+    CHECKED_GL_CALL(glGenFramebuffers, 1, &framebuffer);
+    CHECKED_GL_CALL(glGenRenderbuffers, 2, renderbuffers);
+    CHECKED_GL_CALL(glGenQueries, 1, &query);
+    // The window framebuffer and viewport are restored even if a draw throws.
+    defer {
+        CHECKED_GL_CALL(glBindVertexArray, 0);
+        CHECKED_GL_CALL(glBindFramebuffer, GL_FRAMEBUFFER, 0);
+        CHECKED_GL_CALL(glViewport, viewport[0], viewport[1], viewport[2], viewport[3]);
+        CHECKED_GL_CALL(glDeleteQueries, 1, &query);
+        CHECKED_GL_CALL(glDeleteRenderbuffers, 2, renderbuffers);
+        CHECKED_GL_CALL(glDeleteFramebuffers, 1, &framebuffer);
+    };
+
+    CHECKED_GL_CALL(glBindRenderbuffer, GL_RENDERBUFFER, renderbuffers[0]);
+    CHECKED_GL_CALL(glRenderbufferStorage, GL_RENDERBUFFER, GL_RGBA8, WARM_UP_TARGET_SIZE, WARM_UP_TARGET_SIZE);
+    CHECKED_GL_CALL(glBindRenderbuffer, GL_RENDERBUFFER, renderbuffers[1]);
+    CHECKED_GL_CALL(glRenderbufferStorage, GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WARM_UP_TARGET_SIZE,
+                    WARM_UP_TARGET_SIZE);
+    CHECKED_GL_CALL(glBindRenderbuffer, GL_RENDERBUFFER, 0);
+    CHECKED_GL_CALL(glBindFramebuffer, GL_FRAMEBUFFER, framebuffer);
+    CHECKED_GL_CALL(glFramebufferRenderbuffer, GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                    renderbuffers[0]);
+    CHECKED_GL_CALL(glFramebufferRenderbuffer, GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                    renderbuffers[1]);
+    RG_GUARANTEE(CHECKED_GL_CALL(glCheckFramebufferStatus, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE,
+                 "Warm-up framebuffer is incomplete");
+    CHECKED_GL_CALL(glViewport, 0, 0, WARM_UP_TARGET_SIZE, WARM_UP_TARGET_SIZE);
+    CHECKED_GL_CALL(glClear, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    costs.reserve(draws.size());
+    double total_ms = 0.0;
+    for (const auto &draw: draws) {
+        const auto start = std::chrono::steady_clock::now();
+        draw.shader->use();
+        CHECKED_GL_CALL(glBindVertexArray, draw.vao);
+        CHECKED_GL_CALL(glBeginQuery, GL_TIME_ELAPSED, query);
+        // A single triangle from the first vertices is enough for the driver to build the program for the layout.
+        CHECKED_GL_CALL(glDrawArrays, GL_TRIANGLES, 0, 3);
+        CHECKED_GL_CALL(glEndQuery, GL_TIME_ELAPSED);
+        CHECKED_GL_CALL(glFinish);
+        const double cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).
+                count();
+        uint64_t elapsed = 0;
+        CHECKED_GL_CALL(glGetQueryObjectui64v, query, GL_QUERY_RESULT, &elapsed);
+
+        auto &cost = costs.emplace_back(WarmUpCost{
+                .program = program_label(draw.shader),
+                .layout = draw.layout,
+                .cpu_ms = cpu_ms,
+                .gpu_ms = static_cast<double>(elapsed) / 1e6,
+        });
+        total_ms += cost.cpu_ms;
+        spdlog::info("[GraphicsController]: warm-up {} with {}: {:.3f} ms CPU, {:.3f} ms GPU", cost.program,
+                     cost.layout, cost.cpu_ms, cost.gpu_ms);
+    }
+    spdlog::info("[GraphicsController]: warmed up {} program and layout pairs in {:.3f} ms", costs.size(), total_ms);
+    return costs;
+}
 
 }
@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <engine/util/Errors.hpp>
+#include <engine/util/IOService.hpp>
+#include <spdlog/spdlog.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define RG_POSIX_IO 1
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// Reads need IORING_OP_READ, which came with the opcode probe in 5.6; older headers use the thread pool.
+#ifdef IO_URING_OP_SUPPORTED
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define RG_IO_URING 1
+#endif
+#endif
+
+namespace engine::util {
+
+namespace {
+constexpr uint32_t QUEUE_DEPTH = 64;
+// A single read is limited to what fits into io_uring_sqe::len; longer reads are resubmitted.
+constexpr uint64_t MAX_READ_SIZE = 1u << 30;
+}
+
+#ifdef RG_IO_URING
+struct IOService::Ring {
+    int fd{-1};
+    uint32_t entries{0};
+    /**
+    * @brief Requests in the submission queue or in the kernel, whose completions haven't been seen yet.
+    */
+    uint32_t in_flight{0};
+    /**
+    * @brief Entries at the end of the submission queue the kernel hasn't taken yet.
+    */
+    uint32_t unsubmitted{0};
+
+    uint32_t *sq_head{nullptr};
+    uint32_t *sq_tail{nullptr};
+    uint32_t *sq_mask{nullptr};
+    uint32_t *sq_array{nullptr};
+    io_uring_sqe *sqes{nullptr};
+
+    uint32_t *cq_head{nullptr};
+    uint32_t *cq_tail{nullptr};
+    uint32_t *cq_mask{nullptr};
+    io_uring_cqe *cqes{nullptr};
+
+    void *sq_ring{MAP_FAILED};
+    size_t sq_ring_size{0};
+    void *cq_ring{MAP_FAILED};
+    size_t cq_ring_size{0};
+    size_t sqes_size{0};
+
+    ~Ring() {
+        if (sqes) {
+            munmap(sqes, sqes_size);
+        }
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+            munmap(cq_ring, cq_ring_size);
+        }
+        if (sq_ring != MAP_FAILED) {
+            munmap(sq_ring, sq_ring_size);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    int enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags) const {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    /**
+    * @returns True if the kernel can run the opcode; kernels before 5.6 can't tell, and can't read either.
+    */
+    bool supports(uint8_t opcode) const {
+        std::array<uint8_t, sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op)> buffer{};
+        auto probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+            return false;
+        }
+        return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+};
+#else
+struct IOService::Ring {
+};
+#endif
+
+IOService *IOService::instance() {
+    static IOService service;
+    return &service;
+}
+
+IOService::IOService() {
+    if (setup_io_uring()) {
+        // The completion thread can start the workers, which adds them to the same list.
+        std::lock_guard lock(m_mutex);
+        m_use_ring = true;
+        m_threads.emplace_back([this] { completion_loop(); });
+    } else {
+        start_workers();
+    }
+    spdlog::info("[IOService]: reading files through {}", backend());
+}
+
+void IOService::start_workers() {
+    const uint32_t workers = std::clamp(std::thread::hardware_concurrency(), 2u, 8u);
+    for (uint32_t i = 0; i < workers; ++i) {
+        m_threads.emplace_back([this] { worker_loop(); });
+    }
+}
+
+IOService::~IOService() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_running = false;
+        if (m_use_ring) {
+            // A no-op wakes up the completion thread, which exits once the in-flight reads are done.
+            m_queue.push_back(nullptr);
+            submit_queued();
+        }
+    }
+    m_queue_cv.notify_all();
+    for (auto &thread: m_threads) {
+        thread.join();
+    }
+}
+
+std::string_view IOService::backend() const {
+    return m_use_ring ? "io_uring" : "thread pool";
+}
+
+std::future<FileBuffer> IOService::read(const std::filesystem::path &path) {
+    auto promise = std::make_shared<std::promise<FileBuffer> >();
+    auto result = promise->get_future();
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(path, error);
+    if (error) {
+        promise->set_exception(std::make_exception_ptr(
+                EngineError(EngineError::Type::FileNotFound, std::format("File {} not found.", path.string()))));
+        return result;
+    }
+    auto buffer = std::make_shared<FileBuffer>(path, size);
+    read(path, buffer->data(), 0, [promise, buffer, size](const ReadResult &read_result) {
+        if (read_result.error != 0 || read_result.bytes != size) {
+            promise->set_exception(std::make_exception_ptr(EngineError(
+                    EngineError::Type::AssetLoadingError,
+                    std::format("Failed to read {}: {}", read_result.path.string(),
+                                read_result.error != 0 ? std::strerror(read_result.error) : "file changed while reading"))));
+            return;
+        }
+        promise->set_value(std::move(*buffer));
+    });
+    return result;
+}
+
+void IOService::read(const std::filesystem::path &path, std::span<uint8_t> destination, uint64_t offset,
+                     ReadCallback on_complete) {
+    submit(path, destination, offset, std::move(on_complete));
+}
+
+FileBuffer IOService::read_file(const std::filesystem::path &path) {
+    return read(path).get();
+}
+
+void IOService::submit(const std::filesystem::path &path, std::span<uint8_t> destination, uint64_t offset,
+                       ReadCallback on_complete) {
+    auto request = new Request{
+            .fd = -1,
+            .destination = destination.data(),
+            .size = destination.size(),
+            .offset = offset,
+            .done = 0,
+            .path = path,
+            .on_complete = std::move(on_complete),
+    };
+#ifdef RG_POSIX_IO
+    request->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (request->fd < 0) {
+        complete(request, errno);
+        return;
+    }
+#endif
+    if (request->size == 0) {
+        complete(request, 0);
+        return;
+    }
+    {
+        std::lock_guard lock(m_mutex);
+        m_queue.push_back(request);
+        if (m_use_ring) {
+            submit_queued();
+        }
+    }
+    m_queue_cv.notify_one();
+}
+
+void IOService::complete(Request *request, int error) {
+#ifdef RG_POSIX_IO
+    if (request->fd >= 0) {
+        close(request->fd);
+    }
+#endif
+    request->on_complete(ReadResult{.path = std::move(request->path), .bytes = request->done, .error = error});
+    delete request;
+}
+
+bool IOService::setup_io_uring() {
+#ifdef RG_IO_URING
+    io_uring_params params{};
+    auto ring = std::make_unique<Ring>();
+    ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+    if (ring->fd < 0) {
+        spdlog::info("[IOService]: io_uring unavailable ({})", std::strerror(errno));
+        return false;
+    }
+    // Kernels 5.1 to 5.5 set up the ring, but fail every IORING_OP_READ with EINVAL.
+    if (!ring->supports(IORING_OP_READ)) {
+        spdlog::info("[IOService]: io_uring can't read files on this kernel");
+        return false;
+    }
+    ring->entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        ring->sq_ring_size = ring->cq_ring_size = std::max(ring->sq_ring_size, ring->cq_ring_size);
+    }
+    ring->sq_ring = mmap(nullptr, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                         IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        return false;
+    }
+    ring->cq_ring = single_mmap
+                    ? ring->sq_ring
+                    : mmap(nullptr, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) {
+        return false;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    ring->sqes = static_cast<io_uring_sqe *>(sqes);
+
+    auto sq = static_cast<uint8_t *>(ring->sq_ring);
+    ring->sq_head = reinterpret_cast<uint32_t *>(sq + params.sq_off.head);
+    ring->sq_tail = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+    ring->sq_mask = reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+    ring->sq_array = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+    auto cq = static_cast<uint8_t *>(ring->cq_ring);
+    ring->cq_head = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+    ring->cq_mask = reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    m_ring = std::move(ring);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void IOService::submit_queued() {
+#ifdef RG_IO_URING
+    // Keeping at most `entries` reads in flight means neither the submission nor the completion queue can overflow.
+    uint32_t submitted = 0;
+    while (!m_queue.empty() && m_ring->in_flight < m_ring->entries) {
+        Request *request = m_queue.front();
+        m_queue.pop_front();
+
+        const uint32_t tail = *m_ring->sq_tail;
+        const uint32_t index = tail & *m_ring->sq_mask;
+        io_uring_sqe &sqe = m_ring->sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        if (request) {
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = request->fd;
+            sqe.addr = reinterpret_cast<uint64_t>(request->destination + request->done);
+            sqe.len = static_cast<uint32_t>(std::min(request->size - request->done, MAX_READ_SIZE));
+            sqe.off = request->offset + request->done;
+        } else {
+            sqe.opcode = IORING_OP_NOP;
+        }
+        sqe.user_data = reinterpret_cast<uint64_t>(request);
+        m_ring->sq_array[index] = index;
+        std::atomic_ref(*m_ring->sq_tail).store(tail + 1, std::memory_order_release);
+        ++m_ring->in_flight;
+        ++submitted;
+    }
+    // The kernel can take fewer entries than offered; the rest stay in the queue and are offered again.
+    m_ring->unsubmitted += submitted;
+    if (m_ring->unsubmitted > 0) {
+        const int taken = m_ring->enter(m_ring->unsubmitted, 0, 0);
+        if (taken >= 0) {
+            m_ring->unsubmitted -= static_cast<uint32_t>(taken);
+        } else if (errno != EAGAIN && errno != EBUSY && errno != EINTR) {
+            fall_back_to_workers(errno);
+        }
+    }
+#endif
+}
+
+void IOService::fall_back_to_workers(int error) {
+#ifdef RG_IO_URING
+    if (!m_use_ring) {
+        return;
+    }
+    spdlog::warn("[IOService]: io_uring failed ({}), reading files through a thread pool from now on",
+                 std::strerror(error));
+    m_use_ring = false;
+    // Entries the kernel hasn't taken are taken back, and their reads go to the workers in the same order.
+    const uint32_t head = std::atomic_ref(*m_ring->sq_head).load(std::memory_order_acquire);
+    uint32_t tail = *m_ring->sq_tail;
+    for (; tail != head && m_ring->unsubmitted > 0; --m_ring->unsubmitted, --m_ring->in_flight) {
+        --tail;
+        if (auto request = reinterpret_cast<Request *>(m_ring->sqes[tail & *m_ring->sq_mask].user_data)) {
+            m_queue.push_front(request);
+        }
+    }
+    std::atomic_ref(*m_ring->sq_tail).store(tail, std::memory_order_release);
+    m_ring->unsubmitted = 0;
+    // The workers are joined by the destructor, which doesn't expect new ones once it started.
+    if (m_running) {
+        start_workers();
+    }
+    m_queue_cv.notify_all();
+#endif
+}
+
+void IOService::completion_loop() {
+#ifdef RG_IO_URING
+    std::vector<std::pair<Request *, int> > finished;
+    while (true) {
+        uint32_t offered = 0;
+        {
+            // With nothing in flight a completion would never come, so the thread sleeps until a read is submitted.
+            std::unique_lock lock(m_mutex);
+            m_queue_cv.wait(lock, [this] { return m_ring->in_flight > 0 || !m_use_ring || !m_running; });
+            // Once the workers took over, the thread only waits for the reads the kernel already has.
+            if (m_ring->in_flight == 0) {
+                break;
+            }
+            // Entries a failed submission left in the queue are offered again.
+            offered = m_ring->unsubmitted;
+        }
+        const int taken = m_ring->enter(offered, 1, IORING_ENTER_GETEVENTS);
+        const int error = errno;
+        bool requeued = false;
+        {
+            std::lock_guard lock(m_mutex);
+            if (taken < 0 && error != EINTR && error != EAGAIN && error != EBUSY) {
+                fall_back_to_workers(error);
+                continue;
+            }
+            if (taken > 0) {
+                m_ring->unsubmitted -= std::min(static_cast<uint32_t>(taken), m_ring->unsubmitted);
+            }
+            uint32_t head = *m_ring->cq_head;
+            const uint32_t tail = std::atomic_ref(*m_ring->cq_tail).load(std::memory_order_acquire);
+            for (; head != tail; ++head) {
+                const io_uring_cqe &cqe = m_ring->cqes[head & *m_ring->cq_mask];
+                --m_ring->in_flight;
+                auto request = reinterpret_cast<Request *>(cqe.user_data);
+                if (!request) {
+                    continue;
+                }
+                if (cqe.res == -EAGAIN || cqe.res == -EINTR) {
+                    m_queue.push_front(request);
+                    requeued = true;
+                } else if (cqe.res == -EINVAL && m_use_ring) {
+                    // The kernel may not support reads despite the probe, for example under a seccomp filter
+                    // that rewrites them; pread tells the workers whether the request itself is wrong.
+                    m_queue.push_front(request);
+                    fall_back_to_workers(EINVAL);
+                } else if (cqe.res < 0) {
+                    finished.emplace_back(request, -cqe.res);
+                } else {
+                    request->done += static_cast<uint64_t>(cqe.res);
+                    if (cqe.res == 0 || request->done == request->size) {
+                        finished.emplace_back(request, 0);
+                    } else {
+                        // Short read, queue the rest of the file.
+                        m_queue.push_front(request);
+                        requeued = true;
+                    }
+                }
+            }
+            std::atomic_ref(*m_ring->cq_head).store(head, std::memory_order_release);
+            if (m_use_ring) {
+                submit_queued();
+            }
+        }
+        // Reads re-queued after the workers took over are theirs.
+        if (requeued && !m_use_ring) {
+            m_queue_cv.notify_all();
+        }
+        // Callbacks run outside the lock, so they can start new reads.
+        for (auto [request, read_error]: finished) {
+            complete(request, read_error);
+        }
+        finished.clear();
+    }
+    // Reads taken back from the ring during destruction have no workers to run them, so they are cancelled.
+    std::unique_lock lock(m_mutex);
+    if (m_threads.size() == 1) {
+        std::deque<Request *> leftover;
+        leftover.swap(m_queue);
+        lock.unlock();
+        for (Request *request: leftover) {
+            complete(request, ECANCELED);
+        }
+    }
+#endif
+}
+
+void IOService::worker_loop() {
+    while (true) {
+        Request *request;
+        {
+            std::unique_lock lock(m_mutex);
+            m_queue_cv.wait(lock, [this] { return !m_running || (!m_use_ring && !m_queue.empty()); });
+            if (m_queue.empty()) {
+                return;
+            }
+            request = m_queue.front();
+            m_queue.pop_front();
+        }
+        int error = 0;
+#ifdef RG_POSIX_IO
+        while (request->done < request->size) {
+            const ssize_t bytes = pread(request->fd, request->destination + request->done,
+                                        request->size - request->done,
+                                        static_cast<off_t>(request->offset + request->done));
+            if (bytes < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error = errno;
+                break;
+            }
+            if (bytes == 0) {
+                break;
+            }
+            request->done += static_cast<uint64_t>(bytes);
+        }
+#else
+        std::ifstream file(request->path, std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(request->offset));
+        file.read(reinterpret_cast<char *>(request->destination), static_cast<std::streamsize>(request->size));
+        request->done = static_cast<uint64_t>(file.gcount());
+        if (!file && !file.eof()) {
+            error = EIO;
+        }
+#endif
+        complete(request, error);
+    }
+}
+
+}
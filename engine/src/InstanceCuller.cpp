@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <glad/glad.h>
+#include <engine/graphics/DepthPyramid.hpp>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/resources/InstanceCuller.hpp>
+#include <engine/resources/Model.hpp>
+#include <engine/resources/Shader.hpp>
+#include <engine/resources/ShaderCompiler.hpp>
+
+namespace engine::resources {
+using graphics::GLExtensions;
+
+/**
+* @brief One thread per instance: appends the matrix of a visible instance to `visible`
+* and counts it in the command of the first mesh.
+*/
+static constexpr const char *CULL_SOURCE = R"(#version 430 core
+layout (local_size_x = 64) in;
+
+struct Command {
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+    mat4 instances[];
+};
+layout (std430, binding = 1) writeonly buffer Visible {
+    mat4 visible[];
+};
+layout (std430, binding = 2) buffer Commands {
+    Command commands[];
+};
+
+uniform int instance_count;
+uniform vec3 box_min;
+uniform vec3 box_max;
+uniform vec4 planes[6];
+
+uniform bool hi_z;
+uniform sampler2D depth_pyramid;
+uniform mat4 pyramid_view_projection;
+uniform vec2 pyramid_size;
+uniform int pyramid_levels;
+
+bool in_frustum(vec3 center, vec3 extent) {
+    for (int i = 0; i < 6; ++i) {
+        float radius = dot(extent, abs(planes[i].xyz));
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool occluded(vec3 center, vec3 extent) {
+    vec2 lo = vec2(1.0);
+    vec2 hi = vec2(0.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = center + extent * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0,
+                                             (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = pyramid_view_projection * vec4(corner, 1.0);
+        // The box crosses the camera plane of the previous frame, its projection is unbounded.
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        lo = min(lo, ndc.xy * 0.5 + 0.5);
+        hi = max(hi, ndc.xy * 0.5 + 0.5);
+        nearest = min(nearest, ndc.z * 0.5 + 0.5);
+    }
+    lo = clamp(lo, 0.0, 1.0);
+    hi = clamp(hi, 0.0, 1.0);
+    // The level at which the box covers at most 2x2 texels.
+    vec2 extent_texels = (hi - lo) * pyramid_size;
+    float level = ceil(log2(max(max(extent_texels.x, extent_texels.y), 1.0)));
+    level = min(level, float(pyramid_levels - 1));
+    float farthest = max(max(textureLod(depth_pyramid, lo, level).r, textureLod(depth_pyramid, vec2(hi.x, lo.y), level).r),
+                         max(textureLod(depth_pyramid, vec2(lo.x, hi.y), level).r, textureLod(depth_pyramid, hi, level).r));
+    return nearest > farthest;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= uint(instance_count)) {
+        return;
+    }
+    mat4 model = instances[index];
+    vec3 center = (model * vec4((box_min + box_max) * 0.5, 1.0)).xyz;
+    // Extent of the transformed box along the world axes.
+    vec3 extent = mat3(abs(model[0].xyz), abs(model[1].xyz), abs(model[2].xyz)) * ((box_max - box_min) * 0.5);
+    if (!in_frustum(center, extent) || (hi_z && occluded(center, extent))) {
+        return;
+    }
+    visible[atomicAdd(commands[0].instance_count, 1u)] = model;
+}
+)";
+
+/**
+* @brief Gives every other mesh the number of visible instances counted in the command of the first one.
+*/
+static constexpr const char *SHARE_COUNT_SOURCE = R"(#version 430 core
+layout (local_size_x = 64) in;
+
+struct Command {
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+layout (std430, binding = 2) buffer Commands {
+    Command commands[];
+};
+
+uniform int command_count;
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index == 0 || index >= uint(command_count)) {
+        return;
+    }
+    commands[index].instance_count = commands[0].instance_count;
+}
+)";
+
+static constexpr uint32_t GROUP_SIZE = 64;
+static constexpr uint32_t INSTANCES_BINDING = 0;
+static constexpr uint32_t VISIBLE_BINDING = 1;
+static constexpr uint32_t COMMANDS_BINDING = 2;
+static constexpr int32_t DEPTH_PYRAMID_UNIT = 0;
+
+InstanceCuller::InstanceCuller() = default;
+
+InstanceCuller::~InstanceCuller() = default;
+
+bool InstanceCuller::supported() {
+    return GLExtensions::compute_shader();
+}
+
+void InstanceCuller::set_instances(Model *model, const glm::mat4 *model_matrices, uint32_t amount) {
+    m_model = model;
+    m_amount = amount;
+    const auto size = static_cast<GLsizeiptr>(amount * sizeof(glm::mat4));
+    if (!m_instances) {
+        m_instances = graphics::GLBuffer::create("culled instances");
+        m_visible = graphics::GLBuffer::create("visible instances");
+    }
+    CHECKED_GL_CALL(glBindBuffer, GLExtensions::SHADER_STORAGE_BUFFER, m_instances.id());
+    CHECKED_GL_CALL(glBufferData, GLExtensions::SHADER_STORAGE_BUFFER, size, model_matrices, GL_STATIC_DRAW);
+    m_instances.set_size(size);
+    CHECKED_GL_CALL(glBindBuffer, GLExtensions::SHADER_STORAGE_BUFFER, m_visible.id());
+    CHECKED_GL_CALL(glBufferData, GLExtensions::SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+    m_visible.set_size(size);
+    CHECKED_GL_CALL(glBindBuffer, GLExtensions::SHADER_STORAGE_BUFFER, 0);
+}
+
+void InstanceCuller::draw(const Shader *shader, const glm::mat4 &view_projection,
+                          const graphics::DepthPyramid *pyramid) {
+    if (!m_model || m_amount == 0) {
+        return;
+    }
+    if (!m_cull) {
+        m_cull = std::make_unique<Shader>(ShaderCompiler::compile_compute("instance culling", CULL_SOURCE));
+        m_share_count = std::make_unique<Shader>(
+                ShaderCompiler::compile_compute("instance culling count", SHARE_COUNT_SOURCE));
+    }
+    m_model->use();
+    auto &meshes = m_model->m_meshes;
+    if (meshes.empty()) {
+        return;
+    }
+
+    // The commands are uploaded with no instances every frame; the culling counts them on the GPU.
+    glm::vec3 box_min(std::numeric_limits<float>::max());
+    glm::vec3 box_max(std::numeric_limits<float>::lowest());
+    m_mesh_commands.clear();
+    for (const auto &mesh: meshes) {
+        box_min = glm::min(box_min, mesh.min_vertex);
+        box_max = glm::max(box_max, mesh.max_vertex);
+        m_mesh_commands.push_back(DrawElementsIndirectCommand{
+                .count = mesh.m_num_indices,
+                .instance_count = 0,
+                .first_index = mesh.m_geometry ? mesh.m_geometry.get().first_index : 0,
+                .base_vertex = mesh.m_geometry ? static_cast<int32_t>(mesh.m_geometry.get().first_vertex) : 0,
+                .base_instance = 0,
+        });
+    }
+    const uint64_t commands_size = m_mesh_commands.size() * sizeof(DrawElementsIndirectCommand);
+    if (!m_commands) {
+        m_commands = graphics::GLBuffer::create("culled instance commands");
+    }
+    CHECKED_GL_CALL(glBindBuffer, GLExtensions::DRAW_INDIRECT_BUFFER, m_commands.id());
+    if (commands_size > m_commands_capacity) {
+        m_commands_capacity = commands_size;
+        CHECKED_GL_CALL(glBufferData, GLExtensions::DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(commands_size),
+                        nullptr, GL_DYNAMIC_DRAW);
+        m_commands.set_size(commands_size);
+    }
+    CHECKED_GL_CALL(glBufferSubData, GLExtensions::DRAW_INDIRECT_BUFFER, 0, static_cast<GLsizeiptr>(commands_size),
+                    m_mesh_commands.data());
+
+    // Rows of the view projection matrix, the planes point into the frustum.
+    const glm::mat4 rows = glm::transpose(view_projection);
+    const std::array<glm::vec4, 6> planes = {
+            rows[3] + rows[0], rows[3] - rows[0],
+            rows[3] + rows[1], rows[3] - rows[1],
+            rows[3] + rows[2], rows[3] - rows[2],
+    };
+    static constexpr std::array<const char *, 6> PLANE_NAMES = {
+            "planes[0]", "planes[1]", "planes[2]", "planes[3]", "planes[4]", "planes[5]",
+    };
+
+    m_cull->use();
+    m_cull->set_int("instance_count", static_cast<int>(m_amount));
+    m_cull->set_vec3("box_min", box_min);
+    m_cull->set_vec3("box_max", box_max);
+    for (size_t i = 0; i < planes.size(); ++i) {
+        m_cull->set_vec4(PLANE_NAMES[i], planes[i]);
+    }
+    m_cull->set_bool("hi_z", pyramid != nullptr);
+    if (pyramid) {
+        CHECKED_GL_CALL(glActiveTexture, GL_TEXTURE0 + DEPTH_PYRAMID_UNIT);
+        CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, pyramid->texture());
+        m_cull->set_int("depth_pyramid", DEPTH_PYRAMID_UNIT);
+        m_cull->set_mat4("pyramid_view_projection", pyramid->view_projection());
+        m_cull->set_vec2("pyramid_size", pyramid->size());
+        m_cull->set_int("pyramid_levels", pyramid->levels());
+    }
+    CHECKED_GL_CALL(glBindBufferBase, GLExtensions::SHADER_STORAGE_BUFFER, INSTANCES_BINDING, m_instances.id());
+    CHECKED_GL_CALL(glBindBufferBase, GLExtensions::SHADER_STORAGE_BUFFER, VISIBLE_BINDING, m_visible.id());
+    CHECKED_GL_CALL(glBindBufferBase, GLExtensions::SHADER_STORAGE_BUFFER, COMMANDS_BINDING, m_commands.id());
+    CHECKED_GL_CALL(GLExtensions::glDispatchCompute, (m_amount + GROUP_SIZE - 1) / GROUP_SIZE, 1u, 1u);
+
+    const auto command_count = static_cast<uint32_t>(m_mesh_commands.size());
+    if (command_count > 1) {
+        CHECKED_GL_CALL(GLExtensions::glMemoryBarrier, GLExtensions::SHADER_STORAGE_BARRIER_BIT);
+        m_share_count->use();
+        m_share_count->set_int("command_count", static_cast<int>(command_count));
+        CHECKED_GL_CALL(GLExtensions::glDispatchCompute, (command_count + GROUP_SIZE - 1) / GROUP_SIZE, 1u, 1u);
+    }
+    CHECKED_GL_CALL(GLExtensions::glMemoryBarrier, GLExtensions::COMMAND_BARRIER_BIT |
+                                                   GLExtensions::VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    shader->use();
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        auto &mesh = meshes[i];
+        mesh.set_instance_source(m_visible.id());
+        mesh.material(shader).bind();
+        CHECKED_GL_CALL(glBindVertexArray, mesh.m_vao.id());
+        CHECKED_GL_CALL(GLExtensions::glDrawElementsIndirect, GL_TRIANGLES, GL_UNSIGNED_INT,
+                        reinterpret_cast<const void *>(i * sizeof(DrawElementsIndirectCommand)));
+    }
+    CHECKED_GL_CALL(glBindVertexArray, 0);
+    CHECKED_GL_CALL(glBindBuffer, GLExtensions::DRAW_INDIRECT_BUFFER, 0);
+}
+
+void InstanceCuller::destroy() {
+    if (m_cull) {
+        m_cull->destroy();
+        m_share_count->destroy();
+        m_cull.reset();
+        m_share_count.reset();
+    }
+    m_instances.reset();
+    m_visible.reset();
+    m_commands.reset();
+    m_commands_capacity = 0;
+    m_model = nullptr;
+    m_amount = 0;
+}
+
+}
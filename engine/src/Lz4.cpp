@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstring>
+#include <engine/util/Lz4.hpp>
+
+namespace engine::util {
+
+namespace {
+constexpr size_t MIN_MATCH = 4;
+// The format requires the last 5 bytes to be literals, and the last match to start 12 bytes before the end.
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_FIND_LIMIT = 12;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr uint32_t HASH_LOG = 16;
+
+uint32_t read32(const uint8_t *data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t hash_sequence(uint32_t sequence) {
+    return sequence * 2654435761u >> (32 - HASH_LOG);
+}
+
+void write_length(std::vector<uint8_t> &out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+void write_sequence(std::vector<uint8_t> &out, std::span<const uint8_t> literals, size_t offset, size_t match_length) {
+    const size_t match_code = match_length - MIN_MATCH;
+    const auto token = static_cast<uint8_t>(std::min<size_t>(literals.size(), 15) << 4 | std::min<size_t>(match_code, 15));
+    out.push_back(token);
+    if (literals.size() >= 15) {
+        write_length(out, literals.size() - 15);
+    }
+    out.insert(out.end(), literals.begin(), literals.end());
+    out.push_back(static_cast<uint8_t>(offset & 0xff));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (match_code >= 15) {
+        write_length(out, match_code - 15);
+    }
+}
+
+bool read_length(std::span<const uint8_t> source, size_t &position, size_t &length) {
+    uint8_t byte;
+    do {
+        if (position >= source.size()) {
+            return false;
+        }
+        byte = source[position++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+}
+
+std::vector<uint8_t> lz4_compress(std::span<const uint8_t> source) {
+    const size_t size = source.size();
+    std::vector<uint8_t> out;
+    out.reserve(size + size / 255 + 16);
+
+    size_t anchor = 0;
+    if (size >= MATCH_FIND_LIMIT) {
+        // Positions are stored + 1, so that 0 marks an empty slot.
+        std::vector<uint32_t> table(1u << HASH_LOG, 0);
+        const size_t match_limit = size - LAST_LITERALS;
+        size_t position = 0;
+        while (position + MATCH_FIND_LIMIT <= size) {
+            const uint32_t sequence = read32(&source[position]);
+            uint32_t &slot = table[hash_sequence(sequence)];
+            const size_t candidate = slot;
+            slot = static_cast<uint32_t>(position + 1);
+            if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || read32(&source[candidate - 1]) != sequence) {
+                ++position;
+                continue;
+            }
+            const size_t match = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (position + length < match_limit && source[match + length] == source[position + length]) {
+                ++length;
+            }
+            write_sequence(out, source.subspan(anchor, position - anchor), position - match, length);
+            position += length;
+            anchor = position;
+        }
+    }
+
+    const size_t literals = size - anchor;
+    out.push_back(static_cast<uint8_t>(std::min<size_t>(literals, 15) << 4));
+    if (literals >= 15) {
+        write_length(out, literals - 15);
+    }
+    out.insert(out.end(), source.begin() + static_cast<std::ptrdiff_t>(anchor), source.end());
+    return out;
+}
+
+bool lz4_decompress(std::span<const uint8_t> source, std::span<uint8_t> destination) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < source.size()) {
+        const uint8_t token = source[in++];
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(source, in, literals)) {
+            return false;
+        }
+        if (literals > source.size() - in || literals > destination.size() - out) {
+            return false;
+        }
+        std::memcpy(destination.data() + out, source.data() + in, literals);
+        in += literals;
+        out += literals;
+        if (in == source.size()) {
+            // The last sequence has only literals.
+            break;
+        }
+
+        if (source.size() - in < 2) {
+            return false;
+        }
+        const size_t offset = source[in] | static_cast<size_t>(source[in + 1]) << 8;
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !read_length(source, in, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if (offset == 0 || offset > out || length > destination.size() - out) {
+            return false;
+        }
+        // Byte by byte, since the match may overlap the bytes it produces.
+        for (size_t i = 0; i < length; ++i) {
+            destination[out + i] = destination[out - offset + i];
+        }
+        out += length;
+    }
+    return out == destination.size();
+}
+
+}
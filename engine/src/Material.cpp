@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <string>
+#include <glad/glad.h>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/resources/Material.hpp>
+#include <engine/resources/Shader.hpp>
+#include <engine/resources/Texture.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::resources {
+using graphics::GLExtensions;
+
+Material::Material(const Shader *shader, const std::vector<Texture *> &textures) : m_shader(shader) {
+    uint32_t counts[static_cast<size_t>(TextureType::Height) + 1] = {};
+    std::string uniform_name;
+    for (auto texture: textures) {
+        uniform_name = Texture::uniform_name_convention(texture->type());
+        uniform_name += std::to_string(++counts[static_cast<size_t>(texture->type())]);
+        const int32_t unit = shader->sampler_unit(uniform_name);
+        if (unit < 0) {
+            continue;
+        }
+        if (unit >= static_cast<int32_t>(MAX_TEXTURES)) {
+            spdlog::warn("[Material]: {} in shader {} needs unit {}, only {} are supported", uniform_name,
+                         shader->name(), unit, MAX_TEXTURES);
+            continue;
+        }
+        m_textures[unit] = texture;
+        m_units = std::max(m_units, static_cast<uint32_t>(unit) + 1);
+    }
+}
+
+void Material::bind() const {
+    uint32_t ids[MAX_TEXTURES];
+    for (uint32_t unit = 0; unit < m_units; ++unit) {
+        if (m_textures[unit]) {
+            m_textures[unit]->use();
+            ids[unit] = m_textures[unit]->id();
+        } else {
+            ids[unit] = 0;
+        }
+    }
+    if (GLExtensions::multi_bind()) {
+        CHECKED_GL_CALL(GLExtensions::glBindTextures, 0, static_cast<int32_t>(m_units), ids);
+        return;
+    }
+    for (uint32_t unit = 0; unit < m_units; ++unit) {
+        CHECKED_GL_CALL(glActiveTexture, GL_TEXTURE0 + unit);
+        CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, ids[unit]);
+    }
+}
+
+}
@@ -2,12 +2,14 @@
 #include <engine/util/Utils.hpp>
 #include <engine/resources/Mesh.hpp>
 #include <engine/resources/Shader.hpp>
-#include <unordered_map>
+#include <engine/graphics/OpenGL.hpp>
 
 namespace engine::resources {
 
-void Mesh::calculate_minmax_vertex(const std::vector<Vertex> &vertices) {
+void Mesh::calculate_minmax_vertex(const std::vector<Vertex> &vertices, MeshBuffers &buffers) {
     unsigned int n = vertices.size();
+    auto &min_vertex = buffers.min_vertex;
+    auto &max_vertex = buffers.max_vertex;
     min_vertex = glm::vec3(vertices[0].Position.x, vertices[0].Position.y, vertices[0].Position.z);
     max_vertex = glm::vec3(vertices[0].Position.x, vertices[0].Position.y, vertices[0].Position.z);
 
@@ -24,110 +26,247 @@ void Mesh::calculate_minmax_vertex(const std::vector<Vertex> &vertices) {
 
 
 Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
-           std::vector<Texture *> textures) {
-    // NOLINTBEGIN
+           std::vector<Texture *> textures) : Mesh(upload(vertices, indices), std::move(textures)) {
+}
+
+MeshBuffers Mesh::upload(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
     static_assert(std::is_trivial_v<Vertex>);
-    uint32_t VAO, VBO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    MeshBuffers buffers;
+    buffers.vbo = graphics::GLBuffer::create("vertices");
+    buffers.ebo = graphics::GLBuffer::create("indices");
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STATIC_DRAW);
+    // GL_ELEMENT_ARRAY_BUFFER is vertex array state, so both buffers are filled through the copy target.
+    const uint64_t vertices_size = vertices.size() * sizeof(vertices[0]);
+    const uint64_t indices_size = indices.size() * sizeof(indices[0]);
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, buffers.vbo.id());
+    CHECKED_GL_CALL(glBufferData, GL_COPY_WRITE_BUFFER, vertices_size, vertices.data(), GL_STATIC_DRAW);
+    buffers.vbo.set_size(vertices_size);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), indices.data(), GL_STATIC_DRAW);
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, buffers.ebo.id());
+    CHECKED_GL_CALL(glBufferData, GL_COPY_WRITE_BUFFER, indices_size, indices.data(), GL_STATIC_DRAW);
+    buffers.ebo.set_size(indices_size);
+    CHECKED_GL_CALL(glBindBuffer, GL_COPY_WRITE_BUFFER, 0);
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Position));
+    buffers.num_vertices = vertices.size();
+    buffers.num_indices = indices.size();
+    calculate_minmax_vertex(vertices, buffers);
+    return buffers;
+}
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Normal));
+void Mesh::set_vertex_layout() {
+    // NOLINTBEGIN
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 0);
+    CHECKED_GL_CALL(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Position));
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, TexCoords));
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 1);
+    CHECKED_GL_CALL(glVertexAttribPointer, 1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Normal));
 
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Tangent));
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 2);
+    CHECKED_GL_CALL(glVertexAttribPointer, 2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, TexCoords));
 
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Bitangent));
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 3);
+    CHECKED_GL_CALL(glVertexAttribPointer, 3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Tangent));
 
-    glBindVertexArray(0);
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 4);
+    CHECKED_GL_CALL(glVertexAttribPointer, 4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Bitangent));
     // NOLINTEND
-    m_vao = VAO;
-    m_num_indices = indices.size();
+}
+
+Mesh::Mesh(MeshBuffers buffers, std::vector<Texture *> textures) {
+    m_vao = graphics::GLVertexArray::create();
+    m_geometry = GeometryBuffer::instance()->allocate(buffers.vbo, buffers.num_vertices, buffers.ebo,
+                                                      buffers.num_indices);
+    // The vertices and indices now live in the geometry buffer; the mesh's own buffers are released with `buffers`.
+    if (!m_geometry) {
+        m_vbo = std::move(buffers.vbo);
+        m_ebo = std::move(buffers.ebo);
+    }
+    const uint32_t vbo = m_geometry ? GeometryBuffer::instance()->vertex_buffer() : m_vbo.id();
+    const uint32_t ebo = m_geometry ? GeometryBuffer::instance()->index_buffer() : m_ebo.id();
+
+    CHECKED_GL_CALL(glBindVertexArray, m_vao.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, vbo);
+    CHECKED_GL_CALL(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, ebo);
+    set_vertex_layout();
+    CHECKED_GL_CALL(glBindVertexArray, 0);
+
+    m_num_indices = buffers.num_indices;
     m_textures = std::move(textures);
-    calculate_minmax_vertex(vertices);
+    min_vertex = buffers.min_vertex;
+    max_vertex = buffers.max_vertex;
+    m_meshlets = std::move(buffers.meshlets);
+    m_meshlet_bounds = MeshletBounds(m_meshlets);
+    m_triangle_bvh = std::move(buffers.triangles);
+}
+
+const void *Mesh::index_offset() const {
+    return m_geometry ? reinterpret_cast<const void *>(m_geometry.get().first_index * sizeof(uint32_t)) : nullptr;
 }
 
 void Mesh::set_instanced_draw(glm::mat4 *model_matrix, int amount) {
-    unsigned int instanced_vbo;
-    glGenBuffers(1, &instanced_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, instanced_vbo);
-    glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &model_matrix[0], GL_STATIC_DRAW);
+    upload_instances(model_matrix, amount * sizeof(glm::mat4));
+    set_instance_source(m_instance_vbo.id());
+}
+
+void Mesh::set_instanced_draw(const InstanceData *instances, int amount) {
+    upload_instances(instances, amount * sizeof(InstanceData));
+    set_instance_source(m_instance_vbo.id(), sizeof(InstanceData));
+}
+
+void Mesh::upload_instances(const void *data, uint64_t size) {
+    if (m_instance_vbo) {
+        CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, m_instance_vbo.id());
+        if (size <= m_instance_capacity) {
+            CHECKED_GL_CALL(glBufferSubData, GL_ARRAY_BUFFER, 0, size, data);
+        } else {
+            CHECKED_GL_CALL(glBufferData, GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_DRAW);
+            m_instance_capacity = size;
+            m_instance_vbo.set_size(size);
+        }
+    } else {
+        m_instance_vbo = graphics::GLBuffer::create("instance matrices");
+        CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, m_instance_vbo.id());
+        CHECKED_GL_CALL(glBufferData, GL_ARRAY_BUFFER, size, data, GL_DYNAMIC_DRAW);
+        m_instance_capacity = size;
+        m_instance_vbo.set_size(size);
+    }
+}
+
+void Mesh::set_instance_source(uint32_t buffer, uint32_t stride) {
+    if (m_instance_source == buffer && m_instance_stride == stride) {
+        return;
+    }
+    m_instance_source = buffer;
+    m_instance_stride = stride;
+    CHECKED_GL_CALL(glBindVertexArray, m_vao.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, buffer);
 
-    glBindVertexArray(m_vao);
+    CHECKED_GL_CALL(glVertexAttribPointer, 3, 4, GL_FLOAT, GL_FALSE, stride, nullptr);
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 3);
+    CHECKED_GL_CALL(glVertexAttribPointer, 4, 4, GL_FLOAT, GL_FALSE, stride, (void *) (sizeof(glm::vec4)));
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 4);
+    CHECKED_GL_CALL(glVertexAttribPointer, 5, 4, GL_FLOAT, GL_FALSE, stride, (void *) (2 * sizeof(glm::vec4)));
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 5);
+    CHECKED_GL_CALL(glVertexAttribPointer, 6, 4, GL_FLOAT, GL_FALSE, stride, (void *) (3 * sizeof(glm::vec4)));
+    CHECKED_GL_CALL(glEnableVertexAttribArray, 6);
 
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *) 0);
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *) (sizeof(glm::vec4)));
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *) (2 * sizeof(glm::vec4)));
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *) (3 * sizeof(glm::vec4)));
-    glEnableVertexAttribArray(6);
+    CHECKED_GL_CALL(glVertexAttribDivisor, 3, 1);
+    CHECKED_GL_CALL(glVertexAttribDivisor, 4, 1);
+    CHECKED_GL_CALL(glVertexAttribDivisor, 5, 1);
+    CHECKED_GL_CALL(glVertexAttribDivisor, 6, 1);
 
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
-    glVertexAttribDivisor(6, 1);
+    // A buffer of bare matrices has no normal matrices and parameters, so their attributes are turned off
+    // rather than read past its instances.
+    if (stride == sizeof(InstanceData)) {
+        for (uint32_t column = 0; column < 3; ++column) {
+            const uint32_t location = InstanceData::NORMAL_LOCATION + column;
+            CHECKED_GL_CALL(glVertexAttribPointer, location, 3, GL_FLOAT, GL_FALSE, stride,
+                            (void *) (offsetof(InstanceData, normal) + column * sizeof(glm::vec3)));
+            CHECKED_GL_CALL(glEnableVertexAttribArray, location);
+            CHECKED_GL_CALL(glVertexAttribDivisor, location, 1);
+        }
+        CHECKED_GL_CALL(glVertexAttribPointer, InstanceData::PARAMS_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+                        (void *) offsetof(InstanceData, params));
+        CHECKED_GL_CALL(glEnableVertexAttribArray, InstanceData::PARAMS_LOCATION);
+        CHECKED_GL_CALL(glVertexAttribDivisor, InstanceData::PARAMS_LOCATION, 1);
+    } else {
+        for (uint32_t location = InstanceData::NORMAL_LOCATION; location <= InstanceData::PARAMS_LOCATION; ++location) {
+            CHECKED_GL_CALL(glDisableVertexAttribArray, location);
+        }
+    }
+
+    CHECKED_GL_CALL(glBindVertexArray, 0);
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, 0);
+}
 
-    glBindVertexArray(0);
+const Material &Mesh::material(const Shader *shader) {
+    for (const auto &material: m_materials) {
+        if (material.shader() == shader) {
+            return material;
+        }
+    }
+    return m_materials.emplace_back(shader, m_textures);
 }
 
 void Mesh::draw(const Shader *shader) {
-    std::unordered_map<std::string_view, uint32_t> counts;
-    std::string uniform_name;
-    uniform_name.reserve(32);
-    for (int i = 0; i < m_textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        const auto &texture_type = Texture::uniform_name_convention(m_textures[i]->type());
-        uniform_name.append(texture_type);
-        const auto count = (counts[texture_type] += 1);
-        uniform_name.append(std::to_string(count));
-        shader->set_int(uniform_name, i);
-        glBindTexture(GL_TEXTURE_2D, m_textures[i]->id());
-        uniform_name.clear();
+    material(shader).bind();
+    CHECKED_GL_CALL(glBindVertexArray, m_vao.id());
+    if (m_geometry) {
+        CHECKED_GL_CALL(glDrawElementsBaseVertex, GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, index_offset(),
+                        m_geometry.get().first_vertex);
+    } else {
+        CHECKED_GL_CALL(glDrawElements, GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, nullptr);
     }
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    CHECKED_GL_CALL(glBindVertexArray, 0);
+}
+
+uint32_t Mesh::draw(const Shader *shader, const MeshletView &view) {
+    if (m_meshlets.empty()) {
+        draw(shader);
+        return static_cast<uint32_t>(m_meshlets.size());
+    }
+    const uint32_t visible = m_meshlet_bounds.cull(view, m_meshlet_visible);
+    if (visible == 0) {
+        return 0;
+    }
+    // Meshlets are contiguous in the index buffer, so a run of visible ones is a single range.
+    m_draw_counts.clear();
+    m_draw_offsets.clear();
+    m_draw_base_vertices.clear();
+    const uint32_t first_index = m_geometry ? m_geometry.get().first_index : 0;
+    const int32_t base_vertex = m_geometry ? static_cast<int32_t>(m_geometry.get().first_vertex) : 0;
+    bool previous_visible = false;
+    for (size_t i = 0; i < m_meshlets.size(); ++i) {
+        if (!m_meshlet_visible[i]) {
+            previous_visible = false;
+            continue;
+        }
+        const auto count = static_cast<int32_t>(m_meshlets[i].index_count);
+        if (previous_visible) {
+            m_draw_counts.back() += count;
+        } else {
+            m_draw_counts.push_back(count);
+            m_draw_offsets.push_back(
+                    reinterpret_cast<const void *>((first_index + m_meshlets[i].first_index) * sizeof(uint32_t)));
+            m_draw_base_vertices.push_back(base_vertex);
+        }
+        previous_visible = true;
+    }
+
+    material(shader).bind();
+    CHECKED_GL_CALL(glBindVertexArray, m_vao.id());
+    CHECKED_GL_CALL(glMultiDrawElementsBaseVertex, GL_TRIANGLES, m_draw_counts.data(), GL_UNSIGNED_INT,
+                    m_draw_offsets.data(), static_cast<GLsizei>(m_draw_counts.size()), m_draw_base_vertices.data());
+    CHECKED_GL_CALL(glBindVertexArray, 0);
+    return visible;
 }
 
 void Mesh::instanced_draw(const Shader *shader, int amount) {
-    std::unordered_map<std::string_view, uint32_t> counts;
-    std::string uniform_name;
-    uniform_name.reserve(32);
-    for (int i = 0; i < m_textures.size(); i++) {
-        glActiveTexture(GL_TEXTURE0 + i);
-        const auto &texture_type = Texture::uniform_name_convention(m_textures[i]->type());
-        uniform_name.append(texture_type);
-        const auto count = (counts[texture_type] += 1);
-        uniform_name.append(std::to_string(count));
-        shader->set_int(uniform_name, i);
-        glBindTexture(GL_TEXTURE_2D, m_textures[i]->id());
-        uniform_name.clear();
+    material(shader).bind();
+    CHECKED_GL_CALL(glBindVertexArray, m_vao.id());
+    if (m_geometry) {
+        CHECKED_GL_CALL(glDrawElementsInstancedBaseVertex, GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT,
+                        index_offset(), amount, m_geometry.get().first_vertex);
+    } else {
+        CHECKED_GL_CALL(glDrawElementsInstanced, GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, nullptr, amount);
     }
-    glBindVertexArray(m_vao);
-    glDrawElementsInstanced(GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, 0, amount);
-    glBindVertexArray(0);
+    CHECKED_GL_CALL(glBindVertexArray, 0);
 }
 
 
+uint64_t Mesh::gpu_bytes() const {
+    return m_vbo.size() + m_ebo.size() + m_geometry.bytes() + m_instance_vbo.size();
+}
+
 void Mesh::destroy() {
-    glDeleteVertexArrays(1, &m_vao);
+    m_vao.reset();
+    m_vbo.reset();
+    m_ebo.reset();
+    m_geometry.reset();
+    m_instance_vbo.reset();
+    m_instance_capacity = 0;
+    m_instance_source = 0;
+    m_instance_stride = 0;
 }
 
 }
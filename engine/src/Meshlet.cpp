@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <engine/resources/Mesh.hpp>
+#include <engine/resources/Meshlet.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RG_MESHLET_SSE2 1
+#endif
+
+namespace engine::resources {
+
+static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+/**
+* @brief How much a triangle that turns the normal cone away counts against it, compared to a new vertex.
+* Tighter cones are culled more often, fewer vertices per triangle are shaded fewer times.
+*/
+static constexpr float CONE_WEIGHT = 0.5f;
+
+static glm::vec3 triangle_normal(const std::vector<Vertex> &vertices, const uint32_t *triangle) {
+    const glm::vec3 &a = vertices[triangle[0]].Position;
+    const glm::vec3 normal = glm::cross(vertices[triangle[1]].Position - a, vertices[triangle[2]].Position - a);
+    const float length = glm::length(normal);
+    return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
+
+static void compute_bounds(Meshlet &meshlet, const std::vector<Vertex> &vertices,
+                           const std::vector<uint32_t> &indices) {
+    const uint32_t *first = indices.data() + meshlet.first_index;
+    glm::vec3 box_min(std::numeric_limits<float>::max());
+    glm::vec3 box_max(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i < meshlet.index_count; ++i) {
+        box_min = glm::min(box_min, vertices[first[i]].Position);
+        box_max = glm::max(box_max, vertices[first[i]].Position);
+    }
+    meshlet.center = 0.5f * (box_min + box_max);
+    float radius_squared = 0.0f;
+    glm::vec3 normal_sum(0.0f);
+    for (uint32_t i = 0; i < meshlet.index_count; ++i) {
+        const glm::vec3 offset = vertices[first[i]].Position - meshlet.center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+        if (i % 3 == 0) {
+            normal_sum += triangle_normal(vertices, first + i);
+        }
+    }
+    meshlet.radius = std::sqrt(radius_squared);
+
+    // Without an axis the cone stays open: a zero axis never passes the backface test.
+    const float length = glm::length(normal_sum);
+    if (length == 0.0f) {
+        return;
+    }
+    const glm::vec3 axis = normal_sum / length;
+    float min_dot = 1.0f;
+    for (uint32_t i = 0; i < meshlet.index_count; i += 3) {
+        const glm::vec3 normal = triangle_normal(vertices, first + i);
+        // Degenerate triangles have no normal and aren't rasterized anyway.
+        if (normal != glm::vec3(0.0f)) {
+            min_dot = std::min(min_dot, glm::dot(axis, normal));
+        }
+    }
+    // Normals more than 90 degrees apart face the camera from every side.
+    if (min_dot <= 0.0f) {
+        return;
+    }
+    meshlet.cone_axis = axis;
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+
+std::vector<Meshlet> Meshlet::build(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+    if (indices.empty() || indices.size() % 3 != 0) {
+        return {};
+    }
+    const auto triangle_count = static_cast<uint32_t>(indices.size() / 3);
+    const auto vertex_count = static_cast<uint32_t>(vertices.size());
+
+    // Triangles of vertex v are vertex_triangles[first_triangle[v] .. first_triangle[v + 1]).
+    std::vector<uint32_t> first_triangle(vertex_count + 1, 0);
+    for (uint32_t index: indices) {
+        ++first_triangle[index + 1];
+    }
+    for (uint32_t v = 0; v < vertex_count; ++v) {
+        first_triangle[v + 1] += first_triangle[v];
+    }
+    std::vector<uint32_t> vertex_triangles(indices.size());
+    {
+        std::vector<uint32_t> fill(first_triangle.begin(), first_triangle.end() - 1);
+        for (uint32_t i = 0; i < indices.size(); ++i) {
+            vertex_triangles[fill[indices[i]]++] = i / 3;
+        }
+    }
+    std::vector<glm::vec3> normals(triangle_count);
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        normals[t] = triangle_normal(vertices, &indices[3 * t]);
+    }
+
+    // The meshlet a vertex or a candidate triangle was last added to, so that neither is cleared between meshlets.
+    std::vector<uint32_t> vertex_meshlet(vertex_count, NONE);
+    std::vector<uint32_t> candidate_meshlet(triangle_count, NONE);
+    std::vector<uint8_t> used(triangle_count, 0);
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    std::vector<Meshlet> meshlets;
+
+    uint32_t seed = 0;
+    while (true) {
+        while (seed < triangle_count && used[seed]) {
+            ++seed;
+        }
+        if (seed == triangle_count) {
+            break;
+        }
+        const auto id = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet;
+        meshlet.first_index = static_cast<uint32_t>(reordered.size());
+        uint32_t meshlet_vertices = 0;
+        glm::vec3 normal_sum(0.0f);
+        candidates.clear();
+
+        uint32_t next = seed;
+        while (next != NONE) {
+            used[next] = 1;
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint32_t v = indices[3 * next + k];
+                reordered.push_back(v);
+                if (vertex_meshlet[v] == id) {
+                    continue;
+                }
+                vertex_meshlet[v] = id;
+                ++meshlet_vertices;
+                for (uint32_t i = first_triangle[v]; i < first_triangle[v + 1]; ++i) {
+                    const uint32_t t = vertex_triangles[i];
+                    if (!used[t] && candidate_meshlet[t] != id) {
+                        candidate_meshlet[t] = id;
+                        candidates.push_back(t);
+                    }
+                }
+            }
+            normal_sum += normals[next];
+            meshlet.index_count += 3;
+            if (meshlet.index_count == MAX_TRIANGLES * 3) {
+                break;
+            }
+
+            // The neighbour that adds the fewest vertices, and of those the one closest to the normals so far.
+            const float length = glm::length(normal_sum);
+            const glm::vec3 axis = length > 0.0f ? normal_sum / length : glm::vec3(0.0f);
+            next = NONE;
+            float best_score = std::numeric_limits<float>::max();
+            for (size_t i = 0; i < candidates.size();) {
+                const uint32_t t = candidates[i];
+                if (used[t]) {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                ++i;
+                uint32_t new_vertices = 0;
+                for (uint32_t k = 0; k < 3; ++k) {
+                    new_vertices += vertex_meshlet[indices[3 * t + k]] != id;
+                }
+                if (meshlet_vertices + new_vertices > MAX_VERTICES) {
+                    continue;
+                }
+                const float score = static_cast<float>(new_vertices) +
+                                    CONE_WEIGHT * (1.0f - glm::dot(axis, normals[t]));
+                if (score < best_score) {
+                    best_score = score;
+                    next = t;
+                }
+            }
+        }
+        compute_bounds(meshlet, vertices, reordered);
+        meshlets.push_back(meshlet);
+    }
+    indices = std::move(reordered);
+    return meshlets;
+}
+
+MeshletView::MeshletView(const glm::mat4 &view_projection, const glm::vec3 &camera_position,
+                         const glm::mat4 &model_matrix, bool backfaces) : backfaces(backfaces) {
+    // Rows of the clip matrix of the mesh give the frustum planes directly in its model space.
+    const glm::mat4 rows = glm::transpose(view_projection * model_matrix);
+    planes = {
+            rows[3] + rows[0], rows[3] - rows[0],
+            rows[3] + rows[1], rows[3] - rows[1],
+            rows[3] + rows[2], rows[3] - rows[2],
+    };
+    for (auto &plane: planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    camera = glm::vec3(glm::inverse(model_matrix) * glm::vec4(camera_position, 1.0f));
+}
+
+MeshletBounds::MeshletBounds(const std::vector<Meshlet> &meshlets) : m_size(static_cast<uint32_t>(meshlets.size())) {
+    const size_t padded = (meshlets.size() + 3) & ~size_t(3);
+    for (auto *component: {&m_center_x, &m_center_y, &m_center_z, &m_radius, &m_axis_x, &m_axis_y, &m_axis_z,
+                           &m_cutoff}) {
+        component->resize(padded, 0.0f);
+    }
+    for (size_t i = 0; i < meshlets.size(); ++i) {
+        m_center_x[i] = meshlets[i].center.x;
+        m_center_y[i] = meshlets[i].center.y;
+        m_center_z[i] = meshlets[i].center.z;
+        m_radius[i] = meshlets[i].radius;
+        m_axis_x[i] = meshlets[i].cone_axis.x;
+        m_axis_y[i] = meshlets[i].cone_axis.y;
+        m_axis_z[i] = meshlets[i].cone_axis.z;
+        m_cutoff[i] = meshlets[i].cone_cutoff;
+    }
+}
+
+uint32_t MeshletBounds::cull(const MeshletView &view, std::vector<uint8_t> &visible) const {
+    visible.resize(m_size);
+    uint32_t result = 0;
+#ifdef RG_MESHLET_SSE2
+    for (uint32_t i = 0; i < m_size; i += 4) {
+        const __m128 center_x = _mm_loadu_ps(&m_center_x[i]);
+        const __m128 center_y = _mm_loadu_ps(&m_center_y[i]);
+        const __m128 center_z = _mm_loadu_ps(&m_center_z[i]);
+        const __m128 radius = _mm_loadu_ps(&m_radius[i]);
+        const __m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+        __m128 culled = _mm_setzero_ps();
+        for (const auto &plane: view.planes) {
+            const __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(plane.x)), _mm_mul_ps(center_y, _mm_set1_ps(plane.y))),
+                    _mm_add_ps(_mm_mul_ps(center_z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            culled = _mm_or_ps(culled, _mm_cmplt_ps(distance, negative_radius));
+        }
+        if (view.backfaces) {
+            const __m128 dx = _mm_sub_ps(center_x, _mm_set1_ps(view.camera.x));
+            const __m128 dy = _mm_sub_ps(center_y, _mm_set1_ps(view.camera.y));
+            const __m128 dz = _mm_sub_ps(center_z, _mm_set1_ps(view.camera.z));
+            const __m128 distance = _mm_sqrt_ps(
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            const __m128 along_axis = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&m_axis_x[i])), _mm_mul_ps(dy, _mm_loadu_ps(&m_axis_y[i]))),
+                    _mm_mul_ps(dz, _mm_loadu_ps(&m_axis_z[i])));
+            const __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_cutoff[i]), distance), radius);
+            culled = _mm_or_ps(culled, _mm_cmpge_ps(along_axis, limit));
+        }
+        const int mask = _mm_movemask_ps(culled);
+        for (uint32_t k = 0; k < 4 && i + k < m_size; ++k) {
+            visible[i + k] = (mask >> k & 1) == 0;
+            result += visible[i + k];
+        }
+    }
+#else
+    for (uint32_t i = 0; i < m_size; ++i) {
+        const glm::vec3 center(m_center_x[i], m_center_y[i], m_center_z[i]);
+        bool culled = false;
+        for (const auto &plane: view.planes) {
+            culled |= glm::dot(glm::vec3(plane), center) + plane.w < -m_radius[i];
+        }
+        if (view.backfaces) {
+            const glm::vec3 offset = center - view.camera;
+            culled |= glm::dot(offset, glm::vec3(m_axis_x[i], m_axis_y[i], m_axis_z[i])) >=
+                      m_cutoff[i] * glm::length(offset) + m_radius[i];
+        }
+        visible[i] = !culled;
+        result += visible[i];
+    }
+#endif
+    return result;
+}
+
+}
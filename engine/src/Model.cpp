@@ -1,20 +1,87 @@
-
+#include <glad/glad.h>
+#include <engine/graphics/OpenGL.hpp>
 #include <engine/resources/Model.hpp>
 #include <engine/resources/Shader.hpp>
 
 namespace engine::resources {
 
-void Model::set_instanced_draw(glm::mat4 *model_matrix, int amount) { for (auto &mesh: m_meshes) { mesh.set_instanced_draw(model_matrix, amount); } }
+void Model::set_instanced_draw(glm::mat4 *model_matrix, int amount) {
+    use();
+    for (auto &mesh: m_meshes) { mesh.set_instanced_draw(model_matrix, amount); } }
+
+void Model::set_instanced_draw(const InstanceData *instances, int amount) {
+    use();
+    for (auto &mesh: m_meshes) { mesh.set_instanced_draw(instances, amount); }
+}
 
 void Model::instanced_draw(const Shader *shader, int amount) {
+    use();
     shader->use();
     for (auto &mesh: m_meshes) { mesh.instanced_draw(shader, amount); }
 }
 
 void Model::draw(const Shader *shader) {
+    use();
     shader->use();
     for (auto &mesh: m_meshes) { mesh.draw(shader); }
 }
 
+uint32_t Model::draw(const Shader *shader, const MeshletView &view) {
+    use();
+    shader->use();
+    if (view.backfaces) {
+        CHECKED_GL_CALL(glEnable, GL_CULL_FACE);
+    }
+    uint32_t result = 0;
+    for (auto &mesh: m_meshes) { result += mesh.draw(shader, view); }
+    if (view.backfaces) {
+        CHECKED_GL_CALL(glDisable, GL_CULL_FACE);
+    }
+    return result;
+}
+
+util::Aabb Model::bounds() const {
+    util::Aabb result;
+    for (const auto &mesh: m_meshes) {
+        result.grow(mesh.min_vertex);
+        result.grow(mesh.max_vertex);
+    }
+    return result;
+}
+
+bool Model::hit_testable() const {
+    return loaded() && !m_meshes.empty() &&
+           std::ranges::all_of(m_meshes, [](const Mesh &mesh) { return mesh.triangle_bvh() != nullptr; });
+}
+
+std::optional<ModelHit> Model::intersect(const glm::vec3 &origin, const glm::vec3 &direction,
+                                         const glm::mat4 &model_matrix, float max_distance) const {
+    std::optional<ModelHit> result;
+    if (!loaded()) {
+        return result;
+    }
+    // The direction isn't normalized in the model space, so the distances stay those of the world space ray.
+    const glm::mat4 inverse = glm::inverse(model_matrix);
+    const glm::vec3 local_origin = inverse * glm::vec4(origin, 1.0f);
+    const glm::vec3 local_direction = inverse * glm::vec4(direction, 0.0f);
+    for (uint32_t i = 0; i < m_meshes.size(); ++i) {
+        const TriangleBvh *triangles = m_meshes[i].triangle_bvh();
+        if (!triangles) {
+            continue;
+        }
+        if (auto hit = triangles->intersect(local_origin, local_direction, max_distance)) {
+            max_distance = hit->distance;
+            result = ModelHit{.mesh = i, .triangle = *hit, .position = origin + hit->distance * direction};
+        }
+    }
+    return result;
+}
+
 void Model::destroy() { for (auto &mesh: m_meshes) { mesh.destroy(); } }
+
+uint64_t Model::gpu_bytes() const {
+    uint64_t result = 0;
+    for (const auto &mesh: m_meshes) { result += mesh.gpu_bytes(); }
+    return result;
+}
 }
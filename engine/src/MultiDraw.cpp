@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <glad/glad.h>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/resources/GeometryBuffer.hpp>
+#include <engine/resources/Model.hpp>
+#include <engine/resources/MultiDraw.hpp>
+#include <engine/resources/Shader.hpp>
+
+namespace engine::resources {
+using graphics::GLExtensions;
+
+bool MultiDraw::supported() {
+    return GeometryBuffer::instance()->enabled();
+}
+
+bool MultiDraw::add(Model *model, const glm::mat4 &model_matrix) {
+    return add(model, model_matrix, glm::transpose(glm::inverse(glm::mat3(model_matrix))));
+}
+
+bool MultiDraw::add(Model *model, const glm::mat4 &model_matrix, const glm::mat3 &normal_matrix) {
+    model->use();
+    for (const auto &mesh: model->m_meshes) {
+        if (!mesh.m_geometry) {
+            return false;
+        }
+    }
+    const auto data = static_cast<uint32_t>(m_data.size());
+    m_data.push_back(DrawData{
+            .model = model_matrix,
+            .normal = glm::mat4(normal_matrix),
+    });
+    for (auto &mesh: model->m_meshes) {
+        m_draws.push_back(Draw{.mesh = &mesh, .material = nullptr, .data = data});
+    }
+    return true;
+}
+
+void MultiDraw::clear() {
+    m_draws.clear();
+    m_data.clear();
+}
+
+void MultiDraw::draw(const Shader *shader) {
+    if (m_draws.empty()) {
+        clear();
+        return;
+    }
+    shader->use();
+    // A mesh builds its material for the shader on the first lookup only, so the later lookups
+    // don't move the materials the earlier draws point to.
+    for (auto &draw: m_draws) {
+        draw.material = &draw.mesh->material(shader);
+    }
+    std::stable_sort(m_draws.begin(), m_draws.end(), [](const Draw &a, const Draw &b) {
+        return a.material < b.material;
+    });
+
+    // The data of the i-th command is at index i, which the command passes on as its base instance.
+    m_commands.clear();
+    m_sorted_data.clear();
+    for (const auto &draw: m_draws) {
+        const auto &range = draw.mesh->m_geometry.get();
+        m_commands.push_back(DrawElementsIndirectCommand{
+                .count = range.index_count,
+                .instance_count = 1,
+                .first_index = range.first_index,
+                .base_vertex = static_cast<int32_t>(range.first_vertex),
+                .base_instance = static_cast<uint32_t>(m_sorted_data.size()),
+        });
+        m_sorted_data.push_back(m_data[draw.data]);
+    }
+    upload(m_data_buffer, m_data_capacity, GLExtensions::SHADER_STORAGE_BUFFER, m_sorted_data.data(),
+           m_sorted_data.size() * sizeof(DrawData));
+    upload(m_command_buffer, m_command_capacity, GLExtensions::DRAW_INDIRECT_BUFFER, m_commands.data(),
+           m_commands.size() * sizeof(DrawElementsIndirectCommand));
+
+    GeometryBuffer::instance()->bind(static_cast<uint32_t>(m_commands.size()));
+    CHECKED_GL_CALL(glBindBufferBase, GLExtensions::SHADER_STORAGE_BUFFER, DRAWS_BINDING, m_data_buffer.id());
+    CHECKED_GL_CALL(glBindBuffer, GLExtensions::DRAW_INDIRECT_BUFFER, m_command_buffer.id());
+    size_t first = 0;
+    while (first < m_draws.size()) {
+        size_t last = first + 1;
+        while (last < m_draws.size() && m_draws[last].material == m_draws[first].material) {
+            ++last;
+        }
+        m_draws[first].material->bind();
+        CHECKED_GL_CALL(GLExtensions::glMultiDrawElementsIndirect, GL_TRIANGLES, GL_UNSIGNED_INT,
+                        reinterpret_cast<const void *>(first * sizeof(DrawElementsIndirectCommand)),
+                        static_cast<int32_t>(last - first), 0);
+        first = last;
+    }
+    CHECKED_GL_CALL(glBindBuffer, GLExtensions::DRAW_INDIRECT_BUFFER, 0);
+    CHECKED_GL_CALL(glBindVertexArray, 0);
+    clear();
+}
+
+void MultiDraw::upload(graphics::GLBuffer &buffer, uint64_t &capacity, uint32_t target, const void *data,
+                       uint64_t size) {
+    if (!buffer) {
+        buffer = graphics::GLBuffer::create(target == GLExtensions::SHADER_STORAGE_BUFFER ? "multi draw data"
+                                                                                        : "multi draw commands");
+    }
+    CHECKED_GL_CALL(glBindBuffer, target, buffer.id());
+    if (size > capacity) {
+        capacity = std::max(size, capacity * 2);
+        CHECKED_GL_CALL(glBufferData, target, static_cast<GLsizeiptr>(capacity), nullptr, GL_STREAM_DRAW);
+        buffer.set_size(capacity);
+    }
+    CHECKED_GL_CALL(glBufferSubData, target, 0, static_cast<GLsizeiptr>(size), data);
+}
+
+}
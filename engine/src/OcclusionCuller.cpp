@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <engine/graphics/OcclusionCuller.hpp>
+#include <engine/resources/Model.hpp>
+#include <engine/util/Configuration.hpp>
+#include <engine/util/Errors.hpp>
+#include <engine/util/WorkerPool.hpp>
+#include <spdlog/spdlog.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RG_OCCLUSION_SSE2 1
+#endif
+
+namespace engine::graphics {
+
+/**
+* @brief Rows of the depth buffer rasterized by one job.
+*/
+static constexpr int32_t BAND_ROWS = 16;
+
+/**
+* @brief Below this many triangles waking the workers costs more than it saves.
+*/
+static constexpr size_t PARALLEL_TRIANGLES = 256;
+
+/**
+* @brief CPU time per frame the culling should fit in, or it costs more than the draws it saves.
+*/
+static constexpr double BUDGET_MS = 1.0;
+
+/**
+* @brief Box corner i has the maximum x if bit 0 is set, the maximum y for bit 1 and the maximum z for bit 2.
+*/
+static constexpr std::array<uint32_t, 36> BOX_INDICES = {
+        0, 2, 3, 0, 3, 1, // -z
+        4, 5, 7, 4, 7, 6, // +z
+        0, 4, 6, 0, 6, 2, // -x
+        1, 3, 7, 1, 7, 5, // +x
+        0, 1, 5, 0, 5, 4, // -y
+        2, 6, 7, 2, 7, 3, // +y
+};
+
+static std::array<glm::vec3, 8> box_corners(const glm::vec3 &box_min, const glm::vec3 &box_max) {
+    std::array<glm::vec3, 8> corners;
+    for (uint32_t i = 0; i < corners.size(); ++i) {
+        corners[i] = glm::vec3(i & 1 ? box_max.x : box_min.x, i & 2 ? box_max.y : box_min.y,
+                               i & 4 ? box_max.z : box_min.z);
+    }
+    return corners;
+}
+
+OccluderMesh OccluderMesh::box(const glm::vec3 &box_min, const glm::vec3 &box_max) {
+    const auto corners = box_corners(box_min, box_max);
+    return OccluderMesh{
+            .vertices = {corners.begin(), corners.end()},
+            .indices = {BOX_INDICES.begin(), BOX_INDICES.end()},
+    };
+}
+
+void OcclusionCuller::initialize() {
+    const auto &config = util::Configuration::config();
+    if (!config.contains("graphics") || !config["graphics"].contains("occlusion_culling")) {
+        return;
+    }
+    const auto &occlusion = config["graphics"]["occlusion_culling"];
+    const auto width = occlusion.value<int32_t>("width", 256);
+    const auto height = occlusion.value<int32_t>("height", 128);
+    RG_GUARANTEE(width > 0 && height > 0, "graphics.occlusion_culling size must be positive.");
+    // The rows are processed 4 pixels at a time.
+    m_width = (width + 3) & ~3;
+    m_height = height;
+    m_depth.assign(static_cast<size_t>(m_width) * m_height, 1.0f);
+    m_enabled = true;
+    spdlog::info("[OcclusionCuller]: {}x{} depth buffer", m_width, m_height);
+}
+
+void OcclusionCuller::begin_frame(const glm::mat4 &view_projection) {
+    m_stats = m_frame_stats;
+    m_frame_stats = {};
+    if (m_stats.cpu_ms > BUDGET_MS && !m_reported_over_budget) {
+        spdlog::warn("[OcclusionCuller]: {:.2f} ms for {} occluder triangles and {} tests, over the {} ms budget. "
+                     "Use fewer occluder triangles or a smaller depth buffer.", m_stats.cpu_ms,
+                     m_stats.occluder_triangles, m_stats.tested, BUDGET_MS);
+        m_reported_over_budget = true;
+    }
+    m_view_projection = view_projection;
+    m_triangles.clear();
+    m_rasterized = true;
+    std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+}
+
+void OcclusionCuller::account(std::chrono::steady_clock::time_point start) {
+    m_frame_stats.cpu_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::add_occluder(const OccluderMesh &mesh, const glm::mat4 &model_matrix) {
+    const auto start = std::chrono::steady_clock::now();
+    const glm::mat4 mvp = m_view_projection * model_matrix;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        add_triangle(mvp * glm::vec4(mesh.vertices[mesh.indices[i]], 1.0f),
+                     mvp * glm::vec4(mesh.vertices[mesh.indices[i + 1]], 1.0f),
+                     mvp * glm::vec4(mesh.vertices[mesh.indices[i + 2]], 1.0f));
+    }
+    account(start);
+}
+
+void OcclusionCuller::add_occluder(const resources::Model *model, const glm::mat4 &model_matrix, float scale) {
+    const auto start = std::chrono::steady_clock::now();
+    const glm::mat4 mvp = m_view_projection * model_matrix;
+    for (const auto &mesh: model->meshes()) {
+        const glm::vec3 center = (mesh.min_vertex + mesh.max_vertex) * 0.5f;
+        const glm::vec3 half_extent = (mesh.max_vertex - mesh.min_vertex) * (0.5f * scale);
+        const auto corners = box_corners(center - half_extent, center + half_extent);
+        std::array<glm::vec4, 8> clip;
+        for (size_t i = 0; i < corners.size(); ++i) {
+            clip[i] = mvp * glm::vec4(corners[i], 1.0f);
+        }
+        for (size_t i = 0; i < BOX_INDICES.size(); i += 3) {
+            add_triangle(clip[BOX_INDICES[i]], clip[BOX_INDICES[i + 1]], clip[BOX_INDICES[i + 2]]);
+        }
+    }
+    account(start);
+}
+
+void OcclusionCuller::add_triangle(const glm::vec4 &v0, const glm::vec4 &v1, const glm::vec4 &v2) {
+    // Distances to the near plane, z = -w; the parts behind it are cut off.
+    const std::array<glm::vec4, 3> vertices = {v0, v1, v2};
+    std::array<float, 3> distances;
+    uint32_t in_front = 0;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        distances[i] = vertices[i].z + vertices[i].w;
+        in_front += distances[i] >= 0.0f;
+    }
+    if (in_front == 3) {
+        setup_triangle(v0, v1, v2);
+        return;
+    }
+    if (in_front == 0) {
+        return;
+    }
+    std::array<glm::vec4, 4> polygon;
+    size_t count = 0;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const size_t next = (i + 1) % vertices.size();
+        if (distances[i] >= 0.0f) {
+            polygon[count++] = vertices[i];
+        }
+        if ((distances[i] >= 0.0f) != (distances[next] >= 0.0f)) {
+            const float t = distances[i] / (distances[i] - distances[next]);
+            polygon[count++] = vertices[i] + (vertices[next] - vertices[i]) * t;
+        }
+    }
+    for (size_t i = 2; i < count; ++i) {
+        setup_triangle(polygon[0], polygon[i - 1], polygon[i]);
+    }
+}
+
+void OcclusionCuller::setup_triangle(const glm::vec4 &v0, const glm::vec4 &v1, const glm::vec4 &v2) {
+    const auto to_screen = [this](const glm::vec4 &clip) {
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3((ndc.x * 0.5f + 0.5f) * static_cast<float>(m_width),
+                         (ndc.y * 0.5f + 0.5f) * static_cast<float>(m_height), ndc.z * 0.5f + 0.5f);
+    };
+    const std::array<glm::vec3, 3> p = {to_screen(v0), to_screen(v1), to_screen(v2)};
+    const float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+    // Clockwise triangles face away from the camera; the front faces of a closed occluder hide them.
+    if (!(area > 0.0f)) {
+        return;
+    }
+
+    Triangle triangle{};
+    const float lowest_x = std::min({p[0].x, p[1].x, p[2].x});
+    const float highest_x = std::max({p[0].x, p[1].x, p[2].x});
+    const float lowest_y = std::min({p[0].y, p[1].y, p[2].y});
+    const float highest_y = std::max({p[0].y, p[1].y, p[2].y});
+    if (highest_x < 0.0f || highest_y < 0.0f || lowest_x >= static_cast<float>(m_width) ||
+        lowest_y >= static_cast<float>(m_height)) {
+        return;
+    }
+    // Clamped before the conversion, vertices close to the near plane project far outside the buffer.
+    const auto width = static_cast<float>(m_width - 1);
+    const auto height = static_cast<float>(m_height - 1);
+    triangle.min_x = static_cast<int32_t>(std::clamp(lowest_x, 0.0f, width));
+    triangle.max_x = static_cast<int32_t>(std::clamp(highest_x, 0.0f, width));
+    triangle.min_y = static_cast<int32_t>(std::clamp(lowest_y, 0.0f, height));
+    triangle.max_y = static_cast<int32_t>(std::clamp(highest_y, 0.0f, height));
+
+    // Edge i goes from vertex i to vertex i + 1, and weighs the vertex opposite to it.
+    std::array<float, 3> weights_x;
+    std::array<float, 3> weights_y;
+    std::array<float, 3> weights_c;
+    for (size_t i = 0; i < 3; ++i) {
+        const auto &from = p[i];
+        const auto &to = p[(i + 1) % 3];
+        triangle.a[i] = from.y - to.y;
+        triangle.b[i] = to.x - from.x;
+        triangle.c[i] = from.x * to.y - from.y * to.x;
+        const float depth = p[(i + 2) % 3].z / area;
+        weights_x[i] = triangle.a[i] * depth;
+        weights_y[i] = triangle.b[i] * depth;
+        weights_c[i] = triangle.c[i] * depth;
+    }
+    triangle.depth_dx = weights_x[0] + weights_x[1] + weights_x[2];
+    triangle.depth_dy = weights_y[0] + weights_y[1] + weights_y[2];
+    triangle.depth_c = weights_c[0] + weights_c[1] + weights_c[2];
+    m_triangles.push_back(triangle);
+    m_rasterized = false;
+}
+
+void OcclusionCuller::rasterize() {
+    const auto start = std::chrono::steady_clock::now();
+    const auto bands = static_cast<uint32_t>((m_height + BAND_ROWS - 1) / BAND_ROWS);
+    if (m_triangles.size() < PARALLEL_TRIANGLES) {
+        for (uint32_t band = 0; band < bands; ++band) {
+            rasterize_band(band);
+        }
+    } else {
+        util::WorkerPool::instance()->parallel_for(bands, [this](uint32_t band) {
+            rasterize_band(band);
+        });
+    }
+    m_frame_stats.occluder_triangles = static_cast<uint32_t>(m_triangles.size());
+    m_rasterized = true;
+    account(start);
+}
+
+void OcclusionCuller::rasterize_band(uint32_t band) {
+    const int32_t first_row = static_cast<int32_t>(band) * BAND_ROWS;
+    const int32_t last_row = std::min(first_row + BAND_ROWS, m_height) - 1;
+    for (const auto &triangle: m_triangles) {
+        const int32_t min_y = std::max(triangle.min_y, first_row);
+        const int32_t max_y = std::min(triangle.max_y, last_row);
+        // The first pixel of every group of 4 is aligned to the row, which is a multiple of 4 wide.
+        const int32_t min_x = triangle.min_x & ~3;
+#ifdef RG_OCCLUSION_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 a0 = _mm_set1_ps(triangle.a[0]);
+        const __m128 a1 = _mm_set1_ps(triangle.a[1]);
+        const __m128 a2 = _mm_set1_ps(triangle.a[2]);
+        const __m128 depth_dx = _mm_set1_ps(triangle.depth_dx);
+#endif
+        for (int32_t y = min_y; y <= max_y; ++y) {
+            const float center_y = static_cast<float>(y) + 0.5f;
+            const float row_e0 = triangle.b[0] * center_y + triangle.c[0];
+            const float row_e1 = triangle.b[1] * center_y + triangle.c[1];
+            const float row_e2 = triangle.b[2] * center_y + triangle.c[2];
+            const float row_depth = triangle.depth_dy * center_y + triangle.depth_c;
+            float *row = m_depth.data() + static_cast<size_t>(y) * m_width;
+#ifdef RG_OCCLUSION_SSE2
+            const __m128 e0_row = _mm_set1_ps(row_e0);
+            const __m128 e1_row = _mm_set1_ps(row_e1);
+            const __m128 e2_row = _mm_set1_ps(row_e2);
+            const __m128 depth_row = _mm_set1_ps(row_depth);
+            for (int32_t x = min_x; x <= triangle.max_x; x += 4) {
+                const __m128 center_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+                const __m128 inside = _mm_and_ps(
+                        _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, center_x), e0_row), zero),
+                                   _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, center_x), e1_row), zero)),
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, center_x), e2_row), zero));
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                const __m128 depth = _mm_add_ps(_mm_mul_ps(depth_dx, center_x), depth_row);
+                const __m128 previous = _mm_loadu_ps(row + x);
+                const __m128 nearer = _mm_min_ps(previous, depth);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, previous)));
+            }
+#else
+            for (int32_t x = min_x; x <= triangle.max_x; ++x) {
+                const float center_x = static_cast<float>(x) + 0.5f;
+                if (triangle.a[0] * center_x + row_e0 >= 0.0f && triangle.a[1] * center_x + row_e1 >= 0.0f &&
+                    triangle.a[2] * center_x + row_e2 >= 0.0f) {
+                    row[x] = std::min(row[x], triangle.depth_dx * center_x + row_depth);
+                }
+            }
+#endif
+        }
+    }
+}
+
+bool OcclusionCuller::visible(const glm::vec3 &box_min, const glm::vec3 &box_max, const glm::mat4 &model_matrix) {
+    if (!m_rasterized) {
+        rasterize();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    ++m_frame_stats.tested;
+    const bool result = [&] {
+        const glm::mat4 mvp = m_view_projection * model_matrix;
+        glm::vec2 lowest(std::numeric_limits<float>::max());
+        glm::vec2 highest(std::numeric_limits<float>::lowest());
+        float nearest = 1.0f;
+        for (const auto &corner: box_corners(box_min, box_max)) {
+            const glm::vec4 clip = mvp * glm::vec4(corner, 1.0f);
+            // A box that reaches the camera covers an unbounded part of the screen.
+            if (clip.z < -clip.w || clip.w <= 0.0f) {
+                return true;
+            }
+            const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            lowest = glm::min(lowest, glm::vec2(ndc));
+            highest = glm::max(highest, glm::vec2(ndc));
+            nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+        }
+        const glm::vec2 size(static_cast<float>(m_width), static_cast<float>(m_height));
+        const glm::vec2 screen_min = (lowest * 0.5f + 0.5f) * size;
+        const glm::vec2 screen_max = (highest * 0.5f + 0.5f) * size;
+        if (screen_max.x < 0.0f || screen_max.y < 0.0f || screen_min.x >= size.x || screen_min.y >= size.y) {
+            return false;
+        }
+        const int32_t first_x = static_cast<int32_t>(std::clamp(screen_min.x, 0.0f, size.x - 1.0f));
+        const int32_t last_x = static_cast<int32_t>(std::clamp(screen_max.x, 0.0f, size.x - 1.0f));
+        const int32_t first_y = static_cast<int32_t>(std::clamp(screen_min.y, 0.0f, size.y - 1.0f));
+        const int32_t last_y = static_cast<int32_t>(std::clamp(screen_max.y, 0.0f, size.y - 1.0f));
+        // Visible as soon as one pixel of the box's rectangle has no occluder in front of its nearest point.
+        for (int32_t y = first_y; y <= last_y; ++y) {
+            const float *row = m_depth.data() + static_cast<size_t>(y) * m_width;
+#ifdef RG_OCCLUSION_SSE2
+            const __m128 depth = _mm_set1_ps(nearest);
+            const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            const __m128 first = _mm_set1_ps(static_cast<float>(first_x));
+            const __m128 last = _mm_set1_ps(static_cast<float>(last_x));
+            for (int32_t x = first_x & ~3; x <= last_x; x += 4) {
+                const __m128 lane_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+                const __m128 in_box = _mm_and_ps(_mm_cmpge_ps(lane_x, first), _mm_cmple_ps(lane_x, last));
+                if (_mm_movemask_ps(_mm_and_ps(in_box, _mm_cmpge_ps(_mm_loadu_ps(row + x), depth))) != 0) {
+                    return true;
+                }
+            }
+#else
+            for (int32_t x = first_x; x <= last_x; ++x) {
+                if (row[x] >= nearest) {
+                    return true;
+                }
+            }
+#endif
+        }
+        return false;
+    }();
+    m_frame_stats.culled += !result;
+    account(start);
+    return result;
+}
+
+bool OcclusionCuller::visible(const resources::Model *model, const glm::mat4 &model_matrix) {
+    const auto &meshes = model->meshes();
+    if (meshes.empty()) {
+        return true;
+    }
+    glm::vec3 box_min = meshes.front().min_vertex;
+    glm::vec3 box_max = meshes.front().max_vertex;
+    for (const auto &mesh: meshes) {
+        box_min = glm::min(box_min, mesh.min_vertex);
+        box_max = glm::max(box_max, mesh.max_vertex);
+    }
+    return visible(box_min, box_max, model_matrix);
+}
+
+}
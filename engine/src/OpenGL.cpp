@@ -1,12 +1,17 @@
 #include <glad/glad.h>
 #include <filesystem>
+#include <algorithm>
 #include <array>
+#include <cstring>
+#include <vector>
 #include <stb_image.h>
+#include <engine/graphics/GLExtensions.hpp>
 #include <engine/graphics/OpenGL.hpp>
 #include <engine/resources/Shader.hpp>
 #include <engine/resources/ShaderCompiler.hpp>
 #include <engine/resources/Skybox.hpp>
 #include <engine/util/Errors.hpp>
+#include <engine/util/IOService.hpp>
 #include <engine/util/Utils.hpp>
 
 namespace engine::graphics {
@@ -15,34 +20,90 @@ int32_t OpenGL::shader_type_to_opengl_type(resources::ShaderType type) {
         case resources::ShaderType::Vertex: return GL_VERTEX_SHADER;
         case resources::ShaderType::Fragment: return GL_FRAGMENT_SHADER;
         case resources::ShaderType::Geometry: return GL_GEOMETRY_SHADER;
+        case resources::ShaderType::Compute: return GLExtensions::COMPUTE_SHADER;
         default: RG_SHOULD_NOT_REACH_HERE("Unhandled ShaderType");
     }
 }
 
-uint32_t OpenGL::generate_texture(const std::filesystem::path &path, bool flip_uvs) {
-    uint32_t texture_id = 0;
-    CHECKED_GL_CALL(glGenTextures, 1, &texture_id);
-
-    int32_t width, height, nr_components;
-    stbi_set_flip_vertically_on_load(flip_uvs);
-    uint8_t *data = stbi_load(path.c_str(), &width, &height, &nr_components, 0);
-    defer { stbi_image_free(data); };
-    if (data) {
-        int32_t format = texture_format(nr_components);
+GLTexture OpenGL::generate_texture(const std::filesystem::path &path, bool flip_uvs) {
+    return upload_texture(load_image(path, flip_uvs));
+}
 
-        CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, texture_id);
-        CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        CHECKED_GL_CALL(glGenerateMipmap, GL_TEXTURE_2D);
+TextureImage OpenGL::load_image(const std::filesystem::path &path, bool flip_uvs) {
+    const auto file = util::IOService::instance()->read_file(path);
+    return decode_image(file.data(), path, flip_uvs);
+}
 
-        CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    } else {
+TextureImage OpenGL::decode_image(std::span<const uint8_t> encoded, const std::filesystem::path &path, bool flip_uvs) {
+    TextureImage image;
+    uint8_t *data = stbi_load_from_memory(encoded.data(), static_cast<int>(encoded.size()), &image.width,
+                                          &image.height, &image.channels, 0);
+    if (!data) {
         throw util::EngineError(util::EngineError::Type::AssetLoadingError,
-                                std::format("Failed to load texture {}", path.string()));
+                                std::format("Failed to decode texture {}", path.string()));
+    }
+    image.pixels = std::shared_ptr<uint8_t>(data, stbi_image_free);
+    image.path = path;
+    if (flip_uvs) {
+        flip_image(image);
+    }
+    return image;
+}
+
+void OpenGL::flip_image(TextureImage &image) {
+    // Flipped by hand, since stbi_set_flip_vertically_on_load is global and images are decoded on loader threads.
+    uint8_t *data = image.pixels.get();
+    const size_t row = static_cast<size_t>(image.width) * image.channels;
+    std::vector<uint8_t> temp(row);
+    for (int32_t y = 0; y < image.height / 2; ++y) {
+        uint8_t *top = data + y * row;
+        uint8_t *bottom = data + (image.height - 1 - y) * row;
+        std::memcpy(temp.data(), top, row);
+        std::memcpy(top, bottom, row);
+        std::memcpy(bottom, temp.data(), row);
     }
-    return texture_id;
+}
+
+GLTexture OpenGL::upload_texture(const TextureImage &image) {
+    auto texture = GLTexture::create(image.path.string());
+    int32_t format = texture_format(image.channels);
+
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, texture.id());
+    CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE,
+                    image.pixels.get());
+    CHECKED_GL_CALL(glGenerateMipmap, GL_TEXTURE_2D);
+    // The full mip chain adds a third on top of the base level.
+    texture.set_size(static_cast<uint64_t>(image.width) * image.height * image.channels * 4 / 3);
+
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+GLTexture OpenGL::generate_placeholder_texture() {
+    static constexpr int32_t SIZE = 8;
+    std::array<uint8_t, SIZE * SIZE * 4> pixels{};
+    for (int32_t y = 0; y < SIZE; ++y) {
+        for (int32_t x = 0; x < SIZE; ++x) {
+            const uint8_t value = (x + y) % 2 == 0 ? 200 : 60;
+            uint8_t *pixel = &pixels[(y * SIZE + x) * 4];
+            pixel[0] = value;
+            pixel[1] = 0;
+            pixel[2] = value;
+            pixel[3] = 255;
+        }
+    }
+    auto texture = GLTexture::create("placeholder");
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, texture.id());
+    CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_2D, 0, GL_RGBA, SIZE, SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    texture.set_size(pixels.size());
+    return texture;
 }
 
 int32_t OpenGL::texture_format(int32_t number_of_channels) {
@@ -54,23 +115,30 @@ int32_t OpenGL::texture_format(int32_t number_of_channels) {
     }
 }
 
+GLVertexArray g_skybox_vao;
+GLBuffer g_skybox_vbo;
+
 uint32_t OpenGL::init_skybox_cube() {
-    static unsigned int skybox_vao = 0;
-    if (skybox_vao != 0) { return skybox_vao; }
+    if (g_skybox_vao) { return g_skybox_vao.id(); }
     float vertices[] = {
             // @formatter:off
         #include <skybox_vertices.include>
             // @formatter:on
     };
-    uint32_t skybox_vbo = 0;
-    CHECKED_GL_CALL(glGenVertexArrays, 1, &skybox_vao);
-    CHECKED_GL_CALL(glGenBuffers, 1, &skybox_vbo);
-    CHECKED_GL_CALL(glBindVertexArray, skybox_vao);
-    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, skybox_vbo);
+    g_skybox_vao = GLVertexArray::create("skybox cube");
+    g_skybox_vbo = GLBuffer::create("skybox cube");
+    CHECKED_GL_CALL(glBindVertexArray, g_skybox_vao.id());
+    CHECKED_GL_CALL(glBindBuffer, GL_ARRAY_BUFFER, g_skybox_vbo.id());
     CHECKED_GL_CALL(glBufferData, GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
+    g_skybox_vbo.set_size(sizeof(vertices));
     CHECKED_GL_CALL(glEnableVertexAttribArray, 0);
-    CHECKED_GL_CALL(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *) 0);// NOLINT
-    return skybox_vao;
+    CHECKED_GL_CALL(glVertexAttribPointer, 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+    return g_skybox_vao.id();
+}
+
+void OpenGL::destroy_skybox_cube() {
+    g_skybox_vao.reset();
+    g_skybox_vbo.reset();
 }
 
 bool OpenGL::shader_compiled_successfully(uint32_t shader_id) {
@@ -79,6 +147,12 @@ bool OpenGL::shader_compiled_successfully(uint32_t shader_id) {
     return success;
 }
 
+bool OpenGL::program_linked_successfully(uint32_t program_id) {
+    int success;
+    CHECKED_GL_CALL(glGetProgramiv, program_id, GL_LINK_STATUS, &success);
+    return success;
+}
+
 uint32_t OpenGL::compile_shader(const std::string &shader_source,
                                 resources::ShaderType shader_type) {
     uint32_t shader_id = CHECKED_GL_CALL(glCreateShader, shader_type_to_opengl_type(shader_type));
@@ -89,9 +163,21 @@ uint32_t OpenGL::compile_shader(const std::string &shader_source,
 }
 
 std::string OpenGL::get_compilation_error_message(uint32_t shader_id) {
-    char infoLog[512];
-    CHECKED_GL_CALL(glGetShaderInfoLog, shader_id, 512, nullptr, infoLog);
-    return infoLog;
+    int32_t length = 0;
+    CHECKED_GL_CALL(glGetShaderiv, shader_id, GL_INFO_LOG_LENGTH, &length);
+    std::string info_log(std::max(length, 1), '\0');
+    CHECKED_GL_CALL(glGetShaderInfoLog, shader_id, static_cast<int32_t>(info_log.size()), &length, info_log.data());
+    info_log.resize(length);
+    return info_log;
+}
+
+std::string OpenGL::get_link_error_message(uint32_t program_id) {
+    int32_t length = 0;
+    CHECKED_GL_CALL(glGetProgramiv, program_id, GL_INFO_LOG_LENGTH, &length);
+    std::string info_log(std::max(length, 1), '\0');
+    CHECKED_GL_CALL(glGetProgramInfoLog, program_id, static_cast<int32_t>(info_log.size()), &length, info_log.data());
+    info_log.resize(length);
+    return info_log;
 }
 
 std::string_view gl_call_error_description(GLenum error) {
@@ -121,41 +207,75 @@ void OpenGL::assert_no_error(std::source_location location) {
     };
 }
 
-uint32_t face_index(std::string_view name);
+GLTexture OpenGL::load_skybox_textures(const std::filesystem::path &path, bool flip_uvs) {
+    return upload_cubemap(load_skybox_images(path, flip_uvs), path);
+}
 
-uint32_t OpenGL::load_skybox_textures(const std::filesystem::path &path, bool flip_uvs) {
+CubemapImages OpenGL::load_skybox_images(const std::filesystem::path &path, bool flip_uvs) {
     RG_GUARANTEE(std::filesystem::is_directory(path),
                  "Directory '{}' doesn't exist. Please specify path to be a directory to where the cubemap textures are located. The cubemap textures should be named: right, left, top, bottom, front, back; by their respective faces in the cubemap.",
                  path.string());
-    uint32_t texture_id;
-    CHECKED_GL_CALL(glGenTextures, 1, &texture_id);
-    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_CUBE_MAP, texture_id);
-
-    int width, height, nr_channels;
+    // All six reads are issued before decoding the first image.
+    std::vector<std::pair<uint32_t, std::future<util::FileBuffer> > > files;
     for (const auto &file: std::filesystem::directory_iterator(path)) {
-        stbi_set_flip_vertically_on_load(flip_uvs);
-        unsigned char *data = stbi_load(absolute(file).c_str(), &width, &height, &nr_channels, 0);
-        defer { stbi_image_free(data); };
-        if (data) {
-            uint32_t i = face_index(file.path()
-                                        .stem()
-                                        .c_str());
-            int32_t format = texture_format(nr_channels);
-            CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, width, height, 0, format,
-                            GL_UNSIGNED_BYTE,
-                            data);
-        } else {
+        uint32_t i = cubemap_face_index(file.path()
+                                            .stem()
+                                            .c_str());
+        files.emplace_back(i, util::IOService::instance()->read(absolute(file)));
+    }
+    CubemapImages images;
+    for (auto &[i, file]: files) {
+        try {
+            const auto buffer = file.get();
+            images[i] = decode_image(buffer.data(), buffer.path(), flip_uvs);
+        } catch (const util::EngineError &) {
             throw util::EngineError(util::EngineError::Type::AssetLoadingError,
                                     std::format("Failed to load skybox texture {}", path.string()));
         }
     }
+    return images;
+}
+
+GLTexture OpenGL::upload_cubemap(const CubemapImages &images, const std::filesystem::path &path) {
+    auto texture = GLTexture::create(path.string());
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_CUBE_MAP, texture.id());
+
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < images.size(); ++i) {
+        const auto &image = images[i];
+        if (!image.pixels) {
+            continue;
+        }
+        int32_t format = texture_format(image.channels);
+        CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, image.width, image.height, 0, format,
+                        GL_UNSIGNED_BYTE,
+                        image.pixels.get());
+        size += static_cast<uint64_t>(image.width) * image.height * image.channels;
+    }
     CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    texture.set_size(size);
 
-    return texture_id;
+    return texture;
+}
+
+GLTexture OpenGL::generate_placeholder_cubemap() {
+    static constexpr std::array<uint8_t, 3> GREY = {90, 90, 100};
+    auto texture = GLTexture::create("placeholder cubemap");
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_CUBE_MAP, texture.id());
+    CHECKED_GL_CALL(glPixelStorei, GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < 6; ++i) {
+        CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                        GREY.data());
+    }
+    CHECKED_GL_CALL(glPixelStorei, GL_UNPACK_ALIGNMENT, 4);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    texture.set_size(6 * GREY.size());
+    return texture;
 }
 
 void OpenGL::set_depth_range(float a, float b) { CHECKED_GL_CALL(glDepthRange, a, b); }
@@ -167,7 +287,7 @@ void OpenGL::disable_depth_testing() { CHECKED_GL_CALL(glDisable, GL_DEPTH_TEST)
 
 void OpenGL::clear_buffers() { CHECKED_GL_CALL(glClear, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); }
 
-uint32_t face_index(std::string_view name) {
+uint32_t OpenGL::cubemap_face_index(std::string_view name) {
     if (name == "right") { return 0; } else if (name == "left") { return 1; } else if (name == "top") { return 2; } else if (name == "bottom") { return 3; } else if (name == "front") { return 4; } else if (name == "back") { return 5; } else {
         RG_SHOULD_NOT_REACH_HERE(
                 "Unknown face name: {}. The cubemap textures should be named: right, left, top, bottom, front, back; by their respective faces in the cubemap. The extension of the image file is ignored.",
@@ -0,0 +1,144 @@
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <vector>
+#include <glad/glad.h>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/GLTrace.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/resources/ProgramCache.hpp>
+#include <engine/resources/ResourcePack.hpp>
+#include <engine/resources/ShaderCompiler.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::resources {
+using graphics::GLExtensions;
+
+/**
+* @brief Header of a cached program file, followed by `length` bytes of the binary.
+*/
+struct ProgramFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+static constexpr char PROGRAM_MAGIC[4] = {'R', 'G', 'P', 'B'};
+static constexpr uint32_t PROGRAM_FILE_VERSION = 1;
+
+ProgramCache *ProgramCache::instance() {
+    static ProgramCache cache;
+    return &cache;
+}
+
+void ProgramCache::initialize(const std::filesystem::path &directory) {
+    if (!GLExtensions::program_binary()) {
+        spdlog::info("[ProgramCache]: program binaries aren't supported by the driver, the cache is disabled");
+        return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        spdlog::warn("[ProgramCache]: failed to create {}: {}, the cache is disabled", directory.string(),
+                     error.message());
+        return;
+    }
+    auto string = [](GLenum name) {
+        return std::string(reinterpret_cast<const char *>(CHECKED_GL_CALL(glGetString, name)));
+    };
+    m_driver = std::format("{}\n{}\n{}", string(GL_VENDOR), string(GL_RENDERER), string(GL_VERSION));
+    m_directory = directory;
+    m_enabled = true;
+    spdlog::info("[ProgramCache]: caching programs in {}", directory.string());
+}
+
+bool ProgramCache::enabled() const {
+    return m_enabled && !graphics::GLTrace::capturing();
+}
+
+uint64_t ProgramCache::key(const ShaderParsingResult &sources, std::string_view defines) const {
+    std::string key;
+    key.reserve(m_driver.size() + defines.size() + sources.vertex_shader.size() + sources.fragment_shader.size() +
+                sources.geometry_shader.size() + 4);
+    for (std::string_view part: {std::string_view(m_driver), defines, std::string_view(sources.vertex_shader),
+                                 std::string_view(sources.fragment_shader),
+                                 std::string_view(sources.geometry_shader)}) {
+        key.append(part);
+        key.push_back('\0');
+    }
+    return ResourcePack::hash(key);
+}
+
+std::filesystem::path ProgramCache::file(uint64_t key) const {
+    return m_directory / std::format("{:016x}.bin", key);
+}
+
+bool ProgramCache::load(uint64_t key, uint32_t program) {
+    std::ifstream in(file(key), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    ProgramFileHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC)) != 0 ||
+        header.version != PROGRAM_FILE_VERSION || header.key != key) {
+        return false;
+    }
+    std::vector<char> binary(header.length);
+    in.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!in) {
+        return false;
+    }
+    // The driver rejects binaries it can no longer load, for example after an update that kept the version string.
+    // A format it doesn't recognize raises GL_INVALID_ENUM, which CHECKED_GL_CALL would throw on in debug builds,
+    // so the call is made directly and the error is taken as a stale binary.
+    GLExtensions::glProgramBinary(program, header.format, binary.data(), static_cast<int32_t>(binary.size()));
+    const GLenum error = glGetError();
+    if (error != GL_NO_ERROR || !graphics::OpenGL::program_linked_successfully(program)) {
+        spdlog::info("[ProgramCache]: the driver rejected {}{}, compiling the sources", file(key).string(),
+                     error != GL_NO_ERROR ? std::format(" (GL error {:#x})", error) : "");
+        return false;
+    }
+    return true;
+}
+
+void ProgramCache::prepare(uint32_t program) const {
+    CHECKED_GL_CALL(GLExtensions::glProgramParameteri, program, GLExtensions::PROGRAM_BINARY_RETRIEVABLE_HINT,
+                    GL_TRUE);
+}
+
+void ProgramCache::store(uint64_t key, uint32_t program) {
+    int32_t length = 0;
+    CHECKED_GL_CALL(glGetProgramiv, program, GLExtensions::PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    ProgramFileHeader header{.version = PROGRAM_FILE_VERSION, .key = key};
+    std::memcpy(header.magic, PROGRAM_MAGIC, sizeof(PROGRAM_MAGIC));
+    CHECKED_GL_CALL(GLExtensions::glGetProgramBinary, program, length, &length, &header.format, binary.data());
+    header.length = static_cast<uint32_t>(length);
+
+    // Written under a temporary name, so that a crash never leaves a truncated binary behind.
+    const auto path = file(key);
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(binary.data(), length);
+        if (!out) {
+            spdlog::warn("[ProgramCache]: failed to write {}", temporary.string());
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        spdlog::warn("[ProgramCache]: failed to write {}: {}", path.string(), error.message());
+    }
+}
+
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <engine/resources/ResourcePack.hpp>
+#include <engine/util/Errors.hpp>
+#include <engine/util/Lz4.hpp>
+#include <engine/util/Utils.hpp>
+#include <spdlog/spdlog.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RG_HAS_MMAP 1
+#endif
+
+namespace engine::resources {
+
+static_assert(std::endian::native == std::endian::little, "The .rgpak format is read without byte swapping.");
+
+static constexpr char PACK_MAGIC[8] = {'R', 'G', 'P', 'A', 'K', 0, 0, 0};
+
+static std::vector<uint8_t> read_binary_file(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw util::EngineError(util::EngineError::Type::FileNotFound,
+                                std::format("Failed to open {}.", path.string()));
+    }
+    std::vector<uint8_t> result(std::filesystem::file_size(path));
+    file.read(reinterpret_cast<char *>(result.data()), static_cast<std::streamsize>(result.size()));
+    return result;
+}
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+ResourcePack::ResourcePack(const std::filesystem::path &path) : m_path(path) {
+    auto fail = [&](std::string_view reason) {
+        return util::EngineError(util::EngineError::Type::AssetLoadingError,
+                                 std::format("Invalid resource pack {}: {}.", path.string(), reason));
+    };
+#ifdef RG_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw util::EngineError(util::EngineError::Type::FileNotFound,
+                                std::format("Failed to open resource pack {}.", path.string()));
+    }
+    defer { close(fd); };
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        throw fail("empty file");
+    }
+    m_size = static_cast<uint64_t>(info.st_size);
+    void *mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        throw fail("mmap failed");
+    }
+    // The whole pack is read during startup, so ask the kernel for one sequential read-ahead.
+    posix_madvise(mapping, m_size, POSIX_MADV_WILLNEED);
+    m_data = static_cast<const uint8_t *>(mapping);
+#else
+    m_buffer = read_binary_file(path);
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#endif
+
+    try {
+        if (m_size < sizeof(Header)) {
+            throw fail("truncated header");
+        }
+        Header header;
+        std::memcpy(&header, m_data, sizeof(header));
+        if (std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) {
+            throw fail("not an .rgpak file");
+        }
+        if (header.version != VERSION) {
+            throw fail(std::format("version {}, expected {}", header.version, VERSION));
+        }
+        const uint64_t toc_size = static_cast<uint64_t>(header.entry_count) * sizeof(Entry);
+        if (header.toc_offset % alignof(Entry) != 0 || header.toc_offset + toc_size > m_size ||
+            header.names_offset + header.names_size > m_size) {
+            throw fail("table of contents out of bounds");
+        }
+        m_entries = std::span(reinterpret_cast<const Entry *>(m_data + header.toc_offset), header.entry_count);
+        m_names = std::string_view(reinterpret_cast<const char *>(m_data + header.names_offset), header.names_size);
+        for (const auto &entry: m_entries) {
+            if (entry.offset + entry.stored_size > m_size ||
+                static_cast<uint64_t>(entry.name_offset) + entry.name_size > m_names.size()) {
+                throw fail("entry out of bounds");
+            }
+        }
+    } catch (...) {
+#ifdef RG_HAS_MMAP
+        munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+        throw;
+    }
+    spdlog::info("[ResourcePack]: mapped {} ({} files, {} bytes)", path.string(), m_entries.size(), m_size);
+}
+
+ResourcePack::~ResourcePack() {
+#ifdef RG_HAS_MMAP
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+}
+
+uint64_t ResourcePack::hash(std::string_view name) {
+    uint64_t result = 14695981039346656037ull;
+    for (char c: name) {
+        result ^= static_cast<uint8_t>(c);
+        result *= 1099511628211ull;
+    }
+    return result;
+}
+
+std::string_view ResourcePack::name(const Entry &entry) const {
+    return m_names.substr(entry.name_offset, entry.name_size);
+}
+
+const ResourcePack::Entry *ResourcePack::find(std::string_view name) const {
+    const uint64_t name_hash = hash(name);
+    auto it = std::ranges::lower_bound(m_entries, name_hash, {}, &Entry::hash);
+    for (; it != m_entries.end() && it->hash == name_hash; ++it) {
+        if (this->name(*it) == name) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+bool ResourcePack::contains(std::string_view name) const {
+    return find(name) != nullptr;
+}
+
+PackedFile ResourcePack::read(std::string_view name) const {
+    const Entry *entry = find(name);
+    if (!entry) {
+        throw util::EngineError(util::EngineError::Type::FileNotFound,
+                                std::format("File {} not found in resource pack {}.", name, m_path.string()));
+    }
+    PackedFile result;
+    std::span<const uint8_t> stored(m_data + entry->offset, entry->stored_size);
+    switch (entry->compression) {
+        case PackCompression::None: result.m_data = stored;
+            break;
+        case PackCompression::LZ4: {
+            result.m_storage.resize(entry->size);
+            if (!util::lz4_decompress(stored, result.m_storage)) {
+                throw util::EngineError(util::EngineError::Type::AssetLoadingError,
+                                        std::format("Corrupted entry {} in resource pack {}.", name,
+                                                    m_path.string()));
+            }
+            result.m_data = result.m_storage;
+            break;
+        }
+        default: RG_SHOULD_NOT_REACH_HERE("Unhandled PackCompression {}", static_cast<uint32_t>(entry->compression));
+    }
+    return result;
+}
+
+std::vector<std::string> ResourcePack::list(std::string_view directory) const {
+    std::string prefix(directory);
+    while (prefix.ends_with('/')) {
+        prefix.pop_back();
+    }
+    if (!prefix.empty()) {
+        prefix.push_back('/');
+    }
+    std::set<std::string> children;
+    for (const auto &entry: m_entries) {
+        auto entry_name = name(entry);
+        if (!entry_name.starts_with(prefix)) {
+            continue;
+        }
+        auto rest = entry_name.substr(prefix.size());
+        children.emplace(prefix + std::string(rest.substr(0, rest.find('/'))));
+    }
+    return {children.begin(), children.end()};
+}
+
+ResourcePackStats ResourcePack::write(const std::filesystem::path &root, const std::filesystem::path &output,
+                                      bool compress) {
+    RG_GUARANTEE(std::filesystem::is_directory(root), "Directory {} doesn't exist.", root.string());
+
+    struct PendingEntry {
+        std::string name;
+        std::vector<uint8_t> data;
+        Entry entry{};
+    };
+    std::vector<PendingEntry> files;
+    for (const auto &file: std::filesystem::recursive_directory_iterator(root)) {
+        if (!file.is_regular_file() || file.path().extension() == EXTENSION) {
+            continue;
+        }
+        files.push_back(PendingEntry{.name = file.path().lexically_relative(root).generic_string()});
+    }
+    std::ranges::sort(files, [](const PendingEntry &a, const PendingEntry &b) {
+        const uint64_t hash_a = hash(a.name);
+        const uint64_t hash_b = hash(b.name);
+        return hash_a != hash_b ? hash_a < hash_b : a.name < b.name;
+    });
+
+    ResourcePackStats stats;
+    std::string names;
+    for (auto &file: files) {
+        auto data = read_binary_file(root / file.name);
+        file.entry.hash = hash(file.name);
+        file.entry.size = data.size();
+        file.entry.name_offset = static_cast<uint32_t>(names.size());
+        file.entry.name_size = static_cast<uint32_t>(file.name.size());
+        file.entry.compression = PackCompression::None;
+        names += file.name;
+        if (compress) {
+            auto compressed = util::lz4_compress(data);
+            if (compressed.size() < data.size() - data.size() / 8) {
+                data = std::move(compressed);
+                file.entry.compression = PackCompression::LZ4;
+                ++stats.compressed_files;
+            }
+        }
+        file.entry.stored_size = data.size();
+        file.data = std::move(data);
+        ++stats.files;
+        stats.bytes += file.entry.size;
+        stats.stored_bytes += file.entry.stored_size;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = VERSION;
+    header.entry_count = static_cast<uint32_t>(files.size());
+    header.toc_offset = sizeof(Header);
+    header.names_offset = header.toc_offset + files.size() * sizeof(Entry);
+    header.names_size = names.size();
+    uint64_t offset = align_up(header.names_offset + header.names_size, ALIGNMENT);
+    for (auto &file: files) {
+        file.entry.offset = offset;
+        offset = align_up(offset + file.entry.stored_size, ALIGNMENT);
+    }
+
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw util::EngineError(util::EngineError::Type::FileNotFound,
+                                std::format("Failed to create resource pack {}.", output.string()));
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto &file: files) {
+        out.write(reinterpret_cast<const char *>(&file.entry), sizeof(Entry));
+    }
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+    for (const auto &file: files) {
+        const std::vector<char> padding(file.entry.offset - static_cast<uint64_t>(out.tellp()), 0);
+        out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        out.write(reinterpret_cast<const char *>(file.data.data()), static_cast<std::streamsize>(file.data.size()));
+    }
+    if (!out) {
+        throw util::EngineError(util::EngineError::Type::AssetLoadingError,
+                                std::format("Failed to write resource pack {}.", output.string()));
+    }
+    return stats;
+}
+
+}
@@ -1,39 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <unordered_set>
 #include <utility>
+#include <assimp/IOSystem.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <engine/graphics/GLUploadThread.hpp>
 #include <engine/graphics/OpenGL.hpp>
+#include <engine/resources/ProgramCache.hpp>
 #include <engine/resources/ResourcesController.hpp>
 #include <engine/resources/ShaderCompiler.hpp>
 #include <engine/util/Configuration.hpp>
 #include <engine/util/Errors.hpp>
+#include <engine/util/IOService.hpp>
+#include <engine/util/WorkerPool.hpp>
 #include <spdlog/spdlog.h>
 
 namespace engine::resources {
 
 void ResourcesController::initialize() {
+    const auto &config = util::Configuration::config();
+    if (config.contains("resources")) {
+        m_gpu_budget = config["resources"].value<uint64_t>("gpu_budget_mb", 0) * 1024 * 1024;
+        m_lazy_loading = config["resources"].value<bool>("lazy_loading", false);
+        if (config["resources"].contains("pack")) {
+            m_pack = std::make_unique<ResourcePack>(config["resources"]["pack"].get<std::string>());
+        }
+        if (config["resources"].contains("program_cache")) {
+            ProgramCache::instance()->initialize(config["resources"]["program_cache"].get<std::string>());
+        }
+        if (config["resources"].contains("texture_streaming")) {
+            const auto &streaming = config["resources"]["texture_streaming"];
+            if (m_lazy_loading) {
+                m_streamer = std::make_unique<TextureStreamer>(
+                        streaming.value<uint64_t>("budget_mb", 0) * 1024 * 1024,
+                        streaming.value<int32_t>("initial_size", 256),
+                        streaming.value<uint32_t>("drop_delay_frames", 120),
+                        [this](const std::filesystem::path &path, bool flip_uvs) {
+                            return load_image(path, flip_uvs);
+                        });
+            } else {
+                spdlog::warn("[ResourcesController]: resources.texture_streaming requires resources.lazy_loading");
+            }
+        }
+    }
     load_shaders();
-    load_models();
+    if (!m_lazy_loading) {
+        load_models();
+    }
     load_textures();
     load_skyboxes();
+    if (m_lazy_loading && config["resources"].contains("preload")) {
+        for (const auto &group: config["resources"]["preload"]) {
+            preload(group.get<std::string>());
+        }
+    }
+}
+
+void ResourcesController::terminate() {
+    // The loads capture the controller, so the ones still queued or running are waited for.
+    for (auto &pending: m_pending_models) {
+        pending.meshes.wait();
+    }
+    for (auto &pending: m_pending_textures) {
+        pending.image.wait();
+    }
+    for (auto &pending: m_pending_skyboxes) {
+        pending.images.wait();
+    }
+    m_pending_models.clear();
+    m_pending_textures.clear();
+    m_pending_skyboxes.clear();
+    // Publishing writes into the resources, so it happens before they're destroyed.
+    graphics::GLUploadThread::instance()->finish();
+    for (auto &[_, job]: m_compiling) {
+        ShaderCompiler::cancel(job);
+    }
+    m_compiling.clear();
+    m_streamer.reset();
+    for (auto &[_, model]: m_models) {
+        model->destroy();
+    }
+    for (auto &[_, texture]: m_textures) {
+        texture->destroy();
+    }
+    for (auto &[_, skybox]: m_sky_boxes) {
+        skybox->destroy();
+    }
+    for (auto &[_, shader]: m_shaders) {
+        shader->destroy();
+    }
+    if (m_placeholder_texture) {
+        m_placeholder_texture->destroy();
+        m_placeholder_texture.reset();
+    }
+    m_models.clear();
+    m_textures.clear();
+    m_sky_boxes.clear();
+    m_shaders.clear();
+    graphics::OpenGL::destroy_skybox_cube();
+}
+
+void ResourcesController::update() {
+    finish_loads(false);
 }
 
 void ResourcesController::load_shaders() {
-    if (!exists(m_shaders_path)) {
+    const auto shader_paths = list_directory(m_shaders_path);
+    if (shader_paths.empty()) {
         spdlog::info("[ResourcesController]: no {} found to load the shaders from", m_shaders_path.string());
         return;
     }
-    for (const auto &shader_path: std::filesystem::directory_iterator(m_shaders_path)) {
-        const auto name = shader_path.path()
-                                     .stem()
+    for (const auto &shader_path: shader_paths) {
+        // Files in the subdirectories, like "resources/shaders/include", are only included by the shaders.
+        if (shader_path.extension() != ".glsl" || shader_path.parent_path() != m_shaders_path) {
+            continue;
+        }
+        const auto name = shader_path.stem()
                                      .string();
-        shader(name, shader_path);
+        auto &result = m_shaders[name];
+        if (result) {
+            continue;
+        }
+        spdlog::info("load_shader(path={})", shader_path.string());
+        ShaderCompileJob job;
+        if (m_pack) {
+            result = std::make_unique<Shader>(ShaderCompiler::submit_from_source(
+                    name, std::string(m_pack->read(pack_name(shader_path)).text()), shader_path, job,
+                    pack_include_reader()));
+        } else {
+            result = std::make_unique<Shader>(ShaderCompiler::submit_from_file(name, shader_path, job));
+        }
+        m_compiling.emplace(name, std::move(job));
     }
+    spdlog::info("[ResourcesController]: submitted {} shaders", m_compiling.size());
 }
 
 void ResourcesController::load_models() {
-    if (!exists(m_models_path)) {
+    if (list_directory(m_models_path).empty()) {
         spdlog::info("[ResourcesController]: no {} found to load the models from", m_models_path.string());
         return;
     }
@@ -48,32 +155,206 @@ void ResourcesController::load_models() {
 }
 
 void ResourcesController::load_textures() {
-    if (!exists(m_textures_path)) {
+    const auto texture_paths = list_directory(m_textures_path);
+    if (texture_paths.empty()) {
         spdlog::info("[ResourcesController]: no {} found to load the textures from", m_textures_path.string());
         return;
     }
-    for (const auto &texture_entry: std::filesystem::directory_iterator(m_textures_path)) {
-        texture(texture_entry.path()
-                             .stem()
-                             .string(), texture_entry.path());
+    for (const auto &texture_path: texture_paths) {
+        const auto name = texture_path.stem()
+                                      .string();
+        m_texture_paths[name] = texture_path;
+        if (!m_lazy_loading) {
+            texture(name, texture_path);
+        }
     }
 }
 
 void ResourcesController::load_skyboxes() {
-    if (!exists(m_skyboxes_path)) {
+    const auto skybox_paths = list_directory(m_skyboxes_path);
+    if (skybox_paths.empty()) {
         spdlog::info("[ResourcesController]: no {} found to load the skyboxes from", m_skyboxes_path.string());
         return;
     }
-    for (const auto &sky_boxes_entry: std::filesystem::directory_iterator(m_skyboxes_path)) {
-        skybox(sky_boxes_entry.path()
-                              .stem()
-                              .string(), sky_boxes_entry.path());
+    for (const auto &skybox_path: skybox_paths) {
+        const auto name = skybox_path.stem()
+                                     .string();
+        m_skybox_paths[name] = skybox_path;
+        if (!m_lazy_loading) {
+            skybox(name, skybox_path);
+        }
     }
 }
 
+std::vector<std::filesystem::path> ResourcesController::list_directory(const std::filesystem::path &directory) const {
+    std::vector<std::filesystem::path> result;
+    if (m_pack) {
+        for (const auto &name: m_pack->list(pack_name(directory))) {
+            result.push_back(m_resources_path / name);
+        }
+    } else if (exists(directory)) {
+        for (const auto &entry: std::filesystem::directory_iterator(directory)) {
+            result.push_back(entry.path());
+        }
+    }
+    return result;
+}
+
+std::string ResourcesController::pack_name(const std::filesystem::path &path) const {
+    return path.lexically_normal()
+               .lexically_relative(m_resources_path)
+               .generic_string();
+}
+
+graphics::TextureImage ResourcesController::load_image(const std::filesystem::path &path, bool flip_uvs) const {
+    if (!m_pack) {
+        return graphics::OpenGL::load_image(path, flip_uvs);
+    }
+    const auto file = m_pack->read(pack_name(path));
+    return graphics::OpenGL::decode_image(file.data(), path, flip_uvs);
+}
+
+graphics::CubemapImages ResourcesController::load_skybox_images(const std::filesystem::path &path,
+                                                                bool flip_uvs) const {
+    if (!m_pack) {
+        return graphics::OpenGL::load_skybox_images(path, flip_uvs);
+    }
+    graphics::CubemapImages images;
+    for (const auto &face_path: list_directory(path)) {
+        images[graphics::OpenGL::cubemap_face_index(face_path.stem()
+                                                             .string())] = load_image(face_path, flip_uvs);
+    }
+    return images;
+}
+
+/**
+ * @class BufferIOStream
+ * @brief Assimp stream over a file that is already in memory: a @ref PackedFile or a @ref util::FileBuffer.
+ */
+template<typename TBuffer>
+class BufferIOStream final : public Assimp::IOStream {
+public:
+    explicit BufferIOStream(TBuffer file) : m_file(std::move(file)) {
+    }
+
+    size_t Read(void *buffer, size_t size, size_t count) override {
+        const auto data = m_file.data();
+        if (size == 0) {
+            return 0;
+        }
+        const size_t items = std::min(count, (data.size() - m_position) / size);
+        std::memcpy(buffer, data.data() + m_position, items * size);
+        m_position += items * size;
+        return items;
+    }
+
+    size_t Write(const void *, size_t, size_t) override {
+        return 0;
+    }
+
+    aiReturn Seek(size_t offset, aiOrigin origin) override {
+        size_t position = offset;
+        if (origin == aiOrigin_CUR) {
+            position = m_position + offset;
+        } else if (origin == aiOrigin_END) {
+            position = FileSize() - offset;
+        }
+        if (position > FileSize()) {
+            return aiReturn_FAILURE;
+        }
+        m_position = position;
+        return aiReturn_SUCCESS;
+    }
+
+    size_t Tell() const override {
+        return m_position;
+    }
+
+    size_t FileSize() const override {
+        return m_file.data()
+                     .size();
+    }
+
+    void Flush() override {
+    }
+
+private:
+    TBuffer m_file;
+    size_t m_position{0};
+};
+
+/**
+ * @class PackIOSystem
+ * @brief Lets assimp open a model and the files it references (.mtl, .bin) from the @ref ResourcePack.
+ */
+class PackIOSystem final : public Assimp::IOSystem {
+public:
+    explicit PackIOSystem(const ResourcePack *pack) : m_pack(pack) {
+    }
+
+    bool Exists(const char *file) const override {
+        return m_pack->contains(normalize(file));
+    }
+
+    char getOsSeparator() const override {
+        return '/';
+    }
+
+    Assimp::IOStream *Open(const char *file, const char *mode) override {
+        const auto name = normalize(file);
+        if (std::string_view(mode).find_first_of("wa+") != std::string_view::npos || !m_pack->contains(name)) {
+            return nullptr;
+        }
+        return new BufferIOStream<PackedFile>(m_pack->read(name));
+    }
+
+    void Close(Assimp::IOStream *file) override {
+        delete file;
+    }
+
+private:
+    static std::string normalize(const char *file) {
+        return std::filesystem::path(file).lexically_normal()
+                                          .generic_string();
+    }
+
+    const ResourcePack *m_pack;
+};
+
+/**
+ * @class FileIOSystem
+ * @brief Lets assimp read the model and the files it references through the @ref util::IOService,
+ * parsing from memory instead of doing its own blocking reads.
+ */
+class FileIOSystem final : public Assimp::IOSystem {
+public:
+    bool Exists(const char *file) const override {
+        return std::filesystem::is_regular_file(file);
+    }
+
+    char getOsSeparator() const override {
+        return static_cast<char>(std::filesystem::path::preferred_separator);
+    }
+
+    Assimp::IOStream *Open(const char *file, const char *mode) override {
+        if (std::string_view(mode).find_first_of("wa+") != std::string_view::npos || !Exists(file)) {
+            return nullptr;
+        }
+        try {
+            return new BufferIOStream<util::FileBuffer>(util::IOService::instance()->read_file(file));
+        } catch (const util::EngineError &) {
+            return nullptr;
+        }
+    }
+
+    void Close(Assimp::IOStream *file) override {
+        delete file;
+    }
+};
+
 /**
  * @class AssimpSceneProcessor
- * @brief Processes the meshes in an Assimp scene.
+ * @brief Processes the meshes in an Assimp scene into client memory.
  */
 class AssimpSceneProcessor {
 public:
@@ -81,11 +362,10 @@ public:
      * @brief Processes the meshes in the scene.
      * @returns The meshes in the scene.
      */
-    std::vector<Mesh> process_meshes();
+    std::vector<MeshData> process_meshes();
 
-    explicit AssimpSceneProcessor(ResourcesController *resources_controller, const aiScene *scene,
-                                  std::filesystem::path model_path) :
-            m_scene(scene), m_model_path(std::move(model_path)), m_resources_controller(resources_controller) {
+    explicit AssimpSceneProcessor(const aiScene *scene, std::filesystem::path model_path) :
+            m_scene(scene), m_model_path(std::move(model_path)) {
     }
 
 private:
@@ -93,16 +373,16 @@ private:
 
     void process_mesh(aiMesh *mesh);
 
-    std::vector<Texture *> process_materials(const aiMaterial *material);
+    std::vector<std::pair<std::filesystem::path, TextureType> > process_materials(const aiMaterial *material);
 
-    void process_material_type(std::vector<Texture *> &textures, const aiMaterial *material, aiTextureType type);
+    void process_material_type(std::vector<std::pair<std::filesystem::path, TextureType> > &textures,
+                               const aiMaterial *material, aiTextureType type);
 
     static TextureType assimp_texture_type_to_engine(aiTextureType type);
 
-    std::vector<Mesh> m_meshes;
+    std::vector<MeshData> m_meshes;
     const aiScene *m_scene;
     std::filesystem::path m_model_path;
-    ResourcesController *m_resources_controller;
 };
 
 Model *ResourcesController::model(
@@ -119,28 +399,252 @@ Model *ResourcesController::model(
                                            std::filesystem::path(
                                                    config["resources"]["models"][name]["path"].get<
                                                            std::string>());
-        Assimp::Importer importer;
-        int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals |
-                    aiProcess_CalcTangentSpace;
-        if (config["resources"]["models"][name].value<bool>("flip_uvs", false)) {
-            flags |= aiProcess_FlipUVs;
+        bool flip_uvs = config["resources"]["models"][name].value<bool>("flip_uvs", false);
+        bool hit_test = config["resources"]["models"][name].value<bool>("hit_test", false);
+        if (m_lazy_loading) {
+            result = std::make_unique<Model>(Model({}, model_path, name));
+            load_model_async(result.get(), flip_uvs, hit_test);
+        } else {
+            result = std::make_unique<Model>(
+                    Model(create_meshes(import_meshes(name, model_path, flip_uvs, hit_test)), model_path, name));
         }
+        result->m_reload = [this, model = result.get(), flip_uvs, hit_test] {
+            if (m_lazy_loading) {
+                load_model_async(model, flip_uvs, hit_test);
+                return;
+            }
+            model->m_meshes = create_meshes(import_meshes(model->name(), model->path(), flip_uvs, hit_test));
+        };
+    }
+    return result.get();
+}
 
-        spdlog::info("load_model(name={}, path={})", name, model_path.string());
-        const aiScene *scene =
-                importer.ReadFile(model_path, flags);
+void ResourcesController::load_model_async(Model *model, bool flip_uvs, bool hit_test) {
+    model->m_meshes = placeholder_meshes();
+    model->m_loaded = false;
+    m_pending_models.push_back(PendingModel{
+            .model = model,
+            .meshes = util::WorkerPool::instance()->async(
+                    [this, name = model->name(), model_path = model->path(), flip_uvs, hit_test] {
+                        return import_meshes(name, model_path, flip_uvs, hit_test);
+                    }),
+    });
+}
 
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-            throw util::EngineError(util::EngineError::Type::AssetLoadingError,
-                                    std::format("Assimp error while reading model: {} from path {}.",
-                                                model_path.string(), name));
+/**
+* @brief Header of the triangle hierarchies cached next to a model file, followed by one @ref TriangleBvh per mesh.
+* The size and the modification time of the model tell when the cache is stale. The hierarchies refer to the
+* triangles by their place in the index buffers, which @ref Meshlet::build reorders, so a hash of the indices
+* tells when the order changed without the model changing.
+*/
+struct TriangleBvhFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_size;
+    int64_t source_time;
+    uint64_t index_hash;
+    uint32_t mesh_count;
+};
+
+static constexpr char TRIANGLE_BVH_FILE_MAGIC[4] = {'R', 'G', 'H', 'T'};
+static constexpr uint32_t TRIANGLE_BVH_FILE_VERSION = 2;
+
+static uint64_t hash_indices(const std::vector<MeshData> &meshes) {
+    uint64_t result = 0;
+    for (const auto &mesh: meshes) {
+        const std::string_view bytes(reinterpret_cast<const char *>(mesh.indices.data()),
+                                     mesh.indices.size() * sizeof(uint32_t));
+        result = result * 1099511628211ull ^ ResourcePack::hash(bytes);
+    }
+    return result;
+}
+
+/**
+* @brief Builds the @ref TriangleBvh of every mesh, or reads them from `<model file>.bvh` if it's up to date.
+* Models in a pack can't be written next to, so their hierarchies are always built.
+*/
+static void attach_triangle_bvhs(std::vector<MeshData> &meshes, const std::filesystem::path &model_path,
+                                 bool cached) {
+    TriangleBvhFileHeader header{.version = TRIANGLE_BVH_FILE_VERSION,
+                                 .mesh_count = static_cast<uint32_t>(meshes.size())};
+    std::memcpy(header.magic, TRIANGLE_BVH_FILE_MAGIC, sizeof(TRIANGLE_BVH_FILE_MAGIC));
+    auto path = model_path;
+    path += ".bvh";
+    std::error_code error;
+    if (cached) {
+        header.source_size = std::filesystem::file_size(model_path, error);
+        header.source_time = std::filesystem::last_write_time(model_path, error).time_since_epoch().count();
+        header.index_hash = hash_indices(meshes);
+        cached = !error;
+    }
+    if (cached) {
+        std::ifstream in(path, std::ios::binary);
+        TriangleBvhFileHeader stored{};
+        in.read(reinterpret_cast<char *>(&stored), sizeof(stored));
+        if (in && std::memcmp(stored.magic, header.magic, sizeof(header.magic)) == 0 &&
+            stored.version == header.version && stored.source_size == header.source_size &&
+            stored.source_time == header.source_time && stored.index_hash == header.index_hash &&
+            stored.mesh_count == header.mesh_count) {
+            std::vector<std::shared_ptr<const TriangleBvh>> loaded;
+            for (const auto &mesh: meshes) {
+                auto bvh = TriangleBvh::load(in, mesh.vertices, mesh.indices);
+                if (!bvh) {
+                    break;
+                }
+                loaded.push_back(std::move(bvh));
+            }
+            if (loaded.size() == meshes.size()) {
+                for (size_t i = 0; i < meshes.size(); ++i) {
+                    meshes[i].triangles = std::move(loaded[i]);
+                }
+                return;
+            }
         }
-        AssimpSceneProcessor scene_processor(this, scene, model_path);
-        std::vector<Mesh> meshes = scene_processor.process_meshes();
-        result = std::make_unique<Model>(Model(std::move(meshes), model_path,
-                                               name));
     }
-    return result.get();
+
+    for (auto &mesh: meshes) {
+        mesh.triangles = TriangleBvh::build(mesh.vertices, mesh.indices);
+    }
+    // Meshes without triangles get no hierarchy, and a cache of them couldn't be read back.
+    if (!cached || std::ranges::any_of(meshes, [](const MeshData &mesh) { return !mesh.triangles; })) {
+        return;
+    }
+    // Written under a temporary name, so that a crash never leaves a truncated cache behind.
+    auto temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const auto &mesh: meshes) {
+            mesh.triangles->save(out);
+        }
+        if (!out) {
+            spdlog::warn("[ResourcesController]: failed to write {}", temporary.string());
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        spdlog::warn("[ResourcesController]: failed to write {}: {}", path.string(), error.message());
+    }
+}
+
+std::vector<MeshData> ResourcesController::import_meshes(const std::string &name,
+                                                         const std::filesystem::path &model_path,
+                                                         bool flip_uvs, bool hit_test) const {
+    Assimp::Importer importer;
+    int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+                aiProcess_CalcTangentSpace;
+    if (flip_uvs) {
+        flags |= aiProcess_FlipUVs;
+    }
+
+    spdlog::info("load_model(name={}, path={})", name, model_path.string());
+    // The importer owns the IO handler.
+    if (m_pack) {
+        importer.SetIOHandler(new PackIOSystem(m_pack.get()));
+    } else {
+        importer.SetIOHandler(new FileIOSystem());
+    }
+    const aiScene *scene =
+            importer.ReadFile(m_pack ? pack_name(model_path) : model_path.string(), flags);
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        throw util::EngineError(util::EngineError::Type::AssetLoadingError,
+                                std::format("Assimp error while reading model: {} from path {}.",
+                                            model_path.string(), name));
+    }
+    AssimpSceneProcessor scene_processor(scene, model_path);
+    auto meshes = scene_processor.process_meshes();
+    if (hit_test) {
+        attach_triangle_bvhs(meshes, model_path, !m_pack);
+    }
+    return meshes;
+}
+
+std::vector<Mesh> ResourcesController::create_meshes(std::vector<MeshData> meshes) {
+    std::vector<Mesh> result;
+    result.reserve(meshes.size());
+    for (auto &mesh: meshes) {
+        std::vector<Texture *> textures;
+        textures.reserve(mesh.textures.size());
+        for (const auto &[path, type]: mesh.textures) {
+            textures.push_back(texture(path.string(), path, type));
+        }
+        auto buffers = Mesh::upload(mesh.vertices, mesh.indices);
+        buffers.meshlets = std::move(mesh.meshlets);
+        buffers.triangles = std::move(mesh.triangles);
+        result.emplace_back(Mesh(std::move(buffers), std::move(textures)));
+    }
+    return result;
+}
+
+void ResourcesController::submit_meshes(Model *model, std::vector<MeshData> meshes) {
+    struct Upload {
+        std::vector<MeshData> meshes;
+        std::vector<std::vector<Texture *> > textures;
+        std::vector<MeshBuffers> buffers;
+    };
+    auto upload = std::make_shared<Upload>();
+    // Textures are resolved here, since resolving them can start loads of their own.
+    for (const auto &mesh: meshes) {
+        auto &textures = upload->textures.emplace_back();
+        textures.reserve(mesh.textures.size());
+        for (const auto &[path, type]: mesh.textures) {
+            textures.push_back(texture(path.string(), path, type));
+        }
+    }
+    upload->meshes = std::move(meshes);
+    ++m_publishing;
+    graphics::GLUploadThread::instance()->submit(
+            [upload] {
+                upload->buffers.reserve(upload->meshes.size());
+                for (auto &mesh: upload->meshes) {
+                    upload->buffers.push_back(Mesh::upload(mesh.vertices, mesh.indices));
+                    upload->buffers.back().meshlets = std::move(mesh.meshlets);
+                    upload->buffers.back().triangles = std::move(mesh.triangles);
+                }
+                upload->meshes.clear();
+            },
+            [this, upload, model] {
+                --m_publishing;
+                model->destroy();
+                model->m_meshes.clear();
+                model->m_meshes.reserve(upload->buffers.size());
+                for (size_t i = 0; i < upload->buffers.size(); ++i) {
+                    model->m_meshes.emplace_back(Mesh(std::move(upload->buffers[i]), std::move(upload->textures[i])));
+                }
+                model->m_loaded = true;
+            });
+}
+
+std::vector<Mesh> ResourcesController::placeholder_meshes() {
+    if (!m_placeholder_texture) {
+        m_placeholder_texture = std::make_unique<Texture>(Texture(graphics::OpenGL::generate_placeholder_texture(),
+                                                                  TextureType::Diffuse, "", "placeholder"));
+    }
+    // Unit box centered at the origin, with a face per side so that the normals are flat.
+    const glm::vec3 normals[] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (const auto &normal: normals) {
+        const glm::vec3 tangent = normal.x != 0 ? glm::vec3(0, 0, -normal.x) : glm::vec3(1, 0, 0);
+        const glm::vec3 bitangent = glm::cross(normal, tangent);
+        const auto first = static_cast<uint32_t>(vertices.size());
+        for (const auto &corner: {glm::vec2(-1, -1), glm::vec2(1, -1), glm::vec2(1, 1), glm::vec2(-1, 1)}) {
+            Vertex vertex{};
+            vertex.Position = 0.5f * (normal + corner.x * tangent + corner.y * bitangent);
+            vertex.Normal = normal;
+            vertex.TexCoords = 0.5f * (corner + glm::vec2(1));
+            vertex.Tangent = tangent;
+            vertex.Bitangent = bitangent;
+            vertices.push_back(vertex);
+        }
+        indices.insert(indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+    }
+    std::vector<Mesh> result;
+    result.emplace_back(Mesh(vertices, indices, {m_placeholder_texture.get()}));
+    return result;
 }
 
 Texture *ResourcesController::texture(const std::string &name,
@@ -148,36 +652,366 @@ Texture *ResourcesController::texture(const std::string &name,
                                       TextureType type, bool flip_uvs) {
     auto &result = m_textures[name];
     if (!result) {
-        spdlog::info("load_texture(path={})", path.string());
-        result = std::make_unique<Texture>(Texture(graphics::OpenGL::generate_texture(path, flip_uvs), type, path,
-                                                   path.stem()));
+        auto texture_path = path;
+        if (texture_path.empty()) {
+            auto it = m_texture_paths.find(name);
+            if (it == m_texture_paths.end()) {
+                m_textures.erase(name);
+                throw util::EngineError(util::EngineError::Type::AssetLoadingError,
+                                        std::format("No texture ({}) found in {}.", name, m_textures_path.string()));
+            }
+            texture_path = it->second;
+        }
+        spdlog::info("load_texture(path={})", texture_path.string());
+        if (m_lazy_loading) {
+            result = std::make_unique<Texture>(Texture({}, type, texture_path, texture_path.stem()));
+            load_texture_async(result.get(), flip_uvs);
+        } else {
+            result = std::make_unique<Texture>(Texture(
+                    graphics::OpenGL::upload_texture(load_image(texture_path, flip_uvs)),
+                    type, texture_path, texture_path.stem()));
+        }
+        result->m_reload = [this, texture = result.get(), flip_uvs] {
+            if (m_lazy_loading) {
+                load_texture_async(texture, flip_uvs);
+                return;
+            }
+            texture->m_texture = graphics::OpenGL::upload_texture(load_image(texture->path(), flip_uvs));
+        };
     }
     return result.get();
 }
 
+void ResourcesController::load_texture_async(Texture *texture, bool flip_uvs) {
+    texture->m_texture = graphics::OpenGL::generate_placeholder_texture();
+    texture->m_loaded = false;
+    m_pending_textures.push_back(PendingTexture{
+            .texture = texture,
+            .flip_uvs = flip_uvs,
+            .image = util::WorkerPool::instance()->async([this, texture_path = texture->path(), flip_uvs] {
+                return graphics::TextureUploader::prepare(load_image(texture_path, flip_uvs));
+            }),
+    });
+}
+
 Skybox *ResourcesController::skybox(const std::string &name,
                                     const std::filesystem::path &path,
                                     bool flip_uvs) {
     auto &result = m_sky_boxes[name];
     if (!result) {
-        spdlog::info("load_skybox(path={})", path.string());
-        result = std::make_unique<Skybox>(Skybox(graphics::OpenGL::init_skybox_cube(),
-                                                 graphics::OpenGL::load_skybox_textures(path, flip_uvs),
-                                                 path, name));
+        auto skybox_path = path;
+        if (skybox_path.empty()) {
+            auto it = m_skybox_paths.find(name);
+            if (it == m_skybox_paths.end()) {
+                m_sky_boxes.erase(name);
+                throw util::EngineError(util::EngineError::Type::AssetLoadingError,
+                                        std::format("No skybox ({}) found in {}.", name, m_skyboxes_path.string()));
+            }
+            skybox_path = it->second;
+        }
+        spdlog::info("load_skybox(path={})", skybox_path.string());
+        if (m_lazy_loading) {
+            result = std::make_unique<Skybox>(Skybox(0, {}, skybox_path, name));
+            load_skybox_async(result.get(), flip_uvs);
+        } else {
+            result = std::make_unique<Skybox>(Skybox(graphics::OpenGL::init_skybox_cube(),
+                                                     graphics::OpenGL::upload_cubemap(
+                                                             load_skybox_images(skybox_path, flip_uvs), skybox_path),
+                                                     skybox_path, name));
+        }
+        result->m_reload = [this, skybox = result.get(), flip_uvs] {
+            if (m_lazy_loading) {
+                load_skybox_async(skybox, flip_uvs);
+                return;
+            }
+            skybox->m_vao = graphics::OpenGL::init_skybox_cube();
+            skybox->m_texture = graphics::OpenGL::upload_cubemap(load_skybox_images(skybox->m_path, flip_uvs),
+                                                                 skybox->m_path);
+        };
     }
     return result.get();
 }
 
+void ResourcesController::load_skybox_async(Skybox *skybox, bool flip_uvs) {
+    skybox->m_vao = graphics::OpenGL::init_skybox_cube();
+    skybox->m_texture = graphics::OpenGL::generate_placeholder_cubemap();
+    skybox->m_loaded = false;
+    m_pending_skyboxes.push_back(PendingSkybox{
+            .skybox = skybox,
+            .images = util::WorkerPool::instance()->async([this, skybox_path = skybox->m_path, flip_uvs] {
+                return load_skybox_images(skybox_path, flip_uvs);
+            }),
+    });
+}
+
+void ResourcesController::finish_loads(bool wait) {
+    auto ready = [wait](auto &future) {
+        if (wait) {
+            future.wait();
+            return true;
+        }
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    finish_shaders(wait);
+    auto upload_thread = graphics::GLUploadThread::instance();
+    // Models go first, since uploading their meshes can request more textures.
+    for (size_t i = 0; i < m_pending_models.size();) {
+        auto &pending = m_pending_models[i];
+        if (!ready(pending.meshes)) {
+            ++i;
+            continue;
+        }
+        auto meshes = pending.meshes.get();
+        Model *model = pending.model;
+        m_pending_models.erase(m_pending_models.begin() + static_cast<std::ptrdiff_t>(i));
+        if (upload_thread->running()) {
+            submit_meshes(model, std::move(meshes));
+            continue;
+        }
+        model->destroy();
+        model->m_meshes = create_meshes(std::move(meshes));
+        model->m_loaded = true;
+    }
+    for (size_t i = 0; i < m_pending_textures.size();) {
+        auto &pending = m_pending_textures[i];
+        if (!ready(pending.image)) {
+            ++i;
+            continue;
+        }
+        if (m_streamer) {
+            // Streamed textures stay with the budgeted uploader, which swaps their levels in place.
+            m_streamer->track(pending.texture, pending.image.get(), pending.flip_uvs);
+        } else if (upload_thread->running()) {
+            auto image = std::make_shared<graphics::StreamedImage>(pending.image.get());
+            auto result = std::make_shared<graphics::GLTexture>();
+            ++m_publishing;
+            upload_thread->submit(
+                    [image, result] {
+                        *result = graphics::TextureUploader::upload_levels(*image);
+                        image->levels.clear();
+                    },
+                    [this, result, texture = pending.texture] {
+                        --m_publishing;
+                        texture->m_texture = std::move(*result);
+                        texture->m_loaded = true;
+                    });
+            m_pending_textures.erase(m_pending_textures.begin() + static_cast<std::ptrdiff_t>(i));
+            continue;
+        } else {
+            pending.texture->m_texture = graphics::TextureUploader::instance()->upload(pending.image.get());
+        }
+        pending.texture->m_loaded = true;
+        m_pending_textures.erase(m_pending_textures.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+    for (size_t i = 0; i < m_pending_skyboxes.size();) {
+        auto &pending = m_pending_skyboxes[i];
+        if (!ready(pending.images)) {
+            ++i;
+            continue;
+        }
+        if (upload_thread->running()) {
+            auto images = std::make_shared<graphics::CubemapImages>(pending.images.get());
+            auto result = std::make_shared<graphics::GLTexture>();
+            ++m_publishing;
+            upload_thread->submit(
+                    [images, result, path = pending.skybox->m_path] {
+                        *result = graphics::OpenGL::upload_cubemap(*images, path);
+                        *images = {};
+                    },
+                    [this, result, skybox = pending.skybox] {
+                        --m_publishing;
+                        skybox->m_texture = std::move(*result);
+                        skybox->m_loaded = true;
+                    });
+        } else {
+            pending.skybox->m_texture = graphics::TextureUploader::instance()->upload_cubemap(pending.images.get(),
+                                                                                              pending.skybox->m_path);
+            pending.skybox->m_loaded = true;
+        }
+        m_pending_skyboxes.erase(m_pending_skyboxes.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+    if (wait) {
+        upload_thread->finish();
+    } else {
+        upload_thread->process();
+    }
+}
+
+static const util::Configuration::json &preload_group(const std::string &group) {
+    const auto &config = util::Configuration::config();
+    if (!config.contains("resources") || !config["resources"].contains("preload_groups") ||
+        !config["resources"]["preload_groups"].contains(group)) {
+        throw util::EngineError(util::EngineError::Type::ConfigurationError, std::format(
+                "No preload group ({}) in resources.preload_groups in the config.json. See the example in the README.md",
+                group));
+    }
+    return config["resources"]["preload_groups"][group];
+}
+
+void ResourcesController::request(const std::string &group) {
+    const auto &entries = preload_group(group);
+    for (const auto &name: entries.value("models", util::Configuration::json::array())) {
+        model(name.get<std::string>());
+    }
+    for (const auto &name: entries.value("textures", util::Configuration::json::array())) {
+        texture(name.get<std::string>());
+    }
+    for (const auto &name: entries.value("skyboxes", util::Configuration::json::array())) {
+        skybox(name.get<std::string>());
+    }
+}
+
+void ResourcesController::preload(const std::string &group) {
+    request(group);
+    // Uploading a model can start loading its textures, so wait until nothing is left.
+    while (pending_loads() > 0) {
+        finish_loads(true);
+    }
+    graphics::TextureUploader::instance()->flush();
+    spdlog::info("[ResourcesController]: preloaded group {}", group);
+}
+
+bool ResourcesController::group_ready(const std::string &group) {
+    const auto &entries = preload_group(group);
+    auto loaded = [](const auto &resources, const std::string &name) {
+        auto it = resources.find(name);
+        return it != resources.end() && it->second->loaded();
+    };
+    for (const auto &name: entries.value("models", util::Configuration::json::array())) {
+        if (!loaded(m_models, name.get<std::string>())) {
+            return false;
+        }
+        for (const auto &mesh: m_models[name.get<std::string>()]->meshes()) {
+            for (const auto *mesh_texture: mesh.m_textures) {
+                if (!mesh_texture->loaded()) {
+                    return false;
+                }
+            }
+        }
+    }
+    for (const auto &name: entries.value("textures", util::Configuration::json::array())) {
+        if (!loaded(m_textures, name.get<std::string>())) {
+            return false;
+        }
+    }
+    for (const auto &name: entries.value("skyboxes", util::Configuration::json::array())) {
+        if (!loaded(m_sky_boxes, name.get<std::string>())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t ResourcesController::resident_bytes() const {
+    uint64_t result = 0;
+    for (const auto &[_, model]: m_models) { result += model->gpu_bytes(); }
+    for (const auto &[_, texture]: m_textures) { result += texture->gpu_bytes(); }
+    for (const auto &[_, skybox]: m_sky_boxes) { result += skybox->gpu_bytes(); }
+    return result;
+}
+
+void ResourcesController::use(const Resource *resource) {
+    resource->m_last_used_frame = m_frame;
+    if (!resource->m_resident) {
+        resource->m_reload();
+        resource->m_resident = true;
+    }
+}
+
+void Resource::use() const {
+    core::Controller::get<ResourcesController>()->use(this);
+}
+
+void ResourcesController::end_draw() {
+    defer { ++m_frame; };
+    if (m_streamer) {
+        m_streamer->update();
+    }
+    if (m_gpu_budget == 0) {
+        return;
+    }
+    uint64_t resident = resident_bytes();
+    if (resident <= m_gpu_budget) {
+        m_over_budget = false;
+        return;
+    }
+
+    struct Candidate {
+        std::string_view name;
+        Resource *resource;
+    };
+    std::vector<Candidate> candidates;
+    auto collect = [&](auto &resources) {
+        for (auto &[name, resource]: resources) {
+            // Resources that are still loading only hold their placeholder, so there's nothing to evict.
+            if (resource->m_loaded && resource->m_resident && resource->m_references == 0 &&
+                resource->m_last_used_frame < m_frame) {
+                candidates.push_back(Candidate{name, resource.get()});
+            }
+        }
+    };
+    collect(m_models);
+    collect(m_textures);
+    collect(m_sky_boxes);
+    std::ranges::sort(candidates, [](const Candidate &a, const Candidate &b) {
+        return a.resource->m_last_used_frame < b.resource->m_last_used_frame;
+    });
+
+    for (const auto &candidate: candidates) {
+        if (resident <= m_gpu_budget) {
+            break;
+        }
+        const uint64_t bytes = candidate.resource->gpu_bytes();
+        spdlog::info("[ResourcesController]: evicting {} ({} bytes, last used in frame {})", candidate.name, bytes,
+                     candidate.resource->m_last_used_frame);
+        candidate.resource->destroy();
+        candidate.resource->m_resident = false;
+        resident -= bytes;
+    }
+    if (resident > m_gpu_budget && !m_over_budget) {
+        spdlog::warn("[ResourcesController]: {} bytes resident, over the {} bytes budget after eviction", resident,
+                     m_gpu_budget);
+    }
+    m_over_budget = resident > m_gpu_budget;
+}
+
 Shader *ResourcesController::shader(const std::string &name, const std::filesystem::path &path) {
     auto &result = m_shaders[name];
     if (!result) {
         spdlog::info("load_shader(path={})", path.string());
-        result = std::make_unique<Shader>(ShaderCompiler::compile_from_file(name, path));
+        if (m_pack) {
+            result = std::make_unique<Shader>(ShaderCompiler::compile_from_source(
+                    name, std::string(m_pack->read(pack_name(path)).text()), path, pack_include_reader()));
+        } else {
+            result = std::make_unique<Shader>(ShaderCompiler::compile_from_file(name, path));
+        }
+    } else if (auto compiling = m_compiling.find(name); compiling != m_compiling.end()) {
+        auto job = std::move(compiling->second);
+        m_compiling.erase(compiling);
+        ShaderCompiler::finish(job);
     }
     return result.get();
 }
 
-std::vector<Mesh> AssimpSceneProcessor::process_meshes() {
+ShaderCompiler::IncludeReader ResourcesController::pack_include_reader() const {
+    return [this](const std::filesystem::path &path) {
+        return std::string(m_pack->read(pack_name(path)).text());
+    };
+}
+
+void ResourcesController::finish_shaders(bool wait) {
+    for (auto it = m_compiling.begin(); it != m_compiling.end();) {
+        if (!wait && !ShaderCompiler::completed(it->second)) {
+            ++it;
+            continue;
+        }
+        auto job = std::move(it->second);
+        it = m_compiling.erase(it);
+        ShaderCompiler::finish(job);
+    }
+}
+
+std::vector<MeshData> AssimpSceneProcessor::process_meshes() {
     m_meshes.clear();
     process_node(m_scene->mRootNode);
     return std::move(m_meshes);
@@ -246,13 +1080,20 @@ void AssimpSceneProcessor::process_mesh(aiMesh *mesh) {
         }
     }
 
+    // Splitting reorders the indices, so it's done once here rather than on every upload.
+    auto meshlets = Meshlet::build(vertices, indices);
     auto material = m_scene->mMaterials[mesh->mMaterialIndex];
-    std::vector<Texture *> textures = process_materials(material);
-    m_meshes.emplace_back(Mesh(vertices, indices, std::move(textures)));
+    m_meshes.push_back(MeshData{
+            .vertices = std::move(vertices),
+            .indices = std::move(indices),
+            .textures = process_materials(material),
+            .meshlets = std::move(meshlets),
+    });
 }
 
-std::vector<Texture *> AssimpSceneProcessor::process_materials(const aiMaterial *material) {
-    std::vector<Texture *> textures;
+std::vector<std::pair<std::filesystem::path, TextureType> > AssimpSceneProcessor::process_materials(
+        const aiMaterial *material) {
+    std::vector<std::pair<std::filesystem::path, TextureType> > textures;
     auto ai_texture_types = {
             aiTextureType_DIFFUSE,
             aiTextureType_SPECULAR,
@@ -266,16 +1107,14 @@ std::vector<Texture *> AssimpSceneProcessor::process_materials(const aiMaterial
     return textures;
 }
 
-void AssimpSceneProcessor::process_material_type(std::vector<Texture *> &textures, const aiMaterial *material,
-                                                 aiTextureType type) {
+void AssimpSceneProcessor::process_material_type(std::vector<std::pair<std::filesystem::path, TextureType> > &textures,
+                                                 const aiMaterial *material, aiTextureType type) {
     auto material_count = material->GetTextureCount(type);
     for (uint32_t i = 0; i < material_count; ++i) {
         aiString ai_texture_path_string;
         material->GetTexture(type, i, &ai_texture_path_string);
         std::filesystem::path texture_path = m_model_path.parent_path() / ai_texture_path_string.C_Str();
-        Texture *texture = m_resources_controller->texture(texture_path.string(), texture_path,
-                                                           assimp_texture_type_to_engine(type));
-        textures.emplace_back(texture);
+        textures.emplace_back(texture_path, assimp_texture_type_to_engine(type));
     }
 }
 
@@ -0,0 +1,582 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <engine/util/Errors.hpp>
+#include <engine/util/SceneBvh.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RG_SCENE_BVH_SSE2 1
+#endif
+
+namespace engine::util {
+
+/**
+* @brief Bins of the centroids along the split axis; more bins find slightly better splits for a longer build.
+*/
+static constexpr uint32_t SAH_BINS = 12;
+
+/**
+* @brief Marks a node on the traversal stack of @ref SceneBvh::query_frustum as entirely inside the frustum.
+*/
+static constexpr uint32_t INSIDE_BIT = 1u << 31;
+
+uint32_t SceneBvh::allocate_node() {
+    if (!m_free_nodes.empty()) {
+        const uint32_t node = m_free_nodes.back();
+        m_free_nodes.pop_back();
+        m_nodes[node] = Node{};
+        return node;
+    }
+    m_nodes.emplace_back();
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void SceneBvh::free_node(uint32_t node) {
+    m_nodes[node] = Node{};
+    m_free_nodes.push_back(node);
+}
+
+uint32_t SceneBvh::insert(const Aabb &box, uint64_t user_data) {
+    uint32_t proxy;
+    if (!m_free_proxies.empty()) {
+        proxy = m_free_proxies.back();
+        m_free_proxies.pop_back();
+    } else {
+        proxy = static_cast<uint32_t>(m_proxies.size());
+        m_proxies.emplace_back();
+    }
+    const uint32_t leaf = allocate_node();
+    m_nodes[leaf].box = box;
+    m_nodes[leaf].proxy = proxy;
+    m_proxies[proxy] = Proxy{.box = box, .user_data = user_data, .leaf = leaf};
+    insert_leaf(leaf);
+    ++m_size;
+    return proxy;
+}
+
+void SceneBvh::move(uint32_t proxy, const Aabb &box) {
+    RG_GUARANTEE(proxy < m_proxies.size() && m_proxies[proxy].leaf != NONE, "Moving a removed proxy {}.", proxy);
+    const uint32_t leaf = m_proxies[proxy].leaf;
+    m_proxies[proxy].box = box;
+    const uint32_t parent = m_nodes[leaf].parent;
+    // An object that jumped away from its siblings would stretch all the ancestors, so it's reinserted instead.
+    if (parent != NONE && !m_nodes[parent].box.overlaps(box)) {
+        remove_leaf(leaf);
+        m_nodes[leaf].box = box;
+        insert_leaf(leaf);
+        return;
+    }
+    m_nodes[leaf].box = box;
+    refit(parent);
+}
+
+void SceneBvh::remove(uint32_t proxy) {
+    RG_GUARANTEE(proxy < m_proxies.size() && m_proxies[proxy].leaf != NONE, "Removing a removed proxy {}.", proxy);
+    const uint32_t leaf = m_proxies[proxy].leaf;
+    remove_leaf(leaf);
+    free_node(leaf);
+    m_proxies[proxy] = Proxy{};
+    m_free_proxies.push_back(proxy);
+    --m_size;
+}
+
+void SceneBvh::build() {
+    std::vector<uint32_t> proxies;
+    proxies.reserve(m_size);
+    for (uint32_t proxy = 0; proxy < m_proxies.size(); ++proxy) {
+        if (m_proxies[proxy].leaf != NONE) {
+            proxies.push_back(proxy);
+        }
+    }
+    m_nodes.clear();
+    m_free_nodes.clear();
+    m_nodes.reserve(2 * proxies.size());
+    m_root = proxies.empty() ? NONE : build_range(proxies, 0, static_cast<uint32_t>(proxies.size()), NONE);
+}
+
+uint32_t SceneBvh::build_range(std::vector<uint32_t> &proxies, uint32_t begin, uint32_t end, uint32_t parent) {
+    const uint32_t index = allocate_node();
+    m_nodes[index].parent = parent;
+    if (end - begin == 1) {
+        const uint32_t proxy = proxies[begin];
+        m_nodes[index].box = m_proxies[proxy].box;
+        m_nodes[index].proxy = proxy;
+        m_proxies[proxy].leaf = index;
+        return index;
+    }
+
+    Aabb centroids;
+    for (uint32_t i = begin; i < end; ++i) {
+        centroids.grow(m_proxies[proxies[i]].box.center());
+    }
+    const glm::vec3 extent = centroids.max - centroids.min;
+    const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    // Objects with the same centroid can't be told apart, so they are split in half.
+    uint32_t middle = begin + (end - begin) / 2;
+    if (extent[axis] > 0.0f) {
+        const float scale = SAH_BINS / extent[axis];
+        auto bin_of = [&](uint32_t proxy) {
+            const float offset = m_proxies[proxy].box.center()[axis] - centroids.min[axis];
+            return std::min(SAH_BINS - 1, static_cast<uint32_t>(offset * scale));
+        };
+        std::array<Aabb, SAH_BINS> bin_boxes{};
+        std::array<uint32_t, SAH_BINS> bin_counts{};
+        for (uint32_t i = begin; i < end; ++i) {
+            const uint32_t bin = bin_of(proxies[i]);
+            bin_boxes[bin].grow(m_proxies[proxies[i]].box);
+            ++bin_counts[bin];
+        }
+        // Cost of the right side of every split, then a sweep from the left picks the cheapest split.
+        std::array<float, SAH_BINS> right_costs{};
+        Aabb right;
+        uint32_t right_count = 0;
+        for (uint32_t bin = SAH_BINS - 1; bin > 0; --bin) {
+            right.grow(bin_boxes[bin]);
+            right_count += bin_counts[bin];
+            right_costs[bin] = right.area() * static_cast<float>(right_count);
+        }
+        Aabb left;
+        uint32_t left_count = 0;
+        uint32_t best_split = 0;
+        float best_cost = std::numeric_limits<float>::max();
+        for (uint32_t bin = 0; bin + 1 < SAH_BINS; ++bin) {
+            left.grow(bin_boxes[bin]);
+            left_count += bin_counts[bin];
+            const float cost = left.area() * static_cast<float>(left_count) + right_costs[bin + 1];
+            if (left_count > 0 && left_count < end - begin && cost < best_cost) {
+                best_cost = cost;
+                best_split = bin + 1;
+            }
+        }
+        if (best_split > 0) {
+            const auto split = std::partition(proxies.begin() + begin, proxies.begin() + end,
+                                              [&](uint32_t proxy) { return bin_of(proxy) < best_split; });
+            middle = static_cast<uint32_t>(split - proxies.begin());
+        }
+    }
+
+    const uint32_t left_child = build_range(proxies, begin, middle, index);
+    const uint32_t right_child = build_range(proxies, middle, end, index);
+    Node &node = m_nodes[index];
+    node.children[0] = left_child;
+    node.children[1] = right_child;
+    node.box = Aabb::merge(m_nodes[left_child].box, m_nodes[right_child].box);
+    return index;
+}
+
+void SceneBvh::insert_leaf(uint32_t leaf) {
+    if (m_root == NONE) {
+        m_root = leaf;
+        m_nodes[leaf].parent = NONE;
+        return;
+    }
+    // Descends while pairing the leaf with a child is cheaper than pairing it with the node itself.
+    const Aabb box = m_nodes[leaf].box;
+    uint32_t sibling = m_root;
+    while (!m_nodes[sibling].leaf()) {
+        const Node &node = m_nodes[sibling];
+        const float combined = Aabb::merge(node.box, box).area();
+        const float cost = 2.0f * combined;
+        // Every node below grows by at least as much as this one.
+        const float inherited = 2.0f * (combined - node.box.area());
+        float child_costs[2];
+        for (int i = 0; i < 2; ++i) {
+            const Node &child = m_nodes[node.children[i]];
+            const float merged = Aabb::merge(child.box, box).area();
+            child_costs[i] = (child.leaf() ? merged : merged - child.box.area()) + inherited;
+        }
+        if (cost < child_costs[0] && cost < child_costs[1]) {
+            break;
+        }
+        sibling = child_costs[0] < child_costs[1] ? node.children[0] : node.children[1];
+    }
+
+    const uint32_t old_parent = m_nodes[sibling].parent;
+    const uint32_t parent = allocate_node();
+    m_nodes[parent].parent = old_parent;
+    m_nodes[parent].children[0] = sibling;
+    m_nodes[parent].children[1] = leaf;
+    m_nodes[sibling].parent = parent;
+    m_nodes[leaf].parent = parent;
+    if (old_parent == NONE) {
+        m_root = parent;
+    } else {
+        auto &children = m_nodes[old_parent].children;
+        children[children[0] == sibling ? 0 : 1] = parent;
+    }
+    refit(parent);
+}
+
+void SceneBvh::remove_leaf(uint32_t leaf) {
+    if (leaf == m_root) {
+        m_root = NONE;
+        return;
+    }
+    const uint32_t parent = m_nodes[leaf].parent;
+    const uint32_t grandparent = m_nodes[parent].parent;
+    const auto &siblings = m_nodes[parent].children;
+    const uint32_t sibling = siblings[0] == leaf ? siblings[1] : siblings[0];
+    m_nodes[sibling].parent = grandparent;
+    free_node(parent);
+    if (grandparent == NONE) {
+        m_root = sibling;
+        return;
+    }
+    auto &children = m_nodes[grandparent].children;
+    children[children[0] == parent ? 0 : 1] = sibling;
+    refit(grandparent);
+}
+
+void SceneBvh::refit(uint32_t node) {
+    while (node != NONE) {
+        Node &current = m_nodes[node];
+        current.box = Aabb::merge(m_nodes[current.children[0]].box, m_nodes[current.children[1]].box);
+        rotate(node);
+        node = current.parent;
+    }
+}
+
+void SceneBvh::rotate(uint32_t index) {
+    const Node &node = m_nodes[index];
+    // A child moves down next to a grandchild under the other child, and the other grandchild moves up.
+    // The box of the node stays the same, only the area of the other child changes.
+    float best_gain = 0.0f;
+    uint32_t best_side = NONE;
+    uint32_t best_grandchild = NONE;
+    for (uint32_t side = 0; side < 2; ++side) {
+        const Node &down = m_nodes[node.children[side]];
+        const Node &other = m_nodes[node.children[1 - side]];
+        if (other.leaf()) {
+            continue;
+        }
+        for (uint32_t grandchild = 0; grandchild < 2; ++grandchild) {
+            const Node &kept = m_nodes[other.children[1 - grandchild]];
+            const float gain = other.box.area() - Aabb::merge(down.box, kept.box).area();
+            if (gain > best_gain) {
+                best_gain = gain;
+                best_side = side;
+                best_grandchild = grandchild;
+            }
+        }
+    }
+    if (best_side == NONE) {
+        return;
+    }
+    const uint32_t down = node.children[best_side];
+    const uint32_t other = node.children[1 - best_side];
+    const uint32_t up = m_nodes[other].children[best_grandchild];
+    m_nodes[index].children[best_side] = up;
+    m_nodes[up].parent = index;
+    Node &other_node = m_nodes[other];
+    other_node.children[best_grandchild] = down;
+    m_nodes[down].parent = other;
+    other_node.box = Aabb::merge(m_nodes[other_node.children[0]].box, m_nodes[other_node.children[1]].box);
+}
+
+float SceneBvh::cost() const {
+    if (m_root == NONE || m_nodes[m_root].leaf()) {
+        return 0.0f;
+    }
+    float area = 0.0f;
+    m_stack.assign(1, m_root);
+    while (!m_stack.empty()) {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+        if (node.leaf()) {
+            continue;
+        }
+        area += node.box.area();
+        m_stack.push_back(node.children[0]);
+        m_stack.push_back(node.children[1]);
+    }
+    const float root_area = m_nodes[m_root].box.area();
+    return root_area > 0.0f ? area / root_area : 0.0f;
+}
+
+void SceneBvh::query_frustum(const glm::mat4 &view_projection, std::vector<uint32_t> &result) const {
+    if (m_root == NONE) {
+        return;
+    }
+    // Rows of the view projection matrix, the planes point into the frustum.
+    const glm::mat4 rows = glm::transpose(view_projection);
+    const std::array<glm::vec4, 6> planes = {
+            rows[3] + rows[0], rows[3] - rows[0],
+            rows[3] + rows[1], rows[3] - rows[1],
+            rows[3] + rows[2], rows[3] - rows[2],
+    };
+    m_stack.assign(1, m_root);
+    while (!m_stack.empty()) {
+        const uint32_t entry = m_stack.back();
+        m_stack.pop_back();
+        const Node &node = m_nodes[entry & ~INSIDE_BIT];
+        bool inside = entry & INSIDE_BIT;
+        if (!inside) {
+            // The corner furthest along the plane normal is the last one to leave the frustum, the nearest the first.
+            bool outside = false;
+            inside = true;
+            for (const auto &plane: planes) {
+                const glm::vec3 normal(plane);
+                const glm::bvec3 positive = glm::greaterThanEqual(normal, glm::vec3(0.0f));
+                const glm::vec3 furthest = glm::mix(node.box.min, node.box.max, positive);
+                const glm::vec3 nearest = glm::mix(node.box.max, node.box.min, positive);
+                if (glm::dot(normal, furthest) + plane.w < 0.0f) {
+                    outside = true;
+                    break;
+                }
+                inside &= glm::dot(normal, nearest) + plane.w >= 0.0f;
+            }
+            if (outside) {
+                continue;
+            }
+        }
+        if (node.leaf()) {
+            result.push_back(node.proxy);
+            continue;
+        }
+        const uint32_t flag = inside ? INSIDE_BIT : 0;
+        m_stack.push_back(node.children[0] | flag);
+        m_stack.push_back(node.children[1] | flag);
+    }
+}
+
+void SceneBvh::query_overlap(const Aabb &box, std::vector<uint32_t> &result) const {
+    if (m_root == NONE) {
+        return;
+    }
+    m_stack.assign(1, m_root);
+    while (!m_stack.empty()) {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+        if (!node.box.overlaps(box)) {
+            continue;
+        }
+        if (node.leaf()) {
+            result.push_back(node.proxy);
+            continue;
+        }
+        m_stack.push_back(node.children[0]);
+        m_stack.push_back(node.children[1]);
+    }
+}
+
+std::optional<RayHit> SceneBvh::ray_closest(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance,
+                                            const std::function<bool(uint32_t proxy)> &accept) const {
+    if (m_root == NONE) {
+        return std::nullopt;
+    }
+    const glm::vec3 inverse_direction = 1.0f / direction;
+    std::optional<RayHit> result;
+    float best = max_distance;
+    m_stack.assign(1, m_root);
+    while (!m_stack.empty()) {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+        // Tested when popped rather than pushed, so that the nodes behind a closer hit found meanwhile are skipped.
+        const auto distance = node.box.intersect(origin, inverse_direction, best);
+        if (!distance) {
+            continue;
+        }
+        if (node.leaf()) {
+            if (!accept || accept(node.proxy)) {
+                best = *distance;
+                result = RayHit{.proxy = node.proxy, .distance = *distance};
+            }
+            continue;
+        }
+        // The nearer child is pushed last, so it's visited first.
+        const glm::vec3 first = m_nodes[node.children[0]].box.center();
+        const glm::vec3 second = m_nodes[node.children[1]].box.center();
+        const bool first_nearer = glm::dot(first - origin, direction) < glm::dot(second - origin, direction);
+        m_stack.push_back(node.children[first_nearer ? 1 : 0]);
+        m_stack.push_back(node.children[first_nearer ? 0 : 1]);
+    }
+    return result;
+}
+
+/**
+* @returns true if the directions of the rays point into the same octant, so that they visit the nodes in one order.
+*/
+static bool coherent(const RayBatch &rays, uint32_t first, uint32_t count) {
+    for (const auto *component: {&rays.direction_x, &rays.direction_y, &rays.direction_z}) {
+        const bool negative = std::signbit((*component)[first]);
+        for (uint32_t ray = first + 1; ray < first + count; ++ray) {
+            if (std::signbit((*component)[ray]) != negative) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void SceneBvh::ray_closest(const RayBatch &rays, std::vector<RayHit> &result,
+                           const std::function<bool(uint32_t proxy)> &accept) const {
+    result.assign(rays.size(), RayHit{.proxy = NONE, .distance = std::numeric_limits<float>::infinity()});
+    if (m_root == NONE) {
+        return;
+    }
+    for (uint32_t first = 0; first < rays.size(); first += 4) {
+        const uint32_t count = std::min(4u, rays.size() - first);
+#ifdef RG_SCENE_BVH_SSE2
+        if (count > 1 && coherent(rays, first, count)) {
+            trace_packet(rays, first, count, result, accept);
+            continue;
+        }
+#endif
+        for (uint32_t ray = first; ray < first + count; ++ray) {
+            if (auto hit = ray_closest(rays.origin(ray), rays.direction(ray), rays.max_distances[ray], accept)) {
+                result[ray] = *hit;
+            }
+        }
+    }
+}
+
+#ifdef RG_SCENE_BVH_SSE2
+/**
+* @brief Replaces the slab of the `parallel` lanes with everything if their origin is between the faces, and
+* with nothing otherwise.
+*/
+static void slab_parallel(__m128 parallel, __m128 origin, __m128 min, __m128 max, __m128 &near, __m128 &far) {
+    const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    const __m128 inside = _mm_and_ps(_mm_cmple_ps(min, origin), _mm_cmple_ps(origin, max));
+    const __m128 parallel_near = _mm_or_ps(_mm_and_ps(inside, _mm_sub_ps(_mm_setzero_ps(), infinity)),
+                                           _mm_andnot_ps(inside, infinity));
+    const __m128 parallel_far = _mm_sub_ps(_mm_setzero_ps(), parallel_near);
+    near = _mm_or_ps(_mm_and_ps(parallel, parallel_near), _mm_andnot_ps(parallel, near));
+    far = _mm_or_ps(_mm_and_ps(parallel, parallel_far), _mm_andnot_ps(parallel, far));
+}
+#endif
+
+void SceneBvh::trace_packet(const RayBatch &rays, uint32_t first, uint32_t count, std::vector<RayHit> &result,
+                            const std::function<bool(uint32_t proxy)> &accept) const {
+#ifdef RG_SCENE_BVH_SSE2
+    // The missing rays of a short packet get a negative distance, so they never hit anything.
+    alignas(16) float lanes[7][4];
+    const std::vector<float> *components[7] = {
+            &rays.origin_x, &rays.origin_y, &rays.origin_z, &rays.direction_x, &rays.direction_y,
+            &rays.direction_z, &rays.max_distances,
+    };
+    for (uint32_t component = 0; component < 7; ++component) {
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            lanes[component][lane] = lane < count ? (*components[component])[first + lane] : 1.0f;
+        }
+    }
+    for (uint32_t lane = count; lane < 4; ++lane) {
+        lanes[6][lane] = -1.0f;
+    }
+    const __m128 origin_x = _mm_load_ps(lanes[0]);
+    const __m128 origin_y = _mm_load_ps(lanes[1]);
+    const __m128 origin_z = _mm_load_ps(lanes[2]);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 inverse_x = _mm_div_ps(one, _mm_load_ps(lanes[3]));
+    const __m128 inverse_y = _mm_div_ps(one, _mm_load_ps(lanes[4]));
+    const __m128 inverse_z = _mm_div_ps(one, _mm_load_ps(lanes[5]));
+    // The lanes parallel to the faces of an axis, as in Aabb::intersect; their slabs are replaced by an interval
+    // that is everything or nothing, since _mm_min_ps and _mm_max_ps would pass on the NaN of 0 * inf.
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    const __m128 parallel_x = _mm_cmpeq_ps(_mm_andnot_ps(sign, inverse_x), infinity);
+    const __m128 parallel_y = _mm_cmpeq_ps(_mm_andnot_ps(sign, inverse_y), infinity);
+    const __m128 parallel_z = _mm_cmpeq_ps(_mm_andnot_ps(sign, inverse_z), infinity);
+    const bool any_parallel = _mm_movemask_ps(_mm_or_ps(_mm_or_ps(parallel_x, parallel_y), parallel_z)) != 0;
+    alignas(16) float best[4];
+    std::copy(std::begin(lanes[6]), std::end(lanes[6]), best);
+    __m128 best_distance = _mm_load_ps(best);
+    uint32_t proxies[4] = {NONE, NONE, NONE, NONE};
+    const glm::vec3 origin(lanes[0][0], lanes[1][0], lanes[2][0]);
+    const glm::vec3 direction(lanes[3][0], lanes[4][0], lanes[5][0]);
+
+    m_stack.assign(1, m_root);
+    while (!m_stack.empty()) {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+        const __m128 min_x = _mm_set1_ps(node.box.min.x);
+        const __m128 max_x = _mm_set1_ps(node.box.max.x);
+        const __m128 min_y = _mm_set1_ps(node.box.min.y);
+        const __m128 max_y = _mm_set1_ps(node.box.max.y);
+        const __m128 min_z = _mm_set1_ps(node.box.min.z);
+        const __m128 max_z = _mm_set1_ps(node.box.max.z);
+        const __m128 x0 = _mm_mul_ps(_mm_sub_ps(min_x, origin_x), inverse_x);
+        const __m128 x1 = _mm_mul_ps(_mm_sub_ps(max_x, origin_x), inverse_x);
+        const __m128 y0 = _mm_mul_ps(_mm_sub_ps(min_y, origin_y), inverse_y);
+        const __m128 y1 = _mm_mul_ps(_mm_sub_ps(max_y, origin_y), inverse_y);
+        const __m128 z0 = _mm_mul_ps(_mm_sub_ps(min_z, origin_z), inverse_z);
+        const __m128 z1 = _mm_mul_ps(_mm_sub_ps(max_z, origin_z), inverse_z);
+        __m128 near_x = _mm_min_ps(x0, x1);
+        __m128 far_x = _mm_max_ps(x0, x1);
+        __m128 near_y = _mm_min_ps(y0, y1);
+        __m128 far_y = _mm_max_ps(y0, y1);
+        __m128 near_z = _mm_min_ps(z0, z1);
+        __m128 far_z = _mm_max_ps(z0, z1);
+        if (any_parallel) {
+            slab_parallel(parallel_x, origin_x, min_x, max_x, near_x, far_x);
+            slab_parallel(parallel_y, origin_y, min_y, max_y, near_y, far_y);
+            slab_parallel(parallel_z, origin_z, min_z, max_z, near_z, far_z);
+        }
+        const __m128 enter = _mm_max_ps(_mm_max_ps(near_x, near_y), _mm_max_ps(near_z, _mm_setzero_ps()));
+        const __m128 leave = _mm_min_ps(_mm_min_ps(far_x, far_y), _mm_min_ps(far_z, best_distance));
+        const int mask = _mm_movemask_ps(_mm_cmple_ps(enter, leave));
+        if (mask == 0) {
+            continue;
+        }
+        if (node.leaf()) {
+            if (accept && !accept(node.proxy)) {
+                continue;
+            }
+            alignas(16) float distances[4];
+            _mm_store_ps(distances, enter);
+            for (uint32_t lane = 0; lane < 4; ++lane) {
+                if (mask >> lane & 1) {
+                    best[lane] = distances[lane];
+                    proxies[lane] = node.proxy;
+                }
+            }
+            best_distance = _mm_load_ps(best);
+            continue;
+        }
+        // The rays point into one octant, so the order of the first one suits them all.
+        const glm::vec3 first_center = m_nodes[node.children[0]].box.center();
+        const glm::vec3 second_center = m_nodes[node.children[1]].box.center();
+        const bool first_nearer =
+                glm::dot(first_center - origin, direction) < glm::dot(second_center - origin, direction);
+        m_stack.push_back(node.children[first_nearer ? 1 : 0]);
+        m_stack.push_back(node.children[first_nearer ? 0 : 1]);
+    }
+    for (uint32_t lane = 0; lane < count; ++lane) {
+        if (proxies[lane] != NONE) {
+            result[first + lane] = RayHit{.proxy = proxies[lane], .distance = best[lane]};
+        }
+    }
+#else
+    RG_SHOULD_NOT_REACH_HERE("Packets are only traced with SSE2.");
+#endif
+}
+
+void SceneBvh::ray_all(const glm::vec3 &origin, const glm::vec3 &direction, std::vector<RayHit> &result,
+                       float max_distance) const {
+    if (m_root == NONE) {
+        return;
+    }
+    const glm::vec3 inverse_direction = 1.0f / direction;
+    const size_t first = result.size();
+    m_stack.assign(1, m_root);
+    while (!m_stack.empty()) {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+        const auto distance = node.box.intersect(origin, inverse_direction, max_distance);
+        if (!distance) {
+            continue;
+        }
+        if (node.leaf()) {
+            result.push_back(RayHit{.proxy = node.proxy, .distance = *distance});
+            continue;
+        }
+        m_stack.push_back(node.children[0]);
+        m_stack.push_back(node.children[1]);
+    }
+    std::sort(result.begin() + static_cast<std::ptrdiff_t>(first), result.end(),
+              [](const RayHit &a, const RayHit &b) { return a.distance < b.distance; });
+}
+
+}
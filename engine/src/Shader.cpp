@@ -1,68 +1,118 @@
 #include <glad/glad.h>
 #include <engine/resources/Shader.hpp>
+#include <engine/resources/ShaderCompiler.hpp>
 #include <engine/graphics/OpenGL.hpp>
+#include <engine/util/Errors.hpp>
 
 namespace engine::resources {
 
 void Shader::use() const {
-    glUseProgram(m_shader_id);
+    CHECKED_GL_CALL(glUseProgram, m_program.id());
 }
 
-void Shader::destroy() const {
-    glDeleteProgram(m_shader_id);
+void Shader::destroy() {
+    for (auto &[_, variant]: m_variants) {
+        variant->destroy();
+    }
+    m_variants.clear();
+    m_sampler_units.clear();
+    m_program.reset();
+}
+
+uint32_t Shader::feature(std::string_view name) const {
+    for (size_t i = 0; i < m_features.size(); ++i) {
+        if (m_features[i].name == name) {
+            return 1u << i;
+        }
+    }
+    throw util::EngineError(util::EngineError::Type::ShaderCompilationError,
+                            std::format("Shader {} doesn't declare the feature {}. Add '//#feature {}' to its source.",
+                                        m_name, name, name));
+}
+
+const Shader *Shader::variant(uint32_t features) const {
+    if (features == m_enabled_features) {
+        return this;
+    }
+    auto &result = m_variants[features];
+    if (!result) {
+        result = std::make_unique<Shader>(ShaderCompiler::compile_variant(*this, features));
+    }
+    return result.get();
+}
+
+int32_t Shader::sampler_unit(std::string_view name) const {
+    for (size_t unit = 0; unit < m_sampler_units.size(); ++unit) {
+        if (m_sampler_units[unit] == name) {
+            return static_cast<int32_t>(unit);
+        }
+    }
+    std::string uniform(name);
+    const int32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), uniform.c_str());
+    if (location < 0) {
+        return -1;
+    }
+    const auto unit = static_cast<int32_t>(m_sampler_units.size());
+    int32_t current = 0;
+    CHECKED_GL_CALL(glGetIntegerv, GL_CURRENT_PROGRAM, &current);
+    CHECKED_GL_CALL(glUseProgram, m_program.id());
+    CHECKED_GL_CALL(glUniform1i, location, unit);
+    CHECKED_GL_CALL(glUseProgram, current);
+    m_sampler_units.push_back(std::move(uniform));
+    return unit;
 }
 
 unsigned Shader::id() const {
-    return m_shader_id;
+    return m_program.id();
 }
 
 void Shader::set_bool(const std::string &name, bool value) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniform1i, location, static_cast<int>(value));
 }
 
 void Shader::set_int(const std::string &name, int value) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniform1i, location, value);
 }
 
 void Shader::set_float(const std::string &name, float value) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniform1f, location, value);
 }
 
 void Shader::set_vec2(const std::string &name, const glm::vec2 &value) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniform2fv, location, 1, &value[0]);
 }
 
 void Shader::set_vec3(const std::string &name, const glm::vec3 &value) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniform3fv, location, 1, &value[0]);
 }
 
 void Shader::set_vec4(const std::string &name, const glm::vec4 &value) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniform4fv, location, 1, &value[0]);
 }
 
 void Shader::set_mat2(const std::string &name, const glm::mat2 &mat) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniformMatrix2fv, location, 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::set_mat3(const std::string &name, const glm::mat3 &mat) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniformMatrix3fv, location, 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::set_mat4(const std::string &name, const glm::mat4 &mat) const {
-    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_shader_id, name.c_str());
+    uint32_t location = CHECKED_GL_CALL(glGetUniformLocation, m_program.id(), name.c_str());
     CHECKED_GL_CALL(glUniformMatrix4fv, location, 1, GL_FALSE, &mat[0][0]);
 }
 
-Shader::Shader(unsigned shader_id, std::string name, std::string source, std::filesystem::path source_path) :
-        m_shader_id(shader_id)
+Shader::Shader(graphics::GLProgram program, std::string name, std::string source, std::filesystem::path source_path) :
+        m_program(std::move(program))
         , m_name(std::move(name))
         , m_source(std::move(source))
         , m_source_path(std::move(source_path)) {
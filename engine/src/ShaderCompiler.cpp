@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <sstream>
 #include <glad/glad.h>
+#include <engine/graphics/GLExtensions.hpp>
+#include <engine/graphics/GLTrace.hpp>
+#include <engine/resources/ProgramCache.hpp>
 #include <engine/resources/ShaderCompiler.hpp>
 #include <engine/util/Errors.hpp>
 #include <format>
@@ -10,53 +15,224 @@ using namespace graphics;
 
 int to_opengl_type(ShaderType type);
 
-Shader ShaderCompiler::compile_from_source(std::string shader_name, std::string shader_source) {
+Shader ShaderCompiler::compile_from_source(std::string shader_name, std::string shader_source,
+                                           std::filesystem::path source_path, const IncludeReader &read_include) {
+    ShaderCompileJob job;
+    Shader result = submit_from_source(std::move(shader_name), std::move(shader_source), source_path, job,
+                                       read_include);
+    finish(job);
+    return result;
+}
+
+Shader ShaderCompiler::submit_from_source(std::string shader_name, std::string shader_source,
+                                          const std::filesystem::path &source_path, ShaderCompileJob &job,
+                                          const IncludeReader &read_include) {
     spdlog::info("ShaderCompiler::Compiling: {}", shader_name);
-    ShaderCompiler compiler(std::move(shader_name), std::move(shader_source));
-    ShaderParsingResult parsing_result = compiler.parse_source();
-    OpenGL::ShaderProgramId shader_program = compiler.compile(parsing_result);
-    Shader result(shader_program, shader_name, shader_source, "");
+    std::vector<std::filesystem::path> including{source_path};
+    auto read = read_include
+                    ? read_include
+                    : IncludeReader([](const std::filesystem::path &path) {
+                        return util::read_text_file(path);
+                    });
+    ShaderCompiler compiler(std::move(shader_name),
+                            expand_includes(shader_source, source_path.parent_path(), read, including));
+    compiler.m_features = compiler.parse_features();
+    return compiler.build(source_path, job);
+}
+
+Shader ShaderCompiler::compile_variant(const Shader &shader, uint32_t features) {
+    RG_GUARANTEE(shader.m_features.size() == MAX_FEATURES || (features >> shader.m_features.size()) == 0,
+                 "Shader {} has only {} features, requested variant {:#x}.", shader.name(), shader.m_features.size(),
+                 features);
+    ShaderCompiler compiler(shader.name(), shader.source());
+    compiler.m_features = shader.m_features;
+    compiler.m_enabled_features = features;
+    spdlog::info("ShaderCompiler::Compiling variant: {} {}", shader.name(), compiler.defines());
+    ShaderCompileJob job;
+    Shader result = compiler.build(shader.source_path(), job);
+    finish(job);
     return result;
 }
 
-OpenGL::ShaderProgramId ShaderCompiler::compile(const ShaderParsingResult &shader_sources) {
-    uint32_t shader_program_id = glCreateProgram();
-    uint32_t vertex_shader_id = 0;
-    uint32_t fragment_shader_id = 0;
-    uint32_t geometry_shader_id = 0;
-    defer {
-        glDeleteShader(vertex_shader_id);
-        glDeleteShader(fragment_shader_id);
-        glDeleteShader(geometry_shader_id);
-    };
+Shader ShaderCompiler::build(const std::filesystem::path &source_path, ShaderCompileJob &job) {
+    ShaderParsingResult parsing_result = parse_source();
+    GLProgram shader_program = submit(parsing_result, job);
+    Shader result(std::move(shader_program), m_shader_name, m_sources, source_path);
+    result.m_features = m_features;
+    result.m_enabled_features = m_enabled_features;
+    return result;
+}
+
+std::string ShaderCompiler::expand_includes(const std::string &source, const std::filesystem::path &directory,
+                                            const IncludeReader &read_include,
+                                            std::vector<std::filesystem::path> &including) {
+    std::string result;
+    result.reserve(source.size());
+    std::istringstream ss(source);
+    std::string line;
+    while (std::getline(ss, line)) {
+        const auto begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos || line.compare(begin, 8, "#include") != 0) {
+            result.append(line);
+            result.push_back('\n');
+            continue;
+        }
+        const auto open = line.find('"', begin);
+        const auto close = open == std::string::npos ? open : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            throw util::EngineError(util::EngineError::Type::ShaderCompilationError, std::format(
+                    "Invalid include in {}: {}. Use: #include \"file.glsl\"", including.back().string(), line));
+        }
+        const auto path = (directory / line.substr(open + 1, close - open - 1)).lexically_normal();
+        if (std::ranges::find(including, path) != including.end()) {
+            throw util::EngineError(util::EngineError::Type::ShaderCompilationError, std::format(
+                    "{} includes itself through {}.", path.string(), including.back().string()));
+        }
+        including.push_back(path);
+        result.append(expand_includes(read_include(path), path.parent_path(), read_include, including));
+        including.pop_back();
+    }
+    return result;
+}
 
-    vertex_shader_id = compile(shader_sources.vertex_shader, ShaderType::Vertex);
-    glAttachShader(shader_program_id, vertex_shader_id);
-    fragment_shader_id = compile(shader_sources.fragment_shader, ShaderType::Fragment);
-    glAttachShader(shader_program_id, fragment_shader_id);
+std::vector<ShaderFeature> ShaderCompiler::parse_features() const {
+    std::vector<ShaderFeature> result;
+    std::istringstream ss(m_sources);
+    std::string line;
+    while (std::getline(ss, line)) {
+        if (!line.starts_with("//#feature") && !line.starts_with("// #feature")) {
+            continue;
+        }
+        std::istringstream declaration(line.substr(line.find("#feature") + 8));
+        ShaderFeature feature;
+        declaration >> feature.name >> feature.value;
+        if (feature.name.empty()) {
+            throw util::EngineError(util::EngineError::Type::ShaderCompilationError, std::format(
+                    "Invalid feature in {}: {}. Use: //#feature NAME [value]", m_shader_name, line));
+        }
+        if (feature.value.empty()) {
+            feature.value = "1";
+        }
+        result.push_back(std::move(feature));
+    }
+    if (result.size() > MAX_FEATURES) {
+        throw util::EngineError(util::EngineError::Type::ShaderCompilationError, std::format(
+                "Shader {} declares {} features, at most {} are supported.", m_shader_name, result.size(),
+                MAX_FEATURES));
+    }
+    return result;
+}
+
+std::string ShaderCompiler::defines() const {
+    std::string result;
+    for (size_t i = 0; i < m_features.size(); ++i) {
+        const bool enabled = m_enabled_features & (1u << i);
+        result.append(std::format("#define {} {}\n", m_features[i].name, enabled ? m_features[i].value : "0"));
+    }
+    return result;
+}
+
+GLProgram ShaderCompiler::submit(const ShaderParsingResult &shader_sources, ShaderCompileJob &job) {
+    auto shader_program = GLProgram::create(m_shader_name);
+    job = ShaderCompileJob{.name = m_shader_name, .program = shader_program.id()};
+    auto cache = ProgramCache::instance();
+    const bool cached = cache->enabled();
+    const uint64_t key = cached ? cache->key(shader_sources, defines()) : 0;
+    if (cached && cache->load(key, job.program)) {
+        spdlog::info("ShaderCompiler::Loaded {} from the program cache", m_shader_name);
+        return shader_program;
+    }
+
+    // No status is queried here: a query waits for the driver to finish the compile.
+    job.vertex_shader = OpenGL::compile_shader(shader_sources.vertex_shader, ShaderType::Vertex);
+    CHECKED_GL_CALL(glAttachShader, job.program, job.vertex_shader);
+    job.fragment_shader = OpenGL::compile_shader(shader_sources.fragment_shader, ShaderType::Fragment);
+    CHECKED_GL_CALL(glAttachShader, job.program, job.fragment_shader);
 
     if (!shader_sources.geometry_shader
                        .empty()) {
-        geometry_shader_id = compile(shader_sources.geometry_shader, ShaderType::Geometry);
-        glAttachShader(shader_program_id, geometry_shader_id);
+        job.geometry_shader = OpenGL::compile_shader(shader_sources.geometry_shader, ShaderType::Geometry);
+        CHECKED_GL_CALL(glAttachShader, job.program, job.geometry_shader);
     }
-    glLinkProgram(shader_program_id);
-    return shader_program_id;
+    if (cached) {
+        cache->prepare(job.program);
+        job.cache_key = key;
+    }
+    CHECKED_GL_CALL(glLinkProgram, job.program);
+    return shader_program;
 }
 
-uint32_t ShaderCompiler::compile(const std::string &shader_source, ShaderType type) {
-    uint32_t shader_id = OpenGL::compile_shader(shader_source, type);
+bool ShaderCompiler::completed(const ShaderCompileJob &job) {
+    if (!GLExtensions::parallel_shader_compile() || GLTrace::capturing()) {
+        return true;
+    }
+    int32_t completed = 0;
+    CHECKED_GL_CALL(glGetProgramiv, job.program, GLExtensions::COMPLETION_STATUS_KHR, &completed);
+    return completed;
+}
+
+void ShaderCompiler::finish(ShaderCompileJob &job) {
+    defer {
+        cancel(job);
+    };
+    if (!OpenGL::program_linked_successfully(job.program)) {
+        const std::pair<uint32_t, ShaderType> stages[] = {
+                {job.vertex_shader, ShaderType::Vertex},
+                {job.fragment_shader, ShaderType::Fragment},
+                {job.geometry_shader, ShaderType::Geometry},
+        };
+        for (auto [shader_id, type]: stages) {
+            if (shader_id && !OpenGL::shader_compiled_successfully(shader_id)) {
+                throw util::EngineError(util::EngineError::Type::ShaderCompilationError, std::format(
+                        "{} shader compilation {} failed:\n{}", to_string(type),
+                        job.name,
+                        OpenGL::get_compilation_error_message(shader_id)));
+            }
+        }
+        throw util::EngineError(util::EngineError::Type::ShaderCompilationError, std::format(
+                "Shader program {} link failed:\n{}", job.name,
+                OpenGL::get_link_error_message(job.program)));
+    }
+    if (job.cache_key) {
+        ProgramCache::instance()->store(job.cache_key, job.program);
+    }
+}
+
+Shader ShaderCompiler::compile_compute(std::string shader_name, std::string shader_source) {
+    RG_GUARANTEE(GLExtensions::compute_shader(), "Compute shader {} needs GL 4.3.", shader_name);
+    spdlog::info("ShaderCompiler::Compiling: {}", shader_name);
+    auto shader_program = GLProgram::create(shader_name);
+    const uint32_t shader_id = OpenGL::compile_shader(shader_source, ShaderType::Compute);
+    defer {
+        CHECKED_GL_CALL(glDeleteShader, shader_id);
+    };
+    CHECKED_GL_CALL(glAttachShader, shader_program.id(), shader_id);
+    CHECKED_GL_CALL(glLinkProgram, shader_program.id());
     if (!OpenGL::shader_compiled_successfully(shader_id)) {
         throw util::EngineError(util::EngineError::Type::ShaderCompilationError, std::format(
-                "{} shader compilation {} failed:\n{}", to_string(type),
-                m_shader_name,
+                "{} shader compilation {} failed:\n{}", to_string(ShaderType::Compute), shader_name,
                 OpenGL::get_compilation_error_message(shader_id)));
     }
-    return shader_id;
+    if (!OpenGL::program_linked_successfully(shader_program.id())) {
+        throw util::EngineError(util::EngineError::Type::ShaderCompilationError, std::format(
+                "Shader program {} link failed:\n{}", shader_name,
+                OpenGL::get_link_error_message(shader_program.id())));
+    }
+    return Shader(std::move(shader_program), std::move(shader_name), std::move(shader_source), "");
+}
+
+void ShaderCompiler::cancel(ShaderCompileJob &job) {
+    // The shaders are attached, so the driver deletes them together with the program.
+    CHECKED_GL_CALL(glDeleteShader, job.vertex_shader);
+    CHECKED_GL_CALL(glDeleteShader, job.fragment_shader);
+    CHECKED_GL_CALL(glDeleteShader, job.geometry_shader);
+    job.vertex_shader = job.fragment_shader = job.geometry_shader = 0;
+    job.cache_key = 0;
 }
 
 ShaderParsingResult ShaderCompiler::parse_source() {
     ShaderParsingResult parsing_result;
+    const std::string feature_defines = defines();
     std::istringstream ss(m_sources);
     std::string line;
     std::string *current_shader = nullptr;
@@ -66,6 +242,10 @@ ShaderParsingResult ShaderCompiler::parse_source() {
         } else if (current_shader) {
             current_shader->append(line);
             current_shader->push_back('\n');
+            // Nothing but comments may come before #version, so the features are defined right after it.
+            if (line.starts_with("#version")) {
+                current_shader->append(feature_defines);
+            }
         }
     }
     if (parsing_result.vertex_shader
@@ -80,18 +260,21 @@ ShaderParsingResult ShaderCompiler::parse_source() {
 
 Shader ShaderCompiler::compile_from_file(std::string shader_name,
                                          const std::filesystem::path &shader_path) {
+    ShaderCompileJob job;
+    Shader result = submit_from_file(std::move(shader_name), shader_path, job);
+    finish(job);
+    return result;
+}
+
+Shader ShaderCompiler::submit_from_file(std::string shader_name, const std::filesystem::path &shader_path,
+                                        ShaderCompileJob &job) {
     if (!exists(shader_path)) {
         throw util::EngineError(util::EngineError::Type::FileNotFound,
                                 std::format("Shader source file {} for shader {} not found.",
                                             shader_path.string(),
                                             shader_name));
     }
-    std::string shader_source = util::read_text_file(shader_path);
-    ShaderCompiler compiler(std::move(shader_name), std::move(shader_source));
-    ShaderParsingResult parsing_result = compiler.parse_source();
-    OpenGL::ShaderProgramId shader_program = compiler.compile(parsing_result);
-    Shader result(shader_program, shader_name, shader_source, shader_path);
-    return result;
+    return submit_from_source(std::move(shader_name), util::read_text_file(shader_path), shader_path, job);
 }
 
 std::string *ShaderCompiler::now_parsing(ShaderParsingResult &result, const std::string &line) {
@@ -114,6 +297,7 @@ std::string_view to_string(ShaderType type) {
         case ShaderType::Vertex: return "vertex";
         case ShaderType::Fragment: return "fragment";
         case ShaderType::Geometry: return "geometry";
+        case ShaderType::Compute: return "compute";
         default: RG_SHOULD_NOT_REACH_HERE("Unhandled shader type");
     }
 }
@@ -0,0 +1,12 @@
+#include <engine/graphics/TextureUploader.hpp>
+#include <engine/resources/Skybox.hpp>
+
+namespace engine::resources {
+
+void Skybox::destroy() {
+    graphics::TextureUploader::instance()->cancel(m_texture.id());
+    m_texture.reset();
+    m_vao = 0;
+}
+
+}
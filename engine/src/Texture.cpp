@@ -1,6 +1,8 @@
 #include <glad/glad.h>
 #include <engine/resources/Texture.hpp>
 #include <engine/util/Errors.hpp>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/graphics/TextureUploader.hpp>
 
 namespace engine::resources {
 std::string_view texture_type_to_string(TextureType type) {
@@ -14,13 +16,15 @@ std::string_view texture_type_to_string(TextureType type) {
 }
 
 void Texture::destroy() {
-    glDeleteTextures(1, &m_id);
+    graphics::TextureUploader::instance()->cancel(m_texture.id());
+    m_texture.reset();
 }
 
 void Texture::bind(int32_t sampler) {
     RG_GUARANTEE(sampler >= GL_TEXTURE0 && sampler <= GL_TEXTURE31, "sampler out of range");
-    glActiveTexture(sampler);
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    use();
+    CHECKED_GL_CALL(glActiveTexture, sampler);
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, m_texture.id());
 }
 
 std::string_view Texture::uniform_name_convention(TextureType type) {
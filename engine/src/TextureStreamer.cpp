@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include <engine/graphics/OpenGL.hpp>
+#include <engine/resources/Texture.hpp>
+#include <engine/resources/TextureStreamer.hpp>
+#include <engine/util/WorkerPool.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::resources {
+
+TextureStreamer::TextureStreamer(uint64_t budget, int32_t initial_size, uint32_t drop_delay, ImageLoader loader)
+    : m_budget(budget), m_initial_size(std::max(initial_size, 1)), m_drop_delay(drop_delay),
+      m_loader(std::move(loader)) {
+}
+
+TextureStreamer::~TextureStreamer() {
+    auto uploader = graphics::TextureUploader::instance();
+    for (auto &[texture, state]: m_states) {
+        if (state.image.valid()) {
+            state.image.wait();
+        }
+        uploader->cancel(state.incoming.id());
+    }
+}
+
+int32_t TextureStreamer::mip_for(const State &state, float pixels) {
+    const float size = static_cast<float>(std::max(state.width, state.height));
+    if (pixels >= size) {
+        return 0;
+    }
+    const auto mip = static_cast<int32_t>(std::floor(std::log2(size / std::max(pixels, 1.0f))));
+    return std::clamp(mip, 0, state.levels - 1);
+}
+
+uint64_t TextureStreamer::bytes_from(const State &state, int32_t mip) {
+    uint64_t result = 0;
+    for (int32_t level = mip; level < state.levels; ++level) {
+        const uint64_t width = std::max(state.width >> level, 1);
+        const uint64_t height = std::max(state.height >> level, 1);
+        result += width * height * state.channels;
+    }
+    return result;
+}
+
+graphics::StreamedImage TextureStreamer::levels_from(const graphics::StreamedImage &image, int32_t mip) {
+    graphics::StreamedImage result{.channels = image.channels, .path = image.path};
+    result.levels.assign(image.levels.begin() + mip, image.levels.end());
+    return result;
+}
+
+void TextureStreamer::track(Texture *texture, graphics::StreamedImage image, bool flip_uvs) {
+    const auto &base = image.levels.front();
+    State state{
+            .width = base.width,
+            .height = base.height,
+            .channels = image.channels,
+            .levels = static_cast<int32_t>(image.levels.size()),
+            .flip_uvs = flip_uvs,
+    };
+    // Requests made while the placeholder was drawn are kept on the texture, so a texture that is already
+    // on screen starts at the level it needs.
+    const float pixels = texture->m_requested_pixels > 0.0f
+                             ? texture->m_requested_pixels
+                             : static_cast<float>(m_initial_size);
+    texture->m_requested_pixels = 0.0f;
+    const int32_t mip = mip_for(state, pixels);
+    state.decoded = std::make_shared<const graphics::StreamedImage>(std::move(image));
+    texture->m_texture = graphics::TextureUploader::instance()->upload(levels_from(*state.decoded, mip));
+    state.texture_id = texture->m_texture.id();
+    state.resident_mip = state.clamp_mip = state.target_mip = mip;
+    m_states[texture] = std::move(state);
+}
+
+void TextureStreamer::start_load(Texture *texture, State &state, int32_t mip) {
+    state.loading_mip = mip;
+    state.coarser_frames = 0;
+    state.image = util::WorkerPool::instance()->async([loader = m_loader, path = texture->path(),
+                                                       flip = state.flip_uvs, decoded = state.decoded, mip] {
+        auto chain = decoded ? decoded
+                             : std::make_shared<const graphics::StreamedImage>(
+                                       graphics::TextureUploader::prepare(loader(path, flip)));
+        return LoadedImage{.decoded = chain, .levels = levels_from(*chain, mip)};
+    });
+}
+
+bool TextureStreamer::fit_budget() {
+    if (m_budget == 0) {
+        return false;
+    }
+    uint64_t total = 0;
+    for (const auto &[texture, state]: m_states) {
+        total += bytes_from(state, state.target_mip);
+    }
+    bool coarsened = false;
+    while (total > m_budget) {
+        State *largest = nullptr;
+        for (auto &[texture, state]: m_states) {
+            if (state.target_mip < state.levels - 1 &&
+                (!largest || bytes_from(state, state.target_mip) > bytes_from(*largest, largest->target_mip))) {
+                largest = &state;
+            }
+        }
+        if (!largest) {
+            break;
+        }
+        total -= bytes_from(*largest, largest->target_mip) - bytes_from(*largest, largest->target_mip + 1);
+        ++largest->target_mip;
+        coarsened = true;
+    }
+    return coarsened;
+}
+
+void TextureStreamer::update() {
+    auto uploader = graphics::TextureUploader::instance();
+    for (auto &[texture, state]: m_states) {
+        if (texture->id() != state.texture_id) {
+            // Reloaded in full after an eviction, or evicted.
+            state.texture_id = texture->id();
+            state.resident_mip = state.clamp_mip = 0;
+        }
+        if (texture->m_requested_pixels > 0.0f) {
+            state.target_mip = mip_for(state, texture->m_requested_pixels);
+            texture->m_requested_pixels = 0.0f;
+            state.unrequested_frames = 0;
+        } else if (++state.unrequested_frames >= m_drop_delay) {
+            // Off screen for the whole delay: the coarsest level is enough, and is dropped to without waiting again.
+            if (state.target_mip != state.levels - 1) {
+                state.target_mip = state.levels - 1;
+                state.coarser_frames = m_drop_delay;
+            } else if (state.resident_mip == state.target_mip && !state.image.valid()) {
+                state.decoded.reset();
+            }
+        }
+    }
+    const bool over_budget = fit_budget();
+
+    for (auto &[texture, state]: m_states) {
+        if (state.image.valid()) {
+            if (state.image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                continue;
+            }
+            auto loaded = state.image.get();
+            if (!texture->resident()) {
+                continue;
+            }
+            // A texture that went off screen has no use for its chain until it's back.
+            state.decoded = state.unrequested_frames < m_drop_delay ? std::move(loaded.decoded) : nullptr;
+            state.incoming = uploader->upload(std::move(loaded.levels));
+        }
+        if (!texture->resident()) {
+            uploader->cancel(state.incoming.id());
+            state.incoming.reset();
+            state.decoded.reset();
+            continue;
+        }
+        if (state.incoming) {
+            if (uploader->pending(state.incoming.id())) {
+                continue;
+            }
+            spdlog::info("[TextureStreamer]: {} now holds mip {} ({} bytes, was mip {})", texture->name(),
+                         state.loading_mip, state.incoming.size(), state.resident_mip);
+            texture->m_texture = std::move(state.incoming);
+            state.texture_id = texture->id();
+            state.resident_mip = state.clamp_mip = state.loading_mip;
+            state.loading_mip = -1;
+        }
+        if (uploader->pending(texture->id())) {
+            continue;
+        }
+
+        // Sampling a coarser level than the resident ones costs nothing, so it's clamped before the memory is released.
+        const int32_t clamp = std::max(state.target_mip, state.resident_mip);
+        if (clamp != state.clamp_mip) {
+            CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, texture->id());
+            CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, clamp - state.resident_mip);
+            CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, 0);
+            state.clamp_mip = clamp;
+        }
+        if (state.target_mip < state.resident_mip) {
+            start_load(texture, state, state.target_mip);
+        } else if (state.target_mip > state.resident_mip) {
+            if (++state.coarser_frames >= m_drop_delay || over_budget) {
+                start_load(texture, state, state.target_mip);
+            }
+        } else {
+            state.coarser_frames = 0;
+        }
+    }
+}
+
+uint64_t TextureStreamer::resident_bytes() const {
+    uint64_t result = 0;
+    for (const auto &[texture, state]: m_states) {
+        result += texture->gpu_bytes() + state.incoming.size();
+    }
+    return result;
+}
+
+}
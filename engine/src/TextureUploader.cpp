@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <glad/glad.h>
+#include <engine/graphics/TextureUploader.hpp>
+#include <engine/util/Configuration.hpp>
+#include <engine/util/Errors.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::graphics {
+
+TextureUploader *TextureUploader::instance() {
+    static TextureUploader uploader;
+    return &uploader;
+}
+
+StreamedImage TextureUploader::prepare(const TextureImage &image) {
+    StreamedImage result;
+    result.channels = image.channels;
+    result.path = image.path;
+    const size_t base_size = static_cast<size_t>(image.width) * image.height * image.channels;
+    result.levels.push_back(MipLevel{
+            .width = image.width,
+            .height = image.height,
+            .pixels = std::vector<uint8_t>(image.pixels.get(), image.pixels.get() + base_size),
+    });
+    const int32_t channels = image.channels;
+    while (result.levels.back().width > 1 || result.levels.back().height > 1) {
+        const MipLevel &source = result.levels.back();
+        MipLevel level{
+                .width = std::max(source.width / 2, 1),
+                .height = std::max(source.height / 2, 1),
+        };
+        level.pixels.resize(static_cast<size_t>(level.width) * level.height * channels);
+        // 2x2 box filter; the last row or column of an odd-sized level is averaged with itself.
+        for (int32_t y = 0; y < level.height; ++y) {
+            const int32_t y0 = std::min(2 * y, source.height - 1);
+            const int32_t y1 = std::min(2 * y + 1, source.height - 1);
+            for (int32_t x = 0; x < level.width; ++x) {
+                const int32_t x0 = std::min(2 * x, source.width - 1);
+                const int32_t x1 = std::min(2 * x + 1, source.width - 1);
+                for (int32_t c = 0; c < channels; ++c) {
+                    auto texel = [&](int32_t sx, int32_t sy) {
+                        return static_cast<uint32_t>(source.pixels[(static_cast<size_t>(sy) * source.width + sx) *
+                                                                   channels + c]);
+                    };
+                    const uint32_t sum = texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1);
+                    level.pixels[(static_cast<size_t>(y) * level.width + x) * channels + c] =
+                            static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+        result.levels.push_back(std::move(level));
+    }
+    return result;
+}
+
+GLTexture TextureUploader::upload(StreamedImage image) {
+    RG_GUARANTEE(!image.levels.empty(), "Texture {} has no mip levels.", image.path.string());
+    auto texture = GLTexture::create(image.path.string());
+    const int32_t format = OpenGL::texture_format(image.channels);
+    const auto last_level = static_cast<int32_t>(image.levels.size() - 1);
+
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, texture.id());
+    uint64_t size = 0;
+    for (int32_t level = 0; level <= last_level; ++level) {
+        const auto &mip = image.levels[level];
+        CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_2D, level, format, mip.width, mip.height, 0, format,
+                        GL_UNSIGNED_BYTE, nullptr);
+        size += mip.pixels.size();
+    }
+    // Only the levels in [BASE_LEVEL, MAX_LEVEL] are sampled, so the texture is complete
+    // as soon as its smallest level is uploaded.
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last_level);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last_level);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, 0);
+    texture.set_size(size);
+
+    auto shared = std::make_shared<const StreamedImage>(std::move(image));
+    for (int32_t level = last_level; level >= 0; --level) {
+        const auto &mip = shared->levels[level];
+        m_uploads.push_back(Upload{
+                .texture = texture.id(),
+                .bind_target = GL_TEXTURE_2D,
+                .image_target = GL_TEXTURE_2D,
+                .level = level,
+                .format = format,
+                .width = mip.width,
+                .height = mip.height,
+                .channels = shared->channels,
+                .pixels = std::shared_ptr<const uint8_t>(shared, mip.pixels.data()),
+                .next_row = 0,
+                .set_base_level = true,
+        });
+    }
+    return texture;
+}
+
+GLTexture TextureUploader::upload_levels(const StreamedImage &image) {
+    RG_GUARANTEE(!image.levels.empty(), "Texture {} has no mip levels.", image.path.string());
+    auto texture = GLTexture::create(image.path.string());
+    const int32_t format = OpenGL::texture_format(image.channels);
+
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, texture.id());
+    CHECKED_GL_CALL(glPixelStorei, GL_UNPACK_ALIGNMENT, 1);
+    uint64_t size = 0;
+    for (int32_t level = 0; level < static_cast<int32_t>(image.levels.size()); ++level) {
+        const auto &mip = image.levels[level];
+        CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_2D, level, format, mip.width, mip.height, 0, format,
+                        GL_UNSIGNED_BYTE, mip.pixels.data());
+        size += mip.pixels.size();
+    }
+    CHECKED_GL_CALL(glPixelStorei, GL_UNPACK_ALIGNMENT, 4);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int32_t>(image.levels.size() - 1));
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, 0);
+    texture.set_size(size);
+    return texture;
+}
+
+GLTexture TextureUploader::upload_cubemap(const CubemapImages &images, const std::filesystem::path &path) {
+    auto texture = GLTexture::create(path.string());
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_CUBE_MAP, texture.id());
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < images.size(); ++i) {
+        const auto &image = images[i];
+        if (!image.pixels) {
+            continue;
+        }
+        const int32_t format = OpenGL::texture_format(image.channels);
+        CHECKED_GL_CALL(glTexImage2D, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, image.width, image.height, 0,
+                        format, GL_UNSIGNED_BYTE, nullptr);
+        size += static_cast<uint64_t>(image.width) * image.height * image.channels;
+        m_uploads.push_back(Upload{
+                .texture = texture.id(),
+                .bind_target = GL_TEXTURE_CUBE_MAP,
+                .image_target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
+                .level = 0,
+                .format = format,
+                .width = image.width,
+                .height = image.height,
+                .channels = image.channels,
+                .pixels = image.pixels,
+                .next_row = 0,
+                .set_base_level = false,
+        });
+    }
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    CHECKED_GL_CALL(glTexParameteri, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_CUBE_MAP, 0);
+    texture.set_size(size);
+    return texture;
+}
+
+void TextureUploader::cancel(uint32_t texture) {
+    std::erase_if(m_uploads, [texture](const Upload &upload) {
+        return upload.texture == texture;
+    });
+}
+
+bool TextureUploader::pending(uint32_t texture) const {
+    return std::ranges::any_of(m_uploads, [texture](const Upload &upload) {
+        return upload.texture == texture;
+    });
+}
+
+void TextureUploader::process() {
+    retire(false);
+    upload_queued(false);
+    end_frame();
+}
+
+void TextureUploader::flush() {
+    upload_queued(true);
+    end_frame();
+}
+
+void TextureUploader::initialize() {
+    const auto &config = util::Configuration::config();
+    uint64_t ring_mb = 32;
+    if (config.contains("graphics") && config["graphics"].contains("texture_upload")) {
+        const auto &upload = config["graphics"]["texture_upload"];
+        m_budget_ms = upload.value<double>("budget_ms", m_budget_ms);
+        m_budget_bytes = upload.value<uint64_t>("budget_mb", m_budget_bytes / (1024 * 1024)) * 1024 * 1024;
+        ring_mb = upload.value<uint64_t>("ring_mb", ring_mb);
+    }
+    RG_GUARANTEE(ring_mb > 0, "graphics.texture_upload.ring_mb must be positive.");
+    m_capacity = ring_mb * 1024 * 1024;
+    m_ring = GLBuffer::create("texture upload ring");
+    CHECKED_GL_CALL(glBindBuffer, GL_PIXEL_UNPACK_BUFFER, m_ring.id());
+    CHECKED_GL_CALL(glBufferData, GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(m_capacity), nullptr,
+                    GL_STREAM_DRAW);
+    CHECKED_GL_CALL(glBindBuffer, GL_PIXEL_UNPACK_BUFFER, 0);
+    m_ring.set_size(m_capacity);
+    spdlog::info("[TextureUploader]: {} MB ring, budget {} ms / {} MB per frame", ring_mb, m_budget_ms,
+                 m_budget_bytes / (1024 * 1024));
+}
+
+void TextureUploader::shutdown() {
+    m_uploads.clear();
+    for (const auto &frame: m_fences) {
+        CHECKED_GL_CALL(glDeleteSync, static_cast<GLsync>(frame.fence));
+    }
+    m_fences.clear();
+    m_ring.reset();
+    m_capacity = m_head = m_used = m_frame_bytes = 0;
+}
+
+void TextureUploader::upload_queued(bool unlimited) {
+    if (m_uploads.empty()) {
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const std::chrono::duration<double, std::milli> budget(m_budget_ms);
+    // A single band never takes more than a quarter of the ring, so the ring holds a few frames of uploads.
+    const uint64_t band_limit = std::max<uint64_t>(m_capacity / 4, 1);
+    uint64_t uploaded = 0;
+
+    CHECKED_GL_CALL(glPixelStorei, GL_UNPACK_ALIGNMENT, 1);
+    while (!m_uploads.empty()) {
+        if (!unlimited && uploaded > 0 &&
+            (uploaded >= m_budget_bytes || std::chrono::steady_clock::now() - start >= budget)) {
+            break;
+        }
+        auto &upload = m_uploads.front();
+        const uint64_t row_size = static_cast<uint64_t>(upload.width) * upload.channels;
+        const auto rows = static_cast<int32_t>(std::clamp<uint64_t>(band_limit / std::max<uint64_t>(row_size, 1), 1,
+                                                                    upload.height - upload.next_row));
+        const uint64_t band_size = row_size * rows;
+        const uint8_t *source = upload.pixels.get() + row_size * upload.next_row;
+
+        CHECKED_GL_CALL(glBindTexture, upload.bind_target, upload.texture);
+        if (band_size > m_capacity || GLTrace::capturing()) {
+            CHECKED_GL_CALL(glTexSubImage2D, upload.image_target, upload.level, 0, upload.next_row, upload.width, rows,
+                            upload.format, GL_UNSIGNED_BYTE, source);
+        } else {
+            auto offset = allocate(band_size);
+            if (!offset.has_value()) {
+                if (!unlimited) {
+                    break;
+                }
+                end_frame();
+                retire(true);
+                continue;
+            }
+            CHECKED_GL_CALL(glBindBuffer, GL_PIXEL_UNPACK_BUFFER, m_ring.id());
+            // The region was last read before a signaled fence, so the GPU doesn't need to be synchronized with.
+            void *destination = CHECKED_GL_CALL(glMapBufferRange, GL_PIXEL_UNPACK_BUFFER,
+                                                static_cast<GLintptr>(offset.value()),
+                                                static_cast<GLsizeiptr>(band_size),
+                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                                GL_MAP_UNSYNCHRONIZED_BIT);
+            std::memcpy(destination, source, band_size);
+            CHECKED_GL_CALL(glUnmapBuffer, GL_PIXEL_UNPACK_BUFFER);
+            CHECKED_GL_CALL(glTexSubImage2D, upload.image_target, upload.level, 0, upload.next_row, upload.width, rows,
+                            upload.format, GL_UNSIGNED_BYTE, reinterpret_cast<const void *>(offset.value()));
+            CHECKED_GL_CALL(glBindBuffer, GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        uploaded += band_size;
+        upload.next_row += rows;
+        if (upload.next_row == upload.height) {
+            if (upload.set_base_level) {
+                CHECKED_GL_CALL(glTexParameteri, upload.bind_target, GL_TEXTURE_BASE_LEVEL, upload.level);
+            }
+            m_uploads.pop_front();
+        }
+    }
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_2D, 0);
+    CHECKED_GL_CALL(glBindTexture, GL_TEXTURE_CUBE_MAP, 0);
+    CHECKED_GL_CALL(glPixelStorei, GL_UNPACK_ALIGNMENT, 4);
+}
+
+std::optional<uint64_t> TextureUploader::allocate(uint64_t size) {
+    uint64_t skipped = 0;
+    if (m_head + size > m_capacity) {
+        // A band is never split across the end of the ring; the bytes at the end are skipped instead.
+        skipped = m_capacity - m_head;
+    }
+    if (m_used + skipped + size > m_capacity) {
+        return std::nullopt;
+    }
+    if (skipped > 0) {
+        m_head = 0;
+    }
+    const uint64_t offset = m_head;
+    m_head += size;
+    m_used += skipped + size;
+    m_frame_bytes += skipped + size;
+    return offset;
+}
+
+void TextureUploader::end_frame() {
+    if (m_frame_bytes == 0) {
+        return;
+    }
+    GLsync fence = CHECKED_GL_CALL(glFenceSync, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_fences.push_back(FrameFence{.fence = fence, .bytes = m_frame_bytes});
+    m_frame_bytes = 0;
+}
+
+void TextureUploader::retire(bool wait) {
+    // Fences signal in submission order, so polling stops at the first frame that is still in flight.
+    while (!m_fences.empty()) {
+        auto fence = static_cast<GLsync>(m_fences.front().fence);
+        GLenum status = CHECKED_GL_CALL(glClientWaitSync, fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                        wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        CHECKED_GL_CALL(glDeleteSync, fence);
+        m_used -= m_fences.front().bytes;
+        m_fences.pop_front();
+        wait = false;
+    }
+}
+
+}
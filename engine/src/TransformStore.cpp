@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cstring>
+#include <engine/util/Errors.hpp>
+#include <engine/util/TransformStore.hpp>
+#include <engine/util/WorkerPool.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RG_TRANSFORM_SSE2 1
+#endif
+
+namespace engine::util {
+
+uint32_t TransformStore::create(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale,
+                                uint32_t parent) {
+    const auto result = size();
+    RG_GUARANTEE(parent == NONE || parent < result, "Parent transform {} has to be created before its child {}",
+                 parent, result);
+    if (result % 4 == 0) {
+        for (auto *component: {&m_position_x, &m_position_y, &m_position_z, &m_rotation_x, &m_rotation_y,
+                               &m_rotation_z}) {
+            component->resize(result + 4, 0.0f);
+        }
+        for (auto *component: {&m_rotation_w, &m_scale_x, &m_scale_y, &m_scale_z}) {
+            component->resize(result + 4, 1.0f);
+        }
+    }
+    m_parents.push_back(parent);
+    m_local.emplace_back(1.0f);
+    m_world.emplace_back(1.0f);
+    m_normal.emplace_back(1.0f);
+    m_dirty.push_back(0);
+    m_changed.push_back(0);
+    set_position(result, position);
+    set_rotation(result, rotation);
+    set_scale(result, scale);
+    return result;
+}
+
+void TransformStore::mark_dirty(uint32_t transform) {
+    m_dirty[transform] = 1;
+    m_first_dirty = std::min(m_first_dirty, transform);
+}
+
+void TransformStore::set_position(uint32_t transform, const glm::vec3 &position) {
+    m_position_x[transform] = position.x;
+    m_position_y[transform] = position.y;
+    m_position_z[transform] = position.z;
+    mark_dirty(transform);
+}
+
+void TransformStore::set_rotation(uint32_t transform, const glm::quat &rotation) {
+    m_rotation_x[transform] = rotation.x;
+    m_rotation_y[transform] = rotation.y;
+    m_rotation_z[transform] = rotation.z;
+    m_rotation_w[transform] = rotation.w;
+    mark_dirty(transform);
+}
+
+void TransformStore::set_scale(uint32_t transform, const glm::vec3 &scale) {
+    m_scale_x[transform] = scale.x;
+    m_scale_y[transform] = scale.y;
+    m_scale_z[transform] = scale.z;
+    mark_dirty(transform);
+}
+
+/**
+* @returns `a * b` of affine matrices.
+*/
+static glm::mat4 multiply(const glm::mat4 &a, const glm::mat4 &b) {
+    glm::mat4 result;
+#ifdef RG_TRANSFORM_SSE2
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    for (int column = 0; column < 4; ++column) {
+        const __m128 sum = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[column][0])), _mm_mul_ps(a1, _mm_set1_ps(b[column][1]))),
+                _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[column][2])), _mm_mul_ps(a3, _mm_set1_ps(b[column][3]))));
+        _mm_storeu_ps(&result[column][0], sum);
+    }
+#else
+    result = a * b;
+#endif
+    return result;
+}
+
+void TransformStore::compute_local(uint32_t first, uint32_t last) {
+    // The rotation matrix of a quaternion, scaled by columns: translate * rotate * scale. Its normal matrix is the
+    // rotation divided by the scale instead, since the inverse transpose of a rotation is the rotation itself.
+#ifdef RG_TRANSFORM_SSE2
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    for (uint32_t i = first; i < last; i += 4) {
+        uint32_t dirty = 0;
+        std::memcpy(&dirty, &m_dirty[i], std::min(4u, last - i));
+        if (dirty == 0) {
+            continue;
+        }
+        const __m128 x = _mm_loadu_ps(&m_rotation_x[i]);
+        const __m128 y = _mm_loadu_ps(&m_rotation_y[i]);
+        const __m128 z = _mm_loadu_ps(&m_rotation_z[i]);
+        const __m128 w = _mm_loadu_ps(&m_rotation_w[i]);
+        const __m128 xx = _mm_mul_ps(x, x);
+        const __m128 yy = _mm_mul_ps(y, y);
+        const __m128 zz = _mm_mul_ps(z, z);
+        const __m128 xy = _mm_mul_ps(x, y);
+        const __m128 xz = _mm_mul_ps(x, z);
+        const __m128 yz = _mm_mul_ps(y, z);
+        const __m128 wx = _mm_mul_ps(w, x);
+        const __m128 wy = _mm_mul_ps(w, y);
+        const __m128 wz = _mm_mul_ps(w, z);
+        // Rotation matrix entries r[column][row].
+        const __m128 r[3][3] = {
+                {_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), _mm_mul_ps(two, _mm_add_ps(xy, wz)),
+                        _mm_mul_ps(two, _mm_sub_ps(xz, wy))},
+                {_mm_mul_ps(two, _mm_sub_ps(xy, wz)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+                        _mm_mul_ps(two, _mm_add_ps(yz, wx))},
+                {_mm_mul_ps(two, _mm_add_ps(xz, wy)), _mm_mul_ps(two, _mm_sub_ps(yz, wx)),
+                        _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)))},
+        };
+        const __m128 scales[3] = {_mm_loadu_ps(&m_scale_x[i]), _mm_loadu_ps(&m_scale_y[i]),
+                                  _mm_loadu_ps(&m_scale_z[i])};
+
+        // Each column of the 4 matrices is a transpose of the same entry of the 4 transforms.
+        __m128 model[4][4];
+        __m128 normal[3][4];
+        for (int column = 0; column < 3; ++column) {
+            const __m128 inverse_scale = _mm_div_ps(one, scales[column]);
+            __m128 m0 = _mm_mul_ps(r[column][0], scales[column]);
+            __m128 m1 = _mm_mul_ps(r[column][1], scales[column]);
+            __m128 m2 = _mm_mul_ps(r[column][2], scales[column]);
+            __m128 m3 = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+            model[column][0] = m0;
+            model[column][1] = m1;
+            model[column][2] = m2;
+            model[column][3] = m3;
+            __m128 n0 = _mm_mul_ps(r[column][0], inverse_scale);
+            __m128 n1 = _mm_mul_ps(r[column][1], inverse_scale);
+            __m128 n2 = _mm_mul_ps(r[column][2], inverse_scale);
+            __m128 n3 = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(n0, n1, n2, n3);
+            normal[column][0] = n0;
+            normal[column][1] = n1;
+            normal[column][2] = n2;
+            normal[column][3] = n3;
+        }
+        __m128 t0 = _mm_loadu_ps(&m_position_x[i]);
+        __m128 t1 = _mm_loadu_ps(&m_position_y[i]);
+        __m128 t2 = _mm_loadu_ps(&m_position_z[i]);
+        __m128 t3 = one;
+        _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+        model[3][0] = t0;
+        model[3][1] = t1;
+        model[3][2] = t2;
+        model[3][3] = t3;
+
+        for (uint32_t k = 0; k < 4 && i + k < last; ++k) {
+            if (!m_dirty[i + k]) {
+                continue;
+            }
+            glm::mat4 &target = m_parents[i + k] == NONE ? m_world[i + k] : m_local[i + k];
+            for (int column = 0; column < 4; ++column) {
+                _mm_storeu_ps(&target[column][0], model[column][k]);
+            }
+            // The columns of a 3x3 matrix are packed, so the fourth lane can't be stored with them.
+            alignas(16) float packed[4];
+            for (int column = 0; column < 3; ++column) {
+                _mm_store_ps(packed, normal[column][k]);
+                std::memcpy(&m_normal[i + k][column][0], packed, sizeof(glm::vec3));
+            }
+        }
+    }
+#else
+    for (uint32_t i = first; i < last; ++i) {
+        if (!m_dirty[i]) {
+            continue;
+        }
+        const glm::mat3 rotation = glm::mat3_cast(this->rotation(i));
+        const glm::vec3 scale = this->scale(i);
+        glm::mat4 &target = m_parents[i] == NONE ? m_world[i] : m_local[i];
+        target = glm::mat4(1.0f);
+        for (int column = 0; column < 3; ++column) {
+            target[column] = glm::vec4(rotation[column] * scale[column], 0.0f);
+            m_normal[i][column] = rotation[column] / scale[column];
+        }
+        target[3] = glm::vec4(position(i), 1.0f);
+    }
+#endif
+}
+
+uint32_t TransformStore::update() {
+    if (m_first_dirty == NONE) {
+        if (m_any_changed) {
+            std::ranges::fill(m_changed, 0);
+            m_any_changed = false;
+        }
+        return 0;
+    }
+    // Parents come before their children, so one pass in order carries a change down the whole hierarchy.
+    const uint32_t count = size();
+    const uint32_t first = m_first_dirty & ~3u;
+    uint32_t result = 0;
+    bool any_child = false;
+    for (uint32_t i = m_first_dirty; i < count; ++i) {
+        if (m_parents[i] != NONE) {
+            m_dirty[i] |= m_dirty[m_parents[i]];
+            any_child |= m_dirty[i] != 0;
+        }
+        result += m_dirty[i];
+    }
+
+    if (result < PARALLEL_THRESHOLD) {
+        compute_local(first, count);
+    } else {
+        const uint32_t chunks = (count - first + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        WorkerPool::instance()->parallel_for(chunks, [this, first, count](uint32_t chunk) {
+            const uint32_t begin = first + chunk * CHUNK_SIZE;
+            compute_local(begin, std::min(begin + CHUNK_SIZE, count));
+        });
+    }
+    if (any_child) {
+        // The inverse transpose of a product is the product of the inverse transposes.
+        for (uint32_t i = m_first_dirty; i < count; ++i) {
+            if (m_dirty[i] && m_parents[i] != NONE) {
+                m_world[i] = multiply(m_world[m_parents[i]], m_local[i]);
+                m_normal[i] = m_normal[m_parents[i]] * m_normal[i];
+            }
+        }
+    }
+
+    m_changed.swap(m_dirty);
+    std::ranges::fill(m_dirty, 0);
+    m_first_dirty = NONE;
+    m_any_changed = true;
+    return result;
+}
+
+}
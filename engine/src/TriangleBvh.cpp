@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <numeric>
+#include <ostream>
+#include <engine/resources/Mesh.hpp>
+#include <engine/resources/TriangleBvh.hpp>
+
+namespace engine::resources {
+
+/**
+* @brief Bins of the centroids along the split axis.
+*/
+static constexpr uint32_t SAH_BINS = 12;
+
+/**
+* @brief Depth of the traversal stack. Below SAH_DEPTH the nodes are split in half, so even the largest meshes fit.
+*/
+static constexpr uint32_t MAX_DEPTH = 64;
+static constexpr uint32_t SAH_DEPTH = 24;
+
+/**
+* @brief Header of a saved hierarchy, followed by the nodes and the mesh index of every triangle.
+*/
+struct TriangleBvhHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t node_count;
+};
+
+static constexpr char TRIANGLE_BVH_MAGIC[4] = {'R', 'G', 'T', 'B'};
+static constexpr uint32_t TRIANGLE_BVH_VERSION = 1;
+
+/**
+* @returns Distance at which the ray enters the box, or infinity if it misses it before `max_distance`.
+*/
+static float box_distance(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &origin,
+                          const glm::vec3 &inverse_direction, float max_distance) {
+    const glm::vec3 t0 = (min - origin) * inverse_direction;
+    const glm::vec3 t1 = (max - origin) * inverse_direction;
+    const glm::vec3 t_near = glm::min(t0, t1);
+    const glm::vec3 t_far = glm::max(t0, t1);
+    const float enter = std::max({t_near.x, t_near.y, t_near.z, 0.0f});
+    const float leave = std::min({t_far.x, t_far.y, t_far.z, max_distance});
+    return enter <= leave ? enter : std::numeric_limits<float>::infinity();
+}
+
+static float half_area(const glm::vec3 &min, const glm::vec3 &max) {
+    if (min.x > max.x) {
+        return 0.0f;
+    }
+    const glm::vec3 extent = max - min;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+void TriangleBvh::set_vertices(const std::vector<Vertex> &vertices) {
+    m_positions.resize(vertices.size());
+    m_uvs.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        m_positions[i] = vertices[i].Position;
+        m_uvs[i] = vertices[i].TexCoords;
+    }
+}
+
+std::shared_ptr<const TriangleBvh> TriangleBvh::build(const std::vector<Vertex> &vertices,
+                                                      const std::vector<uint32_t> &indices) {
+    if (indices.empty() || indices.size() % 3 != 0) {
+        return nullptr;
+    }
+    auto result = std::make_shared<TriangleBvh>();
+    result->set_vertices(vertices);
+    const auto triangle_count = static_cast<uint32_t>(indices.size() / 3);
+    std::vector<glm::vec3> centroids(triangle_count);
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        centroids[t] = (vertices[indices[3 * t]].Position + vertices[indices[3 * t + 1]].Position +
+                        vertices[indices[3 * t + 2]].Position) / 3.0f;
+    }
+    result->m_triangles.resize(triangle_count);
+    std::iota(result->m_triangles.begin(), result->m_triangles.end(), 0u);
+    // A binary tree with at least one triangle per leaf never has more nodes than this, so it never reallocates.
+    result->m_nodes.reserve(2 * triangle_count - 1);
+    result->m_nodes.emplace_back();
+    result->m_indices = indices;
+    result->build_node(0, 0, triangle_count, 0, centroids);
+
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        const uint32_t triangle = result->m_triangles[i];
+        std::copy_n(&indices[3 * triangle], 3, &result->m_indices[3 * i]);
+    }
+    return result;
+}
+
+void TriangleBvh::build_node(uint32_t index, uint32_t first, uint32_t count, uint32_t depth,
+                             const std::vector<glm::vec3> &centroids) {
+    glm::vec3 box_min(std::numeric_limits<float>::max());
+    glm::vec3 box_max(std::numeric_limits<float>::lowest());
+    glm::vec3 centroid_min = box_min;
+    glm::vec3 centroid_max = box_max;
+    for (uint32_t i = first; i < first + count; ++i) {
+        const uint32_t triangle = m_triangles[i];
+        for (uint32_t k = 0; k < 3; ++k) {
+            const glm::vec3 &position = m_positions[m_indices[3 * triangle + k]];
+            box_min = glm::min(box_min, position);
+            box_max = glm::max(box_max, position);
+        }
+        centroid_min = glm::min(centroid_min, centroids[triangle]);
+        centroid_max = glm::max(centroid_max, centroids[triangle]);
+    }
+    m_nodes[index] = Node{.min = box_min, .first = first, .max = box_max, .count = count};
+    if (count <= MAX_LEAF_TRIANGLES) {
+        return;
+    }
+
+    const glm::vec3 extent = centroid_max - centroid_min;
+    const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    // Triangles with the same centroid can't be told apart, so they are split in half.
+    uint32_t middle = first + count / 2;
+    if (depth >= SAH_DEPTH) {
+        std::nth_element(m_triangles.begin() + first, m_triangles.begin() + middle,
+                         m_triangles.begin() + first + count,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+    } else if (extent[axis] > 0.0f) {
+        const float scale = SAH_BINS / extent[axis];
+        auto bin_of = [&](uint32_t triangle) {
+            return std::min(SAH_BINS - 1,
+                            static_cast<uint32_t>((centroids[triangle][axis] - centroid_min[axis]) * scale));
+        };
+        std::array<glm::vec3, SAH_BINS> bin_min;
+        std::array<glm::vec3, SAH_BINS> bin_max;
+        bin_min.fill(glm::vec3(std::numeric_limits<float>::max()));
+        bin_max.fill(glm::vec3(std::numeric_limits<float>::lowest()));
+        std::array<uint32_t, SAH_BINS> bin_counts{};
+        for (uint32_t i = first; i < first + count; ++i) {
+            const uint32_t triangle = m_triangles[i];
+            const uint32_t bin = bin_of(triangle);
+            for (uint32_t k = 0; k < 3; ++k) {
+                const glm::vec3 &position = m_positions[m_indices[3 * triangle + k]];
+                bin_min[bin] = glm::min(bin_min[bin], position);
+                bin_max[bin] = glm::max(bin_max[bin], position);
+            }
+            ++bin_counts[bin];
+        }
+        std::array<float, SAH_BINS> right_costs{};
+        glm::vec3 right_min(std::numeric_limits<float>::max());
+        glm::vec3 right_max(std::numeric_limits<float>::lowest());
+        uint32_t right_count = 0;
+        for (uint32_t bin = SAH_BINS - 1; bin > 0; --bin) {
+            right_min = glm::min(right_min, bin_min[bin]);
+            right_max = glm::max(right_max, bin_max[bin]);
+            right_count += bin_counts[bin];
+            right_costs[bin] = half_area(right_min, right_max) * static_cast<float>(right_count);
+        }
+        glm::vec3 left_min(std::numeric_limits<float>::max());
+        glm::vec3 left_max(std::numeric_limits<float>::lowest());
+        uint32_t left_count = 0;
+        uint32_t best_split = 0;
+        float best_cost = std::numeric_limits<float>::max();
+        for (uint32_t bin = 0; bin + 1 < SAH_BINS; ++bin) {
+            left_min = glm::min(left_min, bin_min[bin]);
+            left_max = glm::max(left_max, bin_max[bin]);
+            left_count += bin_counts[bin];
+            const float cost = half_area(left_min, left_max) * static_cast<float>(left_count) + right_costs[bin + 1];
+            if (left_count > 0 && left_count < count && cost < best_cost) {
+                best_cost = cost;
+                best_split = bin + 1;
+            }
+        }
+        if (best_split > 0) {
+            const auto split = std::partition(m_triangles.begin() + first, m_triangles.begin() + first + count,
+                                              [&](uint32_t triangle) { return bin_of(triangle) < best_split; });
+            middle = static_cast<uint32_t>(split - m_triangles.begin());
+        }
+    }
+
+    // The left child directly follows its parent; the right one comes after the whole left subtree.
+    const auto left = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+    build_node(left, first, middle - first, depth + 1, centroids);
+    const auto right = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+    build_node(right, middle, first + count - middle, depth + 1, centroids);
+    m_nodes[index].first = right;
+    m_nodes[index].count = 0;
+}
+
+std::shared_ptr<const TriangleBvh> TriangleBvh::load(std::istream &in, const std::vector<Vertex> &vertices,
+                                                     const std::vector<uint32_t> &indices) {
+    TriangleBvhHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    const auto triangle_count = static_cast<uint32_t>(indices.size() / 3);
+    if (!in || std::memcmp(header.magic, TRIANGLE_BVH_MAGIC, sizeof(TRIANGLE_BVH_MAGIC)) != 0 ||
+        header.version != TRIANGLE_BVH_VERSION || header.vertex_count != vertices.size() ||
+        header.index_count != indices.size() || triangle_count == 0 || header.node_count == 0 ||
+        header.node_count > 2 * triangle_count - 1) {
+        return nullptr;
+    }
+    auto result = std::make_shared<TriangleBvh>();
+    result->m_nodes.resize(header.node_count);
+    result->m_triangles.resize(triangle_count);
+    in.read(reinterpret_cast<char *>(result->m_nodes.data()),
+            static_cast<std::streamsize>(result->m_nodes.size() * sizeof(Node)));
+    in.read(reinterpret_cast<char *>(result->m_triangles.data()),
+            static_cast<std::streamsize>(result->m_triangles.size() * sizeof(uint32_t)));
+    if (!in) {
+        return nullptr;
+    }
+    // A file that doesn't fit the mesh would send the traversal out of bounds. The children come after their
+    // parents, so the depth of a node is final when it's reached; a node at depth d can leave d + 1 entries on
+    // the traversal stack.
+    std::vector<uint32_t> depths(header.node_count, 0);
+    for (uint32_t i = 0; i < header.node_count; ++i) {
+        const Node &node = result->m_nodes[i];
+        if (node.count > 0 ? node.first + node.count > triangle_count
+                           : node.first <= i + 1 || node.first >= header.node_count) {
+            return nullptr;
+        }
+        if (depths[i] > MAX_DEPTH - 1) {
+            return nullptr;
+        }
+        if (node.count == 0) {
+            depths[i + 1] = std::max(depths[i + 1], depths[i] + 1);
+            depths[node.first] = std::max(depths[node.first], depths[i] + 1);
+        }
+    }
+    result->m_indices.resize(indices.size());
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        const uint32_t triangle = result->m_triangles[i];
+        if (triangle >= triangle_count) {
+            return nullptr;
+        }
+        std::copy_n(&indices[3 * triangle], 3, &result->m_indices[3 * i]);
+    }
+    result->set_vertices(vertices);
+    return result;
+}
+
+void TriangleBvh::save(std::ostream &out) const {
+    TriangleBvhHeader header{
+            .version = TRIANGLE_BVH_VERSION,
+            .vertex_count = static_cast<uint32_t>(m_positions.size()),
+            .index_count = static_cast<uint32_t>(m_indices.size()),
+            .node_count = static_cast<uint32_t>(m_nodes.size()),
+    };
+    std::memcpy(header.magic, TRIANGLE_BVH_MAGIC, sizeof(TRIANGLE_BVH_MAGIC));
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(m_nodes.data()),
+              static_cast<std::streamsize>(m_nodes.size() * sizeof(Node)));
+    out.write(reinterpret_cast<const char *>(m_triangles.data()),
+              static_cast<std::streamsize>(m_triangles.size() * sizeof(uint32_t)));
+}
+
+std::optional<TriangleHit> TriangleBvh::intersect(const glm::vec3 &origin, const glm::vec3 &direction,
+                                                  float max_distance) const {
+    const glm::vec3 inverse_direction = 1.0f / direction;
+    std::optional<TriangleHit> result;
+    float best = max_distance;
+    if (m_nodes.empty() ||
+        std::isinf(box_distance(m_nodes[0].min, m_nodes[0].max, origin, inverse_direction, best))) {
+        return result;
+    }
+
+    std::array<uint32_t, MAX_DEPTH> stack;
+    uint32_t stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const Node &node = m_nodes[stack[--stack_size]];
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                // Möller-Trumbore, without culling either side.
+                const glm::vec3 &p0 = m_positions[m_indices[3 * i]];
+                const glm::vec3 edge1 = m_positions[m_indices[3 * i + 1]] - p0;
+                const glm::vec3 edge2 = m_positions[m_indices[3 * i + 2]] - p0;
+                const glm::vec3 p = glm::cross(direction, edge2);
+                const float determinant = glm::dot(edge1, p);
+                if (std::abs(determinant) < 1e-12f) {
+                    continue;
+                }
+                const float inverse_determinant = 1.0f / determinant;
+                const glm::vec3 offset = origin - p0;
+                const float u = glm::dot(offset, p) * inverse_determinant;
+                if (u < 0.0f || u > 1.0f) {
+                    continue;
+                }
+                const glm::vec3 q = glm::cross(offset, edge1);
+                const float v = glm::dot(direction, q) * inverse_determinant;
+                if (v < 0.0f || u + v > 1.0f) {
+                    continue;
+                }
+                const float t = glm::dot(edge2, q) * inverse_determinant;
+                if (t < 0.0f || t > best) {
+                    continue;
+                }
+                best = t;
+                result = TriangleHit{.triangle = m_triangles[i], .distance = t, .barycentrics = {u, v}};
+                result->uv = (1.0f - u - v) * m_uvs[m_indices[3 * i]] + u * m_uvs[m_indices[3 * i + 1]] +
+                             v * m_uvs[m_indices[3 * i + 2]];
+            }
+            continue;
+        }
+        // The nearer child is pushed last, so it's visited first, and a hit in it can skip the other one.
+        const uint32_t left = static_cast<uint32_t>(&node - m_nodes.data()) + 1;
+        const uint32_t right = node.first;
+        float left_distance = box_distance(m_nodes[left].min, m_nodes[left].max, origin, inverse_direction, best);
+        float right_distance = box_distance(m_nodes[right].min, m_nodes[right].max, origin, inverse_direction,
+                                            best);
+        uint32_t near = left;
+        uint32_t far = right;
+        if (right_distance < left_distance) {
+            std::swap(near, far);
+            std::swap(left_distance, right_distance);
+        }
+        if (!std::isinf(right_distance)) {
+            stack[stack_size++] = far;
+        }
+        if (!std::isinf(left_distance)) {
+            stack[stack_size++] = near;
+        }
+    }
+    return result;
+}
+
+uint64_t TriangleBvh::cpu_bytes() const {
+    return m_nodes.size() * sizeof(Node) + m_positions.size() * sizeof(glm::vec3) +
+           m_uvs.size() * sizeof(glm::vec2) + (m_indices.size() + m_triangles.size()) * sizeof(uint32_t);
+}
+
+}
@@ -2,9 +2,11 @@
 #include <engine/util/Utils.hpp>
 #include <engine/util/Errors.hpp>
 #include <spdlog/spdlog.h>
+#include <cstring>
 #include <fstream>
 #include <engine/util/Configuration.hpp>
 #include <engine/util/ArgParser.hpp>
+#include <engine/util/IOService.hpp>
 
 namespace engine::util {
 static bool g_tracing = true;
@@ -100,9 +102,17 @@ std::string ArgParser::get_arg_value(std::string_view arg_name) {
 
 std::string read_text_file(const std::filesystem::path &path) {
     RG_GUARANTEE(std::filesystem::exists(path), "File {} doesn't exist.", path.string());
-    std::ifstream file(path);
-    std::stringstream ss;
-    ss << file.rdbuf();
-    return ss.str();
+    // Read straight into the string, without going through a stringstream.
+    std::string result(std::filesystem::file_size(path), '\0');
+    std::promise<ReadResult> done;
+    auto read = done.get_future();
+    IOService::instance()->read(path, std::span(reinterpret_cast<uint8_t *>(result.data()), result.size()), 0,
+                                [&done](const ReadResult &read_result) {
+                                    done.set_value(read_result);
+                                });
+    const auto read_result = read.get();
+    RG_GUARANTEE(read_result.error == 0, "Failed to read {}: {}", path.string(), std::strerror(read_result.error));
+    result.resize(read_result.bytes);
+    return result;
 }
 } // namespace engine
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <engine/util/WorkerPool.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::util {
+
+WorkerPool *WorkerPool::instance() {
+    static WorkerPool pool;
+    return &pool;
+}
+
+WorkerPool::WorkerPool() {
+    // The main thread runs jobs too, so one core is left for it.
+    const uint32_t workers = std::clamp(std::thread::hardware_concurrency(), 2u, 8u) - 1;
+    m_max_background = std::max(workers / 2, 1u);
+    for (uint32_t i = 0; i < workers; ++i) {
+        m_threads.emplace_back([this] { worker_loop(); });
+    }
+    spdlog::info("[WorkerPool]: {} worker threads", workers);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_running = false;
+    }
+    m_work_cv.notify_all();
+    for (auto &thread: m_threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::parallel_for(uint32_t count, const Job &job) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        job(0);
+        return;
+    }
+    std::lock_guard submit_lock(m_submit_mutex);
+    {
+        std::lock_guard lock(m_mutex);
+        m_job = &job;
+        m_count = count;
+        m_next.store(0, std::memory_order_relaxed);
+        ++m_generation;
+    }
+    m_work_cv.notify_all();
+    run(job, count);
+
+    // A worker that wakes up after this sees no job, so none can outlive the call.
+    std::unique_lock lock(m_mutex);
+    m_done_cv.wait(lock, [this] { return m_busy == 0; });
+    m_job = nullptr;
+}
+
+void WorkerPool::submit(Task task) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_work_cv.notify_one();
+}
+
+void WorkerPool::run(const Job &job, uint32_t count) {
+    for (uint32_t i = m_next.fetch_add(1, std::memory_order_relaxed); i < count;
+         i = m_next.fetch_add(1, std::memory_order_relaxed)) {
+        job(i);
+    }
+}
+
+void WorkerPool::worker_loop() {
+    uint64_t seen = 0;
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        m_work_cv.wait(lock, [this, seen] {
+            return !m_running || m_generation != seen || (!m_tasks.empty() && m_background < m_max_background);
+        });
+        if (!m_running) {
+            return;
+        }
+        // A parallel_for is waited on by the frame, so it goes before the background tasks.
+        if (m_generation == seen) {
+            Task task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            ++m_background;
+            lock.unlock();
+            task();
+            lock.lock();
+            --m_background;
+            // The limit may have kept other workers from taking the next task.
+            if (!m_tasks.empty()) {
+                m_work_cv.notify_one();
+            }
+            continue;
+        }
+        seen = m_generation;
+        if (!m_job) {
+            continue;
+        }
+        const Job *job = m_job;
+        const uint32_t count = m_count;
+        ++m_busy;
+        lock.unlock();
+        run(*job, count);
+        lock.lock();
+        if (--m_busy == 0) {
+            m_done_cv.notify_one();
+        }
+    }
+}
+
+}
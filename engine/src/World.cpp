@@ -0,0 +1,162 @@
+#include <bit>
+#include <mutex>
+#include <engine/core/World.hpp>
+
+namespace engine::core {
+
+/**
+* @brief Sizes of the component types, indexed by their ids. Ids are handed out once per process,
+* possibly from several threads, hence the lock.
+*/
+static std::vector<uint32_t> g_component_sizes;
+static std::mutex g_component_mutex;
+
+uint32_t World::register_component(uint32_t size) {
+    std::lock_guard lock(g_component_mutex);
+    RG_GUARANTEE(g_component_sizes.size() < MAX_COMPONENTS, "A World supports at most {} component types.",
+                 MAX_COMPONENTS);
+    g_component_sizes.push_back(size);
+    return static_cast<uint32_t>(g_component_sizes.size() - 1);
+}
+
+uint32_t World::component_size(uint32_t id) {
+    std::lock_guard lock(g_component_mutex);
+    return g_component_sizes[id];
+}
+
+World::World() {
+    // Entities without components live in the archetype of the empty mask.
+    archetype(0);
+}
+
+uint32_t World::archetype(uint64_t mask) {
+    if (auto it = m_archetype_lookup.find(mask); it != m_archetype_lookup.end()) {
+        return it->second;
+    }
+    Archetype result;
+    result.mask = mask;
+    uint32_t row_bytes = sizeof(Entity);
+    for (uint64_t bits = mask; bits != 0; bits &= bits - 1) {
+        const auto id = static_cast<uint32_t>(std::countr_zero(bits));
+        result.components.push_back(id);
+        result.sizes[id] = component_size(id);
+        row_bytes += result.sizes[id];
+    }
+    // Every column starts aligned to max_align_t, which costs at most that much padding per column.
+    constexpr uint32_t alignment = alignof(std::max_align_t);
+    const auto padding = static_cast<uint32_t>(result.components.size() + 1) * alignment;
+    RG_GUARANTEE(row_bytes + padding <= CHUNK_BYTES, "Components of an entity don't fit into a {} byte chunk.",
+                 CHUNK_BYTES);
+    result.capacity = (CHUNK_BYTES - padding) / row_bytes;
+    uint32_t offset = result.capacity * sizeof(Entity);
+    for (uint32_t id: result.components) {
+        offset = (offset + alignment - 1) & ~(alignment - 1);
+        result.offsets[id] = offset;
+        offset += result.capacity * result.sizes[id];
+    }
+
+    const auto index = static_cast<uint32_t>(m_archetypes.size());
+    m_archetypes.push_back(std::move(result));
+    m_archetype_lookup.emplace(mask, index);
+    return index;
+}
+
+Entity World::create_entity(uint64_t mask) {
+    Entity result;
+    if (m_free_entities.empty()) {
+        result.index = static_cast<uint32_t>(m_records.size());
+        m_records.emplace_back();
+    } else {
+        result.index = m_free_entities.back();
+        m_free_entities.pop_back();
+    }
+    result.generation = m_records[result.index].generation;
+    allocate_row(archetype(mask), result);
+    ++m_size;
+    return result;
+}
+
+void World::destroy(Entity entity) {
+    if (!alive(entity)) {
+        return;
+    }
+    Record &record = m_records[entity.index];
+    free_row(record.archetype, record.chunk, record.row);
+    ++record.generation;
+    m_free_entities.push_back(entity.index);
+    --m_size;
+}
+
+bool World::alive(Entity entity) const {
+    return entity.index < m_records.size() && m_records[entity.index].generation == entity.generation;
+}
+
+void *World::component(Entity entity, uint32_t id) const {
+    RG_GUARANTEE(alive(entity), "Entity {} was destroyed.", entity.index);
+    const Record &record = m_records[entity.index];
+    const Archetype &archetype = m_archetypes[record.archetype];
+    if ((archetype.mask >> id & 1) == 0) {
+        return nullptr;
+    }
+    return archetype.chunks[record.chunk].data.get() + archetype.offsets[id] +
+           static_cast<size_t>(record.row) * archetype.sizes[id];
+}
+
+void World::set_archetype(Entity entity, uint64_t mask) {
+    const Record source = m_records[entity.index];
+    // Creating the archetype can move the others, so they are referenced by index until it exists.
+    const uint32_t target = archetype(mask);
+    allocate_row(target, entity);
+    const Record &moved = m_records[entity.index];
+    const Archetype &from = m_archetypes[source.archetype];
+    const Archetype &to = m_archetypes[target];
+    for (uint32_t id: to.components) {
+        if (from.mask >> id & 1) {
+            const uint32_t size = to.sizes[id];
+            std::memcpy(to.chunks[moved.chunk].data.get() + to.offsets[id] + static_cast<size_t>(moved.row) * size,
+                        from.chunks[source.chunk].data.get() + from.offsets[id] +
+                        static_cast<size_t>(source.row) * size, size);
+        }
+    }
+    // The record points at the new row already, so the moved-in last row doesn't overwrite it.
+    free_row(source.archetype, source.chunk, source.row);
+}
+
+void World::allocate_row(uint32_t archetype, Entity entity) {
+    Archetype &target = m_archetypes[archetype];
+    if (target.chunks.empty() || target.chunks.back().count == target.capacity) {
+        target.chunks.push_back(Chunk{.data = std::make_unique_for_overwrite<std::byte[]>(CHUNK_BYTES)});
+    }
+    Chunk &chunk = target.chunks.back();
+    const uint32_t row = chunk.count++;
+    reinterpret_cast<Entity *>(chunk.data.get())[row] = entity;
+    Record &record = m_records[entity.index];
+    record.archetype = archetype;
+    record.chunk = static_cast<uint32_t>(target.chunks.size() - 1);
+    record.row = row;
+}
+
+void World::free_row(uint32_t archetype, uint32_t chunk, uint32_t row) {
+    Archetype &source = m_archetypes[archetype];
+    Chunk &last = source.chunks.back();
+    const auto last_chunk = static_cast<uint32_t>(source.chunks.size() - 1);
+    const uint32_t last_row = last.count - 1;
+    if (chunk != last_chunk || row != last_row) {
+        std::byte *to = source.chunks[chunk].data.get();
+        const std::byte *from = last.data.get();
+        const Entity moved = reinterpret_cast<const Entity *>(from)[last_row];
+        reinterpret_cast<Entity *>(to)[row] = moved;
+        for (uint32_t id: source.components) {
+            const uint32_t size = source.sizes[id];
+            std::memcpy(to + source.offsets[id] + static_cast<size_t>(row) * size,
+                        from + source.offsets[id] + static_cast<size_t>(last_row) * size, size);
+        }
+        m_records[moved.index].chunk = chunk;
+        m_records[moved.index].row = row;
+    }
+    if (--last.count == 0) {
+        source.chunks.pop_back();
+    }
+}
+
+}
@@ -0,0 +1,17 @@
+#include <engine/core/WorldController.hpp>
+#include <spdlog/spdlog.h>
+
+namespace engine::core {
+
+void WorldController::add_system(std::string name, System system) {
+    spdlog::info("[WorldController]: added system {}", name);
+    m_systems.emplace_back(std::move(name), std::move(system));
+}
+
+void WorldController::update() {
+    for (auto &[name, system]: m_systems) {
+        system(m_world);
+    }
+}
+
+}
@@ -0,0 +1,50 @@
+#include <engine/graphics/GLTrace.hpp>
+#include <engine/util/Errors.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <string>
+
+/**
+ * Replays a trace recorded with `--gl-capture <trace-file>` in a hidden window and prints per-call timings.
+ *
+ * Usage: gl-replay <trace-file> [--top <N>]
+ */
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        spdlog::error("Usage: {} <trace-file> [--top <N>]", argv[0]);
+        return 1;
+    }
+    size_t top = 20;
+    for (int i = 2; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--top") {
+            top = std::stoul(argv[i + 1]);
+        }
+    }
+
+    try {
+        auto report = engine::graphics::GLTraceReplayer::replay(argv[1]);
+
+        for (const auto &frame: report.frames) {
+            spdlog::info("frame {:>4}: {:>7} calls, submit {:>9.3f} ms, finish {:>9.3f} ms", frame.index, frame.calls,
+                         frame.submit_ns / 1e6, frame.finish_ns / 1e6);
+        }
+
+        auto &functions = report.functions;
+        std::erase_if(functions, [](const auto &stats) { return stats.calls == 0; });
+        std::ranges::sort(functions, std::greater{}, &engine::graphics::GLReplayFunctionStats::total_ns);
+        spdlog::info("{:<28} {:>9} {:>12} {:>10} {:>10}", "function", "calls", "total ms", "avg us", "max us");
+        for (size_t i = 0; i < std::min(top, functions.size()); ++i) {
+            const auto &stats = functions[i];
+            spdlog::info("{:<28} {:>9} {:>12.3f} {:>10.3f} {:>10.3f}", stats.name, stats.calls, stats.total_ns / 1e6,
+                         stats.total_ns / 1e3 / static_cast<double>(stats.calls), stats.max_ns / 1e3);
+        }
+        if (report.skipped_calls > 0) {
+            spdlog::warn("{} calls of unsupported functions were skipped.", report.skipped_calls);
+        }
+    } catch (const engine::util::Error &e) {
+        spdlog::error(e.report());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <engine/util/SceneBvh.hpp>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using engine::util::Aabb;
+using engine::util::RayBatch;
+using engine::util::RayHit;
+using engine::util::SceneBvh;
+
+/**
+* @brief Random boxes on an integer grid, so that the axis aligned rays of @ref make_rays start on their faces.
+*/
+static void make_scene(SceneBvh &bvh, uint32_t objects, std::mt19937 &random) {
+    std::uniform_int_distribution<int> position(-100, 100);
+    std::uniform_int_distribution<int> extent(1, 4);
+    for (uint32_t i = 0; i < objects; ++i) {
+        const glm::vec3 min(position(random), position(random), position(random));
+        const glm::vec3 max = min + glm::vec3(extent(random), extent(random), extent(random));
+        bvh.insert(Aabb{min, max}, i);
+    }
+    bvh.build();
+}
+
+/**
+* @brief Rays in groups of 4 pointing into the same octant, as the camera rays of a tile would. Every fourth group is
+* parallel to an axis and starts on the grid, so its other direction components are 0 and its origins lie on faces.
+*/
+static void make_rays(RayBatch &rays, uint32_t count, std::mt19937 &random) {
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+    std::uniform_int_distribution<int> grid(-100, 100);
+    std::uniform_real_distribution<float> spread(0.05f, 1.0f);
+    std::uniform_int_distribution<int> axis(0, 2);
+    std::bernoulli_distribution negative(0.5);
+    for (uint32_t group = 0; rays.size() < count; ++group) {
+        if (group % 4 == 3) {
+            const int along = axis(random);
+            glm::vec3 direction(0.0f);
+            direction[along] = negative(random) ? -1.0f : 1.0f;
+            for (uint32_t ray = 0; ray < 4; ++ray) {
+                glm::vec3 origin(grid(random), grid(random), grid(random));
+                origin[along] = position(random);
+                rays.add(origin, direction);
+            }
+            continue;
+        }
+        const glm::vec3 octant(negative(random) ? -1.0f : 1.0f, negative(random) ? -1.0f : 1.0f,
+                               negative(random) ? -1.0f : 1.0f);
+        const glm::vec3 origin(position(random), position(random), position(random));
+        for (uint32_t ray = 0; ray < 4; ++ray) {
+            const glm::vec3 direction = octant * glm::vec3(spread(random), spread(random), spread(random));
+            rays.add(origin, glm::normalize(direction), 500.0f);
+        }
+    }
+}
+
+/**
+* @returns Number of rays whose batch hit differs from the single ray one. Hits at the same distance are ties,
+* which the two traversals may break differently.
+*/
+static uint32_t check(const SceneBvh &bvh, const RayBatch &rays,
+                      const std::function<bool(uint32_t proxy)> &accept) {
+    std::vector<RayHit> batch;
+    bvh.ray_closest(rays, batch, accept);
+    uint32_t mismatches = 0;
+    for (uint32_t ray = 0; ray < rays.size(); ++ray) {
+        const auto single = bvh.ray_closest(rays.origin(ray), rays.direction(ray), rays.max_distances[ray], accept);
+        const bool same = single ? batch[ray].proxy != SceneBvh::NONE && batch[ray].distance == single->distance
+                                 : batch[ray].proxy == SceneBvh::NONE;
+        if (!same) {
+            if (mismatches++ < 10) {
+                const glm::vec3 origin = rays.origin(ray);
+                const glm::vec3 direction = rays.direction(ray);
+                spdlog::error("ray {} ({}, {}, {}) -> ({}, {}, {}): single {} at {}, batch {} at {}", ray, origin.x,
+                              origin.y, origin.z, direction.x, direction.y, direction.z,
+                              single ? single->proxy : SceneBvh::NONE, single ? single->distance : -1.0f,
+                              batch[ray].proxy, batch[ray].distance);
+            }
+        }
+    }
+    return mismatches;
+}
+
+/**
+* @returns Millions of rays traced per second by `trace`, over `repeat` runs.
+*/
+template<typename Trace>
+static double measure(uint32_t rays, uint32_t repeat, Trace &&trace) {
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < repeat; ++i) {
+        trace();
+    }
+    const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(rays) * repeat / seconds.count() / 1e6;
+}
+
+/**
+ * Checks the packet traversal of SceneBvh::ray_closest against the single ray one on a random scene,
+ * then prints how many rays per second each of them traces.
+ *
+ * Usage: ray-bench [--objects <N>] [--rays <N>] [--repeat <N>] [--seed <N>]
+ */
+int main(int argc, char **argv) {
+    uint32_t objects = 10000;
+    uint32_t count = 1 << 20;
+    uint32_t repeat = 5;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string option(argv[i]);
+        const auto value = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+        if (option == "--objects") {
+            objects = value;
+        } else if (option == "--rays") {
+            count = value;
+        } else if (option == "--repeat") {
+            repeat = value;
+        } else if (option == "--seed") {
+            seed = value;
+        } else {
+            spdlog::error("Usage: {} [--objects <N>] [--rays <N>] [--repeat <N>] [--seed <N>]", argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937 random(seed);
+    SceneBvh bvh;
+    make_scene(bvh, objects, random);
+    RayBatch rays;
+    make_rays(rays, count, random);
+    spdlog::info("{} objects, {} rays, tree cost {:.2f}", bvh.size(), rays.size(), bvh.cost());
+
+    const auto even = [&bvh](uint32_t proxy) { return bvh.user_data(proxy) % 2 == 0; };
+    const uint32_t mismatches = check(bvh, rays, {}) + check(bvh, rays, even);
+    if (mismatches > 0) {
+        spdlog::error("{} rays hit something else in the batch than alone.", mismatches);
+        return 1;
+    }
+    spdlog::info("The batch hits match the single rays.");
+
+    std::vector<RayHit> result(rays.size());
+    const double single = measure(rays.size(), repeat, [&] {
+        for (uint32_t ray = 0; ray < rays.size(); ++ray) {
+            if (auto hit = bvh.ray_closest(rays.origin(ray), rays.direction(ray), rays.max_distances[ray])) {
+                result[ray] = *hit;
+            }
+        }
+    });
+    const double batch = measure(rays.size(), repeat, [&] { bvh.ray_closest(rays, result); });
+    spdlog::info("single rays: {:>8.2f} Mrays/s", single);
+    spdlog::info("batch:       {:>8.2f} Mrays/s ({:.2f}x)", batch, batch / single);
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include <engine/resources/ResourcePack.hpp>
+#include <engine/util/Errors.hpp>
+#include <spdlog/spdlog.h>
+
+#include <string>
+
+/**
+ * Packs a resources directory into a single .rgpak archive that the ResourcesController reads in the pack mode.
+ *
+ * Usage: rg-pack <resources-dir> <output.rgpak> [--lz4]
+ */
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        spdlog::error("Usage: {} <resources-dir> <output.rgpak> [--lz4]", argv[0]);
+        return 1;
+    }
+    bool compress = false;
+    for (int i = 3; i < argc; ++i) {
+        if (std::string(argv[i]) == "--lz4") {
+            compress = true;
+        }
+    }
+
+    try {
+        auto stats = engine::resources::ResourcePack::write(argv[1], argv[2], compress);
+        spdlog::info("Packed {} files ({} LZ4-compressed) from {} into {}: {} bytes stored as {} bytes.", stats.files,
+                     stats.compressed_files, argv[1], argv[2], stats.bytes, stats.stored_bytes);
+    } catch (const engine::util::Error &e) {
+        spdlog::error(e.report());
+        return 1;
+    }
+    return 0;
+}